@@ -1,4 +1,5 @@
 #include "CommonSceneCB.hlsli"
+#include "VertexInput.hlsli"
 
 struct PixelInputType
 {
@@ -21,10 +22,14 @@ struct GBufferOutput
     float4 material : SV_TARGET2;
 };
 
-PixelInputType VSMain(float4 position : POSITION, float2 uv : TEXCOORD, float3 normal : NORMAL, float4 tangent : TANGENT)
+PixelInputType VSMain(float4 packedPosition : POSITION, float2 uv : TEXCOORD, VertexNormal packedNormal : NORMAL, VertexTangent packedTangent : TANGENT)
 {
 	PixelInputType output;
 
+    float4 position = DecodePosition(packedPosition);
+    float3 normal = DecodeNormal(packedNormal);
+    float4 tangent = DecodeTangent(packedTangent, packedPosition);
+
 	output.position = mul(position,mvp);
 	output.uv = uv;
     //Here we multiply the normal by the model matrix, this works because for now the model matrix is only a rotation and translation matrix,
@@ -43,7 +48,10 @@ GBufferOutput PSMain(PixelInputType input)
     float3 N = normalize(input.normal);
     float3 T = normalize(input.tangent.xyz);
     float3 B = cross(N,T) * input.tangent.w;
-    float3 normalTexture = g_normalTexture.Sample(g_sampler, input.uv).xyz * 2.0 - 1.0;
+    // Only x and y are stored (BC5), z is rebuilt from the unit length
+    float3 normalTexture;
+    normalTexture.xy = g_normalTexture.Sample(g_sampler, input.uv).xy * 2.0 - 1.0;
+    normalTexture.z = sqrt(saturate(1.0 - dot(normalTexture.xy, normalTexture.xy)));
     normalTexture.y = -normalTexture.y;
     float3 convertedNormal = normalize(mul(normalTexture, float3x3(T, B, N)));
     output.normal = float4(convertedNormal, 0.0);
@@ -6,8 +6,13 @@ Texture2D rt_material : register(t2);
 Texture2D rt_depth : register(t3);
 Texture2D g_brdfLUT : register(t4);
 Texture2D g_shadowMap : register(t5);
-TextureCube g_irradianceMap : register(t6);
-TextureCube g_prefilterMap : register(t7);
+TextureCube g_prefilterMap : register(t6);
+
+// Irradiance / PI as 9 SH coefficients per channel, the cosine lobe and the basis constants are folded in on the CPU
+cbuffer IrradianceCB : register(b1)
+{
+    float4 irradianceSH[9];
+};
 
 SamplerState g_sampler : register(s0);
 SamplerComparisonState g_shadowSampler : register(s1);
@@ -66,6 +71,15 @@ float3 SchlickFresnelRoughness(float cosT, float3 f0, float rough)
     return f0 + (ceil - f0) * pow(1.0 - cosT, 5.0);
 }
 
+float3 EvaluateIrradianceSH(float3 n)
+{
+    float3 irradiance = irradianceSH[0].rgb
+        + irradianceSH[1].rgb * n.y + irradianceSH[2].rgb * n.z + irradianceSH[3].rgb * n.x
+        + irradianceSH[4].rgb * (n.x * n.y) + irradianceSH[5].rgb * (n.y * n.z) + irradianceSH[6].rgb * (3.0 * n.z * n.z - 1.0)
+        + irradianceSH[7].rgb * (n.x * n.z) + irradianceSH[8].rgb * (n.x * n.x - n.y * n.y);
+    return max(irradiance, 0.0);
+}
+
 float3 ACESFilm(float3 x)
 {
     const float a = 2.51, b = 0.03, c = 2.43, d = 0.59, e = 0.14;
@@ -158,7 +172,7 @@ float4 PSMain(PSIn input): SV_TARGET
     F0 = lerp(F0, albedo, metallic);
 
     // IBL
-    float3 irradiance = g_irradianceMap.SampleLevel(g_sampler, normal, 0).rgb;
+    float3 irradiance = EvaluateIrradianceSH(normal);
 
     // Cook-Torrance specular
     float NDF = NormalDistribution(normal, hVector, roughness * roughness);
@@ -1,4 +1,5 @@
 #include "CommonSceneCB.hlsli"
+#include "VertexInput.hlsli"
 
 struct PixelInputType
 {
@@ -15,11 +16,11 @@ struct GBufferOutput
     float4 material : SV_TARGET2;
 };
 
-PixelInputType VSMain(float4 position : POSITION, float3 normal : NORMAL)
+PixelInputType VSMain(float4 packedPosition : POSITION, VertexNormal packedNormal : NORMAL)
 {
     PixelInputType output;
-    output.position = mul(position, mvp);
-    output.normal = normal;
+    output.position = mul(DecodePosition(packedPosition), mvp);
+    output.normal = DecodeNormal(packedNormal);
     return output;
 }
 
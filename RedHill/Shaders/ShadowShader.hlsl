@@ -1,13 +1,14 @@
 #include "CommonSceneCB.hlsli"
+#include "VertexInput.hlsli"
 
 struct PixelInputType
 {
     float4 position : SV_POSITION;
 };
 
-PixelInputType VSMain(float4 position : POSITION)
+PixelInputType VSMain(float4 packedPosition : POSITION)
 {
     PixelInputType output;
-    output.position = mul(position, lightVP);
+    output.position = mul(DecodePosition(packedPosition), lightVP);
     return output;
 }
\ No newline at end of file
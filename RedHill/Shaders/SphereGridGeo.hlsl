@@ -1,4 +1,5 @@
 #include "CommonSceneCB.hlsli"
+#include "VertexInput.hlsli"
 
 struct PixelInputType
 {
@@ -8,10 +9,16 @@ struct PixelInputType
 };
 
 static float3 g_color = float3(1.0, 0.7, 0.25);
-static float g_offset[5] = { 5.0, 2.5, 0.0, -2.5, -5.0 };
+static float g_offset[5] = { 5.0, 2.5, 0.0, -2.5, -5.0 }; // Has to match kSphereGridOffsets in Renderer.cpp
 static float g_metallic[5] = { 0.0, 0.25, 0.5, 0.75, 1.0 };
 static float g_roughness[5] = { 1.0, 0.75, 0.5, 0.25, 0.05 };
 
+// Spheres are drawn one at a time with their own level of detail
+cbuffer InstanceConstants : register(b2)
+{
+    uint instanceOffset;
+};
+
 struct GBufferOutput
 {
     float4 albedo : SV_TARGET0;
@@ -19,11 +26,14 @@ struct GBufferOutput
     float4 material : SV_TARGET2;
 };
 
-PixelInputType VSMain(float4 position : POSITION,  float3 normal : NORMAL, uint instanceID : SV_InstanceID)
+PixelInputType VSMain(float4 packedPosition : POSITION, VertexNormal packedNormal : NORMAL, uint instanceID : SV_InstanceID)
 {
     PixelInputType output;
-    uint col = instanceID % 5;
-    uint row = instanceID / 5;
+    float4 position = DecodePosition(packedPosition);
+    float3 normal = DecodeNormal(packedNormal);
+    uint instance = instanceID + instanceOffset;
+    uint col = instance % 5;
+    uint row = instance / 5;
     float xOffset = g_offset[col];
     float zOffset = g_offset[row];
 
@@ -0,0 +1,63 @@
+// Decoding of the mesh vertex attributes.
+// With PACKED_VERTEX the input assembler reads the 20 byte PackedVertex layout (Model.h): position as unorm16 against
+// the mesh bounds (tangent sign in w), uv as half floats and normal/tangent as octahedral snorm16. Without it the
+// attributes come in as floats and these functions just pass them through.
+
+#ifdef PACKED_VERTEX
+
+#define VertexNormal float2
+#define VertexTangent float2
+
+cbuffer VertexDequantization : register(b1)
+{
+    float3 positionOffset;
+    float padding0;
+    float3 positionScale;
+    float padding1;
+};
+
+float3 OctDecode(float2 e)
+{
+    float3 n = float3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+float4 DecodePosition(float4 position)
+{
+    return float4(positionOffset + position.xyz * positionScale, 1.0);
+}
+
+float3 DecodeNormal(float2 normal)
+{
+    return OctDecode(normal);
+}
+
+float4 DecodeTangent(float2 tangent, float4 position)
+{
+    return float4(OctDecode(tangent), position.w * 2.0 - 1.0);
+}
+
+#else
+
+#define VertexNormal float3
+#define VertexTangent float4
+
+float4 DecodePosition(float4 position)
+{
+    return position;
+}
+
+float3 DecodeNormal(float3 normal)
+{
+    return normal;
+}
+
+float4 DecodeTangent(float4 tangent, float4 position)
+{
+    return tangent;
+}
+
+#endif
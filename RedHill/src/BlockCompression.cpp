@@ -0,0 +1,783 @@
+#include "BlockCompression.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <emmintrin.h>
+#include <xmmintrin.h>
+
+#include "JobSystem.h"
+
+// Block rows are handed to the jobs in batches of at least this many blocks
+static constexpr uint32_t kMinBatchBlocks = 256;
+
+// Endpoint refinement rounds after the principal axis fit
+static constexpr uint32_t kRefineIterations = 2;
+
+// BC7 interpolation weights of the 4 bit indices (out of 64), symmetric: weight[15 - i] == 64 - weight[i]
+static constexpr uint32_t kBc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+// 4x4 pixels with one array of 16 values per channel, so the index search loads 4 pixels of a channel at once
+struct BlockPixels
+{
+	alignas(16) float channel[4][16];
+};
+
+uint32_t BlockBytes(const BlockFormat format)
+{
+	return (format == BlockFormat::BC1 || format == BlockFormat::BC4) ? 8 : 16;
+}
+
+// Edge blocks of levels that aren't a multiple of 4 repeat the last row / column
+static void LoadBlock(const MipLevel& level, const uint32_t blockX, const uint32_t blockY, BlockPixels& block)
+{
+	if (blockX * 4 + 4 <= level.width && blockY * 4 + 4 <= level.height)
+	{
+		// Whole block: widen every row of 4 pixels to floats and transpose it into the channel arrays
+		const __m128i zero = _mm_setzero_si128();
+		for (uint32_t y = 0; y < 4; ++y)
+		{
+			const uint8_t* row = level.pixels + (static_cast<size_t>(blockY * 4 + y) * level.width + blockX * 4) * 4;
+			const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row));
+			const __m128i low = _mm_unpacklo_epi8(pixels, zero);
+			const __m128i high = _mm_unpackhi_epi8(pixels, zero);
+			__m128 p0 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero));
+			__m128 p1 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero));
+			__m128 p2 = _mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero));
+			__m128 p3 = _mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero));
+			_MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+			_mm_store_ps(block.channel[0] + y * 4, p0);
+			_mm_store_ps(block.channel[1] + y * 4, p1);
+			_mm_store_ps(block.channel[2] + y * 4, p2);
+			_mm_store_ps(block.channel[3] + y * 4, p3);
+		}
+		return;
+	}
+
+	for (uint32_t y = 0; y < 4; ++y)
+	{
+		const uint32_t sy = (std::min)(blockY * 4 + y, level.height - 1);
+		for (uint32_t x = 0; x < 4; ++x)
+		{
+			const uint32_t sx = (std::min)(blockX * 4 + x, level.width - 1);
+			const uint8_t* pixel = level.pixels + (static_cast<size_t>(sy) * level.width + sx) * 4;
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				block.channel[c][y * 4 + x] = pixel[c];
+			}
+		}
+	}
+}
+
+// Endpoints of the segment that covers the block along its principal axis (first channelCount channels)
+static void FitPrincipalAxis(const BlockPixels& block, const uint32_t channelCount, float e0[4], float e1[4])
+{
+	float mean[4] = {};
+	float minValue[4] = { 255.0f, 255.0f, 255.0f, 255.0f };
+	float maxValue[4] = {};
+	for (uint32_t c = 0; c < channelCount; ++c)
+	{
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			mean[c] += block.channel[c][i];
+			minValue[c] = (std::min)(minValue[c], block.channel[c][i]);
+			maxValue[c] = (std::max)(maxValue[c], block.channel[c][i]);
+		}
+		mean[c] /= 16.0f;
+	}
+
+	float covariance[4][4] = {};
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		for (uint32_t a = 0; a < channelCount; ++a)
+		{
+			for (uint32_t b = a; b < channelCount; ++b)
+			{
+				covariance[a][b] += (block.channel[a][i] - mean[a]) * (block.channel[b][i] - mean[b]);
+			}
+		}
+	}
+	for (uint32_t a = 0; a < channelCount; ++a)
+	{
+		for (uint32_t b = 0; b < a; ++b)
+		{
+			covariance[a][b] = covariance[b][a];
+		}
+	}
+
+	// Power iteration from the bounding box diagonal
+	float axis[4] = {};
+	float length = 0.0f;
+	for (uint32_t c = 0; c < channelCount; ++c)
+	{
+		axis[c] = maxValue[c] - minValue[c];
+		length += axis[c] * axis[c];
+	}
+	if (length == 0.0f)
+	{
+		std::copy(mean, mean + 4, e0);
+		std::copy(mean, mean + 4, e1);
+		return;
+	}
+
+	for (uint32_t iteration = 0; iteration < 8; ++iteration)
+	{
+		float next[4] = {};
+		for (uint32_t a = 0; a < channelCount; ++a)
+		{
+			for (uint32_t b = 0; b < channelCount; ++b)
+			{
+				next[a] += covariance[a][b] * axis[b];
+			}
+		}
+
+		float nextLength = 0.0f;
+		for (uint32_t c = 0; c < channelCount; ++c)
+		{
+			nextLength += next[c] * next[c];
+		}
+		if (nextLength < 1e-12f)
+		{
+			break;
+		}
+
+		const float invLength = 1.0f / std::sqrt(nextLength);
+		for (uint32_t c = 0; c < channelCount; ++c)
+		{
+			axis[c] = next[c] * invLength;
+		}
+	}
+
+	float axisLength = 0.0f;
+	for (uint32_t c = 0; c < channelCount; ++c)
+	{
+		axisLength += axis[c] * axis[c];
+	}
+	const float invAxisLength = 1.0f / std::sqrt(axisLength);
+
+	float tMin = FLT_MAX;
+	float tMax = -FLT_MAX;
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		float t = 0.0f;
+		for (uint32_t c = 0; c < channelCount; ++c)
+		{
+			t += (block.channel[c][i] - mean[c]) * axis[c] * invAxisLength;
+		}
+		tMin = (std::min)(tMin, t);
+		tMax = (std::max)(tMax, t);
+	}
+
+	for (uint32_t c = 0; c < 4; ++c)
+	{
+		const float direction = c < channelCount ? axis[c] * invAxisLength : 0.0f;
+		e0[c] = std::clamp(mean[c] + tMin * direction, 0.0f, 255.0f);
+		e1[c] = std::clamp(mean[c] + tMax * direction, 0.0f, 255.0f);
+	}
+}
+
+// Nearest of levelCount evenly spaced points from e0 to e1 for every pixel, 4 pixels per iteration
+static void ProjectIndices(const BlockPixels& block, const uint32_t channelCount, const float e0[4], const float e1[4], const uint32_t levelCount, uint8_t indices[16])
+{
+	float direction[4] = {};
+	float length = 0.0f;
+	for (uint32_t c = 0; c < channelCount; ++c)
+	{
+		direction[c] = e1[c] - e0[c];
+		length += direction[c] * direction[c];
+	}
+	if (length < 1e-6f)
+	{
+		std::memset(indices, 0, 16);
+		return;
+	}
+
+	const float scale = (levelCount - 1) / length;
+	const __m128 maxIndex = _mm_set1_ps(static_cast<float>(levelCount - 1));
+	for (uint32_t i = 0; i < 16; i += 4)
+	{
+		__m128 t = _mm_setzero_ps();
+		for (uint32_t c = 0; c < channelCount; ++c)
+		{
+			const __m128 offset = _mm_sub_ps(_mm_load_ps(block.channel[c] + i), _mm_set1_ps(e0[c]));
+			t = _mm_add_ps(t, _mm_mul_ps(offset, _mm_set1_ps(direction[c] * scale)));
+		}
+		t = _mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), maxIndex);
+
+		alignas(16) int32_t rounded[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(rounded), _mm_cvtps_epi32(t));
+		for (uint32_t k = 0; k < 4; ++k)
+		{
+			indices[i + k] = static_cast<uint8_t>(rounded[k]);
+		}
+	}
+}
+
+// Least squares endpoints for the given indices, weights[index] is the position of the index on the segment (0 to 1)
+static bool RefineEndpoints(const BlockPixels& block, const uint32_t channelCount, const uint8_t indices[16], const float* weights, float e0[4], float e1[4])
+{
+	float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+	float ax[4] = {}, bx[4] = {};
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		const float b = weights[indices[i]];
+		const float a = 1.0f - b;
+		aa += a * a;
+		ab += a * b;
+		bb += b * b;
+		for (uint32_t c = 0; c < channelCount; ++c)
+		{
+			ax[c] += a * block.channel[c][i];
+			bx[c] += b * block.channel[c][i];
+		}
+	}
+
+	const float determinant = aa * bb - ab * ab;
+	if (std::fabs(determinant) < 1e-6f)
+	{
+		return false;
+	}
+
+	const float invDeterminant = 1.0f / determinant;
+	for (uint32_t c = 0; c < channelCount; ++c)
+	{
+		e0[c] = std::clamp((bb * ax[c] - ab * bx[c]) * invDeterminant, 0.0f, 255.0f);
+		e1[c] = std::clamp((aa * bx[c] - ab * ax[c]) * invDeterminant, 0.0f, 255.0f);
+	}
+	return true;
+}
+
+// Sets count bits at a time from bit 0 of the block up, like the BC7 layout is specified
+struct BlockBitWriter
+{
+	uint8_t* block;
+	uint32_t cursor = 0;
+
+	void Write(uint32_t value, const uint32_t count)
+	{
+		for (uint32_t i = 0; i < count; ++i, ++cursor, value >>= 1)
+		{
+			block[cursor >> 3] |= static_cast<uint8_t>((value & 1) << (cursor & 7));
+		}
+	}
+};
+
+struct BlockBitReader
+{
+	const uint8_t* block;
+	uint32_t cursor = 0;
+
+	uint32_t Read(const uint32_t count)
+	{
+		uint32_t value = 0;
+		for (uint32_t i = 0; i < count; ++i, ++cursor)
+		{
+			value |= ((block[cursor >> 3] >> (cursor & 7)) & 1u) << i;
+		}
+		return value;
+	}
+};
+
+static uint16_t To565(const float color[4])
+{
+	const uint32_t r = static_cast<uint32_t>(color[0] * 31.0f / 255.0f + 0.5f);
+	const uint32_t g = static_cast<uint32_t>(color[1] * 63.0f / 255.0f + 0.5f);
+	const uint32_t b = static_cast<uint32_t>(color[2] * 31.0f / 255.0f + 0.5f);
+	return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+static void From565(const uint16_t packed, uint32_t color[3])
+{
+	const uint32_t r = (packed >> 11) & 31;
+	const uint32_t g = (packed >> 5) & 63;
+	const uint32_t b = packed & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+static void EncodeBc1(const BlockPixels& block, uint8_t* out)
+{
+	static constexpr float kWeights[4] = { 0.0f, 1.0f / 3.0f, 2.0f / 3.0f, 1.0f };
+
+	float e0[4], e1[4];
+	FitPrincipalAxis(block, 3, e0, e1);
+
+	float bestError = FLT_MAX;
+	uint16_t bestColors[2] = {};
+	uint8_t bestIndices[16] = {};
+	for (uint32_t iteration = 0; iteration <= kRefineIterations; ++iteration)
+	{
+		// Evaluate the quantized endpoints, index 1 and 2 are the thirds along the segment
+		const uint16_t colors[2] = { To565(e0), To565(e1) };
+		uint32_t c0[3], c1[3];
+		From565(colors[0], c0);
+		From565(colors[1], c1);
+		const float q0[4] = { static_cast<float>(c0[0]), static_cast<float>(c0[1]), static_cast<float>(c0[2]), 0.0f };
+		const float q1[4] = { static_cast<float>(c1[0]), static_cast<float>(c1[1]), static_cast<float>(c1[2]), 0.0f };
+
+		uint8_t indices[16];
+		ProjectIndices(block, 3, q0, q1, 4, indices);
+
+		float palette[4][3];
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			palette[0][c] = static_cast<float>(c0[c]);
+			palette[1][c] = static_cast<float>((2 * c0[c] + c1[c]) / 3);
+			palette[2][c] = static_cast<float>((c0[c] + 2 * c1[c]) / 3);
+			palette[3][c] = static_cast<float>(c1[c]);
+		}
+
+		float error = 0.0f;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				const float d = palette[indices[i]][c] - block.channel[c][i];
+				error += d * d;
+			}
+		}
+
+		if (error < bestError)
+		{
+			bestError = error;
+			bestColors[0] = colors[0];
+			bestColors[1] = colors[1];
+			std::memcpy(bestIndices, indices, 16);
+		}
+
+		if (bestError == 0.0f || iteration == kRefineIterations || !RefineEndpoints(block, 3, indices, kWeights, e0, e1))
+		{
+			break;
+		}
+	}
+
+	// Four color mode needs color0 > color1, equal endpoints leave every index at 0
+	uint16_t color0 = bestColors[0];
+	uint16_t color1 = bestColors[1];
+	if (color0 < color1)
+	{
+		std::swap(color0, color1);
+		for (uint8_t& index : bestIndices)
+		{
+			index = static_cast<uint8_t>(3 - index);
+		}
+	}
+
+	static constexpr uint32_t kCodes[4] = { 0, 2, 3, 1 };
+	uint32_t indexBits = 0;
+	if (color0 != color1)
+	{
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			indexBits |= kCodes[bestIndices[i]] << (i * 2);
+		}
+	}
+
+	std::memcpy(out, &color0, 2);
+	std::memcpy(out + 2, &color1, 2);
+	std::memcpy(out + 4, &indexBits, 4);
+}
+
+// One channel of the block in channel 0
+static void EncodeBc4(const BlockPixels& block, uint8_t* out)
+{
+	static constexpr float kWeights[8] = { 0.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f, 1.0f };
+
+	float e0[4] = { 255.0f }, e1[4] = { 0.0f };
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		e0[0] = (std::min)(e0[0], block.channel[0][i]);
+		e1[0] = (std::max)(e1[0], block.channel[0][i]);
+	}
+
+	float bestError = FLT_MAX;
+	uint8_t bestValues[2] = {};
+	uint8_t bestIndices[16] = {};
+	for (uint32_t iteration = 0; iteration <= kRefineIterations; ++iteration)
+	{
+		const uint8_t values[2] = { static_cast<uint8_t>(e0[0] + 0.5f), static_cast<uint8_t>(e1[0] + 0.5f) };
+		const float q0[4] = { static_cast<float>(values[0]) };
+		const float q1[4] = { static_cast<float>(values[1]) };
+
+		uint8_t indices[16];
+		ProjectIndices(block, 1, q0, q1, 8, indices);
+
+		float error = 0.0f;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const float d = q0[0] + (q1[0] - q0[0]) * kWeights[indices[i]] - block.channel[0][i];
+			error += d * d;
+		}
+
+		if (error < bestError)
+		{
+			bestError = error;
+			bestValues[0] = values[0];
+			bestValues[1] = values[1];
+			std::memcpy(bestIndices, indices, 16);
+		}
+
+		if (bestError == 0.0f || iteration == kRefineIterations || !RefineEndpoints(block, 1, indices, kWeights, e0, e1))
+		{
+			break;
+		}
+	}
+
+	// Eight value mode needs red0 > red1, code 0 and 1 are the endpoints and 2..7 the steps from red0 to red1
+	uint8_t red0 = bestValues[0];
+	uint8_t red1 = bestValues[1];
+	if (red0 < red1)
+	{
+		std::swap(red0, red1);
+		for (uint8_t& index : bestIndices)
+		{
+			index = static_cast<uint8_t>(7 - index);
+		}
+	}
+
+	uint64_t indexBits = 0;
+	if (red0 != red1)
+	{
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const uint64_t code = bestIndices[i] == 0 ? 0 : (bestIndices[i] == 7 ? 1 : bestIndices[i] + 1);
+			indexBits |= code << (i * 3);
+		}
+	}
+
+	out[0] = red0;
+	out[1] = red1;
+	std::memcpy(out + 2, &indexBits, 6);
+}
+
+// Mode 6: 7 bit RGBA endpoints with one p-bit each, 4 bit indices
+static void EncodeBc7(const BlockPixels& block, uint8_t* out)
+{
+	float weights[16];
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		weights[i] = kBc7Weights[i] / 64.0f;
+	}
+
+	float e0[4], e1[4];
+	FitPrincipalAxis(block, 4, e0, e1);
+
+	float bestError = FLT_MAX;
+	uint32_t bestEndpoints[2][4] = {};
+	uint32_t bestPBits[2] = {};
+	uint8_t bestIndices[16] = {};
+	for (uint32_t iteration = 0; iteration <= kRefineIterations; ++iteration)
+	{
+		// The p-bit is the shared low bit of the 8 bit endpoint, each endpoint takes the one that rounds it closer
+		const float* endpoints[2] = { e0, e1 };
+		uint32_t p[2];
+		uint32_t quantized[2][4];
+		float q[2][4];
+		for (uint32_t e = 0; e < 2; ++e)
+		{
+			float roundingError[2] = {};
+			uint32_t candidates[2][4];
+			for (uint32_t pBit = 0; pBit < 2; ++pBit)
+			{
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					candidates[pBit][c] = static_cast<uint32_t>(std::clamp((endpoints[e][c] - pBit) * 0.5f + 0.5f, 0.0f, 127.0f));
+					const float d = static_cast<float>((candidates[pBit][c] << 1) | pBit) - endpoints[e][c];
+					roundingError[pBit] += d * d;
+				}
+			}
+
+			p[e] = roundingError[1] < roundingError[0] ? 1 : 0;
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				quantized[e][c] = candidates[p[e]][c];
+				q[e][c] = static_cast<float>((quantized[e][c] << 1) | p[e]);
+			}
+		}
+
+		uint8_t indices[16];
+		ProjectIndices(block, 4, q[0], q[1], 16, indices);
+
+		float error = 0.0f;
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const uint32_t w = kBc7Weights[indices[i]];
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				const uint32_t value = ((64 - w) * static_cast<uint32_t>(q[0][c]) + w * static_cast<uint32_t>(q[1][c]) + 32) >> 6;
+				const float d = static_cast<float>(value) - block.channel[c][i];
+				error += d * d;
+			}
+		}
+
+		if (error < bestError)
+		{
+			bestError = error;
+			std::memcpy(bestEndpoints, quantized, sizeof(quantized));
+			bestPBits[0] = p[0];
+			bestPBits[1] = p[1];
+			std::memcpy(bestIndices, indices, 16);
+		}
+
+		if (bestError == 0.0f || iteration == kRefineIterations || !RefineEndpoints(block, 4, indices, weights, e0, e1))
+		{
+			break;
+		}
+	}
+
+	// The MSB of the first index is implicit 0, swap the endpoints if it is set
+	if (bestIndices[0] >= 8)
+	{
+		std::swap(bestEndpoints[0], bestEndpoints[1]);
+		std::swap(bestPBits[0], bestPBits[1]);
+		for (uint8_t& index : bestIndices)
+		{
+			index = static_cast<uint8_t>(15 - index);
+		}
+	}
+
+	std::memset(out, 0, 16);
+	BlockBitWriter writer{ out };
+	writer.Write(1u << 6, 7);
+	for (uint32_t c = 0; c < 4; ++c)
+	{
+		writer.Write(bestEndpoints[0][c], 7);
+		writer.Write(bestEndpoints[1][c], 7);
+	}
+	writer.Write(bestPBits[0], 1);
+	writer.Write(bestPBits[1], 1);
+	writer.Write(bestIndices[0], 3);
+	for (uint32_t i = 1; i < 16; ++i)
+	{
+		writer.Write(bestIndices[i], 4);
+	}
+}
+
+static void EncodeBlock(const BlockFormat format, BlockPixels& block, uint8_t* out)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1:
+		EncodeBc1(block, out);
+		break;
+	case BlockFormat::BC4:
+		EncodeBc4(block, out);
+		break;
+	case BlockFormat::BC5:
+		EncodeBc4(block, out);
+		std::memcpy(block.channel[0], block.channel[1], sizeof(block.channel[0]));
+		EncodeBc4(block, out + 8);
+		break;
+	case BlockFormat::BC7:
+		EncodeBc7(block, out);
+		break;
+	}
+}
+
+CompressedTexture CompressMipChain(const MipChain& chain, const BlockFormat format)
+{
+	CompressedTexture texture;
+	texture.format = format;
+	texture.levels.resize(chain.levels.size());
+
+	const uint32_t blockBytes = BlockBytes(format);
+	size_t storageSize = 0;
+	for (const MipLevel& level : chain.levels)
+	{
+		storageSize += static_cast<size_t>((level.width + 3) / 4) * ((level.height + 3) / 4) * blockBytes;
+	}
+	texture.storage.resize(storageSize);
+
+	JobSystem& jobs = JobSystem::Get();
+	size_t offset = 0;
+	for (size_t i = 0; i < chain.levels.size(); ++i)
+	{
+		const MipLevel& source = chain.levels[i];
+		CompressedLevel& level = texture.levels[i];
+		const uint32_t blocksWide = (source.width + 3) / 4;
+		uint8_t* blocks = texture.storage.data() + offset;
+		level = { blocks, source.width, source.height, blocksWide * blockBytes, (source.height + 3) / 4 };
+		offset += static_cast<size_t>(level.rowPitch) * level.blockRows;
+
+		const uint32_t grain = (std::max)(1u, kMinBatchBlocks / blocksWide);
+		jobs.ParallelFor(level.blockRows, grain, [&](const size_t blockY)
+		{
+			BlockPixels block;
+			for (uint32_t blockX = 0; blockX < blocksWide; ++blockX)
+			{
+				LoadBlock(source, blockX, static_cast<uint32_t>(blockY), block);
+				EncodeBlock(format, block, blocks + blockY * level.rowPitch + blockX * blockBytes);
+			}
+		});
+	}
+
+	return texture;
+}
+
+static void DecompressBc4(const uint8_t* block, uint8_t values[16])
+{
+	const uint32_t red0 = block[0];
+	const uint32_t red1 = block[1];
+	float palette[8] = { static_cast<float>(red0), static_cast<float>(red1) };
+	if (red0 > red1)
+	{
+		for (uint32_t i = 1; i < 7; ++i)
+		{
+			palette[i + 1] = ((7 - i) * red0 + i * red1) / 7.0f;
+		}
+	}
+	else
+	{
+		for (uint32_t i = 1; i < 5; ++i)
+		{
+			palette[i + 1] = ((5 - i) * red0 + i * red1) / 5.0f;
+		}
+		palette[6] = 0.0f;
+		palette[7] = 255.0f;
+	}
+
+	uint64_t indexBits = 0;
+	std::memcpy(&indexBits, block + 2, 6);
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		values[i] = static_cast<uint8_t>(palette[(indexBits >> (i * 3)) & 7] + 0.5f);
+	}
+}
+
+void DecompressBlock(const BlockFormat format, const uint8_t* block, uint8_t rgba[64])
+{
+	std::memset(rgba, 0, 64);
+	for (uint32_t i = 0; i < 16; ++i)
+	{
+		rgba[i * 4 + 3] = 255;
+	}
+
+	switch (format)
+	{
+	case BlockFormat::BC1:
+	{
+		uint16_t color0, color1;
+		uint32_t indexBits;
+		std::memcpy(&color0, block, 2);
+		std::memcpy(&color1, block + 2, 2);
+		std::memcpy(&indexBits, block + 4, 4);
+
+		uint32_t palette[4][4] = {};
+		From565(color0, palette[0]);
+		From565(color1, palette[1]);
+		palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			if (color0 > color1)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+			else
+			{
+				palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+				palette[3][c] = 0;
+			}
+		}
+		if (color0 <= color1)
+		{
+			palette[3][3] = 0;
+		}
+
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const uint32_t code = (indexBits >> (i * 2)) & 3;
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				rgba[i * 4 + c] = static_cast<uint8_t>(palette[code][c]);
+			}
+		}
+		break;
+	}
+	case BlockFormat::BC4:
+	case BlockFormat::BC5:
+	{
+		uint8_t values[16];
+		DecompressBc4(block, values);
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			rgba[i * 4] = values[i];
+		}
+		if (format == BlockFormat::BC5)
+		{
+			DecompressBc4(block + 8, values);
+			for (uint32_t i = 0; i < 16; ++i)
+			{
+				rgba[i * 4 + 1] = values[i];
+			}
+		}
+		break;
+	}
+	case BlockFormat::BC7:
+	{
+		// Only mode 6 is decoded since it is the only one the encoder writes, other modes come out black
+		BlockBitReader reader{ block };
+		if (reader.Read(7) != (1u << 6))
+		{
+			break;
+		}
+
+		uint32_t endpoints[2][4];
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			endpoints[0][c] = reader.Read(7) << 1;
+			endpoints[1][c] = reader.Read(7) << 1;
+		}
+		const uint32_t p0 = reader.Read(1);
+		const uint32_t p1 = reader.Read(1);
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			endpoints[0][c] |= p0;
+			endpoints[1][c] |= p1;
+		}
+
+		for (uint32_t i = 0; i < 16; ++i)
+		{
+			const uint32_t w = kBc7Weights[reader.Read(i == 0 ? 3 : 4)];
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				rgba[i * 4 + c] = static_cast<uint8_t>(((64 - w) * endpoints[0][c] + w * endpoints[1][c] + 32) >> 6);
+			}
+		}
+		break;
+	}
+	}
+}
+
+float MeasurePsnr(const MipLevel& source, const CompressedLevel& level, const BlockFormat format)
+{
+	const uint32_t channelCount = format == BlockFormat::BC1 ? 3 : (format == BlockFormat::BC4 ? 1 : (format == BlockFormat::BC5 ? 2 : 4));
+	const uint32_t blockBytes = BlockBytes(format);
+
+	double squaredError = 0.0;
+	for (uint32_t y = 0; y < source.height; y += 4)
+	{
+		for (uint32_t x = 0; x < source.width; x += 4)
+		{
+			uint8_t decoded[64];
+			DecompressBlock(format, level.blocks + (y / 4) * level.rowPitch + (x / 4) * blockBytes, decoded);
+			for (uint32_t py = 0; py < 4 && y + py < source.height; ++py)
+			{
+				for (uint32_t px = 0; px < 4 && x + px < source.width; ++px)
+				{
+					const uint8_t* original = source.pixels + (static_cast<size_t>(y + py) * source.width + x + px) * 4;
+					for (uint32_t c = 0; c < channelCount; ++c)
+					{
+						const double d = static_cast<double>(decoded[(py * 4 + px) * 4 + c]) - original[c];
+						squaredError += d * d;
+					}
+				}
+			}
+		}
+	}
+
+	const double meanError = squaredError / (static_cast<double>(source.width) * source.height * channelCount);
+	return meanError > 0.0 ? static_cast<float>(10.0 * std::log10(255.0 * 255.0 / meanError)) : 99.0f;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "MipGenerator.h"
+
+// Block compressed formats of the material textures:
+// - BC1: RGB 565 endpoints, 4 colors per 4x4 block (8 bytes)
+// - BC4: one channel, 8 levels per block (8 bytes)
+// - BC5: two BC4 blocks for the red and green channels (16 bytes), the normal maps, z is rebuilt in the shader
+// - BC7: RGBA, only mode 6 is used (one subset, 7 bit endpoints with a p-bit, 16 levels) (16 bytes)
+enum class BlockFormat : uint32_t
+{
+	BC1,
+	BC4,
+	BC5,
+	BC7
+};
+
+uint32_t BlockBytes(BlockFormat format);
+
+// One level of a compressed mip chain, rows of blocks tightly packed. Levels under 4x4 still take a whole block.
+struct CompressedLevel
+{
+	const uint8_t* blocks = nullptr;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t rowPitch = 0;	// Bytes per row of blocks
+	uint32_t blockRows = 0;
+};
+
+struct CompressedTexture
+{
+	BlockFormat format = BlockFormat::BC7;
+	std::vector<uint8_t> storage;
+	std::vector<CompressedLevel> levels;
+};
+
+// Compresses every level of the chain. The blocks of each level are split over the job system. The endpoints come
+// from the principal axis of the block, refined twice by least squares on the chosen indices, the index search
+// runs 4 pixels at a time with SSE.
+CompressedTexture CompressMipChain(const MipChain& chain, BlockFormat format);
+
+// Decodes one block to 16 RGBA8 pixels the way the GPU does (unused channels are 0, alpha 255)
+void DecompressBlock(BlockFormat format, const uint8_t* block, uint8_t rgba[64]);
+
+// PSNR of a compressed level against its source over the channels the format stores (RGB for BC1, R for BC4, RG for
+// BC5, RGBA for BC7)
+float MeasurePsnr(const MipLevel& source, const CompressedLevel& level, BlockFormat format);
@@ -9,5 +9,20 @@ namespace RHConfig
 	static constexpr uint32_t height = 720;
 	static constexpr uint32_t gbuffersNumber = 3; // Albedo + normal + material
 	static constexpr uint32_t environmentsNumber = 4;
+	static constexpr bool sharedExponentEquirect = true; // Environment equirects decoded to R9G9B9E5 (4 bytes a texel), to RGBA16F (8) otherwise
+	static constexpr uint32_t residentEnvironments = 2; // Environments whose maps stay on the GPU, the least recently shown one past that is evicted (it comes back from the IBL cache)
 	static constexpr uint32_t shadowMapSize = 2048;
+	static constexpr uint64_t uploadRingSize = 64ull * 1024 * 1024; // Bytes of the persistently mapped upload buffer every mesh and texture upload is staged in
+	static constexpr uint64_t placedHeapSize = 64ull * 1024 * 1024; // Bytes of the default heaps the buffers, textures and render targets are placed in (bigger resources get a heap of their own size)
+	static constexpr bool cpuIblBake = false; // Bake the IBL maps of the cache misses on the CPU with IblBaker instead of the GPU passes (same maps and cache files, slower)
+	static constexpr uint32_t jobWorkers = 0; // Worker threads of the job system, 0 starts one per hardware thread besides the main thread
+	static constexpr bool materialMips = true; // Generate the full mip chain of the material textures on the CPU when they are loaded (sRGB ones are filtered in linear space)
+	static constexpr bool compressTextures = true; // Block compress the material textures when they are loaded (BC7 albedo and metal-roughness, BC5 normal, BC4 AO)
+	static constexpr bool parallelObjIngest = true; // Parse OBJ files in line aligned chunks on every core (falls back to tinyobj on unsupported files)
+	static constexpr bool optimizeMeshes = true; // Vertex cache, overdraw and vertex fetch reordering of the generated and imported meshes
+	static constexpr bool packedVertices = false; // Upload meshes as 20 byte PackedVertex (quantized position, half uv, octahedral normal/tangent) instead of the 48 byte Vertex
+	static constexpr bool buildMeshlets = true; // Split imported meshes in meshlets (64 vertices / 124 triangles) with culling bounds, stored in the cooked mesh
+	static constexpr float lodRatios[] = { 0.5f, 0.25f, 0.125f, 0.0625f }; // Triangle ratios of the LOD chain built when a mesh is cooked
+	static constexpr bool buildLods = true; // Build a LOD chain of the imported meshes by quadric simplification, stored in the cooked mesh
+	static constexpr float lodErrorPixels = 2.0f; // Largest projected simplification error accepted when picking a LOD (the quadric error is on the conservative side)
 }
\ No newline at end of file
@@ -0,0 +1,145 @@
+#include "CookedMesh.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+static uint64_t AlignUp(const uint64_t value, const uint64_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// An array of count T at offset lies inside the file and is aligned for T. Written so a crafted offset can't wrap
+// around, the counts are 32 bits so the byte sizes can't.
+template <typename T>
+static bool ArrayFits(const uint64_t offset, const uint32_t count, const uint64_t fileSize)
+{
+	const uint64_t bytes = static_cast<uint64_t>(count) * sizeof(T);
+	return offset % alignof(T) == 0 && offset <= fileSize && bytes <= fileSize - offset;
+}
+
+bool CookMesh(const std::string& cookedFile, const uint64_t sourceHash, const PBRMesh& mesh)
+{
+	CookedMeshHeader header;
+	header.sourceHash = sourceHash;
+	header.vertexCount = static_cast<uint32_t>(mesh.vertices_data.size());
+	header.indexCount = static_cast<uint32_t>(mesh.indices_data.size());
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		header.boundsMin[axis] = mesh.boundsMin[axis];
+		header.boundsMax[axis] = mesh.boundsMax[axis];
+	}
+
+	header.vertexOffset = AlignUp(sizeof(CookedMeshHeader), 16);
+	header.indexOffset = AlignUp(header.vertexOffset + header.vertexCount * sizeof(Vertex), 16);
+
+	const MeshletData& meshlets = mesh.meshlets;
+	header.meshletCount = static_cast<uint32_t>(meshlets.meshlets.size());
+	header.meshletVertexCount = static_cast<uint32_t>(meshlets.vertices.size());
+	header.meshletTriangleByteCount = static_cast<uint32_t>(meshlets.triangles.size());
+	header.meshletOffset = AlignUp(header.indexOffset + header.indexCount * sizeof(uint32_t), 16);
+	header.meshletBoundsOffset = AlignUp(header.meshletOffset + header.meshletCount * sizeof(Meshlet), 16);
+	header.meshletVertexOffset = AlignUp(header.meshletBoundsOffset + header.meshletCount * sizeof(MeshletBounds), 16);
+	header.meshletTriangleOffset = AlignUp(header.meshletVertexOffset + header.meshletVertexCount * sizeof(uint32_t), 16);
+	header.lodCount = static_cast<uint32_t>(mesh.lods.size());
+	header.lodOffset = AlignUp(header.meshletTriangleOffset + header.meshletTriangleByteCount, 16);
+
+	std::error_code ec;
+	std::filesystem::create_directories(std::filesystem::path(cookedFile).parent_path(), ec);
+
+	std::ofstream file(cookedFile, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		return false;
+	}
+
+	auto WriteAt = [&file](const uint64_t offset, const void* data, const size_t size)
+	{
+		const uint64_t position = static_cast<uint64_t>(file.tellp());
+		static const char zeros[16] = {};
+		file.write(zeros, static_cast<std::streamsize>(offset - position));
+		file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+	};
+
+	WriteAt(0, &header, sizeof(header));
+	WriteAt(header.vertexOffset, mesh.vertices_data.data(), mesh.vertices_data.size() * sizeof(Vertex));
+	WriteAt(header.indexOffset, mesh.indices_data.data(), mesh.indices_data.size() * sizeof(uint32_t));
+	WriteAt(header.meshletOffset, meshlets.meshlets.data(), meshlets.meshlets.size() * sizeof(Meshlet));
+	WriteAt(header.meshletBoundsOffset, meshlets.bounds.data(), meshlets.bounds.size() * sizeof(MeshletBounds));
+	WriteAt(header.meshletVertexOffset, meshlets.vertices.data(), meshlets.vertices.size() * sizeof(uint32_t));
+	WriteAt(header.meshletTriangleOffset, meshlets.triangles.data(), meshlets.triangles.size());
+	WriteAt(header.lodOffset, mesh.lods.data(), mesh.lods.size() * sizeof(MeshLod));
+
+	return static_cast<bool>(file);
+}
+
+bool CookedMeshFile::Open(const std::string& cookedFile, const uint64_t expectedSourceHash)
+{
+	if (!m_file.Open(cookedFile) || m_file.Size() < sizeof(CookedMeshHeader))
+	{
+		return false;
+	}
+
+	const CookedMeshHeader* header = reinterpret_cast<const CookedMeshHeader*>(m_file.Data());
+	if (header->magic != kCookedMeshMagic || header->version != kCookedMeshVersion || header->vertexStride != sizeof(Vertex) || header->sourceHash != expectedSourceHash)
+	{
+		m_file.Close();
+		return false;
+	}
+
+	const uint64_t size = m_file.Size();
+	if (!ArrayFits<Vertex>(header->vertexOffset, header->vertexCount, size) || !ArrayFits<uint32_t>(header->indexOffset, header->indexCount, size) ||
+		!ArrayFits<Meshlet>(header->meshletOffset, header->meshletCount, size) || !ArrayFits<MeshletBounds>(header->meshletBoundsOffset, header->meshletCount, size) ||
+		!ArrayFits<uint32_t>(header->meshletVertexOffset, header->meshletVertexCount, size) ||
+		!ArrayFits<uint8_t>(header->meshletTriangleOffset, header->meshletTriangleByteCount, size) || !ArrayFits<MeshLod>(header->lodOffset, header->lodCount, size))
+	{
+		m_file.Close();
+		return false;
+	}
+
+	// The arrays fit in the file, now what they reference has to fit in the arrays
+	const uint32_t* indices = reinterpret_cast<const uint32_t*>(m_file.Data() + header->indexOffset);
+	const MeshLod* lods = reinterpret_cast<const MeshLod*>(m_file.Data() + header->lodOffset);
+	const Meshlet* meshlets = reinterpret_cast<const Meshlet*>(m_file.Data() + header->meshletOffset);
+	const uint32_t* meshletVertices = reinterpret_cast<const uint32_t*>(m_file.Data() + header->meshletVertexOffset);
+	const uint8_t* meshletTriangles = m_file.Data() + header->meshletTriangleOffset;
+	bool valid = std::all_of(indices, indices + header->indexCount, [header](const uint32_t index) { return index < header->vertexCount; }) &&
+		std::all_of(meshletVertices, meshletVertices + header->meshletVertexCount, [header](const uint32_t index) { return index < header->vertexCount; });
+	for (uint32_t i = 0; valid && i < header->lodCount; ++i)
+	{
+		valid = static_cast<uint64_t>(lods[i].indexOffset) + lods[i].indexCount <= header->indexCount && lods[i].vertexCount <= header->vertexCount;
+	}
+	for (uint32_t i = 0; valid && i < header->meshletCount; ++i)
+	{
+		const Meshlet& meshlet = meshlets[i];
+		valid = static_cast<uint64_t>(meshlet.vertexOffset) + meshlet.vertexCount <= header->meshletVertexCount &&
+			static_cast<uint64_t>(meshlet.triangleOffset) + static_cast<uint64_t>(meshlet.triangleCount) * 3 <= header->meshletTriangleByteCount &&
+			std::all_of(meshletTriangles + meshlet.triangleOffset, meshletTriangles + meshlet.triangleOffset + meshlet.triangleCount * 3,
+				[&meshlet](const uint8_t local) { return local < meshlet.vertexCount; });
+	}
+	if (!valid)
+	{
+		m_file.Close();
+		return false;
+	}
+
+	m_header = header;
+	m_vertices = { reinterpret_cast<const Vertex*>(m_file.Data() + header->vertexOffset), header->vertexCount };
+	m_indices = { reinterpret_cast<const uint32_t*>(m_file.Data() + header->indexOffset), header->indexCount };
+	m_meshlets = { reinterpret_cast<const Meshlet*>(m_file.Data() + header->meshletOffset), header->meshletCount };
+	m_meshletBounds = { reinterpret_cast<const MeshletBounds*>(m_file.Data() + header->meshletBoundsOffset), header->meshletCount };
+	m_meshletVertices = { reinterpret_cast<const uint32_t*>(m_file.Data() + header->meshletVertexOffset), header->meshletVertexCount };
+	m_meshletTriangles = { reinterpret_cast<const uint8_t*>(m_file.Data() + header->meshletTriangleOffset), header->meshletTriangleByteCount };
+	m_lods = { reinterpret_cast<const MeshLod*>(m_file.Data() + header->lodOffset), header->lodCount };
+	return true;
+}
+
+MeshletData CookedMeshFile::LoadMeshlets() const
+{
+	MeshletData data;
+	data.meshlets.assign(m_meshlets.begin(), m_meshlets.end());
+	data.bounds.assign(m_meshletBounds.begin(), m_meshletBounds.end());
+	data.vertices.assign(m_meshletVertices.begin(), m_meshletVertices.end());
+	data.triangles.assign(m_meshletTriangles.begin(), m_meshletTriangles.end());
+	return data;
+}
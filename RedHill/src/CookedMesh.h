@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "Model.h"
+
+// Binary cooked mesh: a versioned header followed by the vertex and index arrays, laid out so the arrays can be
+// handed to the upload path straight from a memory mapped view of the file.
+static constexpr uint32_t kCookedMeshMagic = 0x48534D52; // "RMSH"
+static constexpr uint32_t kCookedMeshVersion = 4; // 2: meshes are cooked after the vertex cache / overdraw optimization, 3: meshlets, 4: LOD chain
+
+struct CookedMeshHeader
+{
+	uint32_t magic = kCookedMeshMagic;
+	uint32_t version = kCookedMeshVersion;
+	uint64_t sourceHash = 0;		// Hash of the source asset content and the cook settings, a mismatch means the cook is stale
+
+	uint32_t vertexStride = sizeof(Vertex);
+	uint32_t vertexCount = 0;
+	uint32_t indexCount = 0;
+	uint32_t reserved = 0;
+
+	float boundsMin[3] = {};
+	float boundsMax[3] = {};
+
+	uint64_t vertexOffset = 0;		// Byte offsets from the start of the file, 16 byte aligned
+	uint64_t indexOffset = 0;
+
+	// Meshlets (MeshletData), the counts are 0 when the mesh was not clustered
+	uint32_t meshletCount = 0;
+	uint32_t meshletVertexCount = 0;
+	uint32_t meshletTriangleByteCount = 0;
+	uint32_t reserved1 = 0;
+
+	uint64_t meshletOffset = 0;
+	uint64_t meshletBoundsOffset = 0;
+	uint64_t meshletVertexOffset = 0;
+	uint64_t meshletTriangleOffset = 0;
+
+	// Levels of detail (MeshLod), their indices are part of the index array
+	uint32_t lodCount = 0;
+	uint32_t reserved2 = 0;
+	uint64_t lodOffset = 0;
+};
+
+// Write the cooked version of a mesh, returns false if the file can't be written
+bool CookMesh(const std::string& cookedFile, const uint64_t sourceHash, const PBRMesh& mesh);
+
+// Memory mapped view of a cooked mesh, the spans stay valid while the object is alive
+class CookedMeshFile
+{
+public:
+	// Fails if the file is missing, corrupted, from another format version or cooked from a different source. Every
+	// range and index is checked against the counts of the header, a damaged file is cooked again rather than uploaded.
+	bool Open(const std::string& cookedFile, const uint64_t expectedSourceHash);
+
+	const CookedMeshHeader& Header() const { return *m_header; }
+	std::span<const Vertex> Vertices() const { return m_vertices; }
+	std::span<const uint32_t> Indices() const { return m_indices; }
+
+	std::span<const Meshlet> Meshlets() const { return m_meshlets; }
+	std::span<const MeshletBounds> MeshletBoundsData() const { return m_meshletBounds; }
+	std::span<const uint32_t> MeshletVertices() const { return m_meshletVertices; }
+	std::span<const uint8_t> MeshletTriangles() const { return m_meshletTriangles; }
+	std::span<const MeshLod> Lods() const { return m_lods; }
+
+	// Copy of the meshlet arrays, for the meshes that keep them after the file is closed
+	MeshletData LoadMeshlets() const;
+
+private:
+	MappedFile m_file;
+	const CookedMeshHeader* m_header = nullptr;
+	std::span<const Vertex> m_vertices;
+	std::span<const uint32_t> m_indices;
+	std::span<const Meshlet> m_meshlets;
+	std::span<const MeshletBounds> m_meshletBounds;
+	std::span<const uint32_t> m_meshletVertices;
+	std::span<const uint8_t> m_meshletTriangles;
+	std::span<const MeshLod> m_lods;
+};
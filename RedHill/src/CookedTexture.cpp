@@ -0,0 +1,163 @@
+#include "CookedTexture.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+// Sanity bound of the subresource table (a cubemap with a full 8K mip chain has 6 * 14)
+static constexpr uint64_t kMaxSubresources = 6 * 32;
+
+static uint64_t AlignUp(const uint64_t value, const uint64_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+std::vector<uint8_t> BuildCookedTexture(const uint64_t sourceHash, const CookedTextureDesc& desc, std::span<const TextureSubresource> subresources)
+{
+	CookedTextureHeader header;
+	header.sourceHash = sourceHash;
+	header.format = desc.format;
+	header.flags = desc.flags;
+	header.width = desc.width;
+	header.height = desc.height;
+	header.arraySize = desc.arraySize;
+	header.mipLevels = desc.mipLevels;
+	header.subresourceOffset = AlignUp(sizeof(CookedTextureHeader), 16);
+	header.payloadOffset = AlignUp(header.subresourceOffset + subresources.size() * sizeof(CookedSubresource), kCookedTexturePlacementAlignment);
+
+	std::vector<CookedSubresource> table(subresources.size());
+	uint64_t payloadSize = 0;
+	for (size_t i = 0; i < subresources.size(); ++i)
+	{
+		const TextureSubresource& source = subresources[i];
+		CookedSubresource& entry = table[i];
+		entry.offset = AlignUp(payloadSize, kCookedTexturePlacementAlignment);
+		entry.width = source.width;
+		entry.height = source.height;
+		entry.rowPitch = static_cast<uint32_t>(AlignUp(source.rowBytes, kCookedTextureRowPitchAlignment));
+		entry.rowCount = source.rowCount;
+		entry.rowBytes = source.rowBytes;
+		payloadSize = entry.offset + static_cast<uint64_t>(entry.rowPitch) * entry.rowCount;
+	}
+	header.payloadSize = payloadSize;
+
+	// Zero filled so the padding of the rows is deterministic
+	std::vector<uint8_t> bytes(header.payloadOffset + payloadSize);
+	std::memcpy(bytes.data(), &header, sizeof(header));
+	std::memcpy(bytes.data() + header.subresourceOffset, table.data(), table.size() * sizeof(CookedSubresource));
+
+	uint8_t* payload = bytes.data() + header.payloadOffset;
+	for (size_t i = 0; i < subresources.size(); ++i)
+	{
+		const TextureSubresource& source = subresources[i];
+		const CookedSubresource& entry = table[i];
+		if (!source.data)
+		{
+			continue;
+		}
+		const size_t sourcePitch = source.rowPitch != 0 ? source.rowPitch : source.rowBytes;
+		for (uint32_t row = 0; row < entry.rowCount; ++row)
+		{
+			std::memcpy(payload + entry.offset + static_cast<uint64_t>(row) * entry.rowPitch, source.data + row * sourcePitch, source.rowBytes);
+		}
+	}
+
+	return bytes;
+}
+
+uint8_t* CookedSubresourceRows(std::span<uint8_t> bytes, const uint32_t subresource, CookedSubresource& entry)
+{
+	const CookedTextureHeader* header = reinterpret_cast<const CookedTextureHeader*>(bytes.data());
+	std::memcpy(&entry, bytes.data() + header->subresourceOffset + subresource * sizeof(CookedSubresource), sizeof(entry));
+	return bytes.data() + header->payloadOffset + entry.offset;
+}
+
+bool WriteCookedTexture(const std::string& cookedFile, std::span<const uint8_t> bytes)
+{
+	std::error_code ec;
+	std::filesystem::create_directories(std::filesystem::path(cookedFile).parent_path(), ec);
+
+	std::ofstream file(cookedFile, std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		return false;
+	}
+
+	file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+	return static_cast<bool>(file);
+}
+
+bool CookedTextureFile::Open(const std::string& cookedFile, const uint64_t expectedSourceHash)
+{
+	if (!m_file.Open(cookedFile))
+	{
+		return false;
+	}
+
+	if (!Parse({ m_file.Data(), m_file.Size() }, expectedSourceHash))
+	{
+		m_file.Close();
+		return false;
+	}
+	return true;
+}
+
+bool CookedTextureFile::Load(std::vector<uint8_t>&& bytes)
+{
+	m_file.Close();
+	m_bytes = std::move(bytes);
+	if (m_bytes.size() < sizeof(CookedTextureHeader))
+	{
+		return false;
+	}
+	return Parse(m_bytes, reinterpret_cast<const CookedTextureHeader*>(m_bytes.data())->sourceHash);
+}
+
+bool CookedTextureFile::Parse(std::span<const uint8_t> bytes, const uint64_t expectedSourceHash)
+{
+	// A failed open doesn't leave the spans of the previous texture behind
+	m_header = nullptr;
+	m_subresources = {};
+	m_payload = {};
+	if (bytes.size() < sizeof(CookedTextureHeader))
+	{
+		return false;
+	}
+
+	const CookedTextureHeader* header = reinterpret_cast<const CookedTextureHeader*>(bytes.data());
+	if (header->magic != kCookedTextureMagic || header->version != kCookedTextureVersion || header->sourceHash != expectedSourceHash)
+	{
+		return false;
+	}
+
+	// Every count and offset is checked against the file so a truncated or corrupted cook is rejected instead of read
+	// out of bounds. The offsets come from the file, they are compared against what is left after them so a huge one
+	// can't wrap the sum around.
+	const uint64_t subresourceCount = static_cast<uint64_t>(header->arraySize) * header->mipLevels;
+	if (header->width == 0 || header->height == 0 || subresourceCount == 0 || subresourceCount > kMaxSubresources ||
+		((header->flags & kCookedTextureCubemap) && header->arraySize != 6) ||
+		header->subresourceOffset % alignof(CookedSubresource) != 0 || header->subresourceOffset > bytes.size() ||
+		subresourceCount * sizeof(CookedSubresource) > bytes.size() - header->subresourceOffset ||
+		header->payloadOffset % kCookedTexturePlacementAlignment != 0 || header->payloadOffset > bytes.size() ||
+		header->payloadSize > bytes.size() - header->payloadOffset)
+	{
+		return false;
+	}
+
+	const CookedSubresource* subresources = reinterpret_cast<const CookedSubresource*>(bytes.data() + header->subresourceOffset);
+	for (uint64_t i = 0; i < subresourceCount; ++i)
+	{
+		const CookedSubresource& entry = subresources[i];
+		if (entry.offset % kCookedTexturePlacementAlignment != 0 || entry.rowPitch % kCookedTextureRowPitchAlignment != 0 ||
+			entry.rowBytes > entry.rowPitch || entry.offset > header->payloadSize ||
+			static_cast<uint64_t>(entry.rowPitch) * entry.rowCount > header->payloadSize - entry.offset)
+		{
+			return false;
+		}
+	}
+
+	m_header = header;
+	m_subresources = { subresources, static_cast<size_t>(subresourceCount) };
+	m_payload = { bytes.data() + header->payloadOffset, static_cast<size_t>(header->payloadSize) };
+	return true;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+// Binary cooked texture: a versioned header, a table of subresources (every mip of every face / array slice) and the
+// payload. The payload is laid out the way a D3D12 upload buffer has to be (row pitches multiple of 256 bytes,
+// subresources at multiples of 512 bytes), so it is copied to the upload heap in one memcpy and each subresource is
+// copied to the texture from its placed footprint.
+static constexpr uint32_t kCookedTextureMagic = 0x58455452; // "RTEX"
+static constexpr uint32_t kCookedTextureVersion = 1;
+static constexpr uint32_t kCookedTextureRowPitchAlignment = 256;		// D3D12_TEXTURE_DATA_PITCH_ALIGNMENT
+static constexpr uint32_t kCookedTexturePlacementAlignment = 512;	// D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT
+
+static constexpr uint32_t kCookedTextureCubemap = 1 << 0;	// The array slices are the 6 faces of a cubemap (+X, -X, +Y, -Y, +Z, -Z)
+
+struct CookedTextureHeader
+{
+	uint32_t magic = kCookedTextureMagic;
+	uint32_t version = kCookedTextureVersion;
+	uint64_t sourceHash = 0;		// Content hash of the source asset and of the cook settings, a mismatch means the cook is stale
+
+	uint32_t format = 0;			// DXGI_FORMAT of the texture
+	uint32_t flags = 0;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t arraySize = 1;			// 6 for a cubemap
+	uint32_t mipLevels = 1;
+
+	uint64_t subresourceOffset = 0;	// Byte offsets from the start of the file
+	uint64_t payloadOffset = 0;		// 512 byte aligned
+	uint64_t payloadSize = 0;
+};
+
+// Placed footprint of one subresource, in the D3D12 subresource order (mip + slice * mipLevels)
+struct CookedSubresource
+{
+	uint64_t offset = 0;			// From the start of the payload, 512 byte aligned
+	uint32_t width = 0;				// Footprint size in pixels, a multiple of the block size for block compressed formats
+	uint32_t height = 0;
+	uint32_t rowPitch = 0;			// 256 byte aligned
+	uint32_t rowCount = 0;			// Rows of pixels, or of blocks
+	uint32_t rowBytes = 0;			// Bytes of data in each row, the rest of the pitch is padding
+	uint32_t reserved = 0;
+};
+
+// Description of the texture to cook
+struct CookedTextureDesc
+{
+	uint32_t format = 0;
+	uint32_t flags = 0;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t arraySize = 1;
+	uint32_t mipLevels = 1;
+};
+
+// Source of one subresource
+struct TextureSubresource
+{
+	const uint8_t* data = nullptr;	// nullptr leaves the rows zeroed, to be filled in place through CookedSubresourceRows
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t rowCount = 0;
+	uint32_t rowBytes = 0;
+	uint32_t rowPitch = 0;			// Bytes from one source row to the next, 0 when they are tightly packed (a GPU readback has pitched rows)
+};
+
+// Lays out the whole cooked file in memory, subresources in the D3D12 order (arraySize * mipLevels of them)
+std::vector<uint8_t> BuildCookedTexture(const uint64_t sourceHash, const CookedTextureDesc& desc, std::span<const TextureSubresource> subresources);
+// First row of a subresource in the bytes of BuildCookedTexture, the next ones are entry.rowPitch apart
+uint8_t* CookedSubresourceRows(std::span<uint8_t> bytes, const uint32_t subresource, CookedSubresource& entry);
+
+// Write a cooked texture built by BuildCookedTexture, returns false if the file can't be written
+bool WriteCookedTexture(const std::string& cookedFile, std::span<const uint8_t> bytes);
+
+// Cooked texture mapped from disk, or kept in memory right after it was cooked. The spans stay valid while the object
+// is alive.
+class CookedTextureFile
+{
+public:
+	// Fails if the file is missing, corrupted, from another format version or cooked from a different source
+	bool Open(const std::string& cookedFile, const uint64_t expectedSourceHash);
+	// Takes the bytes of a texture that was just cooked
+	bool Load(std::vector<uint8_t>&& bytes);
+
+	const CookedTextureHeader& Header() const { return *m_header; }
+	std::span<const CookedSubresource> Subresources() const { return m_subresources; }
+	std::span<const uint8_t> Payload() const { return m_payload; }
+	bool IsMapped() const { return m_file.IsOpen(); }
+
+private:
+	bool Parse(std::span<const uint8_t> bytes, const uint64_t expectedSourceHash);
+
+	MappedFile m_file;
+	std::vector<uint8_t> m_bytes;
+	const CookedTextureHeader* m_header = nullptr;
+	std::span<const CookedSubresource> m_subresources;
+	std::span<const uint8_t> m_payload;
+};
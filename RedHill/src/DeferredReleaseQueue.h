@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <utility>
+
+// What a retired object was, for the byte accounting
+enum class ReleaseCategory : uint32_t
+{
+	Texture,	// Source textures only read while baking (the equirectangular environments) and evicted environment maps
+	Scratch,	// Descriptor heaps and buffers of the init passes
+	Pipeline,	// PSOs and root signatures of the bake passes (counted, their size isn't known)
+	Count
+};
+
+// Keeps the objects the GPU may still use alive until the fence value signaled after their last use is reached. Object
+// is anything that frees what it holds when destroyed (ComPtr in the renderer), the queue doesn't know about the
+// device so it can be driven by a fake fence.
+template <typename Object>
+class DeferredReleaseQueue
+{
+public:
+	struct CategoryStats
+	{
+		uint64_t pendingBytes = 0;
+		uint64_t releasedBytes = 0;
+		uint32_t pendingCount = 0;
+		uint32_t releasedCount = 0;
+	};
+
+	DeferredReleaseQueue() = default;
+	DeferredReleaseQueue(const DeferredReleaseQueue&) = delete;
+	DeferredReleaseQueue& operator=(const DeferredReleaseQueue&) = delete;
+
+	~DeferredReleaseQueue()
+	{
+		// The owner waits for the GPU before it is destroyed, whatever is left can go
+		Release(UINT64_MAX);
+	}
+
+	// fenceValue is the value signaled after the last command list that uses the object
+	void Retire(Object object, const ReleaseCategory category, const uint64_t bytes, uint64_t fenceValue)
+	{
+		// The entries stay sorted by fence so Release only looks at the front. A smaller value than the last one (not
+		// expected with a single queue) keeps the object alive a little longer, never shorter.
+		if (!m_entries.empty() && fenceValue < m_entries.back().fenceValue)
+		{
+			fenceValue = m_entries.back().fenceValue;
+		}
+
+		CategoryStats& stats = m_stats[static_cast<uint32_t>(category)];
+		stats.pendingBytes += bytes;
+		++stats.pendingCount;
+		m_entries.push_back({ fenceValue, category, bytes, std::move(object) });
+	}
+
+	// Destroys every object whose fence value is completed, returns how many
+	uint32_t Release(const uint64_t completedFenceValue)
+	{
+		uint32_t released = 0;
+		while (!m_entries.empty() && m_entries.front().fenceValue <= completedFenceValue)
+		{
+			const Entry& entry = m_entries.front();
+			CategoryStats& stats = m_stats[static_cast<uint32_t>(entry.category)];
+			stats.pendingBytes -= entry.bytes;
+			stats.releasedBytes += entry.bytes;
+			--stats.pendingCount;
+			++stats.releasedCount;
+
+			m_entries.pop_front();
+			++released;
+		}
+		return released;
+	}
+
+	const CategoryStats& Stats(const ReleaseCategory category) const { return m_stats[static_cast<uint32_t>(category)]; }
+	size_t PendingCount() const { return m_entries.size(); }
+
+private:
+	struct Entry
+	{
+		uint64_t fenceValue;
+		ReleaseCategory category;
+		uint64_t bytes;
+		Object object;
+	};
+
+	std::deque<Entry> m_entries;
+	CategoryStats m_stats[static_cast<uint32_t>(ReleaseCategory::Count)];
+};
@@ -9,16 +9,15 @@
 
 #include <cassert>
 
-void DescriptorHeapAllocator::Init(ID3D12Device* device, const D3D12_DESCRIPTOR_HEAP_TYPE type, const uint32_t persistentSize, const uint32_t transientSize)
+void DescriptorHeapAllocator::Init(ID3D12Device* device, const D3D12_DESCRIPTOR_HEAP_TYPE type, const uint32_t persistentSize, const uint32_t transientSize, const uint32_t transientBlock)
 {
 	// Shader visibility is deduced from the type
 	m_isShaderVisible = (type == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV || type == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER);
 	m_type = type;
 
 	m_persistentLimit = persistentSize;
-	m_tempBase = m_persistentLimit;
-	m_tempTop = m_tempBase;
-	m_totalLimit = persistentSize + transientSize;
+	m_persistent.Init(persistentSize);
+	m_transient.Init(transientSize, transientBlock);
 
 	D3D12_DESCRIPTOR_HEAP_DESC desc = {};
 	desc.Flags = m_isShaderVisible ? D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE : D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
@@ -36,9 +35,10 @@ void DescriptorHeapAllocator::Init(ID3D12Device* device, const D3D12_DESCRIPTOR_
 	}
 }
 
-DescriptorHandle DescriptorHeapAllocator::AllocatePersistent()
+DescriptorHandle DescriptorHeapAllocator::AllocatePersistent(const uint32_t count)
 {
-	if (m_persistentTop >= m_persistentLimit)
+	const DescriptorRangeAllocator::Range range = m_persistent.Allocate(count);
+	if (range.slot == DescriptorRangeAllocator::kInvalidSlot)
 	{
 		::OutputDebugStringA("Insufficient persistent descriptors available\n");
 		::__debugbreak();
@@ -46,39 +46,80 @@ DescriptorHandle DescriptorHeapAllocator::AllocatePersistent()
 	}
 
 	DescriptorHandle handle;
-	handle.cpu = CD3DX12_CPU_DESCRIPTOR_HANDLE(m_cpuStart, m_persistentTop, m_descriptorSize);
+	handle.cpu = CD3DX12_CPU_DESCRIPTOR_HANDLE(m_cpuStart, range.offset, m_descriptorSize);
 
 	if (m_isShaderVisible)
 	{
-		handle.gpu = CD3DX12_GPU_DESCRIPTOR_HANDLE(m_gpuStart, m_persistentTop, m_descriptorSize);
+		handle.gpu = CD3DX12_GPU_DESCRIPTOR_HANDLE(m_gpuStart, range.offset, m_descriptorSize);
 	}
-	++m_persistentTop;
+	handle.range = range;
 
 	return handle;
 }
 
-DescriptorHandle DescriptorHeapAllocator::AllocateTransient()
+void DescriptorHeapAllocator::FreePersistent(DescriptorHandle& handle, const uint64_t fenceValue)
 {
-	if (m_tempTop >= m_totalLimit)
+	if (!m_persistent.Free(handle.range, fenceValue))
+	{
+		::OutputDebugStringA("Freeing a persistent descriptor range that isn't live\n");
+		::__debugbreak();
+	}
+	handle = {};
+}
+
+void DescriptorHeapAllocator::ReclaimPersistent(const uint64_t completedFenceValue)
+{
+	m_persistent.Reclaim(completedFenceValue);
+}
+
+DescriptorHandle DescriptorHeapAllocator::Element(const DescriptorHandle& handle, const uint32_t index) const
+{
+	assert(index < handle.range.count);
+
+	DescriptorHandle element;
+	element.cpu = CD3DX12_CPU_DESCRIPTOR_HANDLE(handle.cpu, index, m_descriptorSize);
+	if (m_isShaderVisible)
+	{
+		element.gpu = CD3DX12_GPU_DESCRIPTOR_HANDLE(handle.gpu, index, m_descriptorSize);
+	}
+	element.range.offset = handle.range.offset + index;
+	element.range.count = 1;
+	return element;
+}
+
+DescriptorHandle DescriptorHeapAllocator::AllocateTransient(const uint32_t count)
+{
+	return AllocateTransient(m_cursor, count);
+}
+
+DescriptorHandle DescriptorHeapAllocator::AllocateTransient(TransientDescriptorRing::Cursor& cursor, const uint32_t count)
+{
+	// Full means the frames in flight hold the whole ring, it is sized for them
+	const uint32_t offset = m_transient.Allocate(cursor, count);
+	if (offset == TransientDescriptorRing::kInvalidOffset)
 	{
 		::OutputDebugStringA("Insufficient transient descriptors available\n");
 		::__debugbreak();
 		return {};
 	}
 
+	const uint32_t index = m_persistentLimit + offset;
 	DescriptorHandle handle;
-	handle.cpu = CD3DX12_CPU_DESCRIPTOR_HANDLE(m_cpuStart, m_tempTop, m_descriptorSize);
+	handle.cpu = CD3DX12_CPU_DESCRIPTOR_HANDLE(m_cpuStart, index, m_descriptorSize);
 
 	if (m_isShaderVisible)
 	{
-		handle.gpu = CD3DX12_GPU_DESCRIPTOR_HANDLE(m_gpuStart, m_tempTop, m_descriptorSize);
+		handle.gpu = CD3DX12_GPU_DESCRIPTOR_HANDLE(m_gpuStart, index, m_descriptorSize);
 	}
-	++m_tempTop;
+	handle.range.offset = index;
+	handle.range.count = count;
 
 	return handle;
 }
 
 void DescriptorHeapAllocator::ResetTransient()
 {
-	m_tempTop = m_tempBase;
+	// The GPU may still read the descriptors of a shader visible heap, those go through the fences
+	assert(!m_isShaderVisible);
+	m_transient.Init(m_transient.Capacity(), m_transient.BlockSize());
 }
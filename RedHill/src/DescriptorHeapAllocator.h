@@ -5,12 +5,18 @@
 #include <wrl.h>
 #include <cstdint>
 
+#include "DescriptorRangeAllocator.h"
+#include "TransientDescriptorRing.h"
+
 using Microsoft::WRL::ComPtr;
 
+// First descriptor of a range. range identifies a persistent allocation for FreePersistent, the transient descriptors
+// and the ones picked with Element don't own one.
 struct DescriptorHandle
 {
 	CD3DX12_CPU_DESCRIPTOR_HANDLE cpu = {};
 	CD3DX12_GPU_DESCRIPTOR_HANDLE gpu = {};
+	DescriptorRangeAllocator::Range range;
 };
 
 class DescriptorHeapAllocator
@@ -20,14 +26,47 @@ public:
 	DescriptorHeapAllocator(const DescriptorHeapAllocator&) = delete;
 	DescriptorHeapAllocator& operator=(const DescriptorHeapAllocator&) = delete;
 
-	void Init(ID3D12Device* device, const D3D12_DESCRIPTOR_HEAP_TYPE type, const uint32_t persistentSize, const uint32_t transientSize);
+	// transientSize is a multiple of transientBlock, the descriptors a recording thread grabs at once
+	void Init(ID3D12Device* device, const D3D12_DESCRIPTOR_HEAP_TYPE type, const uint32_t persistentSize, const uint32_t transientSize, const uint32_t transientBlock = 1);
+
+	// The persistent ranges are allocated and freed on the render thread only
+
+	// count contiguous descriptors, for the tables bound with a single handle
+	DescriptorHandle AllocatePersistent(const uint32_t count = 1);
+
+	// The range goes back to the heap once fenceValue (the one signaled after the last command list using it) is
+	// completed, the handle is cleared. Breaks on a handle that was already freed.
+	void FreePersistent(DescriptorHandle& handle, const uint64_t fenceValue);
+
+	void ReclaimPersistent(const uint64_t completedFenceValue);
+
+	bool IsLive(const DescriptorHandle& handle) const { return m_persistent.IsLive(handle.range); }
 
-	DescriptorHandle AllocatePersistent();
+	// Descriptor index of a range
+	DescriptorHandle Element(const DescriptorHandle& handle, const uint32_t index) const;
 
-	DescriptorHandle AllocateTransient();
+	DescriptorRangeAllocator::Stats PersistentStats() const { return m_persistent.GetStats(); }
 
+	// The transient region is a ring like the upload one: what is allocated between two fence signals is tagged with the
+	// value by SubmitTransient and comes back once ReclaimTransient sees it completed, so the next frame records its
+	// descriptors while the GPU still reads the ones of the frames in flight. count descriptors are contiguous.
+	// Render thread version, it allocates from a cursor of the allocator.
+	DescriptorHandle AllocateTransient(const uint32_t count = 1);
+
+	// Thread safe and lock free version for the recording jobs, each one with its own cursor (see TransientDescriptorRing)
+	DescriptorHandle AllocateTransient(TransientDescriptorRing::Cursor& cursor, const uint32_t count = 1);
+
+	// Render thread only, with every recording of the frame done
+	void SubmitTransient(const uint64_t fenceValue) { m_transient.Submit(fenceValue); }
+
+	void ReclaimTransient(const uint64_t completedFenceValue) { m_transient.Reclaim(completedFenceValue); }
+
+	// CPU only heaps (RTV, DSV): the views are copied when the command is recorded, the whole region can be reused
+	// right away without a fence
 	void ResetTransient();
 
+	uint32_t TransientPeak() const { return m_transient.PeakDescriptors(); }
+
 	ID3D12DescriptorHeap* Heap() const { return m_heap.Get(); }
 
 private:
@@ -40,11 +79,10 @@ private:
 	CD3DX12_CPU_DESCRIPTOR_HANDLE m_cpuStart = {};
 	CD3DX12_GPU_DESCRIPTOR_HANDLE m_gpuStart = {};
 
-	uint32_t m_persistentTop = 0;
+	DescriptorRangeAllocator m_persistent;
 	uint32_t m_persistentLimit = 0;
-	uint32_t m_tempBase = 0;      // == m_persistentLimit
-	uint32_t m_tempTop = 0;
-	uint32_t m_totalLimit= 0;
+	TransientDescriptorRing m_transient;	// Counting in descriptors from m_persistentLimit
+	TransientDescriptorRing::Cursor m_cursor;
 
 	UINT m_descriptorSize = 0;
 
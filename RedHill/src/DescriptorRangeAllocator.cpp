@@ -0,0 +1,110 @@
+#include "DescriptorRangeAllocator.h"
+
+#include <algorithm>
+
+void DescriptorRangeAllocator::Init(const uint32_t size)
+{
+	m_size = size;
+	m_ranges.Init(size, 1);
+	m_slots.clear();
+	m_freeSlots.clear();
+	m_pendingFrees.clear();
+	m_liveRanges = 0;
+	m_pendingDescriptors = 0;
+	m_peakDescriptors = 0;
+}
+
+DescriptorRangeAllocator::Range DescriptorRangeAllocator::Allocate(const uint32_t count)
+{
+	if (count == 0 || count > m_size)
+	{
+		return {};
+	}
+
+	const TlsfAllocator::Allocation allocation = m_ranges.Allocate(count, 1);
+	if (allocation.handle == TlsfAllocator::kInvalidAllocation)
+	{
+		return {};
+	}
+
+	uint32_t slot;
+	if (!m_freeSlots.empty())
+	{
+		slot = m_freeSlots.back();
+		m_freeSlots.pop_back();
+	}
+	else
+	{
+		slot = static_cast<uint32_t>(m_slots.size());
+		m_slots.emplace_back();
+	}
+
+	// The generation was bumped by the last free of the slot, the handles of the previous owner don't match it
+	Slot& entry = m_slots[slot];
+	entry.allocation = allocation.handle;
+	entry.offset = static_cast<uint32_t>(allocation.offset);
+	entry.count = count;
+	entry.live = true;
+	++m_liveRanges;
+	m_peakDescriptors = (std::max)(m_peakDescriptors, static_cast<uint32_t>(m_ranges.GetStats().usedBytes));
+
+	return { entry.offset, count, slot, entry.generation };
+}
+
+bool DescriptorRangeAllocator::Free(const Range& range, uint64_t fenceValue)
+{
+	if (!IsLive(range))
+	{
+		return false;
+	}
+
+	// Dead for the CPU right away, the descriptors stay reserved until the GPU is done with them
+	Slot& entry = m_slots[range.slot];
+	entry.live = false;
+	++entry.generation;
+	--m_liveRanges;
+	m_pendingDescriptors += entry.count;
+
+	// Sorted by fence like the release queue, a smaller value waits for the last one
+	if (!m_pendingFrees.empty() && fenceValue < m_pendingFrees.back().fenceValue)
+	{
+		fenceValue = m_pendingFrees.back().fenceValue;
+	}
+	m_pendingFrees.push_back({ fenceValue, range.slot });
+	return true;
+}
+
+void DescriptorRangeAllocator::Reclaim(const uint64_t completedFenceValue)
+{
+	while (!m_pendingFrees.empty() && m_pendingFrees.front().fenceValue <= completedFenceValue)
+	{
+		const uint32_t slot = m_pendingFrees.front().slot;
+		m_pendingFrees.pop_front();
+
+		Slot& entry = m_slots[slot];
+		m_ranges.Free(entry.allocation);
+		m_pendingDescriptors -= entry.count;
+		entry.allocation = TlsfAllocator::kInvalidAllocation;
+		m_freeSlots.push_back(slot);
+	}
+}
+
+bool DescriptorRangeAllocator::IsLive(const Range& range) const
+{
+	if (range.slot >= m_slots.size())
+	{
+		return false;
+	}
+	const Slot& entry = m_slots[range.slot];
+	return entry.live && entry.generation == range.generation && entry.offset == range.offset && entry.count == range.count;
+}
+
+DescriptorRangeAllocator::Stats DescriptorRangeAllocator::GetStats() const
+{
+	Stats stats;
+	stats.ranges = m_ranges.GetStats();
+	stats.liveRanges = m_liveRanges;
+	stats.pendingDescriptors = m_pendingDescriptors;
+	stats.peakDescriptors = m_peakDescriptors;
+	return stats;
+}
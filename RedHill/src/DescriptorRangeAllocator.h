@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "TlsfAllocator.h"
+
+// Ranges of descriptors in the persistent part of a heap, no device involved (the heap lives in DescriptorHeapAllocator).
+// The ranges come from a TLSF allocator counting in descriptors, so single descriptors and contiguous tables share the
+// region and a freed range merges with its free neighbours. Each allocation owns a slot whose generation is bumped when
+// it is freed: a range kept after its free, or freed twice, no longer matches. The descriptors of a freed range are only
+// handed out again once the fence value of the last command list that may read them is completed.
+class DescriptorRangeAllocator
+{
+public:
+	static constexpr uint32_t kInvalidSlot = UINT32_MAX;
+
+	struct Range
+	{
+		uint32_t offset = 0;	// First descriptor in the region
+		uint32_t count = 0;
+		uint32_t slot = kInvalidSlot;
+		uint32_t generation = 0;
+	};
+
+	struct Stats
+	{
+		TlsfAllocator::Stats ranges;	// In descriptors, the freed ranges still waiting on their fence count as used
+		uint32_t liveRanges = 0;
+		uint32_t pendingDescriptors = 0;
+		uint32_t peakDescriptors = 0;
+	};
+
+	void Init(const uint32_t size);
+
+	// slot is kInvalidSlot when no free range is big enough
+	Range Allocate(const uint32_t count);
+
+	// fenceValue is the value signaled after the last command list that may read the descriptors. False, and nothing
+	// freed, for a range that isn't live.
+	bool Free(const Range& range, uint64_t fenceValue);
+
+	// Gives back the ranges of every free up to the completed fence value
+	void Reclaim(const uint64_t completedFenceValue);
+
+	bool IsLive(const Range& range) const;
+	Stats GetStats() const;
+	uint32_t Size() const { return m_size; }
+
+private:
+	struct Slot
+	{
+		uint32_t allocation = TlsfAllocator::kInvalidAllocation;
+		uint32_t offset = 0;
+		uint32_t count = 0;
+		uint32_t generation = 0;
+		bool live = false;
+	};
+
+	struct PendingFree
+	{
+		uint64_t fenceValue;
+		uint32_t slot;
+	};
+
+	uint32_t m_size = 0;
+	TlsfAllocator m_ranges;
+	std::vector<Slot> m_slots;
+	std::vector<uint32_t> m_freeSlots;
+	std::deque<PendingFree> m_pendingFrees;
+	uint32_t m_liveRanges = 0;
+	uint32_t m_pendingDescriptors = 0;
+	uint32_t m_peakDescriptors = 0;
+};
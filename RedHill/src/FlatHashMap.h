@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Open addressing hash map with linear probing for insert-only workloads (mesh import, edge tables...).
+// Keys and values live in a single flat array so a lookup touches one or two cache lines instead of
+// chasing tree nodes. There is no erase, the table is meant to be sized once and thrown away (or cleared and refilled).
+template<typename Key, typename Value, typename Hash>
+class FlatHashMap
+{
+public:
+	FlatHashMap() = default;
+
+	explicit FlatHashMap(const size_t expectedCount)
+	{
+		Reserve(expectedCount);
+	}
+
+	// Size the table so that expectedCount entries keep the load factor under 0.5
+	void Reserve(const size_t expectedCount)
+	{
+		size_t capacity = 16;
+		while (capacity < expectedCount * 2)
+		{
+			capacity <<= 1;
+		}
+
+		if (capacity <= m_slots.size())
+		{
+			return;
+		}
+
+		std::vector<Slot> oldSlots = std::move(m_slots);
+		m_slots.assign(capacity, Slot{});
+		m_mask = capacity - 1;
+		m_count = 0;
+
+		for (const Slot& slot : oldSlots)
+		{
+			if (slot.used)
+			{
+				Insert(slot.key, slot.value);
+			}
+		}
+	}
+
+	// Returns the stored value for key, inserting value first if the key is not present yet.
+	// inserted reports which of the two happened.
+	Value FindOrInsert(const Key& key, const Value& value, bool& inserted)
+	{
+		if ((m_count + 1) * 2 > m_slots.size())
+		{
+			Reserve(m_count + 1);
+		}
+
+		size_t i = Hash{}(key) & m_mask;
+		while (m_slots[i].used)
+		{
+			if (m_slots[i].key == key)
+			{
+				inserted = false;
+				return m_slots[i].value;
+			}
+			i = (i + 1) & m_mask;
+		}
+
+		m_slots[i].key = key;
+		m_slots[i].value = value;
+		m_slots[i].used = true;
+		++m_count;
+
+		inserted = true;
+		return value;
+	}
+
+	void Insert(const Key& key, const Value& value)
+	{
+		bool inserted;
+		FindOrInsert(key, value, inserted);
+	}
+
+	const Value* Find(const Key& key) const
+	{
+		if (m_slots.empty())
+		{
+			return nullptr;
+		}
+
+		size_t i = Hash{}(key) & m_mask;
+		while (m_slots[i].used)
+		{
+			if (m_slots[i].key == key)
+			{
+				return &m_slots[i].value;
+			}
+			i = (i + 1) & m_mask;
+		}
+		return nullptr;
+	}
+
+	// Drops every entry but keeps the capacity
+	void Clear()
+	{
+		std::fill(m_slots.begin(), m_slots.end(), Slot{});
+		m_count = 0;
+	}
+
+	size_t Size() const { return m_count; }
+
+private:
+	struct Slot
+	{
+		Key key = {};
+		Value value = {};
+		bool used = false;
+	};
+
+	std::vector<Slot> m_slots;
+	size_t m_mask = 0;
+	size_t m_count = 0;
+};
+
+// 64 bit finalizer from MurmurHash3, good enough avalanche for packed integer keys
+inline uint64_t MixHash64(uint64_t k)
+{
+	k ^= k >> 33;
+	k *= 0xff51afd7ed558ccdULL;
+	k ^= k >> 33;
+	k *= 0xc4ceb93fe53a85b3ULL;
+	k ^= k >> 33;
+	return k;
+}
@@ -0,0 +1,132 @@
+#include "HalfFloat.h"
+
+#include <cstring>
+
+uint16_t FloatToHalf(float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+
+	const uint32_t sign = (bits >> 16) & 0x8000;
+	const uint32_t absBits = bits & 0x7FFFFFFF;
+
+	// NaN and infinity
+	if (absBits >= 0x7F800000)
+	{
+		return static_cast<uint16_t>(sign | 0x7C00 | (absBits > 0x7F800000 ? 0x200 : 0));
+	}
+
+	// Overflows to infinity (65520 and above round up past the largest half)
+	if (absBits >= 0x477FF000)
+	{
+		return static_cast<uint16_t>(sign | 0x7C00);
+	}
+
+	// Normal half
+	if (absBits >= 0x38800000)
+	{
+		const uint32_t rounded = absBits + 0xFFF + ((absBits >> 13) & 1);
+		return static_cast<uint16_t>(sign | ((rounded - 0x38000000) >> 13));
+	}
+
+	// Denormal half, let the fpu do the rounding by adding a magic value whose ulp is the half denormal step
+	float magic;
+	const uint32_t magicBits = 0x3F000000; // 0.5
+	std::memcpy(&magic, &magicBits, sizeof(magic));
+	float absValue;
+	std::memcpy(&absValue, &absBits, sizeof(absValue));
+	const float sum = absValue + magic;
+	uint32_t sumBits;
+	std::memcpy(&sumBits, &sum, sizeof(sumBits));
+	return static_cast<uint16_t>(sign | (sumBits - magicBits));
+}
+
+float HalfToFloat(uint16_t value)
+{
+	const uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+	const uint32_t exponent = (value >> 10) & 0x1F;
+	const uint32_t mantissa = value & 0x3FF;
+
+	uint32_t bits;
+	if (exponent == 0x1F)
+	{
+		bits = sign | 0x7F800000 | (mantissa << 13);
+	}
+	else if (exponent != 0)
+	{
+		bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+	}
+	else
+	{
+		// Zero or denormal, mantissa * 2^-24
+		const float magnitude = static_cast<float>(mantissa) * 5.96046448e-8f;
+		std::memcpy(&bits, &magnitude, sizeof(bits));
+		bits |= sign;
+	}
+
+	float result;
+	std::memcpy(&result, &bits, sizeof(result));
+	return result;
+}
+
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+
+#include <immintrin.h>
+
+__m128i FloatToHalf4(__m128 values)
+{
+	return _mm_cvtps_ph(values, _MM_FROUND_TO_NEAREST_INT);
+}
+
+__m128 HalfToFloat4(__m128i halves)
+{
+	return _mm_cvtph_ps(halves);
+}
+
+#else
+
+__m128i FloatToHalf4(__m128 values)
+{
+	const __m128i signMask = _mm_set1_epi32(static_cast<int>(0x80000000u));
+	const __m128 sign = _mm_and_ps(values, _mm_castsi128_ps(signMask));
+	const __m128 absValues = _mm_xor_ps(values, sign);
+	const __m128i absBits = _mm_castps_si128(absValues);
+
+	// NaN and infinity, then everything from 65536 up (the rounding of the normal path takes 65520 up to infinity)
+	const __m128i isNan = _mm_castps_si128(_mm_cmpunord_ps(absValues, absValues));
+	const __m128i special = _mm_or_si128(_mm_and_si128(isNan, _mm_set1_epi32(0x200)), _mm_set1_epi32(0x7C00));
+	const __m128i isRegular = _mm_cmpgt_epi32(_mm_set1_epi32((127 + 16) << 23), absBits);
+
+	// Denormal half, the fpu rounds when adding a magic value whose ulp is the half denormal step (as FloatToHalf)
+	const __m128i magic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+	const __m128i denormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absValues, _mm_castsi128_ps(magic))), magic);
+	const __m128i isDenormal = _mm_cmpgt_epi32(_mm_set1_epi32((127 - 14) << 23), absBits);
+
+	// Normal half, rebias the exponent and round to nearest even
+	const __m128i odd = _mm_srai_epi32(_mm_slli_epi32(absBits, 31 - 13), 31);
+	const __m128i rounded = _mm_sub_epi32(_mm_add_epi32(absBits, _mm_set1_epi32(0xFFF - ((127 - 15) << 23))), odd);
+	const __m128i normal = _mm_srli_epi32(rounded, 13);
+
+	const __m128i finite = _mm_or_si128(_mm_and_si128(isDenormal, denormal), _mm_andnot_si128(isDenormal, normal));
+	const __m128i magnitude = _mm_or_si128(_mm_and_si128(isRegular, finite), _mm_andnot_si128(isRegular, special));
+
+	// The sign goes in as 0xFFFF8000 so the signed saturation of the pack keeps all 16 bits
+	const __m128i halves = _mm_or_si128(magnitude, _mm_srai_epi32(_mm_castps_si128(sign), 16));
+	return _mm_packs_epi32(halves, _mm_setzero_si128());
+}
+
+__m128 HalfToFloat4(__m128i halves)
+{
+	const __m128i widened = _mm_unpacklo_epi16(halves, _mm_setzero_si128());
+	const __m128i magnitude = _mm_and_si128(widened, _mm_set1_epi32(0x7FFF));
+	const __m128i sign = _mm_slli_epi32(_mm_xor_si128(widened, magnitude), 16);
+
+	// Shifted into a float and scaled by 2^112, which also normalizes the denormals
+	const __m128 scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(magnitude, 13)), _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23)));
+
+	// Infinity and NaN keep the top exponent
+	const __m128i infNan = _mm_and_si128(_mm_cmpgt_epi32(magnitude, _mm_set1_epi32(0x7BFF)), _mm_set1_epi32(255 << 23));
+	return _mm_or_ps(scaled, _mm_castsi128_ps(_mm_or_si128(sign, infNan)));
+}
+
+#endif
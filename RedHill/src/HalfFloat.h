@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+#include <emmintrin.h>
+
+// Float <-> IEEE half conversion (round to nearest even, denormals and infinities kept)
+uint16_t FloatToHalf(float value);
+float HalfToFloat(uint16_t value);
+
+// Same conversions 4 values at a time, the halves packed in the low 64 bits. F16C when the build targets it (AVX2 for
+// MSVC, -mf16c for gcc / clang), SSE2 otherwise.
+__m128i FloatToHalf4(__m128 values);
+__m128 HalfToFloat4(__m128i halves);
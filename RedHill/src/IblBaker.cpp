@@ -0,0 +1,531 @@
+#include "IblBaker.h"
+
+#include <cmath>
+#include <filesystem>
+#include <initializer_list>
+#include <span>
+#include <xmmintrin.h>
+
+#include "Config.h"
+#include "CookedTexture.h"
+#include "HalfFloat.h"
+#include "JobSystem.h"
+#include "MappedFile.h"
+
+static constexpr float kPi = 3.14159265359f;
+static constexpr uint32_t kSampleCount = 1024;	// SAMPLE_COUNT of PrefilterBake and Brdflut
+
+// Rows of a face filtered by one job
+static constexpr uint32_t kRowsPerJob = 16;
+
+// Hash of the map sizes and of the bake shaders, on top of the seed. Editing any of them bakes again.
+static uint64_t BakeHash(std::span<const uint32_t> settings, std::initializer_list<const char*> shaders, const uint64_t seed)
+{
+	uint64_t hash = HashBytes(settings.data(), settings.size_bytes(), seed);
+	for (const char* shader : shaders)
+	{
+		const uint64_t shaderHash = HashFileContents(shader);
+		hash = HashBytes(&shaderHash, sizeof(shaderHash), hash);
+	}
+	return hash;
+}
+
+uint64_t EnvironmentCacheKey(const std::string& hdrFile, const IblBakeSettings& settings)
+{
+	const uint32_t values[] = { settings.cubemapSize, settings.cubemapMips, settings.prefilterSize, settings.prefilterMips, settings.sharedExponentEquirect };
+	return BakeHash(values, { "Shaders/Fullscreen.hlsli", "Shaders/BakeCubemapShader.hlsl", "Shaders/MipDownsample.hlsl", "Shaders/PrefilterBake.hlsl" },
+		HashFileContents(hdrFile));
+}
+
+uint64_t EnvironmentCacheKey(const std::string& hdrFile)
+{
+	IblBakeSettings settings;
+	settings.sharedExponentEquirect = RHConfig::sharedExponentEquirect;
+	return EnvironmentCacheKey(hdrFile, settings);
+}
+
+uint64_t BrdfLutCacheKey(const uint32_t lutSize)
+{
+	// The LUT doesn't depend on the environments, it is cached on its own
+	const uint32_t values[] = { lutSize };
+	return BakeHash(values, { "Shaders/Brdflut.hlsl" }, 0);
+}
+
+uint64_t BrdfLutCacheKey()
+{
+	return BrdfLutCacheKey(kBrdfLutSize);
+}
+
+// The IBL cache lives with the cooked textures, one file per baked map of an environment
+std::string IblCachePath(const std::string& hdrFile, const char* suffix)
+{
+	return "resources/cooked/" + std::filesystem::path(hdrFile).filename().string() + suffix;
+}
+
+struct Float3
+{
+	float x, y, z;
+};
+
+static constexpr Float3 Cross(const Float3& a, const Float3& b)
+{
+	return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+static float Dot(const Float3& a, const Float3& b)
+{
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static Float3 Normalize(const Float3& v)
+{
+	const float scale = 1.0f / std::sqrt(Dot(v, v));
+	return { v.x * scale, v.y * scale, v.z * scale };
+}
+
+// Face basis of the GPU bake (Renderer::SetFaceBasis), a texel looks along right * x + up * y + forward
+struct FaceBasis
+{
+	Float3 right;
+	Float3 up;
+	Float3 forward;
+};
+
+static constexpr FaceBasis MakeFaceBasis(const Float3 forward, const Float3 up)
+{
+	return { Cross(up, forward), up, forward };
+}
+
+static constexpr FaceBasis kFaces[6] =
+{
+	MakeFaceBasis({ 1, 0, 0 }, { 0, 1, 0 }), MakeFaceBasis({ -1, 0, 0 }, { 0, 1, 0 }),
+	MakeFaceBasis({ 0, 1, 0 }, { 0, 0, -1 }), MakeFaceBasis({ 0, -1, 0 }, { 0, 0, 1 }),
+	MakeFaceBasis({ 0, 0, 1 }, { 0, 1, 0 }), MakeFaceBasis({ 0, 0, -1 }, { 0, 1, 0 })
+};
+
+// Normalized direction through the center of texel (x, y) of a face
+static Float3 TexelDirection(const uint32_t face, const uint32_t x, const uint32_t y, const uint32_t size)
+{
+	const float clipX = (x + 0.5f) / size * 2.0f - 1.0f;
+	const float clipY = 1.0f - (y + 0.5f) / size * 2.0f;
+	const FaceBasis& basis = kFaces[face];
+	return Normalize({
+		basis.right.x * clipX + basis.up.x * clipY + basis.forward.x,
+		basis.right.y * clipX + basis.up.y * clipY + basis.forward.y,
+		basis.right.z * clipX + basis.up.z * clipY + basis.forward.z });
+}
+
+// Face the direction points at (the major axis) and the [0, 1] coordinates in it, the inverse of TexelDirection
+static uint32_t CubeFace(const Float3& direction, float& u, float& v)
+{
+	const float absX = std::fabs(direction.x);
+	const float absY = std::fabs(direction.y);
+	const float absZ = std::fabs(direction.z);
+
+	uint32_t face;
+	float major;
+	if (absX >= absY && absX >= absZ)
+	{
+		face = direction.x >= 0.0f ? 0 : 1;
+		major = absX;
+	}
+	else if (absY >= absZ)
+	{
+		face = direction.y >= 0.0f ? 2 : 3;
+		major = absY;
+	}
+	else
+	{
+		face = direction.z >= 0.0f ? 4 : 5;
+		major = absZ;
+	}
+
+	u = 0.5f + 0.5f * Dot(direction, kFaces[face].right) / major;
+	v = 0.5f - 0.5f * Dot(direction, kFaces[face].up) / major;
+	return face;
+}
+
+static __m128 Lerp(const __m128 a, const __m128 b, const float t)
+{
+	return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), _mm_set1_ps(t)));
+}
+
+// Bilinear lookup in a face, clamped to its edges
+static __m128 SampleFace(const float* texels, const uint32_t size, const float u, const float v)
+{
+	const float x = u * size - 0.5f;
+	const float y = v * size - 0.5f;
+	const float floorX = std::floor(x);
+	const float floorY = std::floor(y);
+	const float tx = x - floorX;
+	const float ty = y - floorY;
+
+	const int last = static_cast<int>(size) - 1;
+	const int x0 = std::clamp(static_cast<int>(floorX), 0, last);
+	const int x1 = std::clamp(static_cast<int>(floorX) + 1, 0, last);
+	const int y0 = std::clamp(static_cast<int>(floorY), 0, last);
+	const int y1 = std::clamp(static_cast<int>(floorY) + 1, 0, last);
+
+	const float* row0 = texels + static_cast<size_t>(y0) * size * 4;
+	const float* row1 = texels + static_cast<size_t>(y1) * size * 4;
+	const __m128 top = Lerp(_mm_loadu_ps(row0 + x0 * 4), _mm_loadu_ps(row0 + x1 * 4), tx);
+	const __m128 bottom = Lerp(_mm_loadu_ps(row1 + x0 * 4), _mm_loadu_ps(row1 + x1 * 4), tx);
+	return Lerp(top, bottom, ty);
+}
+
+// SampleLevel with a trilinear sampler, the mip is clamped to the chain
+static __m128 SampleCubemap(const FloatCubemap& cubemap, const Float3& direction, const float mip)
+{
+	float u, v;
+	const uint32_t face = CubeFace(direction, u, v);
+
+	const float level = std::clamp(mip, 0.0f, static_cast<float>(cubemap.mipLevels - 1));
+	const uint32_t mip0 = static_cast<uint32_t>(level);
+	const float t = level - mip0;
+
+	const __m128 color = SampleFace(cubemap.Face(mip0, face), cubemap.MipSize(mip0), u, v);
+	if (t <= 0.0f)
+	{
+		return color;
+	}
+	return Lerp(color, SampleFace(cubemap.Face(mip0 + 1, face), cubemap.MipSize(mip0 + 1), u, v), t);
+}
+
+// Bilinear lookup in the equirectangular image, u wraps and v clamps like the sampler of the GPU bake
+static __m128 SampleEquirect(const uint8_t* texels, const HdrTexelFormat format, const uint32_t width, const uint32_t height, const uint32_t rowPitch, const float u, const float v)
+{
+	const float x = u * width - 0.5f;
+	const float y = v * height - 0.5f;
+	const float floorX = std::floor(x);
+	const float floorY = std::floor(y);
+	const float tx = x - floorX;
+	const float ty = y - floorY;
+
+	const int columns = static_cast<int>(width);
+	const int x0 = ((static_cast<int>(floorX) % columns) + columns) % columns;
+	const int x1 = (x0 + 1) % columns;
+	const int last = static_cast<int>(height) - 1;
+	const int y0 = std::clamp(static_cast<int>(floorY), 0, last);
+	const int y1 = std::clamp(static_cast<int>(floorY) + 1, 0, last);
+
+	const uint32_t texelBytes = HdrTexelBytes(format);
+	const uint8_t* row0 = texels + static_cast<size_t>(y0) * rowPitch;
+	const uint8_t* row1 = texels + static_cast<size_t>(y1) * rowPitch;
+	const __m128 top = Lerp(LoadHdrTexel(row0 + x0 * texelBytes, format), LoadHdrTexel(row0 + x1 * texelBytes, format), tx);
+	const __m128 bottom = Lerp(LoadHdrTexel(row1 + x0 * texelBytes, format), LoadHdrTexel(row1 + x1 * texelBytes, format), tx);
+	return Lerp(top, bottom, ty);
+}
+
+static FloatCubemap AllocateCubemap(const uint32_t size, const uint32_t mipLevels)
+{
+	FloatCubemap cubemap;
+	cubemap.size = size;
+	cubemap.mipLevels = mipLevels;
+	cubemap.levels.resize(mipLevels);
+	for (uint32_t mip = 0; mip < mipLevels; ++mip)
+	{
+		cubemap.levels[mip].resize(static_cast<size_t>(6) * cubemap.MipSize(mip) * cubemap.MipSize(mip) * 4);
+	}
+	return cubemap;
+}
+
+// Runs body(face, y) for every row of the 6 faces of a mip, rowsPerJob rows per job
+template <typename Body>
+static void ForEachFaceRow(const uint32_t size, const uint32_t rowsPerJob, const Body& body)
+{
+	const uint32_t bandsPerFace = (size + rowsPerJob - 1) / rowsPerJob;
+	JobSystem::Get().ParallelFor(static_cast<size_t>(6) * bandsPerFace, 1, [&](const size_t band)
+	{
+		const uint32_t face = static_cast<uint32_t>(band / bandsPerFace);
+		const uint32_t rowBegin = static_cast<uint32_t>(band % bandsPerFace) * rowsPerJob;
+		const uint32_t rowEnd = (std::min)(size, rowBegin + rowsPerJob);
+		for (uint32_t y = rowBegin; y < rowEnd; ++y)
+		{
+			body(face, y);
+		}
+	});
+}
+
+FloatCubemap BakeEnvironmentCubemap(const uint8_t* texels, const HdrTexelFormat format, const uint32_t width, const uint32_t height, const uint32_t rowPitch, const uint32_t size, const uint32_t mipLevels)
+{
+	FloatCubemap cubemap = AllocateCubemap(size, mipLevels);
+
+	ForEachFaceRow(size, kRowsPerJob, [&](const uint32_t face, const uint32_t y)
+	{
+		float* row = cubemap.Face(0, face) + static_cast<size_t>(y) * size * 4;
+		for (uint32_t x = 0; x < size; ++x)
+		{
+			const Float3 direction = TexelDirection(face, x, y, size);
+			const float u = 0.5f - std::atan2(direction.z, direction.x) * (1.0f / (2.0f * kPi));
+			const float v = 0.5f - std::asin(direction.y) * (1.0f / kPi);
+			_mm_storeu_ps(row + x * 4, SampleEquirect(texels, format, width, height, rowPitch, u, v));
+		}
+	});
+
+	// Each level reads the previous one, the faces and rows of a level go in parallel
+	for (uint32_t mip = 1; mip < mipLevels; ++mip)
+	{
+		const uint32_t sourceSize = cubemap.MipSize(mip - 1);
+		const uint32_t mipSize = cubemap.MipSize(mip);
+		ForEachFaceRow(mipSize, kRowsPerJob, [&](const uint32_t face, const uint32_t y)
+		{
+			const float* source0 = cubemap.Face(mip - 1, face) + static_cast<size_t>(y * 2) * sourceSize * 4;
+			const float* source1 = source0 + static_cast<size_t>(sourceSize) * 4;
+			float* row = cubemap.Face(mip, face) + static_cast<size_t>(y) * mipSize * 4;
+			for (uint32_t x = 0; x < mipSize; ++x)
+			{
+				const __m128 sum = _mm_add_ps(
+					_mm_add_ps(_mm_loadu_ps(source0 + x * 8), _mm_loadu_ps(source0 + x * 8 + 4)),
+					_mm_add_ps(_mm_loadu_ps(source1 + x * 8), _mm_loadu_ps(source1 + x * 8 + 4)));
+				_mm_storeu_ps(row + x * 4, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+			}
+		});
+	}
+	return cubemap;
+}
+
+// reversebits of HLSL
+static uint32_t ReverseBits(uint32_t bits)
+{
+	bits = (bits << 16) | (bits >> 16);
+	bits = ((bits & 0x00FF00FFu) << 8) | ((bits & 0xFF00FF00u) >> 8);
+	bits = ((bits & 0x0F0F0F0Fu) << 4) | ((bits & 0xF0F0F0F0u) >> 4);
+	bits = ((bits & 0x33333333u) << 2) | ((bits & 0xCCCCCCCCu) >> 2);
+	bits = ((bits & 0x55555555u) << 1) | ((bits & 0xAAAAAAAAu) >> 1);
+	return bits;
+}
+
+// Half vector of the Hammersley sample i around +Z, ImportanceSampleGGX before it goes to the normal frame
+static Float3 SampleGGX(const uint32_t i, const float roughness)
+{
+	const float xi0 = static_cast<float>(i) / static_cast<float>(kSampleCount);
+	const float xi1 = static_cast<float>(ReverseBits(i)) * 2.3283064365e-10f; // /2^32
+	const float a = roughness * roughness;
+	const float phi = 2.0f * kPi * xi0;
+	const float cosTheta = std::sqrt((1.0f - xi1) / (1.0f + (a * a - 1.0f) * xi1));
+	const float sinTheta = std::sqrt((std::max)(1.0f - cosTheta * cosTheta, 0.0f));
+	return { std::cos(phi) * sinTheta, std::sin(phi) * sinTheta, cosTheta };
+}
+
+// Frame ImportanceSampleGGX builds around the normal
+static void TangentFrame(const Float3& normal, Float3& tangent, Float3& bitangent)
+{
+	const Float3 up = std::fabs(normal.z) < 0.999f ? Float3{ 0.0f, 0.0f, 1.0f } : Float3{ 1.0f, 0.0f, 0.0f };
+	tangent = Normalize(Cross(up, normal));
+	bitangent = Cross(normal, tangent);
+}
+
+static Float3 ToFrame(const Float3& v, const Float3& tangent, const Float3& bitangent, const Float3& normal)
+{
+	return {
+		tangent.x * v.x + bitangent.x * v.y + normal.x * v.z,
+		tangent.y * v.x + bitangent.y * v.y + normal.y * v.z,
+		tangent.z * v.x + bitangent.z * v.y + normal.z * v.z };
+}
+
+static float NormalDistribution(const float NdotH, const float roughness)
+{
+	const float alpha = roughness * roughness;
+	const float squaredAlpha = alpha * alpha;
+	const float denom = NdotH * NdotH * (squaredAlpha - 1.0f) + 1.0f;
+	return squaredAlpha / (kPi * denom * denom);
+}
+
+// One GGX sample of the prefilter, V = N so everything but the direction is the same for every texel
+struct PrefilterSample
+{
+	Float3 direction;	// L around +Z
+	float NdotL;
+	float mip;
+};
+
+FloatCubemap PrefilterEnvironmentCubemap(const FloatCubemap& environment, const uint32_t size, const uint32_t mipLevels)
+{
+	FloatCubemap prefilter = AllocateCubemap(size, mipLevels);
+	const float texelSolidAngle = 4.0f * kPi / (6.0f * environment.size * environment.size);
+
+	for (uint32_t mip = 0; mip < mipLevels; ++mip)
+	{
+		const float roughness = mipLevels > 1 ? static_cast<float>(mip) / (mipLevels - 1) : 0.0f;
+		const uint32_t mipSize = prefilter.MipSize(mip);
+
+		// Every sample of a mirror is along the normal at mip 0, a single lookup is the same average
+		if (roughness <= 0.0f)
+		{
+			ForEachFaceRow(mipSize, kRowsPerJob, [&](const uint32_t face, const uint32_t y)
+			{
+				float* row = prefilter.Face(mip, face) + static_cast<size_t>(y) * mipSize * 4;
+				for (uint32_t x = 0; x < mipSize; ++x)
+				{
+					_mm_storeu_ps(row + x * 4, SampleCubemap(environment, TexelDirection(face, x, y, mipSize), 0.0f));
+					row[x * 4 + 3] = 1.0f;
+				}
+			});
+			continue;
+		}
+
+		std::vector<PrefilterSample> samples;
+		samples.reserve(kSampleCount);
+		float weight = 0.0f;
+		for (uint32_t i = 0; i < kSampleCount; ++i)
+		{
+			const Float3 h = SampleGGX(i, roughness);
+			const Float3 l = { 2.0f * h.z * h.x, 2.0f * h.z * h.y, 2.0f * h.z * h.z - 1.0f };
+			if (l.z > 0.0f)
+			{
+				// NdotH and VdotH are both h.z
+				const float pdf = NormalDistribution(h.z, roughness) * h.z / (4.0f * h.z) + 1e-4f;
+				const float sampleSolidAngle = 1.0f / (kSampleCount * pdf + 1e-4f);
+				samples.push_back({ l, l.z, 0.5f * std::log2(sampleSolidAngle / texelSolidAngle) });
+				weight += l.z;
+			}
+		}
+		const __m128 invWeight = _mm_set1_ps(1.0f / (std::max)(weight, 0.001f));
+
+		// A texel is 1024 lookups, one row per job
+		ForEachFaceRow(mipSize, 1, [&](const uint32_t face, const uint32_t y)
+		{
+			float* row = prefilter.Face(mip, face) + static_cast<size_t>(y) * mipSize * 4;
+			for (uint32_t x = 0; x < mipSize; ++x)
+			{
+				const Float3 normal = TexelDirection(face, x, y, mipSize);
+				Float3 tangent, bitangent;
+				TangentFrame(normal, tangent, bitangent);
+
+				__m128 color = _mm_setzero_ps();
+				for (const PrefilterSample& sample : samples)
+				{
+					const __m128 radiance = SampleCubemap(environment, ToFrame(sample.direction, tangent, bitangent, normal), sample.mip);
+					color = _mm_add_ps(color, _mm_mul_ps(radiance, _mm_set1_ps(sample.NdotL)));
+				}
+				_mm_storeu_ps(row + x * 4, _mm_mul_ps(color, invWeight));
+				row[x * 4 + 3] = 1.0f;
+			}
+		});
+	}
+	return prefilter;
+}
+
+std::vector<float> IntegrateBrdfLut(const uint32_t size)
+{
+	std::vector<float> lut(static_cast<size_t>(size) * size * 2);
+
+	const Float3 normal = { 0.0f, 0.0f, 1.0f };
+	Float3 tangent, bitangent;
+	TangentFrame(normal, tangent, bitangent);
+
+	JobSystem::Get().ParallelFor(size, 1, [&](const size_t y)
+	{
+		const float roughness = (y + 0.5f) / size;
+		const __m128 k = _mm_set1_ps(roughness * roughness / 2.0f);
+		const __m128 oneMinusK = _mm_sub_ps(_mm_set1_ps(1.0f), k);
+
+		// Half vectors of the row, 4 samples per iteration of the texels
+		alignas(16) float hx[kSampleCount];
+		alignas(16) float hz[kSampleCount];
+		for (uint32_t i = 0; i < kSampleCount; ++i)
+		{
+			const Float3 h = Normalize(ToFrame(SampleGGX(i, roughness), tangent, bitangent, normal));
+			hx[i] = h.x;
+			hz[i] = h.z;
+		}
+
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		float* row = lut.data() + y * size * 2;
+		for (uint32_t x = 0; x < size; ++x)
+		{
+			// v = (sqrt(1 - NdotV^2), 0, NdotV)
+			const float clampedNdotV = (std::max)((x + 0.5f) / size, 0.0001f);
+			const __m128 NdotV = _mm_set1_ps(clampedNdotV);
+			const __m128 vx = _mm_set1_ps(std::sqrt(1.0f - clampedNdotV * clampedNdotV));
+			const __m128 geometryV = _mm_div_ps(NdotV, _mm_add_ps(_mm_mul_ps(NdotV, oneMinusK), k));
+
+			__m128 scale = zero;
+			__m128 bias = zero;
+			for (uint32_t i = 0; i < kSampleCount; i += 4)
+			{
+				const __m128 hxi = _mm_load_ps(hx + i);
+				const __m128 hzi = _mm_load_ps(hz + i);
+				const __m128 VdotHRaw = _mm_add_ps(_mm_mul_ps(vx, hxi), _mm_mul_ps(NdotV, hzi));
+
+				// l = reflect(-v, h), only its z matters
+				const __m128 lz = _mm_sub_ps(_mm_mul_ps(_mm_add_ps(VdotHRaw, VdotHRaw), hzi), NdotV);
+				const __m128 NdotL = _mm_max_ps(lz, zero);
+				const __m128 mask = _mm_cmpgt_ps(NdotL, zero);
+
+				const __m128 NdotH = _mm_max_ps(hzi, zero);
+				const __m128 VdotH = _mm_max_ps(VdotHRaw, zero);
+				const __m128 geometryL = _mm_div_ps(NdotL, _mm_add_ps(_mm_mul_ps(NdotL, oneMinusK), k));
+				const __m128 denom = _mm_max_ps(_mm_mul_ps(NdotH, NdotV), _mm_set1_ps(1e-4f));
+				const __m128 Gv = _mm_div_ps(_mm_mul_ps(_mm_mul_ps(geometryL, geometryV), VdotH), denom);
+
+				const __m128 f = _mm_sub_ps(one, VdotH);
+				const __m128 f2 = _mm_mul_ps(f, f);
+				const __m128 Fc = _mm_mul_ps(_mm_mul_ps(f2, f2), f);
+
+				// The masked out lanes can be 0 / 0, the and drops them
+				scale = _mm_add_ps(scale, _mm_and_ps(mask, _mm_mul_ps(_mm_sub_ps(one, Fc), Gv)));
+				bias = _mm_add_ps(bias, _mm_and_ps(mask, _mm_mul_ps(Fc, Gv)));
+			}
+						alignas(16) float scaleLanes[4];
+			alignas(16) float biasLanes[4];
+			_mm_store_ps(scaleLanes, scale);
+			_mm_store_ps(biasLanes, bias);
+			row[x * 2 + 0] = (scaleLanes[0] + scaleLanes[1] + scaleLanes[2] + scaleLanes[3]) / kSampleCount;
+			row[x * 2 + 1] = (biasLanes[0] + biasLanes[1] + biasLanes[2] + biasLanes[3]) / kSampleCount;
+		}
+	});
+	return lut;
+}
+
+std::vector<uint8_t> CookCubemap(const FloatCubemap& cubemap, const uint64_t sourceHash)
+{
+	// Subresources in the D3D12 order, mip + face * mipLevels
+	const uint32_t subresourceCount = 6 * cubemap.mipLevels;
+	std::vector<std::vector<uint16_t>> halves(subresourceCount);
+	JobSystem::Get().ParallelFor(subresourceCount, 1, [&](const size_t index)
+	{
+		const uint32_t mip = static_cast<uint32_t>(index % cubemap.mipLevels);
+		const uint32_t face = static_cast<uint32_t>(index / cubemap.mipLevels);
+		const size_t count = static_cast<size_t>(cubemap.MipSize(mip)) * cubemap.MipSize(mip) * 4;
+		const float* texels = cubemap.Face(mip, face);
+		halves[index].resize(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			halves[index][i] = FloatToHalf(texels[i]);
+		}
+	});
+
+	std::vector<TextureSubresource> subresources(subresourceCount);
+	for (uint32_t index = 0; index < subresourceCount; ++index)
+	{
+		const uint32_t mipSize = cubemap.MipSize(index % cubemap.mipLevels);
+		subresources[index] = { reinterpret_cast<const uint8_t*>(halves[index].data()), mipSize, mipSize, mipSize, mipSize * 4 * 2 };
+	}
+
+	CookedTextureDesc desc;
+	desc.format = kIblCubemapFormat;
+	desc.flags = kCookedTextureCubemap;
+	desc.width = cubemap.size;
+	desc.height = cubemap.size;
+	desc.arraySize = 6;
+	desc.mipLevels = cubemap.mipLevels;
+	return BuildCookedTexture(sourceHash, desc, subresources);
+}
+
+std::vector<uint8_t> CookBrdfLut(const std::vector<float>& lut, const uint32_t size, const uint64_t sourceHash)
+{
+	std::vector<uint16_t> halves(lut.size());
+	for (size_t i = 0; i < lut.size(); ++i)
+	{
+		halves[i] = FloatToHalf(lut[i]);
+	}
+
+	const TextureSubresource subresource = { reinterpret_cast<const uint8_t*>(halves.data()), size, size, size, size * 2 * 2 };
+	CookedTextureDesc desc;
+	desc.format = kIblBrdfLutFormat;
+	desc.width = size;
+	desc.height = size;
+	return BuildCookedTexture(sourceHash, desc, std::span<const TextureSubresource>(&subresource, 1));
+}
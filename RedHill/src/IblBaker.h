@@ -0,0 +1,69 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "RadianceHdr.h"
+
+// Sizes of the baked image based lighting maps
+static constexpr uint32_t kCubemapSize = 1024;
+static constexpr uint32_t kCubemapMips = 11;
+static constexpr uint32_t kPrefilterSize = 128;
+static constexpr uint32_t kPrefilterMips = 5;
+static constexpr uint32_t kBrdfLutSize = 512;
+
+// DXGI_FORMAT of the cooked maps, the baker doesn't pull the Windows headers in
+static constexpr uint32_t kIblCubemapFormat = 10;	// DXGI_FORMAT_R16G16B16A16_FLOAT
+static constexpr uint32_t kIblBrdfLutFormat = 34;	// DXGI_FORMAT_R16G16_FLOAT
+
+// Everything an environment bake depends on besides the HDR file and the shaders
+struct IblBakeSettings
+{
+	uint32_t cubemapSize = kCubemapSize;
+	uint32_t cubemapMips = kCubemapMips;
+	uint32_t prefilterSize = kPrefilterSize;
+	uint32_t prefilterMips = kPrefilterMips;
+	bool sharedExponentEquirect = false;
+};
+
+// Keys and files of the IBL cache. The GPU bakes of the renderer and the CPU baker make the same maps, so whichever
+// one runs fills the cache for the other. The keys hash the map sizes and the bake shaders (the reference the CPU
+// baker follows, read from Shaders/ under the working directory), on top of the HDR file for an environment. The
+// overloads without settings key the renderer's own.
+uint64_t EnvironmentCacheKey(const std::string& hdrFile, const IblBakeSettings& settings);
+uint64_t EnvironmentCacheKey(const std::string& hdrFile);
+uint64_t BrdfLutCacheKey(uint32_t lutSize);
+uint64_t BrdfLutCacheKey();
+std::string IblCachePath(const std::string& hdrFile, const char* suffix);
+static constexpr char kBrdfLutCacheFile[] = "resources/cooked/brdf_lut.rhtex";
+
+// RGBA32F cubemap and its mips, faces in the D3D12 order (+X, -X, +Y, -Y, +Z, -Z) with the orientation of the GPU bake
+struct FloatCubemap
+{
+	uint32_t size = 0;
+	uint32_t mipLevels = 0;
+	std::vector<std::vector<float>> levels;		// The 6 faces of a mip one after the other, rows tightly packed
+
+	uint32_t MipSize(const uint32_t mip) const { return (std::max)(size >> mip, 1u); }
+	const float* Face(const uint32_t mip, const uint32_t face) const { return levels[mip].data() + static_cast<size_t>(face) * MipSize(mip) * MipSize(mip) * 4; }
+	float* Face(const uint32_t mip, const uint32_t face) { return levels[mip].data() + static_cast<size_t>(face) * MipSize(mip) * MipSize(mip) * 4; }
+};
+
+// CPU versions of the GPU bakes, same math as the shaders they follow. The rows of every face are split over the job
+// system and the texels are filtered with SSE over their 4 channels. Face sizes are powers of two.
+//
+// BakeCubemapShader + MipDownsample: bilinear lookups in the decoded equirectangular image (rows rowPitch bytes apart,
+// u wraps, v clamps), then a 2x2 box filter down the chain.
+FloatCubemap BakeEnvironmentCubemap(const uint8_t* texels, HdrTexelFormat format, uint32_t width, uint32_t height, uint32_t rowPitch, uint32_t size, uint32_t mipLevels);
+// PrefilterBake: 1024 GGX importance samples per texel with the mip picked from the sample solid angle, roughness
+// mip / (mipLevels - 1). The samples only depend on the roughness, they are built once per mip and rotated around each
+// texel normal. The lookups filter inside a face, the hardware also blends across the face edges.
+FloatCubemap PrefilterEnvironmentCubemap(const FloatCubemap& environment, uint32_t size, uint32_t mipLevels);
+// Brdflut: scale and bias of the split sum, NdotV along x and roughness along y, RG pairs
+std::vector<float> IntegrateBrdfLut(uint32_t size);
+
+// Cooked textures in the layout the renderer creates the maps with: RGBA16F cubemap, R16G16F LUT
+std::vector<uint8_t> CookCubemap(const FloatCubemap& cubemap, uint64_t sourceHash);
+std::vector<uint8_t> CookBrdfLut(const std::vector<float>& lut, uint32_t size, uint64_t sourceHash);
@@ -0,0 +1,167 @@
+#include "Icosphere.h"
+
+#include <windows.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "FlatHashMap.h"
+
+struct EdgeKeyHash
+{
+	size_t operator()(const uint64_t key) const noexcept
+	{
+		return static_cast<size_t>(MixHash64(key));
+	}
+};
+
+void GenerateIcosphere(uint32_t subdivisions, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<MeshLod>& lods)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	vertices.clear();
+	indices.clear();
+	lods.clear();
+
+	// Closed form sizes, level n has 20 * 4^n triangles, 30 * 4^n edges and 10 * 4^n + 2 vertices.
+	// Subdividing only appends vertices so the vertices of a level are a prefix of the ones of the next level.
+	auto TriangleCount = [](uint32_t level) -> size_t { return static_cast<size_t>(20) << (2 * level); };
+	auto EdgeCount = [](uint32_t level) -> size_t { return static_cast<size_t>(30) << (2 * level); };
+	auto VertexCount = [](uint32_t level) -> size_t { return (static_cast<size_t>(10) << (2 * level)) + 2; };
+
+	size_t totalIndexCount = 0;
+	for (uint32_t level = 0; level <= subdivisions; ++level)
+	{
+		totalIndexCount += TriangleCount(level) * 3;
+	}
+
+	vertices.reserve(VertexCount(subdivisions));
+	indices.reserve(totalIndexCount);
+	lods.reserve(subdivisions + 1);
+
+	// Add the vertices to the vertex buffer, project them into the unit sphere and keep track of the indices in the index buffer
+	auto AddVertex = [&vertices](float x, float y, float z) -> uint32_t
+	{
+		float invLength = 1.0f / sqrtf(x * x + y * y + z * z);
+		Vertex v = {};
+		v.position[0] = x * invLength;
+		v.position[1] = y * invLength;
+		v.position[2] = z * invLength;
+
+		// Normal is the same as the position for a unit sphere
+		v.normal[0] = v.position[0];
+		v.normal[1] = v.position[1];
+		v.normal[2] = v.position[2];
+
+		uint32_t index = static_cast<uint32_t>(vertices.size());
+		vertices.push_back(v);
+		return index;
+	};
+
+	const float phi = (1.0f + sqrt(5.0f)) * 0.5f; // golden ratio
+	// Add the 12 base vertices of an icosahedron
+
+	AddVertex(-1.0f, phi, 0.0f);
+	AddVertex(1.0f, phi, 0.0f);
+	AddVertex(-1.0f, -phi, 0.0f);
+	AddVertex(1.0f, -phi, 0.0f);
+
+	AddVertex(0.0f, -1.0f, phi);
+	AddVertex(0.0f, 1.0f, phi);
+	AddVertex(0.0f, -1.0f, -phi);
+	AddVertex(0.0f, 1.0f, -phi);
+
+	AddVertex(phi, 0.0f, -1.0f);
+	AddVertex(phi, 0.0f, 1.0f);
+	AddVertex(-phi, 0.0f, -1.0f);
+	AddVertex(-phi, 0.0f, 1.0f);
+
+	// Level 0 is the icosahedron itself
+	indices =
+	{
+		0, 11, 5,   0, 5, 1,    0, 1, 7,    0, 7, 10,   0, 10, 11,
+		1, 5, 9,    5, 11, 4,   11, 10, 2,  10, 7, 6,   7, 1, 8,
+		3, 9, 4,    3, 4, 2,    3, 2, 6,    3, 6, 8,    3, 8, 9,
+		4, 9, 5,    2, 4, 11,   6, 2, 10,   8, 6, 7,    9, 8, 1
+	};
+	// Farthest distance of the triangles of a level from the unit sphere. The vertices are on the sphere, so the point of a
+	// triangle closest to the center is its circumcenter (the triangles are all acute), at the distance of its plane.
+	// The subdivided triangles aren't equilateral, the ones in the middle of the icosahedron faces are the biggest and
+	// deviate about 1.43x more than an even split of the angles would.
+	auto LevelError = [&](uint32_t indexOffset, uint32_t indexCount) -> float
+	{
+		float minPlaneDistance = 1.0f;
+		for (uint32_t j = indexOffset; j < indexOffset + indexCount; j += 3)
+		{
+			const float* a = vertices[indices[j]].position;
+			const float* b = vertices[indices[j + 1]].position;
+			const float* c = vertices[indices[j + 2]].position;
+			const float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			const float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+			const float n[3] = { ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0] };
+			const float distance = (n[0] * a[0] + n[1] * a[1] + n[2] * a[2]) / sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			minPlaneDistance = (std::min)(minPlaneDistance, distance);
+		}
+		return 1.0f - minPlaneDistance;
+	};
+
+	lods.push_back({ 0, static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(vertices.size()), LevelError(0, static_cast<uint32_t>(indices.size())) });
+
+	// Midpoints of the edges of the level being subdivided, sized for the biggest level and cleared between levels
+	FlatHashMap<uint64_t, uint32_t, EdgeKeyHash> midPoints(subdivisions > 0 ? EdgeCount(subdivisions - 1) : 0);
+
+	auto GetMidPoint = [&](uint32_t a, uint32_t b) -> uint32_t
+	{
+		auto lohi = std::minmax(a, b);
+		auto key = static_cast<uint64_t>(lohi.first) << 32 | static_cast<uint64_t>(lohi.second);
+
+		bool inserted = false;
+		const uint32_t midIndex = midPoints.FindOrInsert(key, static_cast<uint32_t>(vertices.size()), inserted);
+		if (inserted)
+		{
+			const Vertex& va = vertices[a];
+			const Vertex& vb = vertices[b];
+			AddVertex(
+				(va.position[0] + vb.position[0]) * 0.5f,
+				(va.position[1] + vb.position[1]) * 0.5f,
+				(va.position[2] + vb.position[2]) * 0.5f
+			);
+		}
+		return midIndex;
+	};
+
+	// Every level reads the previous range of indices and appends its own, the arrays are reserved so they never move
+	for (uint32_t level = 1; level <= subdivisions; ++level)
+	{
+		midPoints.Clear();
+
+		const MeshLod previous = lods.back();
+		const uint32_t levelOffset = static_cast<uint32_t>(indices.size());
+
+		for (uint32_t j = previous.indexOffset; j < previous.indexOffset + previous.indexCount; j += 3)
+		{
+			uint32_t v0 = indices[j];
+			uint32_t v1 = indices[j + 1];
+			uint32_t v2 = indices[j + 2];
+
+			uint32_t v01 = GetMidPoint(v0, v1);
+			uint32_t v12 = GetMidPoint(v1, v2);
+			uint32_t v20 = GetMidPoint(v2, v0);
+
+			indices.insert(indices.end(), { v0, v01, v20 });
+			indices.insert(indices.end(), { v1, v12, v01 });
+			indices.insert(indices.end(), { v2, v20, v12 });
+			indices.insert(indices.end(), { v01, v12, v20 });
+		}
+
+		const uint32_t levelCount = static_cast<uint32_t>(indices.size()) - levelOffset;
+		lods.push_back({ levelOffset, levelCount, static_cast<uint32_t>(vertices.size()), LevelError(levelOffset, levelCount) });
+	}
+
+	const auto end = std::chrono::steady_clock::now();
+	char message[128];
+	sprintf_s(message, "Icosphere (%u subdivisions): %zu vertices, %zu indices in %.3f ms\n", subdivisions,
+		vertices.size(), indices.size(), std::chrono::duration<double, std::milli>(end - start).count());
+	::OutputDebugStringA(message);
+}
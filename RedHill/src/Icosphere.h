@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "MeshTypes.h"
+
+// Unit icosphere with every subdivision level 0..subdivisions as a LOD, coarsest first. Subdividing only appends
+// vertices, so each level indexes a prefix of the vertex buffer, and the midpoint of an edge is shared by the two
+// triangles of the level that use it. The lods carry the distance from the unit sphere at the center of the triangles.
+void GenerateIcosphere(uint32_t subdivisions, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<MeshLod>& lods);
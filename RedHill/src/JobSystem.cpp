@@ -0,0 +1,297 @@
+#include "JobSystem.h"
+
+#include <cstdlib>
+
+#include "Config.h"
+
+// Rounds of stealing an idle worker does before it goes to sleep
+static constexpr uint32_t kIdleSpins = 64;
+
+struct Job
+{
+	std::function<void()> function;
+	JobCounter* counter = nullptr;
+};
+
+// Worker of the calling thread, UINT32_MAX on threads that don't belong to the system
+struct WorkerIdentity
+{
+	const JobSystem* system = nullptr;
+	uint32_t index = UINT32_MAX;
+};
+static thread_local WorkerIdentity t_worker;
+
+JobCounter::~JobCounter()
+{
+	// Destroying a counter with jobs in flight or continuations that never ran is a missing Wait
+	if (!IsDone() || !m_continuations.empty())
+	{
+		std::abort();
+	}
+}
+
+bool WorkStealingDeque::Push(Job* job)
+{
+	const int64_t bottom = m_bottom.load(std::memory_order_relaxed);
+	const int64_t top = m_top.load(std::memory_order_acquire);
+	if (bottom - top >= kCapacity)
+	{
+		return false;
+	}
+
+	m_jobs[bottom & (kCapacity - 1)].store(job, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	m_bottom.store(bottom + 1, std::memory_order_relaxed);
+	return true;
+}
+
+Job* WorkStealingDeque::Pop()
+{
+	const int64_t bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+	m_bottom.store(bottom, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t top = m_top.load(std::memory_order_relaxed);
+
+	if (top > bottom)
+	{
+		// Empty
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	Job* job = m_jobs[bottom & (kCapacity - 1)].load(std::memory_order_relaxed);
+	if (top == bottom)
+	{
+		// Last job, race the thieves for it
+		if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		{
+			job = nullptr;
+		}
+		m_bottom.store(bottom + 1, std::memory_order_relaxed);
+	}
+	return job;
+}
+
+Job* WorkStealingDeque::Steal()
+{
+	int64_t top = m_top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	const int64_t bottom = m_bottom.load(std::memory_order_acquire);
+	if (top >= bottom)
+	{
+		return nullptr;
+	}
+
+	// The slot can't be reused before top moves past it (Push fails when full), so it is safe to read before the CAS
+	Job* job = m_jobs[top & (kCapacity - 1)].load(std::memory_order_relaxed);
+	if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+	{
+		return nullptr;
+	}
+	return job;
+}
+
+JobSystem::JobSystem(uint32_t workerCount)
+{
+	if (workerCount == 0)
+	{
+		workerCount = (std::max)(1u, std::thread::hardware_concurrency()) - 1;
+	}
+
+	m_deques.reserve(workerCount);
+	for (uint32_t i = 0; i < workerCount; ++i)
+	{
+		m_deques.push_back(std::make_unique<WorkStealingDeque>());
+	}
+
+	m_workers.reserve(workerCount);
+	for (uint32_t i = 0; i < workerCount; ++i)
+	{
+		m_workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+JobSystem& JobSystem::Get()
+{
+	static JobSystem system(RHConfig::jobWorkers);
+	return system;
+}
+
+void JobSystem::Run(std::function<void()> function, JobCounter* counter)
+{
+	if (counter)
+	{
+		counter->m_pending.fetch_add(1);
+	}
+	Push(new Job{ std::move(function), counter });
+}
+
+void JobSystem::RunAfter(JobCounter& dependency, std::function<void()> function, JobCounter* counter)
+{
+	if (counter)
+	{
+		counter->m_pending.fetch_add(1);
+	}
+	Job* job = new Job{ std::move(function), counter };
+
+	{
+		// Checked under the lock so it can't miss the release done by the last job of the dependency
+		std::lock_guard<std::mutex> lock(dependency.m_mutex);
+		if (dependency.m_pending.load() != 0)
+		{
+			dependency.m_continuations.push_back(job);
+			return;
+		}
+	}
+	Push(job);
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+	while (!counter.IsDone())
+	{
+		if (Job* job = FindJob())
+		{
+			Execute(job);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::Push(Job* job)
+{
+	// Counted before it is visible so the count never goes below the jobs that can be taken. Both sides are seq_cst:
+	// either the push sees the sleeper or the sleeper sees the queued job before it waits.
+	m_queued.fetch_add(1);
+
+	const bool isWorker = t_worker.system == this;
+	if (!isWorker || !m_deques[t_worker.index]->Push(job))
+	{
+		std::lock_guard<std::mutex> lock(m_sharedMutex);
+		m_shared.push_back(job);
+	}
+
+	if (m_sleeping.load() > 0)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_sleepMutex);
+		}
+		m_wake.notify_one();
+	}
+}
+
+Job* JobSystem::FindJob()
+{
+	if (m_queued.load() == 0)
+	{
+		return nullptr;
+	}
+
+	const bool isWorker = t_worker.system == this;
+	const uint32_t self = isWorker ? t_worker.index : 0;
+
+	Job* job = isWorker ? m_deques[self]->Pop() : nullptr;
+	if (!job)
+	{
+		std::lock_guard<std::mutex> lock(m_sharedMutex);
+		if (!m_shared.empty())
+		{
+			job = m_shared.front();
+			m_shared.pop_front();
+		}
+	}
+
+	// Steal starting from the next worker so the thieves spread over the deques
+	const size_t dequeCount = m_deques.size();
+	for (size_t i = 0; !job && i < dequeCount; ++i)
+	{
+		const size_t victim = (self + 1 + i) % dequeCount;
+		if (!isWorker || victim != self)
+		{
+			job = m_deques[victim]->Steal();
+		}
+	}
+
+	if (job)
+	{
+		m_queued.fetch_sub(1);
+	}
+	return job;
+}
+
+void JobSystem::Execute(Job* job)
+{
+	job->function();
+
+	if (JobCounter* counter = job->counter)
+	{
+		counter->m_finishing.fetch_add(1);
+		if (counter->m_pending.fetch_sub(1) == 1)
+		{
+			std::vector<Job*> ready;
+			{
+				std::lock_guard<std::mutex> lock(counter->m_mutex);
+				if (counter->m_pending.load() == 0)
+				{
+					ready.swap(counter->m_continuations);
+				}
+			}
+			for (Job* continuation : ready)
+			{
+				Push(continuation);
+			}
+		}
+		counter->m_finishing.fetch_sub(1);
+	}
+
+	delete job;
+}
+
+void JobSystem::WorkerLoop(const uint32_t index)
+{
+	t_worker = { this, index };
+
+	uint32_t idleSpins = 0;
+	for (;;)
+	{
+		if (Job* job = FindJob())
+		{
+			Execute(job);
+			idleSpins = 0;
+			continue;
+		}
+
+		if (++idleSpins < kIdleSpins)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_sleeping.fetch_add(1);
+		m_wake.wait(lock, [this]() { return m_stop || m_queued.load() > 0; });
+		m_sleeping.fetch_sub(1);
+		if (m_stop)
+		{
+			return;
+		}
+		idleSpins = 0;
+	}
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct Job;
+
+// Number of jobs in flight that were started with the counter. Waiting on it runs other jobs instead of blocking, and
+// jobs started with RunAfter wait for it to reach zero before they are queued.
+class JobCounter
+{
+public:
+	JobCounter() = default;
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+	~JobCounter();
+
+	bool IsDone() const
+	{
+		return m_pending.load() == 0 && m_finishing.load() == 0;
+	}
+
+private:
+	friend class JobSystem;
+
+	std::atomic<uint32_t> m_pending = 0;
+	std::atomic<uint32_t> m_finishing = 0;	// Jobs past their decrement that still touch the counter, so a waiter doesn't free it under them
+	std::mutex m_mutex;
+	std::vector<Job*> m_continuations;
+};
+
+// Chase-Lev deque of one worker. The owner pushes and pops at the bottom, the other threads steal from the top.
+// The capacity is fixed, a full deque makes Push fail and the job goes to the shared queue instead.
+class WorkStealingDeque
+{
+public:
+	static constexpr int64_t kCapacity = 4096;
+
+	bool Push(Job* job);
+	Job* Pop();
+	Job* Steal();
+
+private:
+	alignas(64) std::atomic<int64_t> m_top = 0;
+	alignas(64) std::atomic<int64_t> m_bottom = 0;
+	std::unique_ptr<std::atomic<Job*>[]> m_jobs = std::make_unique<std::atomic<Job*>[]>(kCapacity);
+};
+
+// Worker threads with one work stealing deque each. Jobs started from a worker go to its own deque (the last one
+// pushed runs first, idle workers steal the oldest ones), jobs started from any other thread go to a shared queue.
+// Threads that wait on a counter run jobs in the meantime, so waits can nest (a parallel for inside a job is fine).
+class JobSystem
+{
+public:
+	// workerCount == 0 starts one worker per hardware thread besides the calling one
+	explicit JobSystem(uint32_t workerCount = 0);
+	~JobSystem();
+
+	// Shared instance with RHConfig::jobWorkers workers, created on first use
+	static JobSystem& Get();
+
+	// Threads that run jobs, the workers plus the thread that waits
+	uint32_t ThreadCount() const { return static_cast<uint32_t>(m_workers.size()) + 1; }
+
+	void Run(std::function<void()> function, JobCounter* counter = nullptr);
+
+	// Queues the job once dependency reaches zero (right away if it already did)
+	void RunAfter(JobCounter& dependency, std::function<void()> function, JobCounter* counter = nullptr);
+
+	void Wait(JobCounter& counter);
+
+	// Calls body(i) for every i in [0, count). Indices are split in batches of at least grain, the calling thread runs
+	// the first batch and then helps with the rest until all of them are done.
+	template<typename Function>
+	void ParallelFor(const size_t count, const size_t grain, const Function& body)
+	{
+		const size_t batchSize = (std::max)((std::max)(grain, size_t(1)), (count + ThreadCount() * 4 - 1) / (ThreadCount() * 4));
+		const size_t batchCount = (count + batchSize - 1) / batchSize;
+
+		auto RunBatch = [&body, batchSize, count](const size_t batch)
+		{
+			const size_t end = (std::min)(count, (batch + 1) * batchSize);
+			for (size_t i = batch * batchSize; i < end; ++i)
+			{
+				body(i);
+			}
+		};
+
+		JobCounter counter;
+		for (size_t batch = 1; batch < batchCount; ++batch)
+		{
+			Run([&RunBatch, batch]() { RunBatch(batch); }, &counter);
+		}
+		if (batchCount > 0)
+		{
+			RunBatch(0);
+		}
+		Wait(counter);
+	}
+
+private:
+	void Push(Job* job);
+	Job* FindJob();
+	void Execute(Job* job);
+	void WorkerLoop(uint32_t index);
+
+	std::vector<std::thread> m_workers;
+	std::vector<std::unique_ptr<WorkStealingDeque>> m_deques;
+
+	// Jobs started outside of the workers or that didn't fit in a deque
+	std::mutex m_sharedMutex;
+	std::deque<Job*> m_shared;
+
+	// Idle workers sleep until a job is queued
+	std::atomic<uint32_t> m_queued = 0;
+	std::atomic<uint32_t> m_sleeping = 0;
+	std::mutex m_sleepMutex;
+	std::condition_variable m_wake;
+	bool m_stop = false;
+};
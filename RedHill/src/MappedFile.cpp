@@ -0,0 +1,131 @@
+#include "MappedFile.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#ifdef _WIN32
+bool MappedFile::Open(const std::string& path)
+{
+	Close();
+
+	m_file = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize = {};
+	if (!::GetFileSizeEx(m_file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+
+	m_mapping = ::CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_mapping == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	m_data = static_cast<const uint8_t*>(::MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (m_data == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	m_size = static_cast<size_t>(fileSize.QuadPart);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_data)
+	{
+		::UnmapViewOfFile(m_data);
+		m_data = nullptr;
+	}
+	if (m_mapping)
+	{
+		::CloseHandle(m_mapping);
+		m_mapping = nullptr;
+	}
+	if (m_file != INVALID_HANDLE_VALUE)
+	{
+		::CloseHandle(m_file);
+		m_file = INVALID_HANDLE_VALUE;
+	}
+	m_size = 0;
+}
+#else
+bool MappedFile::Open(const std::string& path)
+{
+	Close();
+
+	const int file = ::open(path.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		return false;
+	}
+
+	// The mapping keeps the file alive, the descriptor isn't needed after mmap
+	struct stat fileStat = {};
+	void* data = MAP_FAILED;
+	if (::fstat(file, &fileStat) == 0 && fileStat.st_size > 0)
+	{
+		data = ::mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	}
+	::close(file);
+
+	if (data == MAP_FAILED)
+	{
+		return false;
+	}
+
+	m_data = static_cast<const uint8_t*>(data);
+	m_size = static_cast<size_t>(fileStat.st_size);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_data)
+	{
+		::munmap(const_cast<uint8_t*>(m_data), m_size);
+		m_data = nullptr;
+	}
+	m_size = 0;
+}
+#endif
+
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	uint64_t hash = seed;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+uint64_t HashFileContents(const std::string& path)
+{
+	MappedFile file;
+	if (!file.Open(path))
+	{
+		return 0;
+	}
+	return HashBytes(file.Data(), file.Size());
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN             // Exclude rarely-used stuff from Windows headers.
+#endif
+
+#include <windows.h>
+#endif
+
+#include <cstdint>
+#include <string>
+
+// Read only memory mapping of a whole file. The view stays valid for the lifetime of the object. mmap on other
+// platforms so the cooking code (IblBaker, CookedTexture) also builds there.
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const std::string& path);
+	void Close();
+
+	const uint8_t* Data() const { return m_data; }
+	size_t Size() const { return m_size; }
+	bool IsOpen() const { return m_data != nullptr; }
+
+private:
+#ifdef _WIN32
+	HANDLE m_file = INVALID_HANDLE_VALUE;
+	HANDLE m_mapping = nullptr;
+#endif
+	const uint8_t* m_data = nullptr;
+	size_t m_size = 0;
+};
+
+// 64 bit FNV-1a, used to key cooked assets on the content of their source
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0xcbf29ce484222325ULL);
+
+// Hash of the whole file content, 0 if the file can't be read
+uint64_t HashFileContents(const std::string& path);
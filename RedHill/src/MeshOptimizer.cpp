@@ -0,0 +1,427 @@
+#include "MeshOptimizer.h"
+
+#include <windows.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+
+static constexpr uint32_t kInvalidIndex = UINT32_MAX;
+
+// Forsyth scoring parameters, the values from the original article
+static constexpr int kScoreCacheSize = 32;
+static constexpr float kCacheDecayPower = 1.5f;
+static constexpr float kLastTriScore = 0.75f;
+static constexpr float kValenceBoostScale = 2.0f;
+static constexpr float kValenceBoostPower = 0.5f;
+static constexpr uint32_t kMaxValenceScore = 64;
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize)
+{
+	VertexCacheStats stats;
+	if (indices.empty() || vertexCount == 0)
+	{
+		return stats;
+	}
+
+	// FIFO cache, a vertex is in the cache if it was transformed less than cacheSize misses ago
+	std::vector<uint32_t> timestamps(vertexCount, 0);
+	uint32_t time = cacheSize + 1;
+
+	for (const uint32_t index : indices)
+	{
+		if (time - timestamps[index] > cacheSize)
+		{
+			timestamps[index] = time++;
+			++stats.misses;
+		}
+	}
+
+	stats.acmr = static_cast<float>(stats.misses) / static_cast<float>(indices.size() / 3);
+	stats.atvr = static_cast<float>(stats.misses) / static_cast<float>(vertexCount);
+	return stats;
+}
+
+void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount)
+{
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	float cacheScores[kScoreCacheSize];
+	for (int i = 0; i < kScoreCacheSize; ++i)
+	{
+		// The last triangle vertices get a fixed score so the next triangle doesn't just reuse the same edge
+		cacheScores[i] = i < 3 ? kLastTriScore : powf(1.0f - static_cast<float>(i - 3) / (kScoreCacheSize - 3), kCacheDecayPower);
+	}
+
+	float valenceScores[kMaxValenceScore];
+	valenceScores[0] = 0.0f;
+	for (uint32_t i = 1; i < kMaxValenceScore; ++i)
+	{
+		valenceScores[i] = kValenceBoostScale * powf(static_cast<float>(i), -kValenceBoostPower);
+	}
+
+	auto VertexScore = [&](const int cachePosition, const uint32_t liveTriangles) -> float
+	{
+		if (liveTriangles == 0)
+		{
+			return -1.0f;
+		}
+		const float cacheScore = cachePosition >= 0 ? cacheScores[cachePosition] : 0.0f;
+		return cacheScore + valenceScores[(std::min)(liveTriangles, kMaxValenceScore - 1)];
+	};
+
+	// Vertex -> triangles adjacency, the live triangles of a vertex are kept at the front of its range
+	std::vector<uint32_t> liveTriangles(vertexCount, 0);
+	for (const uint32_t index : indices)
+	{
+		++liveTriangles[index];
+	}
+
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+	}
+
+	std::vector<uint32_t> adjacency(indices.size());
+	{
+		std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+	}
+
+	std::vector<int> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		vertexScores[v] = VertexScore(-1, liveTriangles[v]);
+	}
+
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	uint32_t bestTriangle = 0;
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+		if (triangleScores[t] > triangleScores[bestTriangle])
+		{
+			bestTriangle = static_cast<uint32_t>(t);
+		}
+	}
+
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+
+	// Vertices of the emitted triangle go first, then whatever was in the cache. The extra 3 slots hold the vertices
+	// pushed out by the last triangle so their scores get updated too.
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> newCache;
+	cache.reserve(kScoreCacheSize + 3);
+	newCache.reserve(kScoreCacheSize + 3);
+
+	// Cursor for dead ends, when nothing in the cache has live triangles left we continue from the input order
+	size_t deadEndCursor = 0;
+
+	for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+	{
+		if (bestTriangle == kInvalidIndex)
+		{
+			while (emitted[deadEndCursor])
+			{
+				++deadEndCursor;
+			}
+			bestTriangle = static_cast<uint32_t>(deadEndCursor);
+		}
+
+		const uint32_t* triangle = &indices[bestTriangle * 3];
+		output.insert(output.end(), triangle, triangle + 3);
+		emitted[bestTriangle] = true;
+
+		// Remove the triangle from the live lists of its vertices
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			const uint32_t v = triangle[corner];
+			uint32_t* begin = &adjacency[adjacencyOffsets[v]];
+			uint32_t* end = begin + liveTriangles[v];
+			uint32_t* it = std::find(begin, end, bestTriangle);
+			std::swap(*it, *(end - 1));
+			--liveTriangles[v];
+		}
+
+		newCache.clear();
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			if (std::find(newCache.begin(), newCache.end(), triangle[corner]) == newCache.end())
+			{
+				newCache.push_back(triangle[corner]);
+			}
+		}
+		for (const uint32_t v : cache)
+		{
+			if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+			{
+				newCache.push_back(v);
+			}
+		}
+
+		// Update the vertex scores, vertices past the cache size drop out
+		for (size_t i = 0; i < newCache.size(); ++i)
+		{
+			const uint32_t v = newCache[i];
+			cachePositions[v] = i < kScoreCacheSize ? static_cast<int>(i) : -1;
+			vertexScores[v] = VertexScore(cachePositions[v], liveTriangles[v]);
+		}
+
+		// Only the triangles touching the cache changed score, the best of them goes next
+		bestTriangle = kInvalidIndex;
+		float bestScore = -1.0f;
+		for (const uint32_t v : newCache)
+		{
+			const uint32_t* begin = &adjacency[adjacencyOffsets[v]];
+			for (uint32_t i = 0; i < liveTriangles[v]; ++i)
+			{
+				const uint32_t t = begin[i];
+				const float score = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+				triangleScores[t] = score;
+				if (score > bestScore)
+				{
+					bestScore = score;
+					bestTriangle = t;
+				}
+			}
+		}
+
+		if (newCache.size() > kScoreCacheSize)
+		{
+			newCache.resize(kScoreCacheSize);
+		}
+		std::swap(cache, newCache);
+	}
+
+	indices = std::move(output);
+}
+
+void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, float threshold)
+{
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// Same FIFO as AnalyzeVertexCache, but it can be flushed at the start of every cluster
+	constexpr uint32_t kCacheSize = 16;
+	std::vector<uint32_t> timestamps(vertices.size(), 0);
+	uint32_t time = kCacheSize + 1;
+
+	auto ResetCache = [&]()
+	{
+		time += kCacheSize + 1;
+	};
+
+	auto TriangleMisses = [&](const size_t t) -> uint32_t
+	{
+		uint32_t misses = 0;
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			const uint32_t v = indices[t * 3 + corner];
+			if (time - timestamps[v] > kCacheSize)
+			{
+				timestamps[v] = time++;
+				++misses;
+			}
+		}
+		return misses;
+	};
+
+	// Hard boundaries, the triangles where the optimized order already misses all three vertices.
+	// Moving what is in between around doesn't hurt the cache.
+	std::vector<uint32_t> hardClusters = { 0 };
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		if (TriangleMisses(t) == 3 && t > 0)
+		{
+			hardClusters.push_back(static_cast<uint32_t>(t));
+		}
+	}
+	hardClusters.push_back(static_cast<uint32_t>(triangleCount));
+
+	// Soft boundaries, split a hard cluster again as soon as its ACMR (with a cold cache) is within the threshold of
+	// the ACMR of the whole hard cluster
+	std::vector<uint32_t> clusters;
+	for (size_t h = 0; h + 1 < hardClusters.size(); ++h)
+	{
+		const uint32_t begin = hardClusters[h];
+		const uint32_t end = hardClusters[h + 1];
+
+		ResetCache();
+		uint32_t hardMisses = 0;
+		for (uint32_t t = begin; t < end; ++t)
+		{
+			hardMisses += TriangleMisses(t);
+		}
+		const float hardAcmr = static_cast<float>(hardMisses) / static_cast<float>(end - begin);
+
+		ResetCache();
+		clusters.push_back(begin);
+		uint32_t clusterMisses = 0;
+		uint32_t clusterStart = begin;
+		for (uint32_t t = begin; t < end; ++t)
+		{
+			clusterMisses += TriangleMisses(t);
+			if (t + 1 < end && static_cast<float>(clusterMisses) <= threshold * hardAcmr * static_cast<float>(t + 1 - clusterStart))
+			{
+				clusters.push_back(t + 1);
+				clusterStart = t + 1;
+				clusterMisses = 0;
+				ResetCache();
+			}
+		}
+	}
+	clusters.push_back(static_cast<uint32_t>(triangleCount));
+
+	// Area weighted centroid and normal of every cluster
+	struct Cluster
+	{
+		uint32_t begin;
+		uint32_t end;
+		float centroid[3];
+		float normal[3];
+		float sortKey;
+	};
+
+	std::vector<Cluster> clusterData(clusters.size() - 1);
+	float meshCentroid[3] = {};
+	float meshArea = 0.0f;
+
+	for (size_t c = 0; c < clusterData.size(); ++c)
+	{
+		Cluster& cluster = clusterData[c];
+		cluster = { clusters[c], clusters[c + 1], {}, {}, 0.0f };
+
+		float clusterArea = 0.0f;
+		for (uint32_t t = cluster.begin; t < cluster.end; ++t)
+		{
+			const float* p0 = vertices[indices[t * 3]].position;
+			const float* p1 = vertices[indices[t * 3 + 1]].position;
+			const float* p2 = vertices[indices[t * 3 + 2]].position;
+
+			const float e0[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			const float e1[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			const float n[3] = { e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0] };
+			const float area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				cluster.centroid[axis] += (p0[axis] + p1[axis] + p2[axis]) * (area / 3.0f);
+				cluster.normal[axis] += n[axis];
+			}
+			clusterArea += area;
+		}
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			meshCentroid[axis] += cluster.centroid[axis];
+		}
+		meshArea += clusterArea;
+
+		const float invArea = clusterArea > 0.0f ? 1.0f / clusterArea : 0.0f;
+		const float normalLength = sqrtf(cluster.normal[0] * cluster.normal[0] + cluster.normal[1] * cluster.normal[1] + cluster.normal[2] * cluster.normal[2]);
+		const float invNormalLength = normalLength > 0.0f ? 1.0f / normalLength : 0.0f;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			cluster.centroid[axis] *= invArea;
+			cluster.normal[axis] *= invNormalLength;
+		}
+	}
+
+	const float invMeshArea = meshArea > 0.0f ? 1.0f / meshArea : 0.0f;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		meshCentroid[axis] *= invMeshArea;
+	}
+
+	// Clusters that face away from the center of the mesh are likely in front of the others, draw them first
+	for (Cluster& cluster : clusterData)
+	{
+		cluster.sortKey =
+			(cluster.centroid[0] - meshCentroid[0]) * cluster.normal[0] +
+			(cluster.centroid[1] - meshCentroid[1]) * cluster.normal[1] +
+			(cluster.centroid[2] - meshCentroid[2]) * cluster.normal[2];
+	}
+
+	std::stable_sort(clusterData.begin(), clusterData.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+	for (const Cluster& cluster : clusterData)
+	{
+		output.insert(output.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+	}
+
+	indices = std::move(output);
+}
+
+void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	std::vector<uint32_t> remap(vertices.size(), kInvalidIndex);
+	std::vector<Vertex> output;
+	output.reserve(vertices.size());
+
+	for (uint32_t& index : indices)
+	{
+		if (remap[index] == kInvalidIndex)
+		{
+			remap[index] = static_cast<uint32_t>(output.size());
+			output.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	vertices = std::move(output);
+}
+
+void OptimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const char* name)
+{
+	const auto start = std::chrono::steady_clock::now();
+	const VertexCacheStats before = AnalyzeVertexCache(indices, vertices.size());
+
+	OptimizeVertexCache(indices, vertices.size());
+	OptimizeOverdraw(indices, vertices);
+	OptimizeVertexFetch(vertices, indices);
+
+	const VertexCacheStats after = AnalyzeVertexCache(indices, vertices.size());
+	const auto end = std::chrono::steady_clock::now();
+
+	char message[256];
+	sprintf_s(message, "Mesh optimization (%s): ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %.2f ms\n", name,
+		before.acmr, after.acmr, before.atvr, after.atvr, std::chrono::duration<double, std::milli>(end - start).count());
+	::OutputDebugStringA(message);
+}
+
+void OptimizeIndexRange(std::span<uint32_t> indices, const std::vector<Vertex>& vertices, size_t vertexCount, const char* name)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	std::vector<uint32_t> range(indices.begin(), indices.end());
+	const VertexCacheStats before = AnalyzeVertexCache(range, vertexCount);
+
+	OptimizeVertexCache(range, vertexCount);
+	OptimizeOverdraw(range, vertices);
+	std::copy(range.begin(), range.end(), indices.begin());
+
+	const VertexCacheStats after = AnalyzeVertexCache(range, vertexCount);
+	const auto end = std::chrono::steady_clock::now();
+
+	char message[256];
+	sprintf_s(message, "Mesh optimization (%s): ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %.2f ms\n", name,
+		before.acmr, after.acmr, before.atvr, after.atvr, std::chrono::duration<double, std::milli>(end - start).count());
+	::OutputDebugStringA(message);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "MeshTypes.h"
+
+// Post transform vertex cache statistics from a headless FIFO cache simulation
+struct VertexCacheStats
+{
+	uint32_t misses = 0;
+	float acmr = 0.0f;		// Average cache miss ratio: transformed vertices per triangle (0.5 is the best case on a big regular grid, 3 the worst)
+	float atvr = 0.0f;		// Average transformed vertex ratio: transformed vertices per vertex (1 is optimal)
+};
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = 16);
+
+// Reorders the triangles for the post transform cache (Forsyth's linear speed algorithm)
+void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+
+// Splits the cache optimized triangle list in clusters and sorts them so the triangles facing outwards are drawn
+// first (Tipsify style). threshold is how much the ACMR of a cluster may exceed the ACMR of the cache optimized run it
+// was cut from, 1 keeps the result close to the cache optimized order and bigger values give smaller clusters.
+void OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, float threshold = 1.0f);
+
+// Reorders the vertices in the order the index buffer first references them and drops the unused ones
+void OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+// Runs the three passes above and logs the cache stats before and after
+void OptimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const char* name);
+
+// Cache and overdraw passes only, for an index range that shares its vertex buffer with other ranges (LOD levels) so the
+// vertices can't be reordered. vertexCount bounds the vertices referenced by the range.
+void OptimizeIndexRange(std::span<uint32_t> indices, const std::vector<Vertex>& vertices, size_t vertexCount, const char* name);
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Mesh data shared by the import, the cook and the upload paths, no device types so the mesh processing builds without D3D12
+
+struct Vertex
+{
+	float position[3] = { 0.0f, 0.0f, 0.0f };
+	float uv[2] = { 0.0f, 0.0f };
+	float normal[3] = { 0.0f, 0.0f, 0.0f };
+	float tangent[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+};
+
+// Compressed vertex, 20 bytes instead of 48 (see VertexPacking.h for the encoding)
+struct PackedVertex
+{
+	uint16_t position[4] = {};	// xyz unorm against the mesh bounds, w is the tangent sign (0 or 0xFFFF)
+	uint16_t uv[2] = {};		// half floats
+	int16_t normal[2] = {};		// octahedral snorm
+	int16_t tangent[2] = {};	// octahedral snorm
+};
+
+// position = offset + unorm * scale, passed to the vertex shaders as root constants when the packed layout is used
+struct VertexQuantization
+{
+	float offset[3] = { 0.0f, 0.0f, 0.0f };
+	float padding0 = 0.0f;
+	float scale[3] = { 1.0f, 1.0f, 1.0f };
+	float padding1 = 0.0f;
+};
+
+// Range of the shared index buffer drawn for one level of detail. Level n only references the first vertexCount
+// vertices, so every level lives in the same vertex buffer.
+struct MeshLod
+{
+	uint32_t indexOffset = 0;
+	uint32_t indexCount = 0;
+	uint32_t vertexCount = 0;
+	float error = 0.0f;		// Geometric deviation from the full detail mesh in world units
+};
+
+// Cluster of the index buffer, see Meshlets.h
+struct Meshlet
+{
+	uint32_t vertexOffset = 0;		// First entry in MeshletData::vertices
+	uint32_t triangleOffset = 0;	// First entry in MeshletData::triangles, 3 local vertex indices per triangle
+	uint32_t vertexCount = 0;
+	uint32_t triangleCount = 0;
+};
+
+// Culling data of a meshlet. Every triangle faces away from a viewer at p when
+// dot(normalize(coneApex - p), coneAxis) >= coneCutoff, a cutoff of 1 means the cone is too wide to be used.
+struct MeshletBounds
+{
+	float center[3] = { 0.0f, 0.0f, 0.0f };
+	float radius = 0.0f;
+	float coneApex[3] = { 0.0f, 0.0f, 0.0f };
+	float coneCutoff = 1.0f;
+	float coneAxis[3] = { 0.0f, 0.0f, 0.0f };
+	float padding0 = 0.0f;
+	float boundsMin[3] = { 0.0f, 0.0f, 0.0f };
+	float padding1 = 0.0f;
+	float boundsMax[3] = { 0.0f, 0.0f, 0.0f };
+	float padding2 = 0.0f;
+};
+
+struct MeshletData
+{
+	std::vector<Meshlet> meshlets;
+	std::vector<MeshletBounds> bounds;	// One per meshlet
+	std::vector<uint32_t> vertices;		// Mesh vertex indices referenced by the meshlets
+	std::vector<uint8_t> triangles;		// Indices into the vertices of the meshlet
+};
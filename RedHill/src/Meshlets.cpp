@@ -0,0 +1,705 @@
+#include "Meshlets.h"
+
+#include <windows.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+
+static constexpr uint8_t kNotInMeshlet = 0xFF;
+static constexpr float kRadiansToDegrees = 57.2957795f;
+
+// How much a triangle facing away from the meshlet normal costs, in new vertices (1 - dot goes from 0 to 2)
+static constexpr float kConeWeight = 0.5f;
+
+// A triangle that isn't connected to the meshlet can still join it when it is this close, in meshlet radii
+static constexpr float kDisconnectedReach = 1.0f;
+
+// Cones wider than acos(kMinConeDot) (~84 degrees) cull next to nothing
+static constexpr float kMinConeDot = 0.1f;
+
+static float Dot(const float a[3], const float b[3])
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static float Length(const float v[3])
+{
+	return sqrtf(Dot(v, v));
+}
+
+static float DistanceSquared(const float a[3], const float b[3])
+{
+	const float dx = a[0] - b[0];
+	const float dy = a[1] - b[1];
+	const float dz = a[2] - b[2];
+	return dx * dx + dy * dy + dz * dz;
+}
+
+// Unit normal of the triangle, zero for degenerate triangles
+static void TriangleNormal(const float p0[3], const float p1[3], const float p2[3], float normal[3])
+{
+	const float e0[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+	const float e1[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+	normal[0] = e0[1] * e1[2] - e0[2] * e1[1];
+	normal[1] = e0[2] * e1[0] - e0[0] * e1[2];
+	normal[2] = e0[0] * e1[1] - e0[1] * e1[0];
+
+	const float length = Length(normal);
+	const float invLength = length > 0.0f ? 1.0f / length : 0.0f;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		normal[axis] *= invLength;
+	}
+}
+
+// Uniform grid over the triangle centroids, finds the closest triangle that is not in a meshlet yet when the meshlet
+// has no neighbour left (meshes split in many small islands by uv and normal seams)
+class TriangleGrid
+{
+public:
+	TriangleGrid(const std::vector<float>& centroids, const size_t triangleCount)
+		: m_centroids(centroids)
+	{
+		float boundsMax[3];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			m_origin[axis] = FLT_MAX;
+			boundsMax[axis] = -FLT_MAX;
+		}
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				m_origin[axis] = (std::min)(m_origin[axis], centroids[t * 3 + axis]);
+				boundsMax[axis] = (std::max)(boundsMax[axis], centroids[t * 3 + axis]);
+			}
+		}
+
+		// About kTrianglesPerCell triangles per cell if they were spread evenly over the bounds
+		const float extent[3] = { boundsMax[0] - m_origin[0], boundsMax[1] - m_origin[1], boundsMax[2] - m_origin[2] };
+		const float volume = (std::max)(extent[0], 1e-6f) * (std::max)(extent[1], 1e-6f) * (std::max)(extent[2], 1e-6f);
+		m_cellSize = (std::max)(cbrtf(volume * kTrianglesPerCell / static_cast<float>(triangleCount)), 1e-6f);
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			m_dims[axis] = (std::min)(static_cast<int>(extent[axis] / m_cellSize) + 1, kMaxDim);
+		}
+		m_cellSize = (std::max)({ m_cellSize, extent[0] / m_dims[0], extent[1] / m_dims[1], extent[2] / m_dims[2] });
+
+		const size_t cellCount = static_cast<size_t>(m_dims[0]) * m_dims[1] * m_dims[2];
+		m_cellOffsets.assign(cellCount + 1, 0);
+		m_triangleCells.resize(triangleCount);
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			m_triangleCells[t] = CellIndex(&centroids[t * 3]);
+			++m_cellOffsets[m_triangleCells[t] + 1];
+		}
+		for (size_t c = 0; c < cellCount; ++c)
+		{
+			m_live.push_back(m_cellOffsets[c + 1]);
+			m_cellOffsets[c + 1] += m_cellOffsets[c];
+		}
+
+		m_cellTriangles.resize(triangleCount);
+		std::vector<uint32_t> cursor(m_cellOffsets.begin(), m_cellOffsets.end() - 1);
+		for (size_t t = 0; t < triangleCount; ++t)
+		{
+			m_cellTriangles[cursor[m_triangleCells[t]]++] = static_cast<uint32_t>(t);
+		}
+	}
+
+	void Remove(const size_t t)
+	{
+		--m_live[m_triangleCells[t]];
+	}
+
+	// Search the shells of cells around the point until the closest candidate can't be beaten, SIZE_MAX when every
+	// triangle is taken
+	size_t FindNearest(const float point[3], const std::vector<uint8_t>& emitted) const
+	{
+		int center[3];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			center[axis] = std::clamp(static_cast<int>((point[axis] - m_origin[axis]) / m_cellSize), 0, m_dims[axis] - 1);
+		}
+
+		const int maxRing = (std::max)({ m_dims[0], m_dims[1], m_dims[2] });
+		size_t best = SIZE_MAX;
+		float bestDistance = FLT_MAX;
+		for (int ring = 0; ring < maxRing; ++ring)
+		{
+			for (int dx = -ring; dx <= ring; ++dx)
+			{
+				for (int dy = -ring; dy <= ring; ++dy)
+				{
+					// Only the surface of the ring, the inside was searched already
+					const bool side = abs(dx) == ring || abs(dy) == ring;
+					for (int dz = -ring; dz <= ring; dz += side ? 1 : (std::max)(2 * ring, 1))
+					{
+						const int x = center[0] + dx;
+						const int y = center[1] + dy;
+						const int z = center[2] + dz;
+						if (x < 0 || y < 0 || z < 0 || x >= m_dims[0] || y >= m_dims[1] || z >= m_dims[2])
+						{
+							continue;
+						}
+
+						const size_t cell = (static_cast<size_t>(z) * m_dims[1] + y) * m_dims[0] + x;
+						if (m_live[cell] == 0)
+						{
+							continue;
+						}
+
+						for (uint32_t i = m_cellOffsets[cell]; i < m_cellOffsets[cell + 1]; ++i)
+						{
+							const uint32_t t = m_cellTriangles[i];
+							if (emitted[t])
+							{
+								continue;
+							}
+							const float distance = DistanceSquared(&m_centroids[t * 3], point);
+							if (distance < bestDistance)
+							{
+								bestDistance = distance;
+								best = t;
+							}
+						}
+					}
+				}
+			}
+
+			// Cells of the next ring are at least ring cells away from the point
+			const float reach = static_cast<float>(ring) * m_cellSize;
+			if (best != SIZE_MAX && bestDistance <= reach * reach)
+			{
+				break;
+			}
+		}
+		return best;
+	}
+
+private:
+	static constexpr float kTrianglesPerCell = 4.0f;
+	static constexpr int kMaxDim = 256;
+
+	uint32_t CellIndex(const float p[3]) const
+	{
+		int cell[3];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			cell[axis] = std::clamp(static_cast<int>((p[axis] - m_origin[axis]) / m_cellSize), 0, m_dims[axis] - 1);
+		}
+		return static_cast<uint32_t>((static_cast<size_t>(cell[2]) * m_dims[1] + cell[1]) * m_dims[0] + cell[0]);
+	}
+
+	const std::vector<float>& m_centroids;
+	float m_origin[3];
+	float m_cellSize;
+	int m_dims[3];
+	std::vector<uint32_t> m_cellOffsets;
+	std::vector<uint32_t> m_cellTriangles;
+	std::vector<uint32_t> m_triangleCells;
+	std::vector<uint32_t> m_live;
+};
+
+MeshletData BuildMeshlets(std::span<const Vertex> vertices, std::span<const uint32_t> indices, uint32_t maxVertices, uint32_t maxTriangles)
+{
+	MeshletData data;
+
+	const size_t triangleCount = indices.size() / 3;
+	const size_t vertexCount = vertices.size();
+	if (triangleCount == 0 || maxVertices < 3 || maxTriangles == 0)
+	{
+		return data;
+	}
+	maxVertices = (std::min)(maxVertices, static_cast<uint32_t>(kNotInMeshlet));
+
+	// Triangles of every vertex (CSR) and how many of them are still waiting for a meshlet
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (const uint32_t index : indices)
+	{
+		++adjacencyOffsets[index + 1];
+	}
+	for (size_t v = 0; v < vertexCount; ++v)
+	{
+		adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+	}
+
+	std::vector<uint32_t> adjacency(indices.size());
+	std::vector<uint32_t> liveTriangles(vertexCount, 0);
+	{
+		std::vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			adjacency[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+			++liveTriangles[indices[i]];
+		}
+	}
+
+	std::vector<float> normals(triangleCount * 3);
+	std::vector<float> centroids(triangleCount * 3);
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		const float* p0 = vertices[indices[t * 3 + 0]].position;
+		const float* p1 = vertices[indices[t * 3 + 1]].position;
+		const float* p2 = vertices[indices[t * 3 + 2]].position;
+		TriangleNormal(p0, p1, p2, &normals[t * 3]);
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			centroids[t * 3 + axis] = (p0[axis] + p1[axis] + p2[axis]) / 3.0f;
+		}
+	}
+
+	TriangleGrid grid(centroids, triangleCount);
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	std::vector<uint8_t> localIndex(vertexCount, kNotInMeshlet);
+
+	// Meshlet being built
+	std::vector<uint32_t> meshletVertices;
+	std::vector<uint8_t> meshletTriangles;
+	meshletVertices.reserve(maxVertices);
+	meshletTriangles.reserve(maxTriangles * 3);
+	float coneSum[3] = { 0.0f, 0.0f, 0.0f };
+	float centroidSum[3] = { 0.0f, 0.0f, 0.0f };
+
+	data.meshlets.reserve(triangleCount / maxTriangles + 1);
+	data.vertices.reserve(triangleCount);
+	data.triangles.reserve(indices.size());
+
+	auto NewVertices = [&](const size_t t) -> uint32_t
+	{
+		return (localIndex[indices[t * 3 + 0]] == kNotInMeshlet ? 1 : 0) +
+			(localIndex[indices[t * 3 + 1]] == kNotInMeshlet ? 1 : 0) +
+			(localIndex[indices[t * 3 + 2]] == kNotInMeshlet ? 1 : 0);
+	};
+
+	// Center of the last flushed meshlet, the next one starts from the free triangle closest to it
+	float lastCenter[3] = { 0.0f, 0.0f, 0.0f };
+	bool lastCenterValid = false;
+
+	auto Flush = [&]()
+	{
+		if (meshletTriangles.empty())
+		{
+			return;
+		}
+
+		const float invCount = 3.0f / static_cast<float>(meshletTriangles.size());
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			lastCenter[axis] = centroidSum[axis] * invCount;
+		}
+		lastCenterValid = true;
+
+		Meshlet meshlet;
+		meshlet.vertexOffset = static_cast<uint32_t>(data.vertices.size());
+		meshlet.triangleOffset = static_cast<uint32_t>(data.triangles.size());
+		meshlet.vertexCount = static_cast<uint32_t>(meshletVertices.size());
+		meshlet.triangleCount = static_cast<uint32_t>(meshletTriangles.size() / 3);
+		data.meshlets.push_back(meshlet);
+
+		data.vertices.insert(data.vertices.end(), meshletVertices.begin(), meshletVertices.end());
+		data.triangles.insert(data.triangles.end(), meshletTriangles.begin(), meshletTriangles.end());
+
+		for (const uint32_t v : meshletVertices)
+		{
+			localIndex[v] = kNotInMeshlet;
+		}
+		meshletVertices.clear();
+		meshletTriangles.clear();
+		std::fill(std::begin(coneSum), std::end(coneSum), 0.0f);
+		std::fill(std::begin(centroidSum), std::end(centroidSum), 0.0f);
+	};
+
+	auto Append = [&](const size_t t)
+	{
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			const uint32_t v = indices[t * 3 + corner];
+			if (localIndex[v] == kNotInMeshlet)
+			{
+				localIndex[v] = static_cast<uint8_t>(meshletVertices.size());
+				meshletVertices.push_back(v);
+			}
+			meshletTriangles.push_back(localIndex[v]);
+			--liveTriangles[v];
+		}
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			coneSum[axis] += normals[t * 3 + axis];
+			centroidSum[axis] += centroids[t * 3 + axis];
+		}
+		emitted[t] = 1;
+		grid.Remove(t);
+	};
+
+	size_t emittedCount = 0;
+	while (emittedCount < triangleCount)
+	{
+		size_t best = SIZE_MAX;
+
+		if (!meshletTriangles.empty())
+		{
+			const float coneLength = Length(coneSum);
+			const float invConeLength = coneLength > 0.0f ? 1.0f / coneLength : 0.0f;
+			const float coneAxis[3] = { coneSum[0] * invConeLength, coneSum[1] * invConeLength, coneSum[2] * invConeLength };
+
+			// Neighbours of the meshlet
+			float bestScore = FLT_MAX;
+			for (const uint32_t v : meshletVertices)
+			{
+				if (liveTriangles[v] == 0)
+				{
+					continue;
+				}
+
+				for (uint32_t i = adjacencyOffsets[v]; i < adjacencyOffsets[v + 1]; ++i)
+				{
+					const uint32_t t = adjacency[i];
+					if (emitted[t])
+					{
+						continue;
+					}
+
+					const uint32_t newVertices = NewVertices(t);
+					if (meshletVertices.size() + newVertices > maxVertices)
+					{
+						continue;
+					}
+
+					const float score = static_cast<float>(newVertices) + kConeWeight * (1.0f - Dot(&normals[t * 3], coneAxis));
+					if (score < bestScore)
+					{
+						bestScore = score;
+						best = t;
+					}
+				}
+			}
+		}
+
+		if (best == SIZE_MAX)
+		{
+			if (meshletTriangles.empty())
+			{
+				// Continue next to the last meshlet, the very first one starts at the first triangle
+				best = lastCenterValid ? grid.FindNearest(lastCenter, emitted) : 0;
+			}
+			else
+			{
+				// Disconnected triangles (uv seams, small islands) join the meshlet if they are close enough, otherwise
+				// the meshlet is done and the triangle starts the next one
+				const float invCount = 3.0f / static_cast<float>(meshletTriangles.size());
+				const float center[3] = { centroidSum[0] * invCount, centroidSum[1] * invCount, centroidSum[2] * invCount };
+				float radiusSquared = 0.0f;
+				for (const uint32_t v : meshletVertices)
+				{
+					radiusSquared = (std::max)(radiusSquared, DistanceSquared(vertices[v].position, center));
+				}
+
+				best = grid.FindNearest(center, emitted);
+				const bool fits = meshletVertices.size() + NewVertices(best) <= maxVertices;
+				const bool near = DistanceSquared(&centroids[best * 3], center) <= radiusSquared * kDisconnectedReach * kDisconnectedReach;
+				if (!fits || !near)
+				{
+					Flush();
+				}
+			}
+		}
+
+		Append(best);
+		++emittedCount;
+
+		if (meshletTriangles.size() == maxTriangles * 3)
+		{
+			Flush();
+		}
+	}
+	Flush();
+
+	data.bounds.reserve(data.meshlets.size());
+	for (const Meshlet& meshlet : data.meshlets)
+	{
+		data.bounds.push_back(ComputeMeshletBounds(data, meshlet, vertices));
+	}
+
+	return data;
+}
+
+MeshletBounds ComputeMeshletBounds(const MeshletData& data, const Meshlet& meshlet, std::span<const Vertex> vertices)
+{
+	MeshletBounds bounds;
+	if (meshlet.vertexCount == 0)
+	{
+		return bounds;
+	}
+
+	auto Position = [&](const uint32_t local) -> const float*
+	{
+		return vertices[data.vertices[meshlet.vertexOffset + local]].position;
+	};
+
+	// AABB
+	std::copy(Position(0), Position(0) + 3, bounds.boundsMin);
+	std::copy(Position(0), Position(0) + 3, bounds.boundsMax);
+	for (uint32_t i = 1; i < meshlet.vertexCount; ++i)
+	{
+		const float* p = Position(i);
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			bounds.boundsMin[axis] = (std::min)(bounds.boundsMin[axis], p[axis]);
+			bounds.boundsMax[axis] = (std::max)(bounds.boundsMax[axis], p[axis]);
+		}
+	}
+
+	// Ritter's sphere: start from two far apart points and grow over the ones left out
+	auto Farthest = [&](const float* from) -> const float*
+	{
+		const float* farthest = Position(0);
+		float farthestDistance = -1.0f;
+		for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+		{
+			const float distance = DistanceSquared(Position(i), from);
+			if (distance > farthestDistance)
+			{
+				farthestDistance = distance;
+				farthest = Position(i);
+			}
+		}
+		return farthest;
+	};
+
+	const float* a = Farthest(Position(0));
+	const float* b = Farthest(a);
+	float center[3] = { (a[0] + b[0]) * 0.5f, (a[1] + b[1]) * 0.5f, (a[2] + b[2]) * 0.5f };
+	float radius = sqrtf(DistanceSquared(a, b)) * 0.5f;
+	for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+	{
+		const float* p = Position(i);
+		const float distance = sqrtf(DistanceSquared(p, center));
+		if (distance > radius)
+		{
+			const float newRadius = (radius + distance) * 0.5f;
+			const float shift = (newRadius - radius) / distance;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				center[axis] += (p[axis] - center[axis]) * shift;
+			}
+			radius = newRadius;
+		}
+	}
+
+	// The sphere around the AABB is sometimes the tighter one
+	float boxCenter[3];
+	float boxRadius = 0.0f;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		boxCenter[axis] = (bounds.boundsMin[axis] + bounds.boundsMax[axis]) * 0.5f;
+	}
+	for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+	{
+		boxRadius = (std::max)(boxRadius, DistanceSquared(Position(i), boxCenter));
+	}
+	boxRadius = sqrtf(boxRadius);
+	if (boxRadius < radius)
+	{
+		std::copy(std::begin(boxCenter), std::end(boxCenter), center);
+		radius = boxRadius;
+	}
+
+	std::copy(std::begin(center), std::end(center), bounds.center);
+	bounds.radius = radius;
+
+	// Normal cone: the axis is the average triangle normal and the half angle covers the farthest normal
+	std::vector<float> normals(meshlet.triangleCount * 3);
+	float axis[3] = { 0.0f, 0.0f, 0.0f };
+	for (uint32_t t = 0; t < meshlet.triangleCount; ++t)
+	{
+		const uint8_t* triangle = &data.triangles[meshlet.triangleOffset + t * 3];
+		TriangleNormal(Position(triangle[0]), Position(triangle[1]), Position(triangle[2]), &normals[t * 3]);
+		for (int i = 0; i < 3; ++i)
+		{
+			axis[i] += normals[t * 3 + i];
+		}
+	}
+
+	const float axisLength = Length(axis);
+	if (axisLength == 0.0f)
+	{
+		return bounds;
+	}
+	for (int i = 0; i < 3; ++i)
+	{
+		axis[i] /= axisLength;
+	}
+
+	float minDot = 1.0f;
+	for (uint32_t t = 0; t < meshlet.triangleCount; ++t)
+	{
+		const float* normal = &normals[t * 3];
+		if (normal[0] != 0.0f || normal[1] != 0.0f || normal[2] != 0.0f)
+		{
+			minDot = (std::min)(minDot, Dot(normal, axis));
+		}
+	}
+
+	std::copy(std::begin(axis), std::end(axis), bounds.coneAxis);
+	if (minDot <= kMinConeDot)
+	{
+		return bounds;
+	}
+
+	// Move the apex back along the axis until it is behind the plane of every triangle, then a viewer inside the
+	// cutoff cone around it sees the back of all of them
+	float maxT = 0.0f;
+	for (uint32_t t = 0; t < meshlet.triangleCount; ++t)
+	{
+		const float* normal = &normals[t * 3];
+		const float* p0 = Position(data.triangles[meshlet.triangleOffset + t * 3]);
+		const float toCenter[3] = { center[0] - p0[0], center[1] - p0[1], center[2] - p0[2] };
+		const float dp = Dot(normal, axis);
+		if (dp > 0.0f)
+		{
+			maxT = (std::max)(maxT, Dot(toCenter, normal) / dp);
+		}
+	}
+
+	for (int i = 0; i < 3; ++i)
+	{
+		bounds.coneApex[i] = center[i] - axis[i] * maxT;
+	}
+	bounds.coneCutoff = sqrtf(1.0f - minDot * minDot);
+	return bounds;
+}
+
+MeshletStats AnalyzeMeshlets(const MeshletData& data, size_t vertexCount, uint32_t maxVertices, uint32_t maxTriangles)
+{
+	MeshletStats stats;
+	stats.meshletCount = data.meshlets.size();
+	if (data.meshlets.empty())
+	{
+		return stats;
+	}
+
+	size_t totalVertices = 0;
+	size_t totalTriangles = 0;
+	for (const Meshlet& meshlet : data.meshlets)
+	{
+		totalVertices += meshlet.vertexCount;
+		totalTriangles += meshlet.triangleCount;
+	}
+
+	const float count = static_cast<float>(data.meshlets.size());
+	stats.avgVertices = static_cast<float>(totalVertices) / count;
+	stats.avgTriangles = static_cast<float>(totalTriangles) / count;
+	stats.vertexFill = stats.avgVertices / static_cast<float>(maxVertices);
+	stats.triangleFill = stats.avgTriangles / static_cast<float>(maxTriangles);
+	stats.vertexDuplication = vertexCount > 0 ? static_cast<float>(totalVertices) / static_cast<float>(vertexCount) : 0.0f;
+
+	// A far viewer culls the meshlet for the directions within 90 - halfAngle of the axis, a cap of (1 - sin(halfAngle)) / 2 of the sphere
+	size_t usable = 0;
+	double angleSum = 0.0;
+	double cullSum = 0.0;
+	for (const MeshletBounds& bounds : data.bounds)
+	{
+		if (bounds.coneCutoff < 1.0f)
+		{
+			++usable;
+			angleSum += asinf(bounds.coneCutoff) * kRadiansToDegrees;
+			cullSum += (1.0f - bounds.coneCutoff) * 0.5f;
+		}
+	}
+
+	stats.usableCones = static_cast<float>(usable) / count;
+	stats.avgConeAngle = usable > 0 ? static_cast<float>(angleSum / usable) : 0.0f;
+	stats.cullProbability = static_cast<float>(cullSum / count);
+	return stats;
+}
+
+bool ValidateMeshlets(const MeshletData& data, std::span<const uint32_t> indices, uint32_t maxVertices, uint32_t maxTriangles)
+{
+	if (data.bounds.size() != data.meshlets.size())
+	{
+		return false;
+	}
+
+	// Triangles rotated so the smallest index comes first, which keeps the winding comparable
+	struct Triangle
+	{
+		uint32_t v[3];
+		bool operator<(const Triangle& o) const { return std::lexicographical_compare(v, v + 3, o.v, o.v + 3); }
+		bool operator==(const Triangle& o) const { return std::equal(v, v + 3, o.v); }
+	};
+
+	auto Canonical = [](uint32_t a, uint32_t b, uint32_t c) -> Triangle
+	{
+		if (b < a && b <= c)
+		{
+			return { { b, c, a } };
+		}
+		if (c < a && c < b)
+		{
+			return { { c, a, b } };
+		}
+		return { { a, b, c } };
+	};
+
+	std::vector<Triangle> expected;
+	expected.reserve(indices.size() / 3);
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		expected.push_back(Canonical(indices[i], indices[i + 1], indices[i + 2]));
+	}
+
+	std::vector<Triangle> clustered;
+	clustered.reserve(expected.size());
+	for (const Meshlet& meshlet : data.meshlets)
+	{
+		if (meshlet.vertexCount > maxVertices || meshlet.triangleCount > maxTriangles ||
+			meshlet.vertexOffset + meshlet.vertexCount > data.vertices.size() ||
+			meshlet.triangleOffset + meshlet.triangleCount * 3 > data.triangles.size())
+		{
+			return false;
+		}
+
+		for (uint32_t i = 0; i < meshlet.triangleCount * 3; i += 3)
+		{
+			const uint8_t* local = &data.triangles[meshlet.triangleOffset + i];
+			if (local[0] >= meshlet.vertexCount || local[1] >= meshlet.vertexCount || local[2] >= meshlet.vertexCount)
+			{
+				return false;
+			}
+			clustered.push_back(Canonical(
+				data.vertices[meshlet.vertexOffset + local[0]],
+				data.vertices[meshlet.vertexOffset + local[1]],
+				data.vertices[meshlet.vertexOffset + local[2]]));
+		}
+	}
+
+	std::sort(expected.begin(), expected.end());
+	std::sort(clustered.begin(), clustered.end());
+	return expected == clustered;
+}
+
+void BuildMeshMeshlets(std::span<const Vertex> vertices, std::span<const uint32_t> indices, MeshletData& meshlets, const char* name)
+{
+	const auto start = std::chrono::steady_clock::now();
+	meshlets = BuildMeshlets(vertices, indices);
+	const auto end = std::chrono::steady_clock::now();
+
+#ifdef _DEBUG
+	if (!ValidateMeshlets(meshlets, indices))
+	{
+		::OutputDebugStringA("Meshlets don't match the index buffer\n");
+		::__debugbreak();
+	}
+#endif
+
+	const MeshletStats stats = AnalyzeMeshlets(meshlets, vertices.size());
+	char message[320];
+	sprintf_s(message, "Meshlets (%s): %zu meshlets, %.1f vertices (%.0f%%) and %.1f triangles (%.0f%%) on average, vertex duplication %.2f, "
+		"cone %.1f deg average with %.0f%% usable, %.1f%% cone culled per view, %.2f ms\n", name,
+		stats.meshletCount, stats.avgVertices, stats.vertexFill * 100.0f, stats.avgTriangles, stats.triangleFill * 100.0f, stats.vertexDuplication,
+		stats.avgConeAngle, stats.usableCones * 100.0f, stats.cullProbability * 100.0f, std::chrono::duration<double, std::milli>(end - start).count());
+	::OutputDebugStringA(message);
+}
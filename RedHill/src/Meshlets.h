@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+#include "MeshTypes.h"
+
+// Meshlet limits, 64 vertices and 124 triangles fit the mesh shader output limits with room for per primitive data
+static constexpr uint32_t kMeshletMaxVertices = 64;
+static constexpr uint32_t kMeshletMaxTriangles = 124;
+
+// Greedy clustering of a triangle list: a meshlet grows through the triangles that share vertices with it, picking
+// the one that adds the fewest new vertices and bends the normal cone the least. When it runs out of neighbours the
+// closest free triangle (centroid grid search) joins it if it is within the meshlet radius, otherwise the meshlet is
+// flushed and the next one starts from that triangle. Triangles keep their winding.
+MeshletData BuildMeshlets(std::span<const Vertex> vertices, std::span<const uint32_t> indices,
+	uint32_t maxVertices = kMeshletMaxVertices, uint32_t maxTriangles = kMeshletMaxTriangles);
+
+// Bounding sphere (Ritter), AABB and normal cone of one meshlet
+MeshletBounds ComputeMeshletBounds(const MeshletData& data, const Meshlet& meshlet, std::span<const Vertex> vertices);
+
+// Quality of a clustering
+struct MeshletStats
+{
+	size_t meshletCount = 0;
+	float avgVertices = 0.0f;
+	float avgTriangles = 0.0f;
+	float vertexFill = 0.0f;		// avgVertices / maxVertices
+	float triangleFill = 0.0f;		// avgTriangles / maxTriangles
+	float vertexDuplication = 0.0f;	// Meshlet vertices per mesh vertex, 1 when no vertex is shared between meshlets
+	float avgConeAngle = 0.0f;		// Half angle in degrees over the usable cones
+	float usableCones = 0.0f;		// Fraction of meshlets with a cone tight enough for culling
+	float cullProbability = 0.0f;	// Fraction of view directions that cone cull the average meshlet (viewer far away)
+};
+
+MeshletStats AnalyzeMeshlets(const MeshletData& data, size_t vertexCount,
+	uint32_t maxVertices = kMeshletMaxVertices, uint32_t maxTriangles = kMeshletMaxTriangles);
+
+// Checks that the meshlets hold every triangle of indices exactly once with the same winding and respect the limits
+bool ValidateMeshlets(const MeshletData& data, std::span<const uint32_t> indices,
+	uint32_t maxVertices = kMeshletMaxVertices, uint32_t maxTriangles = kMeshletMaxTriangles);
+
+// Builds the meshlets of the mesh and their bounds into meshlets and logs the stats
+void BuildMeshMeshlets(std::span<const Vertex> vertices, std::span<const uint32_t> indices, MeshletData& meshlets, const char* name);
@@ -0,0 +1,206 @@
+#include "MipGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <emmintrin.h>
+
+#include "JobSystem.h"
+
+// Rows are handed to the jobs in batches of at least this many output pixels
+static constexpr uint32_t kMinBatchPixels = 16 * 1024;
+
+// Linear values of the sRGB path are kept in 13 bits so the sum of 4 still fits a 16 bit lane, the inverse table is
+// indexed by that sum directly
+static constexpr uint32_t kLinearBits = 13;
+static constexpr uint32_t kLinearMax = (1u << kLinearBits) - 1;
+static constexpr uint32_t kLinearSumMax = kLinearMax * 4;
+
+struct SrgbTables
+{
+	uint16_t toLinear[256];
+	uint8_t fromLinearSum[kLinearSumMax + 1];
+
+	SrgbTables()
+	{
+		for (uint32_t i = 0; i < 256; ++i)
+		{
+			const float c = i / 255.0f;
+			const float linear = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			toLinear[i] = static_cast<uint16_t>(linear * kLinearMax + 0.5f);
+		}
+		for (uint32_t i = 0; i <= kLinearSumMax; ++i)
+		{
+			const float linear = static_cast<float>(i) / kLinearSumMax;
+			const float c = linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+			fromLinearSum[i] = static_cast<uint8_t>((std::min)(c, 1.0f) * 255.0f + 0.5f);
+		}
+	}
+};
+
+static const SrgbTables& GetSrgbTables()
+{
+	static const SrgbTables tables;
+	return tables;
+}
+
+uint32_t MipLevelCount(uint32_t width, uint32_t height)
+{
+	uint32_t count = 1;
+	while (width > 1 || height > 1)
+	{
+		width = (std::max)(1u, width / 2);
+		height = (std::max)(1u, height / 2);
+		++count;
+	}
+	return count;
+}
+
+// Sums of the 2x2 footprints of 4 output pixels in 16 bit lanes (2 pixels per register)
+static inline void SumFootprints(const uint8_t* row0, const uint8_t* row1, __m128i& sum01, __m128i& sum23)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0));
+	const __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1));
+	const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + 16));
+	const __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + 16));
+
+	// Vertical sums of the source pixels, two per register
+	const __m128i p01 = _mm_add_epi16(_mm_unpacklo_epi8(a0, zero), _mm_unpacklo_epi8(a1, zero));
+	const __m128i p23 = _mm_add_epi16(_mm_unpackhi_epi8(a0, zero), _mm_unpackhi_epi8(a1, zero));
+	const __m128i p45 = _mm_add_epi16(_mm_unpacklo_epi8(b0, zero), _mm_unpacklo_epi8(b1, zero));
+	const __m128i p67 = _mm_add_epi16(_mm_unpackhi_epi8(b0, zero), _mm_unpackhi_epi8(b1, zero));
+
+	// Horizontal pairs
+	sum01 = _mm_add_epi16(_mm_unpacklo_epi64(p01, p23), _mm_unpackhi_epi64(p01, p23));
+	sum23 = _mm_add_epi16(_mm_unpacklo_epi64(p45, p67), _mm_unpackhi_epi64(p45, p67));
+}
+
+static void DownsampleRowLinear(const uint8_t* row0, const uint8_t* row1, const uint32_t srcWidth, uint8_t* dst, const uint32_t dstWidth)
+{
+	uint32_t x = 0;
+	if (srcWidth > 1)
+	{
+		const __m128i rounding = _mm_set1_epi16(2);
+		for (; x + 4 <= dstWidth; x += 4)
+		{
+			__m128i sum01, sum23;
+			SumFootprints(row0 + x * 8, row1 + x * 8, sum01, sum23);
+			sum01 = _mm_srli_epi16(_mm_add_epi16(sum01, rounding), 2);
+			sum23 = _mm_srli_epi16(_mm_add_epi16(sum23, rounding), 2);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), _mm_packus_epi16(sum01, sum23));
+		}
+	}
+
+	for (; x < dstWidth; ++x)
+	{
+		const uint32_t x0 = x * 2;
+		const uint32_t x1 = (std::min)(x0 + 1, srcWidth - 1);
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			const uint32_t sum = row0[x0 * 4 + c] + row0[x1 * 4 + c] + row1[x0 * 4 + c] + row1[x1 * 4 + c];
+			dst[x * 4 + c] = static_cast<uint8_t>((sum + 2) >> 2);
+		}
+	}
+}
+
+static void DownsampleRowSrgb(const uint8_t* row0, const uint8_t* row1, const uint32_t srcWidth, uint8_t* dst, const uint32_t dstWidth)
+{
+	const SrgbTables& tables = GetSrgbTables();
+
+	// The table lookups are scalar, only the footprint sums go through SSE: the source rows are expanded to linear
+	// 16 bit (alpha keeps its 8 bit value) in a scratch row first
+	thread_local std::vector<uint16_t> scratch;
+	scratch.resize(static_cast<size_t>(srcWidth) * 8);
+	uint16_t* linear0 = scratch.data();
+	uint16_t* linear1 = scratch.data() + srcWidth * 4;
+	for (uint32_t i = 0; i < srcWidth; ++i)
+	{
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			linear0[i * 4 + c] = tables.toLinear[row0[i * 4 + c]];
+			linear1[i * 4 + c] = tables.toLinear[row1[i * 4 + c]];
+		}
+		linear0[i * 4 + 3] = row0[i * 4 + 3];
+		linear1[i * 4 + 3] = row1[i * 4 + 3];
+	}
+
+	alignas(16) uint16_t sums[8];
+	uint32_t x = 0;
+	if (srcWidth > 1)
+	{
+		for (; x + 2 <= dstWidth; x += 2)
+		{
+			// 2 output pixels: 4 source pixels of 4 channels per row
+			const __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(linear0 + x * 8));
+			const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(linear0 + x * 8 + 8));
+			const __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(linear1 + x * 8));
+			const __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(linear1 + x * 8 + 8));
+			const __m128i p01 = _mm_add_epi16(a0, a1);
+			const __m128i p23 = _mm_add_epi16(b0, b1);
+			_mm_store_si128(reinterpret_cast<__m128i*>(sums), _mm_add_epi16(_mm_unpacklo_epi64(p01, p23), _mm_unpackhi_epi64(p01, p23)));
+
+			for (uint32_t p = 0; p < 2; ++p)
+			{
+				uint8_t* out = dst + (x + p) * 4;
+				out[0] = tables.fromLinearSum[sums[p * 4 + 0]];
+				out[1] = tables.fromLinearSum[sums[p * 4 + 1]];
+				out[2] = tables.fromLinearSum[sums[p * 4 + 2]];
+				out[3] = static_cast<uint8_t>((sums[p * 4 + 3] + 2) >> 2);
+			}
+		}
+	}
+
+	for (; x < dstWidth; ++x)
+	{
+		const uint32_t x0 = x * 2;
+		const uint32_t x1 = (std::min)(x0 + 1, srcWidth - 1);
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			const uint32_t sum = linear0[x0 * 4 + c] + linear0[x1 * 4 + c] + linear1[x0 * 4 + c] + linear1[x1 * 4 + c];
+			dst[x * 4 + c] = c < 3 ? tables.fromLinearSum[sum] : static_cast<uint8_t>((sum + 2) >> 2);
+		}
+	}
+}
+
+MipChain GenerateMipChain(const uint8_t* rgba, const uint32_t width, const uint32_t height, const bool srgb)
+{
+	MipChain chain;
+	const uint32_t levelCount = MipLevelCount(width, height);
+	chain.levels.resize(levelCount);
+	chain.levels[0] = { rgba, width, height };
+
+	// Size the storage once so the level pointers stay valid
+	size_t storageSize = 0;
+	for (uint32_t level = 1, w = width, h = height; level < levelCount; ++level)
+	{
+		w = (std::max)(1u, w / 2);
+		h = (std::max)(1u, h / 2);
+		storageSize += static_cast<size_t>(w) * h * 4;
+	}
+	chain.storage.resize(storageSize);
+
+	JobSystem& jobs = JobSystem::Get();
+	auto DownsampleRow = srgb ? DownsampleRowSrgb : DownsampleRowLinear;
+
+	size_t offset = 0;
+	for (uint32_t level = 1; level < levelCount; ++level)
+	{
+		const MipLevel& src = chain.levels[level - 1];
+		MipLevel& dst = chain.levels[level];
+		uint8_t* dstPixels = chain.storage.data() + offset;
+		dst = { dstPixels, (std::max)(1u, src.width / 2), (std::max)(1u, src.height / 2) };
+		offset += static_cast<size_t>(dst.width) * dst.height * 4;
+
+		const size_t srcPitch = static_cast<size_t>(src.width) * 4;
+		const size_t dstPitch = static_cast<size_t>(dst.width) * 4;
+		const uint32_t grain = (std::max)(1u, kMinBatchPixels / dst.width);
+		jobs.ParallelFor(dst.height, grain, [&](const size_t y)
+		{
+			const uint8_t* row0 = src.pixels + (y * 2) * srcPitch;
+			const uint8_t* row1 = src.pixels + (std::min)(y * 2 + 1, static_cast<size_t>(src.height) - 1) * srcPitch;
+			DownsampleRow(row0, row1, src.width, dstPixels + y * dstPitch, dst.width);
+		});
+	}
+
+	return chain;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// One level of a mip chain, RGBA8 rows tightly packed
+struct MipLevel
+{
+	const uint8_t* pixels = nullptr;
+	uint32_t width = 0;
+	uint32_t height = 0;
+};
+
+// Level 0 points at the source image, the smaller levels live in storage
+struct MipChain
+{
+	std::vector<uint8_t> storage;
+	std::vector<MipLevel> levels;
+};
+
+// Levels down to 1x1, each one half the size of the previous one rounded down
+uint32_t MipLevelCount(uint32_t width, uint32_t height);
+
+// 2x2 box filter of every level into the next one (odd sizes drop the last row / column like D3D does). With srgb the
+// color channels are averaged in linear space, alpha is always linear. The rows of each level are split over the job
+// system, the levels go one after the other since each one reads the previous. rgba has to outlive the chain.
+MipChain GenerateMipChain(const uint8_t* rgba, uint32_t width, uint32_t height, bool srgb);
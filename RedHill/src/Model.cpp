@@ -1,275 +1,179 @@
 #include "Model.h"
 
-#include <map>
 #include <cmath>
 #include <cstdint>
 #include <algorithm>
+#include <chrono>
+
+#include "Config.h"
+#include "ObjParser.h"
 
 #define TINYOBJLOADER_DISABLE_FAST_FLOAT
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loader.h"
 
-#include "mikktspace.h"
+#include "FlatHashMap.h"
+#include "Icosphere.h"
+#include "TangentSpace.h"
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
+#include "Simplifier.h"
 
-struct MeshLoader
+// Reference path, kept for files the parallel parser doesn't handle (polygons, exotic statements...)
+static bool ParseObjWithTinyObj(const std::string& objFile, ObjData& out)
 {
-	std::vector<Vertex>& vertex;
-	std::vector<uint32_t>& index;
-
-	static int GetNumFaces(const SMikkTSpaceContext* ctx)
-	{
-		MeshLoader* meshLoader = static_cast<MeshLoader*>(ctx->m_pUserData);
-		return meshLoader->index.size() / 3;
-	}
-
-	static int GetNumVerticesOfFace(const SMikkTSpaceContext* ctx, const int face)
-	{
-		return 3;
-	}
+	tinyobj::ObjReaderConfig config;
+	config.triangulate = true;
 
-	static void GetPosition(const SMikkTSpaceContext* ctx, float posOut[3], const int face, const int vert)
+	tinyobj::ObjReader reader;
+	if (!reader.ParseFromFile(objFile, config))
 	{
-		MeshLoader* meshLoader = static_cast<MeshLoader*>(ctx->m_pUserData);
-		const uint32_t& vI = meshLoader->index[face * 3 + vert];
-		const Vertex& v = meshLoader->vertex[vI];
-		posOut[0] = v.position[0];
-		posOut[1] = v.position[1];
-		posOut[2] = v.position[2];
+		if (!reader.Error().empty())
+		{
+			::OutputDebugStringA(reader.Error().c_str());
+			::__debugbreak();
+		}
+		return false;
 	}
 
-	static void GetNormal(const SMikkTSpaceContext* ctx, float normOut[3], const int face, const int vert)
-	{
-		MeshLoader* meshLoader = static_cast<MeshLoader*>(ctx->m_pUserData);
-		const uint32_t& vI = meshLoader->index[face * 3 + vert];
-		const Vertex& v = meshLoader->vertex[vI];
-		normOut[0] = v.normal[0];
-		normOut[1] = v.normal[1];
-		normOut[2] = v.normal[2];
-	}
-	static void GetTexCoord(const SMikkTSpaceContext* ctx, float texcOut[2], const int face, const int vert)
-	{
-		MeshLoader* meshLoader = static_cast<MeshLoader*>(ctx->m_pUserData);
-		const uint32_t& vI = meshLoader->index[face * 3 + vert];
-		const Vertex& v = meshLoader->vertex[vI];
-		texcOut[0] = v.uv[0];
-		texcOut[1] = v.uv[1];
-	}
-	static void SetTSpaceBasic(const SMikkTSpaceContext* ctx, const float tangent[3], const float sign, const int face, const int vert)
+	if (!reader.Warning().empty())
 	{
-		MeshLoader* meshLoader = static_cast<MeshLoader*>(ctx->m_pUserData);
-		const uint32_t& vI = meshLoader->index[face * 3 + vert];
-		Vertex& v = meshLoader->vertex[vI];
-		v.tangent[0] = tangent[0];
-		v.tangent[1] = tangent[1];
-		v.tangent[2] = tangent[2];
-		v.tangent[3] = sign;
+		::OutputDebugStringA(reader.Warning().c_str());
 	}
-};
 
-struct VertexKey
-{
-	int32_t posIndex;
-	int32_t uvIndex;
-	int32_t normIndex;
+	const tinyobj::attrib_t& attrib = reader.GetAttrib();
+	out.positions = attrib.vertices;
+	out.texcoords = attrib.texcoords;
+	out.normals = attrib.normals;
 
-	bool operator<(const VertexKey& o) const noexcept
+	for (const auto& shape : reader.GetShapes())
 	{
-		if (posIndex == o.posIndex)
+		for (const auto& idx : shape.mesh.indices)
 		{
-			if (uvIndex == o.uvIndex)
-			{
-				return normIndex < o.normIndex;
-			}
-			return uvIndex < o.uvIndex;
+			out.corners.push_back({ idx.vertex_index, idx.texcoord_index, idx.normal_index });
 		}
-		return posIndex < o.posIndex;
 	}
-};
+	return true;
+}
 
 void PBRMesh::GenerateVertexAndIndexFromObj(const std::string& objFile)
 {
-	tinyobj::ObjReaderConfig config;
-	config.triangulate = true;
+	const auto parseStart = std::chrono::steady_clock::now();
 
-	tinyobj::ObjReader reader;
-	if (!reader.ParseFromFile(objFile, config))
+	ObjData obj;
+	bool parsed = false;
+	if (RHConfig::parallelObjIngest)
 	{
-		if (!reader.Error().empty())
+		std::string error;
+		parsed = ObjParser::ParseFromFile(objFile, obj, error);
+		if (!parsed)
 		{
-			::OutputDebugStringA(reader.Error().c_str());
-			::__debugbreak();
+			::OutputDebugStringA(error.c_str());
+			obj = {};
 		}
+	}
+
+	if (!parsed && !ParseObjWithTinyObj(objFile, obj))
+	{
 		// TODO: Handle error
+		return;
 	}
 
-	if (!reader.Warning().empty())
+	// tinyobj doesn't check the positive indices against the attribute counts
+	std::string indexError;
+	if (!parsed && !ObjParser::ValidateIndices(obj, indexError))
 	{
-		::OutputDebugStringA(reader.Warning().c_str());
+		::OutputDebugStringA(indexError.c_str());
+		return;
 	}
 
-	const tinyobj::attrib_t& attrib = reader.GetAttrib();
-	const std::vector<tinyobj::shape_t>& shapes = reader.GetShapes();
-	const std::vector<tinyobj::material_t>& materials = reader.GetMaterials();
+	const auto parseEnd = std::chrono::steady_clock::now();
+	char message[128];
+	sprintf_s(message, "OBJ parse (%s): %.2f ms\n", parsed ? "parallel" : "tinyobj",
+		std::chrono::duration<double, std::milli>(parseEnd - parseStart).count());
+	::OutputDebugStringA(message);
+
+	// Size the index buffer and the dedup table from the corner count up front (there can't be more unique vertices than corners)
+	const size_t cornerCount = obj.corners.size();
+	indices_data.reserve(cornerCount);
 
-	std::map<VertexKey, uint32_t> vertexMap;
+	FlatHashMap<VertexKey, uint32_t, VertexKeyHash> vertexMap(cornerCount);
 
-	for (const auto& shape : shapes)
+	for (const ObjCorner& idx : obj.corners)
 	{
-		for (const auto& idx : shape.mesh.indices)
+		VertexKey key{ idx.posIndex, idx.uvIndex, idx.normIndex };
+
+		bool inserted = false;
+		uint32_t vertexIndex = vertexMap.FindOrInsert(key, static_cast<uint32_t>(vertices_data.size()), inserted);
+		if (inserted)
 		{
-			VertexKey key{ idx.vertex_index, idx.texcoord_index, idx.normal_index };
+			Vertex v;
+			v.position[0] = obj.positions[3 * idx.posIndex];
+			v.position[1] = obj.positions[3 * idx.posIndex + 1];
+			v.position[2] = obj.positions[3 * idx.posIndex + 2];
 
-			auto it = vertexMap.find(key);
-			if (it == vertexMap.end())
+			// Missing texcoords and normals (-1) stay at zero
+			if (idx.uvIndex >= 0)
 			{
-				Vertex v;
-				v.position[0] = attrib.vertices[3 * idx.vertex_index];
-				v.position[1] = attrib.vertices[3 * idx.vertex_index + 1];
-				v.position[2] = attrib.vertices[3 * idx.vertex_index + 2];
-
-				v.uv[0] = attrib.texcoords[2 * idx.texcoord_index];
+				v.uv[0] = obj.texcoords[2 * idx.uvIndex];
 				// Convert the uvs to d3d12 conventions
-				v.uv[1] = 1.0f - attrib.texcoords[2 * idx.texcoord_index + 1];
-
-				v.normal[0] = attrib.normals[3 * idx.normal_index];
-				v.normal[1] = attrib.normals[3 * idx.normal_index + 1];
-				v.normal[2] = attrib.normals[3 * idx.normal_index + 2];
-
-				v.tangent[0] = 0.0f;
-				v.tangent[1] = 0.0f;
-				v.tangent[2] = 0.0f;
-				v.tangent[3] = 0.0f;
-
-				uint32_t newIndex = vertices_data.size();
-				vertices_data.push_back(v);
-				vertexMap[key] = newIndex;
-				indices_data.push_back(newIndex);
+				v.uv[1] = 1.0f - obj.texcoords[2 * idx.uvIndex + 1];
 			}
-			else
+
+			if (idx.normIndex >= 0)
 			{
-				indices_data.push_back(it->second);
+				v.normal[0] = obj.normals[3 * idx.normIndex];
+				v.normal[1] = obj.normals[3 * idx.normIndex + 1];
+				v.normal[2] = obj.normals[3 * idx.normIndex + 2];
 			}
+
+			v.tangent[0] = 0.0f;
+			v.tangent[1] = 0.0f;
+			v.tangent[2] = 0.0f;
+			v.tangent[3] = 0.0f;
+
+			vertices_data.push_back(v);
 		}
+		indices_data.push_back(vertexIndex);
 	}
 
 	// Tangent space generation
 
-	MeshLoader mesh{ vertices_data, indices_data };
-
-	SMikkTSpaceInterface ispace = {};
-	ispace.m_getNumFaces = MeshLoader::GetNumFaces;
-	ispace.m_getNumVerticesOfFace = MeshLoader::GetNumVerticesOfFace;
-	ispace.m_getPosition = MeshLoader::GetPosition;
-	ispace.m_getNormal = MeshLoader::GetNormal;
-	ispace.m_getTexCoord = MeshLoader::GetTexCoord;
-	ispace.m_setTSpaceBasic = MeshLoader::SetTSpaceBasic;
-	ispace.m_setTSpace = nullptr;
+	GenerateTangents(vertices_data, indices_data);
 
-	SMikkTSpaceContext ctx = {};
-	ctx.m_pUserData = &mesh;
-	ctx.m_pInterface = &ispace;
+	if (RHConfig::optimizeMeshes)
+	{
+		OptimizeMesh(vertices_data, indices_data, objFile.c_str());
+	}
 
-	//  We could check the return to handle errors
-	genTangSpaceDefault(&ctx);
+	// Clustered after the optimization, the seeds follow the final triangle order
+	if (RHConfig::buildMeshlets)
+	{
+		BuildMeshMeshlets(vertices_data, indices_data, meshlets, objFile.c_str());
+	}
 
+	// Last, the levels are appended after the full detail indices the meshlets were built from
+	if (RHConfig::buildLods)
+	{
+		BuildMeshLods(vertices_data, indices_data, lods, objFile.c_str());
+	}
 }
 
 void PBRMesh::GenerateSphere(uint32_t subdivisions)
 {
-	vertices_data.clear();
-	indices_data.clear();
-
-	// Add the vertices to the vertex buffer, project them into the unit sphere and keep track of the indices in the index buffer
-	auto AddVertex = [this](float x, float y, float z) -> uint32_t
-	{
-		float invLength = 1.0f / sqrtf(x * x + y * y + z * z);
-		Vertex v = {};
-		v.position[0] = x * invLength;
-		v.position[1] = y * invLength;
-		v.position[2] = z * invLength;
-
-		// Normal is the same as the position for a unit sphere
-		v.normal[0] = v.position[0];
-		v.normal[1] = v.position[1];
-		v.normal[2] = v.position[2];
-
-		uint32_t index = static_cast<uint32_t>(vertices_data.size());
-		vertices_data.push_back(v);
-		return index;
-	};
-
-	const float phi = (1.0f + sqrt(5.0f)) * 0.5f; // golden ratio
-	// Add the 12 base vertices of an icosahedron
-
-	AddVertex(-1.0f, phi, 0.0f);
-	AddVertex(1.0f, phi, 0.0f);
-	AddVertex(-1.0f, -phi, 0.0f);
-	AddVertex(1.0f, -phi, 0.0f);
-
-	AddVertex(0.0f, -1.0f, phi);
-	AddVertex(0.0f, 1.0f, phi);
-	AddVertex(0.0f, -1.0f, -phi);
-	AddVertex(0.0f, 1.0f, -phi);
-
-	AddVertex(phi, 0.0f, -1.0f);
-	AddVertex(phi, 0.0f, 1.0f);
-	AddVertex(-phi, 0.0f, -1.0f);
-	AddVertex(-phi, 0.0f, 1.0f);
-
-	// Build an auxiliary base index buffer
-	std::vector<uint32_t> baseIndices =
-	{
-		0, 11, 5,   0, 5, 1,    0, 1, 7,    0, 7, 10,   0, 10, 11,
-		1, 5, 9,    5, 11, 4,   11, 10, 2,  10, 7, 6,   7, 1, 8,
-		3, 9, 4,    3, 4, 2,    3, 2, 6,    3, 6, 8,    3, 8, 9,
-		4, 9, 5,    2, 4, 11,   6, 2, 10,   8, 6, 7,    9, 8, 1
-	};
-
-	std::map<uint64_t, uint32_t> vertexMidPointCache;
+	GenerateIcosphere(subdivisions, vertices_data, indices_data, lods);
 
-	auto GetMidPoint = [&](uint32_t a, uint32_t b) -> uint32_t
+	// The levels share the vertex buffer, only the triangles of each level can be reordered
+	if (RHConfig::optimizeMeshes)
 	{
-			auto lohi = std::minmax(a, b);
-			auto key = static_cast<uint64_t>(lohi.first) << 32 | static_cast<uint64_t>(lohi.second);
-			auto it = vertexMidPointCache.find(key);
-			if (it != vertexMidPointCache.end())
-			{
-				return it->second;
-			}
-
-			const Vertex& va = vertices_data[a];
-			const Vertex& vb = vertices_data[b];
-			uint32_t midIndex = AddVertex(
-				(va.position[0] + vb.position[0]) * 0.5f,
-				(va.position[1] + vb.position[1]) * 0.5f,
-				(va.position[2] + vb.position[2]) * 0.5f
-			);
-			vertexMidPointCache[key] = midIndex;
-			return midIndex;
-	};
-
-	for (uint32_t i = 0; i < subdivisions; ++i)
-	{
-		std::vector<uint32_t> newIndices;
-		for (size_t j = 0; j < baseIndices.size(); j += 3)
+		for (size_t level = 0; level < lods.size(); ++level)
 		{
-			uint32_t v0 = baseIndices[j];
-			uint32_t v1 = baseIndices[j + 1];
-			uint32_t v2 = baseIndices[j + 2];
-
-			uint32_t v01 = GetMidPoint(v0, v1);
-			uint32_t v12 = GetMidPoint(v1, v2);
-			uint32_t v20 = GetMidPoint(v2, v0);
-
-			newIndices.insert(newIndices.end(), { v0, v01, v20 });
-			newIndices.insert(newIndices.end(), { v1, v12, v01 });
-			newIndices.insert(newIndices.end(), { v2, v20, v12 });
-			newIndices.insert(newIndices.end(), { v01, v12, v20 });
+			const MeshLod& lod = lods[level];
+			char name[32];
+			sprintf_s(name, "sphere lod %zu", level);
+			OptimizeIndexRange(std::span<uint32_t>(indices_data).subspan(lod.indexOffset, lod.indexCount), vertices_data, lod.vertexCount, name);
 		}
-		baseIndices = std::move(newIndices);
 	}
-
-	indices_data = std::move(baseIndices);
 }
 
 void PBRMesh::GenerateFloor(float size)
@@ -302,3 +206,26 @@ void PBRMesh::GenerateFloor(float size)
 
 	indices_data = { 0, 1, 2, 0, 3, 1 };
 }
+
+void PBRMesh::ComputeBounds()
+{
+	if (vertices_data.empty())
+	{
+		return;
+	}
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		boundsMin[axis] = vertices_data[0].position[axis];
+		boundsMax[axis] = vertices_data[0].position[axis];
+	}
+
+	for (const Vertex& v : vertices_data)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			boundsMin[axis] = (std::min)(boundsMin[axis], v.position[axis]);
+			boundsMax[axis] = (std::max)(boundsMax[axis], v.position[axis]);
+		}
+	}
+}
@@ -8,42 +8,30 @@
 
 #include <wrl.h>
 #include "DescriptorHeapAllocator.h"
+#include "MeshTypes.h"
 
 #include <string>
 #include <vector>
 
 using Microsoft::WRL::ComPtr;
 
-struct Vertex
-{
-	float position[3] = { 0.0f, 0.0f, 0.0f };
-	float uv[2] = { 0.0f, 0.0f };
-	float normal[3] = { 0.0f, 0.0f, 0.0f };
-	float tangent[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
-};
-
 struct PBRMesh
 {
 
 public:
 	ComPtr<ID3D12Resource> vBuffer;
-	ComPtr<ID3D12Resource> vBufferUploader;
 
 	ComPtr<ID3D12Resource> iBuffer;
-	ComPtr<ID3D12Resource> iBufferUploader;
 
 	ComPtr<ID3D12Resource> albedoTexture;
-	ComPtr<ID3D12Resource> albedoTextureUploader;
 	ComPtr<ID3D12Resource> normalTexture;
-	ComPtr<ID3D12Resource> normalTextureUploader;
 	ComPtr<ID3D12Resource> metalRoughnessTexture;
-	ComPtr<ID3D12Resource> metalRoughnessTextureUploader;
 	ComPtr<ID3D12Resource> aoTexture;
-	ComPtr<ID3D12Resource> aoTextureUploader;
 
 	// Let's store the descriptor handles for the textures in the mesh itself, so we can easily bind them when rendering
 	// Note: In a more complex engine, you might want to manage these handles in a more centralized way with a material system, but for this example, we'll keep it simple.
-	// These handles are assumed to be contiguous in the descriptor heap but we will store them all
+	// The 4 handles are one range of the heap so the first one binds the table, we store them all for the views
+	DescriptorHandle textureSrvHandles;
 	DescriptorHandle albedoTextureSrvHandle;
 	DescriptorHandle normalTextureSrvHandle;
 	DescriptorHandle metalRoughnessTextureSrvHandle;
@@ -55,6 +43,21 @@ public:
 	UINT iBufferSize = 0;
 	DXGI_FORMAT iBufferFormat = DXGI_FORMAT_R16_UINT;
 
+	// Number of indices uploaded to the index buffer. The cpu side arrays may be empty when the mesh is uploaded straight from a cooked file
+	UINT indexCount = 0;
+
+	float boundsMin[3] = { 0.0f, 0.0f, 0.0f };
+	float boundsMax[3] = { 0.0f, 0.0f, 0.0f };
+
+	// Only meaningful when the vertex buffer holds PackedVertex
+	VertexQuantization quantization;
+
+	// Coarsest first, empty for meshes without levels of detail (the whole index buffer is drawn)
+	std::vector<MeshLod> lods;
+
+	// Empty unless the mesh was clustered
+	MeshletData meshlets;
+
 	std::vector<Vertex> vertices_data = {};
 	std::vector<uint32_t> indices_data = {};
 
@@ -80,8 +83,11 @@ public:
 
 	void GenerateVertexAndIndexFromObj(const std::string& objFile);
 
+	// Icosphere with every subdivision level 0..subdivisions as a LOD
 	void GenerateSphere(uint32_t subdivisions);
 
 	void GenerateFloor(float size);
 
+	void ComputeBounds();
+
 };
@@ -0,0 +1,459 @@
+#include "ObjParser.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <fstream>
+
+#include "JobSystem.h"
+
+namespace
+{
+	// Chunks smaller than this are not worth a job
+	constexpr size_t kMinChunkSize = 256 * 1024;
+
+	enum RelativeFlags : uint8_t
+	{
+		RelativePos = 1 << 0,
+		RelativeUv = 1 << 1,
+		RelativeNorm = 1 << 2
+	};
+
+	struct ObjChunk
+	{
+		const char* begin = nullptr;
+		const char* end = nullptr;
+
+		std::vector<float> positions;
+		std::vector<float> texcoords;
+		std::vector<float> normals;
+		std::vector<ObjCorner> corners;
+
+		// For every corner, which of its indices are still relative to the start of this chunk
+		std::vector<uint8_t> relative;
+
+		bool failed = false;
+		std::string error;
+	};
+
+	inline bool IsBlank(const char c)
+	{
+		return c == ' ' || c == '\t';
+	}
+
+	inline bool IsTokenEnd(const char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+	}
+
+	inline void SkipBlanks(const char*& p, const char* end)
+	{
+		while (p < end && IsBlank(*p))
+		{
+			++p;
+		}
+	}
+
+	inline bool IsDigit(const char c)
+	{
+		return c >= '0' && c <= '9';
+	}
+
+	// The float parser tinyobj uses when built with TINYOBJLOADER_DISABLE_FAST_FLOAT (like Model.cpp does), step for step.
+	// It isn't correctly rounded (from_chars differs in the last bits on ~5% of the values with an exponent), copying it
+	// is what keeps both paths bit identical. Greedy, false when the token doesn't start with a number.
+	bool ParseDouble(const char* p, const char* end, double& result)
+	{
+		if (p >= end)
+		{
+			return false;
+		}
+
+		double mantissa = 0.0;
+		int exponent = 0;
+		char sign = '+';
+		char exponentSign = '+';
+		int read = 0;
+		bool leadingDot = false;
+
+		if (*p == '+' || *p == '-')
+		{
+			sign = *p++;
+			leadingDot = p != end && *p == '.';
+		}
+		else if (*p == '.')
+		{
+			leadingDot = true;
+		}
+		else if (!IsDigit(*p))
+		{
+			return false;
+		}
+
+		if (!leadingDot)
+		{
+			while (p != end && IsDigit(*p))
+			{
+				mantissa = mantissa * 10 + static_cast<int>(*p++ - '0');
+				++read;
+			}
+			if (read == 0)
+			{
+				return false;
+			}
+		}
+
+		if (p != end)
+		{
+			if (*p == '.')
+			{
+				static const double kPowers[] = { 1.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001 };
+				++p;
+				for (read = 1; p != end && IsDigit(*p); ++read)
+				{
+					mantissa += static_cast<int>(*p++ - '0') * (read < 8 ? kPowers[read] : std::pow(10.0, -read));
+				}
+			}
+
+			if (p != end && (*p == 'e' || *p == 'E'))
+			{
+				++p;
+				if (p != end && (*p == '+' || *p == '-'))
+				{
+					exponentSign = *p++;
+				}
+				else if (p == end || !IsDigit(*p))
+				{
+					return false;
+				}
+
+				for (read = 0; p != end && IsDigit(*p); ++read)
+				{
+					if (exponent > (2147483647 - 9) / 10)
+					{
+						return false;
+					}
+					exponent = exponent * 10 + static_cast<int>(*p++ - '0');
+				}
+				exponent *= exponentSign == '+' ? 1 : -1;
+				if (read == 0)
+				{
+					return false;
+				}
+			}
+		}
+
+		result = (sign == '+' ? 1 : -1) * (exponent ? std::ldexp(mantissa * std::pow(5.0, exponent), exponent) : mantissa);
+		return true;
+	}
+
+	// Parse as double and narrow afterwards, 0 for a token that isn't a number, like tinyobj parseReal
+	inline float ParseFloat(const char*& p, const char* end)
+	{
+		SkipBlanks(p, end);
+		const char* tokenEnd = p;
+		while (tokenEnd < end && !IsTokenEnd(*tokenEnd))
+		{
+			++tokenEnd;
+		}
+
+		double value = 0.0;
+		ParseDouble(p, tokenEnd, value);
+		p = tokenEnd;
+		return static_cast<float>(value);
+	}
+
+	inline int32_t ParseInt(const char*& p, const char* end)
+	{
+		const char* first = (p < end && *p == '+') ? p + 1 : p;
+		int32_t value = 0;
+		auto result = std::from_chars(first, end, value);
+		p = result.ptr;
+		return value;
+	}
+
+	// Same rules as tinyobj fixIndex: 1 based positive indices, negative indices relative to the current count.
+	// Relative indices are stored relative to the chunk start and flagged so the merge can offset them.
+	inline bool FixIndex(const int32_t idx, const size_t localCount, int32_t& ret, uint8_t& relativeMask, const uint8_t flag)
+	{
+		if (idx > 0)
+		{
+			ret = idx - 1;
+			return true;
+		}
+		if (idx < 0)
+		{
+			ret = static_cast<int32_t>(localCount) + idx;
+			relativeMask |= flag;
+			return true;
+		}
+		ret = -1;
+		return false;
+	}
+
+	// -1 is a missing texcoord or normal, a position is never missing
+	inline bool IsValidCorner(const ObjCorner& corner, const size_t posCount, const size_t uvCount, const size_t normCount)
+	{
+		return corner.posIndex >= 0 && static_cast<size_t>(corner.posIndex) < posCount &&
+			corner.uvIndex >= -1 && (corner.uvIndex == -1 || static_cast<size_t>(corner.uvIndex) < uvCount) &&
+			corner.normIndex >= -1 && (corner.normIndex == -1 || static_cast<size_t>(corner.normIndex) < normCount);
+	}
+
+	bool ParseCorner(const char*& p, const char* end, ObjChunk& chunk, ObjCorner& corner, uint8_t& relativeMask)
+	{
+		if (!FixIndex(ParseInt(p, end), chunk.positions.size() / 3, corner.posIndex, relativeMask, RelativePos))
+		{
+			return false;
+		}
+
+		if (p >= end || *p != '/')
+		{
+			return true;
+		}
+		++p;
+
+		// i//k
+		if (p < end && *p == '/')
+		{
+			++p;
+			FixIndex(ParseInt(p, end), chunk.normals.size() / 3, corner.normIndex, relativeMask, RelativeNorm);
+			return true;
+		}
+
+		// i/j or i/j/k
+		FixIndex(ParseInt(p, end), chunk.texcoords.size() / 2, corner.uvIndex, relativeMask, RelativeUv);
+		if (p >= end || *p != '/')
+		{
+			return true;
+		}
+		++p;
+		FixIndex(ParseInt(p, end), chunk.normals.size() / 3, corner.normIndex, relativeMask, RelativeNorm);
+		return true;
+	}
+
+	void ParseChunk(ObjChunk& chunk)
+	{
+		const char* p = chunk.begin;
+		const char* end = chunk.end;
+
+		while (p < end && !chunk.failed)
+		{
+			const char* lineEnd = std::find(p, end, '\n');
+
+			SkipBlanks(p, lineEnd);
+
+			if (p + 1 < lineEnd && p[0] == 'v' && IsBlank(p[1]))
+			{
+				p += 2;
+				chunk.positions.push_back(ParseFloat(p, lineEnd));
+				chunk.positions.push_back(ParseFloat(p, lineEnd));
+				chunk.positions.push_back(ParseFloat(p, lineEnd));
+			}
+			else if (p + 2 < lineEnd && p[0] == 'v' && p[1] == 't' && IsBlank(p[2]))
+			{
+				p += 3;
+				chunk.texcoords.push_back(ParseFloat(p, lineEnd));
+				chunk.texcoords.push_back(ParseFloat(p, lineEnd));
+			}
+			else if (p + 2 < lineEnd && p[0] == 'v' && p[1] == 'n' && IsBlank(p[2]))
+			{
+				p += 3;
+				chunk.normals.push_back(ParseFloat(p, lineEnd));
+				chunk.normals.push_back(ParseFloat(p, lineEnd));
+				chunk.normals.push_back(ParseFloat(p, lineEnd));
+			}
+			else if (p + 1 < lineEnd && p[0] == 'f' && IsBlank(p[1]))
+			{
+				p += 2;
+
+				ObjCorner face[3];
+				uint8_t relative[3] = {};
+				uint32_t cornerCount = 0;
+
+				SkipBlanks(p, lineEnd);
+				while (p < lineEnd && !IsTokenEnd(*p))
+				{
+					if (cornerCount == 3)
+					{
+						chunk.failed = true;
+						chunk.error = "ObjParser: polygon with more than 3 corners found\n";
+						break;
+					}
+
+					if (!ParseCorner(p, lineEnd, chunk, face[cornerCount], relative[cornerCount]))
+					{
+						chunk.failed = true;
+						chunk.error = "ObjParser: invalid face index found\n";
+						break;
+					}
+					++cornerCount;
+
+					// Skip whatever is left of the token and the separators
+					while (p < lineEnd && !IsTokenEnd(*p))
+					{
+						++p;
+					}
+					SkipBlanks(p, lineEnd);
+				}
+
+				if (!chunk.failed && cornerCount == 3)
+				{
+					chunk.corners.insert(chunk.corners.end(), face, face + 3);
+					chunk.relative.insert(chunk.relative.end(), relative, relative + 3);
+				}
+			}
+
+			p = lineEnd + 1;
+		}
+	}
+}
+
+bool ObjParser::ParseFromFile(const std::string& objFile, ObjData& out, std::string& error, uint32_t threadCount)
+{
+	std::ifstream file(objFile, std::ios::binary | std::ios::ate);
+	if (!file)
+	{
+		error = "ObjParser: cannot open " + objFile + "\n";
+		return false;
+	}
+
+	const std::streamsize size = file.tellg();
+	file.seekg(0, std::ios::beg);
+
+	std::vector<char> buffer(static_cast<size_t>(size));
+	if (!file.read(buffer.data(), size))
+	{
+		error = "ObjParser: cannot read " + objFile + "\n";
+		return false;
+	}
+
+	return ParseFromMemory(buffer.data(), buffer.size(), out, error, threadCount);
+}
+
+bool ObjParser::ParseFromMemory(const char* data, size_t size, ObjData& out, std::string& error, uint32_t threadCount)
+{
+	JobSystem& jobs = JobSystem::Get();
+	if (threadCount == 0)
+	{
+		threadCount = jobs.ThreadCount();
+	}
+
+	const size_t chunkCount = std::clamp<size_t>(size / kMinChunkSize, 1, threadCount);
+
+	// Split the buffer in line aligned chunks
+	std::vector<ObjChunk> chunks(chunkCount);
+	const char* cursor = data;
+	const char* end = data + size;
+	for (size_t i = 0; i < chunkCount; ++i)
+	{
+		const char* chunkEnd = (i + 1 == chunkCount) ? end : std::max(cursor, data + (size * (i + 1)) / chunkCount);
+		chunkEnd = std::find(chunkEnd, end, '\n');
+		if (chunkEnd != end)
+		{
+			++chunkEnd;
+		}
+
+		chunks[i].begin = cursor;
+		chunks[i].end = chunkEnd;
+		cursor = chunkEnd;
+	}
+
+	// Parse every chunk in parallel
+	jobs.ParallelFor(chunkCount, 1, [&chunks](const size_t i) { ParseChunk(chunks[i]); });
+
+	for (const ObjChunk& chunk : chunks)
+	{
+		if (chunk.failed)
+		{
+			error = chunk.error;
+			return false;
+		}
+	}
+
+	// Prefix sums of the attribute counts give each chunk its global base offsets
+	std::vector<size_t> posBase(chunkCount), uvBase(chunkCount), normBase(chunkCount), cornerBase(chunkCount);
+	size_t posTotal = 0, uvTotal = 0, normTotal = 0, cornerTotal = 0;
+	for (size_t i = 0; i < chunkCount; ++i)
+	{
+		posBase[i] = posTotal;
+		uvBase[i] = uvTotal;
+		normBase[i] = normTotal;
+		cornerBase[i] = cornerTotal;
+
+		posTotal += chunks[i].positions.size();
+		uvTotal += chunks[i].texcoords.size();
+		normTotal += chunks[i].normals.size();
+		cornerTotal += chunks[i].corners.size();
+	}
+
+	out.positions.resize(posTotal);
+	out.texcoords.resize(uvTotal);
+	out.normals.resize(normTotal);
+	out.corners.resize(cornerTotal);
+
+	// Merge, every chunk writes its own disjoint range so this is parallel too. The indices are checked once resolved,
+	// they may point past the attributes of their chunk but not past the end of the file (nor before its start).
+	auto MergeChunk = [&](const size_t i)
+	{
+		ObjChunk& chunk = chunks[i];
+		std::copy(chunk.positions.begin(), chunk.positions.end(), out.positions.begin() + posBase[i]);
+		std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), out.texcoords.begin() + uvBase[i]);
+		std::copy(chunk.normals.begin(), chunk.normals.end(), out.normals.begin() + normBase[i]);
+
+		const int32_t posOffset = static_cast<int32_t>(posBase[i] / 3);
+		const int32_t uvOffset = static_cast<int32_t>(uvBase[i] / 2);
+		const int32_t normOffset = static_cast<int32_t>(normBase[i] / 3);
+
+		ObjCorner* dst = out.corners.data() + cornerBase[i];
+		for (size_t c = 0; c < chunk.corners.size(); ++c)
+		{
+			ObjCorner corner = chunk.corners[c];
+			const uint8_t relative = chunk.relative[c];
+			if (relative & RelativePos)
+			{
+				corner.posIndex += posOffset;
+			}
+			if (relative & RelativeUv)
+			{
+				corner.uvIndex += uvOffset;
+			}
+			if (relative & RelativeNorm)
+			{
+				corner.normIndex += normOffset;
+			}
+			// A relative index resolving to -1 points before the start of the file, it isn't a missing attribute
+			const bool beforeStart = ((relative & RelativeUv) && corner.uvIndex < 0) || ((relative & RelativeNorm) && corner.normIndex < 0);
+			if (beforeStart || !IsValidCorner(corner, posTotal / 3, uvTotal / 2, normTotal / 3))
+			{
+				chunk.failed = true;
+			}
+			dst[c] = corner;
+		}
+	};
+
+	jobs.ParallelFor(chunkCount, 1, MergeChunk);
+
+	for (const ObjChunk& chunk : chunks)
+	{
+		if (chunk.failed)
+		{
+			error = "ObjParser: face index out of range found\n";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool ObjParser::ValidateIndices(const ObjData& data, std::string& error)
+{
+	for (const ObjCorner& corner : data.corners)
+	{
+		if (!IsValidCorner(corner, data.positions.size() / 3, data.texcoords.size() / 2, data.normals.size() / 3))
+		{
+			error = "ObjParser: face index out of range found\n";
+			return false;
+		}
+	}
+	return true;
+}
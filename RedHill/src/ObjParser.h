@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "FlatHashMap.h"
+
+// Index triple of a face corner. Indices are already resolved to absolute 0 based positions in the attribute
+// arrays, -1 means the attribute is missing (same convention as tinyobj::index_t).
+struct ObjCorner
+{
+	int32_t posIndex = -1;
+	int32_t uvIndex = -1;
+	int32_t normIndex = -1;
+};
+
+// Corners with the same key become one vertex of the mesh
+struct VertexKey
+{
+	int32_t posIndex;
+	int32_t uvIndex;
+	int32_t normIndex;
+
+	bool operator==(const VertexKey& o) const noexcept
+	{
+		return posIndex == o.posIndex && uvIndex == o.uvIndex && normIndex == o.normIndex;
+	}
+};
+
+struct VertexKeyHash
+{
+	size_t operator()(const VertexKey& key) const noexcept
+	{
+		// Pack the three obj indices in a single 64 bit word (21 bits each covers ~2M attributes per stream,
+		// collisions beyond that only cost an extra probe) and mix it
+		uint64_t packed = (static_cast<uint64_t>(static_cast<uint32_t>(key.posIndex)) & 0x1FFFFF) |
+			((static_cast<uint64_t>(static_cast<uint32_t>(key.uvIndex)) & 0x1FFFFF) << 21) |
+			((static_cast<uint64_t>(static_cast<uint32_t>(key.normIndex)) & 0x1FFFFF) << 42);
+		return static_cast<size_t>(MixHash64(packed));
+	}
+};
+
+struct ObjData
+{
+	std::vector<float> positions;	// xyz
+	std::vector<float> texcoords;	// uv
+	std::vector<float> normals;		// xyz
+	std::vector<ObjCorner> corners;	// 3 per triangle, in file order
+};
+
+// Parallel OBJ ingest. The file is read once, split in line aligned chunks and each chunk is parsed as a job. Relative (negative) indices are resolved in a merge step once the attribute counts of the previous
+// chunks are known, so the result matches what tinyobj produces for the same file.
+// Only the geometry statements (v, vt, vn, f) are handled. Faces with more than 3 corners are not triangulated
+// here, the parser fails instead so the caller can fall back to tinyobj and keep the exact same triangulation.
+class ObjParser
+{
+public:
+	// Splits in at most threadCount chunks, 0 uses every thread of the job system
+	static bool ParseFromFile(const std::string& objFile, ObjData& out, std::string& error, uint32_t threadCount = 0);
+
+	static bool ParseFromMemory(const char* data, size_t size, ObjData& out, std::string& error, uint32_t threadCount = 0);
+
+	// False if a corner indexes past its attribute array (the parse already checks this, for data from elsewhere)
+	static bool ValidateIndices(const ObjData& data, std::string& error);
+};
@@ -0,0 +1,145 @@
+#include "PlacedResourceAllocator.h"
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN             // Exclude rarely-used stuff from Windows headers.
+#endif
+
+#include <windows.h>
+#include "Utils.h"
+
+#include <algorithm>
+#include <atomic>
+
+// Key of the PlacedRange attached to the placed resources
+static const GUID kPlacedRangeGuid = { 0x6f1c3a52, 0x8e4b, 0x4d0a, { 0x9b, 0x27, 0x31, 0x5e, 0xc8, 0x44, 0x0f, 0xa1 } };
+
+// Ranges are carved at the default placement alignment, MSAA targets ask for 4MB
+static constexpr uint64_t kGranularity = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+
+// Frees its range of the heap when the resource it is attached to releases it
+class PlacedResourceAllocator::PlacedRange final : public IUnknown
+{
+public:
+	PlacedRange(PlacedResourceAllocator* owner, const PlacedHeapKind kind, const uint32_t heapIndex, const uint32_t handle) :
+		m_owner(owner), m_kind(kind), m_heapIndex(heapIndex), m_handle(handle)
+	{
+	}
+
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override
+	{
+		if (riid == __uuidof(IUnknown))
+		{
+			*object = static_cast<IUnknown*>(this);
+			AddRef();
+			return S_OK;
+		}
+		*object = nullptr;
+		return E_NOINTERFACE;
+	}
+
+	ULONG STDMETHODCALLTYPE AddRef() override
+	{
+		return ++m_refCount;
+	}
+
+	ULONG STDMETHODCALLTYPE Release() override
+	{
+		const ULONG count = --m_refCount;
+		if (count == 0)
+		{
+			m_owner->Free(m_kind, m_heapIndex, m_handle);
+			delete this;
+		}
+		return count;
+	}
+
+private:
+	std::atomic<ULONG> m_refCount = 1;
+	PlacedResourceAllocator* m_owner;
+	PlacedHeapKind m_kind;
+	uint32_t m_heapIndex;
+	uint32_t m_handle;
+};
+
+static PlacedHeapKind HeapKindOf(const D3D12_RESOURCE_DESC& desc)
+{
+	if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+	{
+		return PlacedHeapKind::Buffers;
+	}
+	if (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL))
+	{
+		return PlacedHeapKind::RenderTargets;
+	}
+	return PlacedHeapKind::Textures;
+}
+
+void PlacedResourceAllocator::Init(ID3D12Device* device, const uint64_t heapSize)
+{
+	m_device = device;
+	m_heapSize = heapSize;
+}
+
+ComPtr<ID3D12Resource> PlacedResourceAllocator::CreateResource(const D3D12_RESOURCE_DESC& desc, const D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue)
+{
+	const D3D12_RESOURCE_ALLOCATION_INFO info = m_device->GetResourceAllocationInfo(0, 1, &desc);
+	const PlacedHeapKind kind = HeapKindOf(desc);
+	std::vector<std::unique_ptr<Heap>>& heaps = m_heaps[static_cast<uint32_t>(kind)];
+
+	TlsfAllocator::Allocation allocation;
+	uint32_t heapIndex = 0;
+	for (; heapIndex < heaps.size(); ++heapIndex)
+	{
+		allocation = heaps[heapIndex]->allocator.Allocate(info.SizeInBytes, info.Alignment);
+		if (allocation.handle != TlsfAllocator::kInvalidAllocation)
+		{
+			break;
+		}
+	}
+
+	if (heapIndex == heaps.size())
+	{
+		// The render target heaps can hold MSAA targets, those need 4MB aligned heaps
+		const uint64_t heapAlignment = kind == PlacedHeapKind::RenderTargets ? D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT : kGranularity;
+		const uint64_t heapSize = (std::max)(m_heapSize, (info.SizeInBytes + heapAlignment - 1) & ~(heapAlignment - 1));
+		static constexpr D3D12_HEAP_FLAGS kHeapFlags[] = { D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS, D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES, D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES };
+
+		auto heap = std::make_unique<Heap>();
+		CD3DX12_HEAP_DESC heapDesc(heapSize, D3D12_HEAP_TYPE_DEFAULT, heapAlignment, kHeapFlags[static_cast<uint32_t>(kind)]);
+		CrashIfFailed(m_device->CreateHeap(&heapDesc, IID_PPV_ARGS(&heap->heap)));
+		heap->allocator.Init(heapSize, kGranularity);
+		allocation = heap->allocator.Allocate(info.SizeInBytes, info.Alignment);
+		heaps.push_back(std::move(heap));
+	}
+
+	ComPtr<ID3D12Resource> resource;
+	CrashIfFailed(m_device->CreatePlacedResource(heaps[heapIndex]->heap.Get(), allocation.offset, &desc, initialState, clearValue, IID_PPV_ARGS(&resource)));
+
+	// The resource holds the only reference of its range
+	ComPtr<PlacedRange> range;
+	range.Attach(new PlacedRange(this, kind, heapIndex, allocation.handle));
+	CrashIfFailed(resource->SetPrivateDataInterface(kPlacedRangeGuid, range.Get()));
+
+	return resource;
+}
+
+void PlacedResourceAllocator::Free(const PlacedHeapKind kind, const uint32_t heapIndex, const uint32_t handle)
+{
+	m_heaps[static_cast<uint32_t>(kind)][heapIndex]->allocator.Free(handle);
+}
+
+PlacedResourceAllocator::KindStats PlacedResourceAllocator::GetStats(const PlacedHeapKind kind) const
+{
+	KindStats stats;
+	for (const std::unique_ptr<Heap>& heap : m_heaps[static_cast<uint32_t>(kind)])
+	{
+		const TlsfAllocator::Stats heapStats = heap->allocator.GetStats();
+		++stats.heapCount;
+		stats.heapBytes += heapStats.totalBytes;
+		stats.usedBytes += heapStats.usedBytes;
+		stats.largestFreeBlock = (std::max)(stats.largestFreeBlock, heapStats.largestFreeBlock);
+		stats.allocationCount += heapStats.allocationCount;
+		stats.freeBlockCount += heapStats.freeBlockCount;
+	}
+	return stats;
+}
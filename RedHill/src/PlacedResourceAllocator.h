@@ -0,0 +1,65 @@
+#pragma once
+
+#include <d3d12.h>
+#include <d3dx12/d3dx12.h>
+#include <wrl.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "TlsfAllocator.h"
+
+using Microsoft::WRL::ComPtr;
+
+// Heaps are split by what they hold so it works on resource heap tier 1
+enum class PlacedHeapKind : uint32_t
+{
+	Buffers,
+	Textures,
+	RenderTargets,	// Render target and depth stencil textures
+	Count
+};
+
+// Default heap resources placed in large ID3D12Heap blocks instead of one committed allocation each. A TlsfAllocator
+// hands out the ranges of every heap, a heap is added when none of its kind has room (sized for the resource when it is
+// bigger than the default heap size). The range is freed when the resource is destroyed: it is attached to the resource
+// as a private data interface, so the resources stay plain ComPtr and go through the deferred release queue like the
+// committed ones. Not thread safe, resources are created and destroyed on the render thread.
+class PlacedResourceAllocator
+{
+public:
+	struct KindStats
+	{
+		uint32_t heapCount = 0;
+		uint64_t heapBytes = 0;
+		uint64_t usedBytes = 0;
+		uint64_t largestFreeBlock = 0;
+		uint32_t allocationCount = 0;
+		uint32_t freeBlockCount = 0;
+	};
+
+	PlacedResourceAllocator() = default;
+	PlacedResourceAllocator(const PlacedResourceAllocator&) = delete;
+	PlacedResourceAllocator& operator=(const PlacedResourceAllocator&) = delete;
+
+	void Init(ID3D12Device* device, const uint64_t heapSize);
+
+	ComPtr<ID3D12Resource> CreateResource(const D3D12_RESOURCE_DESC& desc, const D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* clearValue = nullptr);
+
+	KindStats GetStats(const PlacedHeapKind kind) const;
+
+private:
+	class PlacedRange;
+
+	struct Heap
+	{
+		ComPtr<ID3D12Heap> heap;
+		TlsfAllocator allocator;
+	};
+
+	void Free(const PlacedHeapKind kind, const uint32_t heapIndex, const uint32_t handle);
+
+	ID3D12Device* m_device = nullptr;
+	uint64_t m_heapSize = 0;
+	std::vector<std::unique_ptr<Heap>> m_heaps[static_cast<uint32_t>(PlacedHeapKind::Count)];
+};
@@ -0,0 +1,325 @@
+#include "RadianceHdr.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
+#include "HalfFloat.h"
+
+// Bigger than any equirect we load, keeps width * height * 8 well inside size_t and uint32_t row pitches
+static constexpr uint32_t kMaxRadianceSize = 32768;
+
+// Largest half, RGBE texels above it are clamped instead of becoming infinities
+static constexpr float kMaxHalf = 65504.0f;
+
+// Next line of the header without its '\n', false at the end of the file
+static bool ReadHeaderLine(std::span<const uint8_t> file, size_t& cursor, std::string_view& line)
+{
+	if (cursor >= file.size())
+	{
+		return false;
+	}
+	const uint8_t* begin = file.data() + cursor;
+	const uint8_t* end = static_cast<const uint8_t*>(std::memchr(begin, '\n', file.size() - cursor));
+	if (!end)
+	{
+		return false;
+	}
+	line = std::string_view(reinterpret_cast<const char*>(begin), end - begin);
+	cursor += line.size() + 1;
+	return true;
+}
+
+// "<sign><axis> <size>" at the start of text, the rest of the text is returned in text
+static bool ParseAxis(std::string_view& text, const char* axis, uint32_t& size)
+{
+	if (text.size() < 3 || text[0] != axis[0] || text[1] != axis[1] || text[2] != ' ')
+	{
+		return false;
+	}
+	text.remove_prefix(3);
+
+	uint64_t value = 0;
+	size_t digits = 0;
+	while (digits < text.size() && text[digits] >= '0' && text[digits] <= '9' && value <= kMaxRadianceSize)
+	{
+		value = value * 10 + (text[digits] - '0');
+		++digits;
+	}
+	if (digits == 0 || value == 0 || value > kMaxRadianceSize)
+	{
+		return false;
+	}
+	text.remove_prefix(digits);
+	size = static_cast<uint32_t>(value);
+	return true;
+}
+
+bool RadianceReader::Open(std::span<const uint8_t> file)
+{
+	m_file = file;
+	m_cursor = 0;
+	m_row = 0;
+
+	std::string_view line;
+	if (!ReadHeaderLine(m_file, m_cursor, line) || (line != "#?RADIANCE" && line != "#?RGBE"))
+	{
+		return false;
+	}
+
+	// Variables up to the empty line, only the format matters
+	bool rgbe = false;
+	while (ReadHeaderLine(m_file, m_cursor, line) && !line.empty())
+	{
+		if (line.starts_with("FORMAT="))
+		{
+			rgbe = line == "FORMAT=32-bit_rle_rgbe";
+		}
+	}
+	if (!rgbe || !ReadHeaderLine(m_file, m_cursor, line))
+	{
+		return false;
+	}
+
+	if (!ParseAxis(line, "-Y", m_height) || line.empty() || line[0] != ' ')
+	{
+		return false;
+	}
+	line.remove_prefix(1);
+	if (!ParseAxis(line, "+X", m_width) || !line.empty())
+	{
+		return false;
+	}
+	return true;
+}
+
+bool RadianceReader::ReadRow(const HdrTexelFormat format, uint8_t* texels)
+{
+	// RGBE is 4 bytes a texel, the end of the row has room for it in both formats
+	uint8_t* rgbe = texels + static_cast<size_t>(m_width) * (HdrTexelBytes(format) - 4);
+	if (m_row >= m_height || !ReadRgbeRow(rgbe))
+	{
+		return false;
+	}
+	++m_row;
+	ConvertRgbeRow(rgbe, m_width, format, texels);
+	return true;
+}
+
+bool RadianceReader::ReadRows(const HdrTexelFormat format, uint8_t* texels, const uint32_t rowPitch, const uint32_t rowCount)
+{
+	for (uint32_t row = 0; row < rowCount; ++row)
+	{
+		if (!ReadRow(format, texels + static_cast<size_t>(row) * rowPitch))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool RadianceReader::ReadRgbeRow(uint8_t* rgbe)
+{
+	const size_t remaining = m_file.size() - m_cursor;
+	const uint8_t* data = m_file.data() + m_cursor;
+
+	// An RLE scanline starts with 2, 2 and its width on 15 bits, anything else is a flat one (the RLE needs 8 to 32767)
+	const bool rle = m_width >= 8 && m_width < 32768 && remaining >= 4 && data[0] == 2 && data[1] == 2 && (data[2] & 0x80) == 0;
+	if (!rle)
+	{
+		const size_t rowBytes = static_cast<size_t>(m_width) * 4;
+		if (remaining < rowBytes)
+		{
+			return false;
+		}
+		std::memcpy(rgbe, data, rowBytes);
+		m_cursor += rowBytes;
+		return true;
+	}
+
+	if ((static_cast<uint32_t>(data[2]) << 8 | data[3]) != m_width)
+	{
+		return false;
+	}
+	size_t cursor = 4;
+
+	// The 4 channels one after the other, each a sequence of runs (count over 128, then the value) and literal spans
+	for (uint32_t channel = 0; channel < 4; ++channel)
+	{
+		uint32_t x = 0;
+		while (x < m_width)
+		{
+			if (cursor >= remaining)
+			{
+				return false;
+			}
+			uint32_t count = data[cursor++];
+			if (count > 128)
+			{
+				count -= 128;
+				if (count > m_width - x || cursor >= remaining)
+				{
+					return false;
+				}
+				const uint8_t value = data[cursor++];
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					rgbe[(x + i) * 4 + channel] = value;
+				}
+			}
+			else
+			{
+				if (count == 0 || count > m_width - x || count > remaining - cursor)
+				{
+					return false;
+				}
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					rgbe[(x + i) * 4 + channel] = data[cursor + i];
+				}
+				cursor += count;
+			}
+			x += count;
+		}
+	}
+
+	m_cursor += cursor;
+	return true;
+}
+
+// Exact while the exponent fits (the 8 bit mantissas become 9 bit ones), clamped per channel to 65408 past it and
+// rounded into the denormals of the shared exponent under it
+static uint32_t RgbeToRgb9e5(const uint8_t* rgbe)
+{
+	if (rgbe[3] == 0)
+	{
+		return 0;
+	}
+
+	// value = m * 2^(e - 136) = (2m) * 2^((e - 113) - 24)
+	const int exponent = static_cast<int>(rgbe[3]) - 113;
+	uint32_t mantissas[3];
+	for (uint32_t c = 0; c < 3; ++c)
+	{
+		const uint32_t mantissa = static_cast<uint32_t>(rgbe[c]) << 1;
+		if (exponent > 31)
+		{
+			const int shift = exponent - 31;
+			mantissas[c] = shift >= 9 ? (mantissa ? 511 : 0) : (std::min)(mantissa << shift, 511u);
+		}
+		else if (exponent < 0)
+		{
+			const int shift = -exponent;
+			mantissas[c] = shift >= 10 ? 0 : (mantissa + (1u << (shift - 1))) >> shift;
+		}
+		else
+		{
+			mantissas[c] = mantissa;
+		}
+	}
+	const uint32_t sharedExponent = static_cast<uint32_t>(std::clamp(exponent, 0, 31));
+	return sharedExponent << 27 | mantissas[2] << 18 | mantissas[1] << 9 | mantissas[0];
+}
+
+// 4 RGBE texels to RGB9E5, the texels whose exponent doesn't fit go through RgbeToRgb9e5
+static void ConvertRgb9e5x4(const uint8_t* rgbe, uint8_t* texels)
+{
+	// Kept aside, the texels can be converted in place
+	alignas(16) uint8_t original[16];
+	const __m128i source = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgbe));
+	_mm_store_si128(reinterpret_cast<__m128i*>(original), source);
+	const __m128i byteMask = _mm_set1_epi32(0xFF);
+	const __m128i red = _mm_and_si128(source, byteMask);
+	const __m128i green = _mm_and_si128(_mm_srli_epi32(source, 8), byteMask);
+	const __m128i blue = _mm_and_si128(_mm_srli_epi32(source, 16), byteMask);
+	const __m128i exponent = _mm_srli_epi32(source, 24);
+
+	// Exponents 113 to 144 map to shared exponents 0 to 31, 0 is a black texel
+	const __m128i fits = _mm_and_si128(_mm_cmpgt_epi32(exponent, _mm_set1_epi32(112)), _mm_cmplt_epi32(exponent, _mm_set1_epi32(145)));
+	const __m128i black = _mm_cmpeq_epi32(exponent, _mm_setzero_si128());
+	__m128i packed = _mm_or_si128(_mm_slli_epi32(_mm_sub_epi32(exponent, _mm_set1_epi32(113)), 27),
+		_mm_or_si128(_mm_slli_epi32(blue, 19), _mm_or_si128(_mm_slli_epi32(green, 10), _mm_slli_epi32(red, 1))));
+	packed = _mm_and_si128(packed, fits);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(texels), packed);
+
+	const int handled = _mm_movemask_ps(_mm_castsi128_ps(_mm_or_si128(fits, black)));
+	if (handled != 0xF)
+	{
+		for (uint32_t i = 0; i < 4; ++i)
+		{
+			if (!(handled & (1 << i)))
+			{
+				const uint32_t texel = RgbeToRgb9e5(original + i * 4);
+				std::memcpy(texels + i * 4, &texel, sizeof(texel));
+			}
+		}
+	}
+}
+
+// One RGBE texel, its 4 bytes widened in the int lanes, to RGBA floats clamped to the half range
+static __m128 RgbeToFloat(const __m128i texel)
+{
+	// value = m * 2^(e - 136), the scale is built in the exponent bits. Exponents under 10 would be float denormals,
+	// they are under the smallest half anyway.
+	const __m128i exponent = _mm_shuffle_epi32(texel, _MM_SHUFFLE(3, 3, 3, 3));
+	const __m128i scaleBits = _mm_and_si128(_mm_cmpgt_epi32(exponent, _mm_set1_epi32(9)), _mm_slli_epi32(_mm_sub_epi32(exponent, _mm_set1_epi32(9)), 23));
+	const __m128 rgb = _mm_mul_ps(_mm_cvtepi32_ps(texel), _mm_castsi128_ps(scaleBits));
+	const __m128 rgba = _mm_or_ps(_mm_and_ps(rgb, _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0))), _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f));
+	return _mm_min_ps(rgba, _mm_set1_ps(kMaxHalf));
+}
+
+// 4 RGBE texels to RGBA16F
+static void ConvertRgba16Fx4(const uint8_t* rgbe, uint8_t* texels)
+{
+	const __m128i source = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgbe));
+	const __m128i low = _mm_unpacklo_epi8(source, _mm_setzero_si128());
+	const __m128i high = _mm_unpackhi_epi8(source, _mm_setzero_si128());
+
+	const __m128i halves01 = _mm_unpacklo_epi64(FloatToHalf4(RgbeToFloat(_mm_unpacklo_epi16(low, _mm_setzero_si128()))),
+		FloatToHalf4(RgbeToFloat(_mm_unpackhi_epi16(low, _mm_setzero_si128()))));
+	const __m128i halves23 = _mm_unpacklo_epi64(FloatToHalf4(RgbeToFloat(_mm_unpacklo_epi16(high, _mm_setzero_si128()))),
+		FloatToHalf4(RgbeToFloat(_mm_unpackhi_epi16(high, _mm_setzero_si128()))));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(texels), halves01);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(texels + 16), halves23);
+}
+
+void ConvertRgbeRow(const uint8_t* rgbe, const uint32_t width, const HdrTexelFormat format, uint8_t* texels)
+{
+	const uint32_t texelBytes = HdrTexelBytes(format);
+	const auto convert = format == HdrTexelFormat::Rgb9e5 ? ConvertRgb9e5x4 : ConvertRgba16Fx4;
+
+	uint32_t x = 0;
+	for (; x + 4 <= width; x += 4)
+	{
+		convert(rgbe + x * 4, texels + x * texelBytes);
+	}
+
+	// The last texels go through a padded group
+	if (x < width)
+	{
+		const uint32_t count = width - x;
+		uint8_t source[16] = {};
+		uint8_t converted[32];
+		std::memcpy(source, rgbe + x * 4, count * 4);
+		convert(source, converted);
+		std::memcpy(texels + x * texelBytes, converted, count * texelBytes);
+	}
+}
+
+__m128 LoadHdrTexel(const uint8_t* texel, const HdrTexelFormat format)
+{
+	if (format == HdrTexelFormat::Rgba16Float)
+	{
+		return HalfToFloat4(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(texel)));
+	}
+
+	uint32_t bits;
+	std::memcpy(&bits, texel, sizeof(bits));
+
+	// value = m * 2^(e - 15 - 9), the scale is built in the exponent bits
+	const uint32_t scaleBits = ((bits >> 27) + 127 - 24) << 23;
+	float scale;
+	std::memcpy(&scale, &scaleBits, sizeof(scale));
+	const __m128 mantissas = _mm_cvtepi32_ps(_mm_setr_epi32(bits & 0x1FF, (bits >> 9) & 0x1FF, (bits >> 18) & 0x1FF, 0));
+	return _mm_add_ps(_mm_mul_ps(mantissas, _mm_set1_ps(scale)), _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f));
+}
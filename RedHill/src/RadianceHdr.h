@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <emmintrin.h>
+#include <span>
+
+// Radiance .hdr (RGBE) decoding without a float image: the file is read one scanline at a time, flat or with the
+// adaptive RLE of the format (what stb_image reads too), and every row goes straight to the texel format the equirect
+// is uploaded with. Only the standard -Y height +X width orientation is supported.
+//
+// The reader allocates nothing and never reads or writes out of bounds, whatever the file holds: every count is checked
+// against the file and the row, a bad file makes Open or ReadRow fail. The rows can go to any pitched memory, the cook
+// or a mapped upload buffer.
+
+// Texel formats of the decoded rows, the values are the DXGI_FORMAT ones (the decoder doesn't pull the Windows headers)
+enum class HdrTexelFormat : uint32_t
+{
+	Rgba16Float = 10,	// DXGI_FORMAT_R16G16B16A16_FLOAT, 8 bytes, alpha 1
+	Rgb9e5 = 67			// DXGI_FORMAT_R9G9B9E5_SHAREDEXP, 4 bytes, keeps every RGBE texel up to 65408 exactly
+};
+
+constexpr uint32_t HdrTexelBytes(const HdrTexelFormat format)
+{
+	return format == HdrTexelFormat::Rgb9e5 ? 4 : 8;
+}
+
+class RadianceReader
+{
+public:
+	// Parses the header, fails on anything else than a 32-bit_rle_rgbe image in the -Y +X orientation. The file has to
+	// stay alive while the rows are read.
+	bool Open(std::span<const uint8_t> file);
+
+	uint32_t Width() const { return m_width; }
+	uint32_t Height() const { return m_height; }
+
+	// Decodes the next scanline to Width() texels, false on a truncated or corrupted one (or past the last). The RGBE
+	// texels are unpacked in the last Width() * 4 bytes of the row and converted in place.
+	bool ReadRow(const HdrTexelFormat format, uint8_t* texels);
+	// rowCount rows rowPitch bytes apart
+	bool ReadRows(const HdrTexelFormat format, uint8_t* texels, const uint32_t rowPitch, const uint32_t rowCount);
+
+private:
+	bool ReadRgbeRow(uint8_t* rgbe);
+
+	std::span<const uint8_t> m_file;
+	size_t m_cursor = 0;
+	uint32_t m_width = 0;
+	uint32_t m_height = 0;
+	uint32_t m_row = 0;
+};
+
+// RGBE texels to the format. SSE2, 4 texels at a time, the half conversion uses F16C when the build targets it. The
+// RGBE texels may be the last width * 4 bytes of the output row (the output itself for RGB9E5), every group is read
+// before it is written and never overwrites a later one.
+void ConvertRgbeRow(const uint8_t* rgbe, const uint32_t width, const HdrTexelFormat format, uint8_t* texels);
+
+// One decoded texel as RGBA floats, alpha 1
+__m128 LoadHdrTexel(const uint8_t* texel, const HdrTexelFormat format);
@@ -9,11 +9,20 @@
 #include <wrl.h>
 
 #include <memory>
+#include <span>
 #include <string>
+#include <vector>
 
 #include "Config.h"
+#include "BlockCompression.h"
+#include "CookedTexture.h"
+#include "DeferredReleaseQueue.h"
 #include "DescriptorHeapAllocator.h"
+#include "JobSystem.h"
 #include "Model.h"
+#include "PlacedResourceAllocator.h"
+#include "SphericalHarmonics.h"
+#include "UploadRing.h"
 
 using Microsoft::WRL::ComPtr;
 using namespace DirectX;
@@ -38,21 +47,44 @@ struct ConstantBuffer
 	UINT8* data;
 };
 
+// Texture loaded on the job system: its cooked container, mapped from disk or cooked from the source file when the cook
+// is missing or stale. Released once it is uploaded.
+struct LoadedTexture
+{
+	std::unique_ptr<CookedTextureFile> cooked;
+};
+
 struct EnvironmentSet
 {
 	ComPtr<ID3D12Resource> equirect;
-	ComPtr<ID3D12Resource> equirectUploader;
 	ComPtr<ID3D12Resource> cubemap;
-	ComPtr<ID3D12Resource> irradiance;
 	ComPtr<ID3D12Resource> prefilter;
 
-	//  Srv handles for the environment maps
+	// Srv handles for the environment maps, allocated while the environment is resident (the equirect one for its bake)
 	DescriptorHandle equirectSrvHandle;
 	DescriptorHandle cubemapSrvHandle;
-	DescriptorHandle irradianceSrvHandle;
 	DescriptorHandle prefilterSrvHandle;
 
 	std::string path;
+	LoadedTexture equirectImage;
+
+	// Diffuse IBL term, projected on the CPU when the equirect is loaded
+	IrradianceSH irradianceSH;
+
+	// Key of the baked maps in the IBL cache. On a hit the cubemap, the prefilter map and the SH come from the cache,
+	// the equirect isn't loaded and the bake passes skip the environment. A miss baked on the CPU is a hit from then on.
+	uint64_t cacheKey = 0;
+	bool fromCache = false;
+	LoadedTexture cachedCubemap;
+	LoadedTexture cachedPrefilter;
+
+	// Residency. The active environment is loaded with the assets and the others on the job system once the init is
+	// done, each one goes to the GPU the first time it is shown. Past RHConfig::residentEnvironments the least recently
+	// shown one is evicted, showing it again uploads its maps from the IBL cache.
+	JobCounter loading;
+	bool inCache = false;		// The maps are in the IBL cache (or come from the CPU baker), it never needs the GPU bakes again
+	bool resident = false;
+	uint64_t lastShown = 0;
 };
 
 enum class SceneMode
@@ -81,6 +113,10 @@ private:
 	void PopulateCommandList();
 	void MoveToNextFrame();
 	void WaitForGpu();
+	// Tags what was handed out since the last signal (upload ring space, transient descriptors) with its fence value
+	void SubmitPending(const uint64_t fenceValue);
+	// Gives back what the GPU is done with: upload ring space, retired objects and freed descriptors
+	void ReclaimCompleted(const uint64_t completedFenceValue);
 
 	void LoadAssets();
 	void SetupShadowPass();
@@ -98,19 +134,63 @@ private:
 	void DrawObject();
 	void DrawSphereGrid();
 
-	ComPtr<ID3D12RootSignature> BuildNoTextureGeoRootSignature();
+	// Screen size of a world unit at the closest point of a bounding sphere, for the level of detail selection
+	float PixelsPerUnit(const float center[3], const float radius) const;
+
+	ComPtr<ID3D12RootSignature> BuildNoTextureGeoRootSignature(UINT extraConstants = 0);
 	ComPtr<ID3D12PipelineState> BuildNoTextureGeoPSO(ID3D12RootSignature* rootSig, const wchar_t* shaderPath);
 
 	void ConfigureRenderTarget(ComPtr<ID3D12Resource>& rtResource, const DXGI_FORMAT format, const D3D12_RESOURCE_STATES& state, const CD3DX12_CPU_DESCRIPTOR_HANDLE& rtvHandle, const CD3DX12_CPU_DESCRIPTOR_HANDLE& srvHandle);
-	ComPtr<ID3D12Resource> CreateDefaultResource(ComPtr<ID3D12Resource>& uploadResource, const CD3DX12_RESOURCE_DESC& resourceDesc, const D3D12_SUBRESOURCE_DATA& resourceData, const D3D12_RESOURCE_STATES& initialState, const D3D12_RESOURCE_STATES& finalState);
-	ComPtr<ID3D12Resource> CreateTextureFromFile(ComPtr<ID3D12Resource>& uploadResource, const std::string& textureFile, const DXGI_FORMAT format, const CD3DX12_CPU_DESCRIPTOR_HANDLE& srvHandle);
-	ComPtr<ID3D12Resource> CreateHDRTextureFromFile(ComPtr<ID3D12Resource>& uploadResource, const std::string& textureFile, const CD3DX12_CPU_DESCRIPTOR_HANDLE& srvHandle);
-
-	ComPtr<IDxcBlob> CompileShader(const std::wstring& filePath, const std::wstring& entryPoint, const std::wstring& target) const;
-
-	void BakeEnvironmentCubemap();
-	void BakeIrradianceMap();
-	void BakePrefilterMap();
+	void UploadMesh(PBRMesh& mesh, std::span<const Vertex> vertices, std::span<const uint32_t> indices);
+	// Staging space in the upload ring. When the ring is full the recorded copies are flushed: the command list is
+	// executed, waited for and reset, so it is only called between two resource creations.
+	UploadAllocation AllocateUpload(const uint64_t size, const uint64_t alignment);
+	void FlushUploads();
+	// Hands an object to the release queue, it is destroyed once the GPU has passed the next fence signal
+	void DeferRelease(ComPtr<IUnknown> object, const ReleaseCategory category, const uint64_t bytes);
+	// Same for a persistent descriptor range, its descriptors are handed out again once the GPU has passed the signal
+	void FreeDescriptors(DescriptorHeapAllocator& heap, DescriptorHandle& handle);
+	uint64_t ResourceBytes(ID3D12Resource* resource) const;
+	// The scratch heaps and pipelines only the init passes use
+	void RetireInitResources();
+	// Default heap buffer filled through the upload ring, in chunks when it is bigger than a quarter of the ring
+	ComPtr<ID3D12Resource> CreateBuffer(std::span<const std::byte> data, const D3D12_RESOURCE_STATES& finalState);
+	// The loads only touch CPU memory, they run on the job system. A cook hit maps the file, a miss decodes the source
+	// (plus mips and block compression for the material textures) and writes the cook for the next launch.
+	static LoadedTexture LoadTexture(const std::string& textureFile, bool srgb, BlockFormat blockFormat);
+	static LoadedTexture LoadHDRTexture(const std::string& textureFile);
+	// SH9 irradiance of a loaded equirect, replaces the irradiance cubemap bake
+	static IrradianceSH ProjectIrradiance(const std::string& textureFile, const LoadedTexture& texture);
+	// Maps the baked maps and reads the SH of an environment from the IBL cache, false when any of them is missing or stale
+	static bool LoadCachedEnvironment(EnvironmentSet& environment);
+	// Bakes the cubemap and the prefilter map of a miss from its equirect with IblBaker, writes them to the IBL cache and
+	// keeps them for the upload, as if it was a hit
+	static bool BakeEnvironmentOnCpu(EnvironmentSet& environment);
+	// The maps and SH of an environment from the IBL cache, or its equirect and SH on a miss
+	static void LoadEnvironment(EnvironmentSet& environment);
+	// Waits for the load of the environment and uploads (or bakes) its maps on the open command list, then evicts the
+	// least recently shown environments over the limit
+	void MakeEnvironmentResident(const UINT index);
+	void EvictEnvironments();
+	// Uploads the equirect of a miss and runs the cubemap, mip and prefilter bakes, the maps are written to the IBL cache
+	void BakeEnvironment(EnvironmentSet& environment);
+	// Copies every subresource of a baked texture (in PIXEL_SHADER_RESOURCE) to a readback buffer, flushes the command
+	// list and writes them as a cooked texture, false if the file couldn't be written. Only for the cache misses, the
+	// flush waits for the GPU.
+	bool CookReadback(ID3D12Resource* texture, const uint32_t flags, const std::string& cookedFile, const uint64_t sourceHash);
+	// Copies the cooked payload to the upload ring as is (whole subresources, or bands of rows for the big ones) and
+	// records the copy of every subresource
+	ComPtr<ID3D12Resource> CreateTexture(LoadedTexture& texture, const CD3DX12_CPU_DESCRIPTOR_HANDLE& srvHandle);
+
+	ComPtr<IDxcBlob> CompileShader(const std::wstring& filePath, const std::wstring& entryPoint, const std::wstring& target, const std::vector<std::wstring>& defines = {}) const;
+
+	// Built the first time an environment misses the cache, kept until every environment is in it
+	void CreateBakePipelines();
+	void RetireBakePipelines();
+	// Retires them if they exist and every environment is loaded and in the cache
+	void RetireBakePipelinesIfCached();
+	void BakeEnvironmentCubemap(EnvironmentSet& environment);
+	void BakePrefilterMap(EnvironmentSet& environment);
 
 	void BeginBakePass(ID3D12PipelineState* pso, ID3D12RootSignature* rootSig);
 	void SetFaceBasis(UINT face);
@@ -118,7 +198,7 @@ private:
 	void RenderCubemapFaces(ID3D12Resource* target, UINT mip, UINT faceSize);
 	void BakeBrdfLut();
 
-	void GenerateMipMaps(const UINT baseSize,const UINT mipLevels);
+	void GenerateMipMaps(EnvironmentSet& environment, const UINT baseSize, const UINT mipLevels);
 
 private:
 	// Pipeline objects.
@@ -127,6 +207,7 @@ private:
 	CD3DX12_RECT m_scissorRect;
 
 	ComPtr<ID3D12Device> m_device;
+	PlacedResourceAllocator m_placedResources; // Declared before every resource it places so it outlives them
 	ComPtr<ID3D12CommandQueue> m_commandQueue;
 	ComPtr<IDXGISwapChain3> m_swapchain;
 
@@ -148,9 +229,6 @@ private:
 	ComPtr<ID3D12RootSignature> m_bakeRootSignature;
 	ComPtr<ID3D12PipelineState> m_bakePSO;
 
-	ComPtr<ID3D12RootSignature> m_irradianceRootSignature;
-	ComPtr<ID3D12PipelineState> m_irradiancePSO;
-
 	ComPtr<ID3D12RootSignature> m_prefilterRootSignature;
 	ComPtr<ID3D12PipelineState> m_prefilterPSO;
 
@@ -160,6 +238,7 @@ private:
 
 	EnvironmentSet m_environments[RHConfig::environmentsNumber];
 	UINT m_environmentIndex;
+	uint64_t m_environmentShows = 0;	// Clock of the LRU eviction
 
 	ComPtr<ID3D12CommandAllocator> m_commandAllocator[RHConfig::frameNumber];
 	ComPtr<ID3D12GraphicsCommandList> m_commandList;
@@ -187,6 +266,10 @@ private:
 	ComPtr<ID3D12Fence> m_fence;
 	UINT64 m_fenceValues[RHConfig::frameNumber];
 
+	UploadRing m_uploadRing;
+	UINT m_uploadFlushes = 0;
+	DeferredReleaseQueue<ComPtr<IUnknown>> m_releaseQueue;
+
 	std::unique_ptr<struct PBRMesh> m_object;
 	std::unique_ptr<struct PBRMesh> m_sphereGrid;
 	std::unique_ptr<struct PBRMesh> m_floor;
@@ -203,9 +286,17 @@ private:
 
 	SceneMode m_sceneMode;
 
+	// Kept from Update for the level of detail selection
+	XMFLOAT3 m_cameraPosition = { 0.0f, 0.0f, 0.0f };
+	float m_projectionScale = 1.0f; // cot(fovY / 2)
+
 	// Global handles
 	DescriptorHandle m_backbufferHandles[RHConfig::frameNumber];
 
+	// The G-buffer RTVs and SRVs (with the depth SRV) are single ranges, bound by their first handle
+	DescriptorHandle m_gbufferRtvHandles;
+	DescriptorHandle m_gbufferSrvHandles;
+
 	DescriptorHandle m_albedoRtvHandle;
 	DescriptorHandle m_albedoSrvHandle;
 
@@ -0,0 +1,64 @@
+#include "RingAllocator.h"
+
+#include <algorithm>
+
+void RingAllocator::Init(const uint64_t capacity)
+{
+	m_capacity = capacity;
+	m_head = 0;
+	m_tail = 0;
+	m_submitted = 0;
+	m_peak = 0;
+	m_submissions.clear();
+}
+
+uint64_t RingAllocator::Allocate(const uint64_t size, const uint64_t alignment)
+{
+	if (size > m_capacity)
+	{
+		return kInvalidOffset;
+	}
+
+	if (UsedBytes() == 0)
+	{
+		// Nothing in flight, start from the beginning so an allocation can take the whole ring
+		m_head = m_tail = m_submitted = m_head + (m_capacity - m_head % m_capacity) % m_capacity;
+	}
+
+	const uint64_t position = m_head % m_capacity;
+	uint64_t offset = (position + alignment - 1) & ~(alignment - 1);
+	if (offset + size > m_capacity)
+	{
+		// Doesn't fit before the end, skip the tail and start over
+		offset = 0;
+	}
+
+	// Bytes taken from the ring, padding included
+	const uint64_t taken = (offset >= position ? offset - position : m_capacity - position) + size;
+	if (UsedBytes() + taken > m_capacity)
+	{
+		return kInvalidOffset;
+	}
+
+	m_head += taken;
+	m_peak = (std::max)(m_peak, UsedBytes());
+	return offset;
+}
+
+void RingAllocator::Submit(const uint64_t fenceValue)
+{
+	if (HasUnsubmitted())
+	{
+		m_submissions.push_back({ fenceValue, m_head });
+		m_submitted = m_head;
+	}
+}
+
+void RingAllocator::Reclaim(const uint64_t completedFenceValue)
+{
+	while (!m_submissions.empty() && m_submissions.front().fenceValue <= completedFenceValue)
+	{
+		m_tail = m_submissions.front().end;
+		m_submissions.pop_front();
+	}
+}
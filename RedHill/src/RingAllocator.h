@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+// Offsets in a ring of bytes shared by work in flight on the GPU. The allocations made since the last Submit are tagged
+// with its fence value and come back once Reclaim sees that value completed. An allocation that doesn't fit before the
+// end of the ring wraps to the start, the skipped tail is given back with it. No device involved, the D3D12 buffer
+// lives in UploadRing.
+class RingAllocator
+{
+public:
+	static constexpr uint64_t kInvalidOffset = UINT64_MAX;
+
+	void Init(const uint64_t capacity);
+
+	// kInvalidOffset if the ring is full of data the GPU may still read: submit the pending work, wait for its fence
+	// and reclaim before trying again. Alignments are powers of two that divide the capacity.
+	uint64_t Allocate(const uint64_t size, const uint64_t alignment);
+
+	// Tag the allocations made since the previous submit with the fence value signaled after the work reading them
+	void Submit(const uint64_t fenceValue);
+
+	// Give back the allocations of every submit up to the completed fence value
+	void Reclaim(const uint64_t completedFenceValue);
+
+	uint64_t Capacity() const { return m_capacity; }
+	uint64_t UsedBytes() const { return m_head - m_tail; }
+	uint64_t PeakBytes() const { return m_peak; }
+	bool HasUnsubmitted() const { return m_head != m_submitted; }
+
+private:
+	// Everything before end (in the running byte count) is free once the fence value is reached
+	struct Submission
+	{
+		uint64_t fenceValue;
+		uint64_t end;
+	};
+
+	uint64_t m_capacity = 0;
+	uint64_t m_head = 0;		// Running counts of allocated and freed bytes, their difference is the space in use
+	uint64_t m_tail = 0;
+	uint64_t m_submitted = 0;
+	uint64_t m_peak = 0;
+	std::deque<Submission> m_submissions;
+};
@@ -0,0 +1,904 @@
+#include "Simplifier.h"
+
+#include <windows.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+#include "Config.h"
+#include "FlatHashMap.h"
+#include "MeshOptimizer.h"
+
+static constexpr uint32_t kNoVertex = UINT32_MAX;
+
+// Open edges get a plane perpendicular to their triangle so collapses along them can't pull them inwards. Borders
+// change the silhouette, seams only move inside the surface.
+static constexpr float kBorderWeight = 10.0f;
+static constexpr float kSeamWeight = 1.0f;
+
+// Vertices whose normals are further apart than ~60 degrees are not merged (hard edges that were not split)
+static constexpr float kMinNormalDot = 0.5f;
+
+enum class VertexKind : uint8_t
+{
+	Manifold,	// Unique position, closed fan
+	Border,		// Unique position on an open border
+	Seam,		// Position shared with exactly one twin along a seam
+	Locked		// Anything else
+};
+
+// Which kind of vertex can collapse onto which (from, to). Borders and seams can shrink into the locked corners
+// they end at, the open edge rule below keeps them on their edge.
+static constexpr bool kCanCollapse[4][4] =
+{
+	{ true, true, true, true },		// Manifold
+	{ false, true, false, true },	// Border
+	{ false, false, true, true },	// Seam
+	{ false, false, false, false },	// Locked
+};
+
+struct Quadric
+{
+	float a00 = 0.0f, a11 = 0.0f, a22 = 0.0f;
+	float a10 = 0.0f, a20 = 0.0f, a21 = 0.0f;
+	float b0 = 0.0f, b1 = 0.0f, b2 = 0.0f;
+	float c = 0.0f;
+	float w = 0.0f;
+
+	// Plane n.p + d = 0 with a unit normal
+	void AddPlane(const float n[3], const float d, const float weight)
+	{
+		a00 += weight * n[0] * n[0];
+		a11 += weight * n[1] * n[1];
+		a22 += weight * n[2] * n[2];
+		a10 += weight * n[1] * n[0];
+		a20 += weight * n[2] * n[0];
+		a21 += weight * n[2] * n[1];
+		b0 += weight * n[0] * d;
+		b1 += weight * n[1] * d;
+		b2 += weight * n[2] * d;
+		c += weight * d * d;
+		w += weight;
+	}
+
+	void Add(const Quadric& q)
+	{
+		a00 += q.a00; a11 += q.a11; a22 += q.a22;
+		a10 += q.a10; a20 += q.a20; a21 += q.a21;
+		b0 += q.b0; b1 += q.b1; b2 += q.b2;
+		c += q.c;
+		w += q.w;
+	}
+
+	// Weighted mean of the squared distances to the planes
+	float Error(const float p[3]) const
+	{
+		const float rx = a00 * p[0] + a10 * p[1] + a20 * p[2];
+		const float ry = a10 * p[0] + a11 * p[1] + a21 * p[2];
+		const float rz = a20 * p[0] + a21 * p[1] + a22 * p[2];
+		const float error = p[0] * rx + p[1] * ry + p[2] * rz + 2.0f * (p[0] * b0 + p[1] * b1 + p[2] * b2) + c;
+		return w > 0.0f ? fabsf(error) / w : 0.0f;
+	}
+};
+
+static void Cross(const float a[3], const float b[3], float out[3])
+{
+	out[0] = a[1] * b[2] - a[2] * b[1];
+	out[1] = a[2] * b[0] - a[0] * b[2];
+	out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static float Dot(const float a[3], const float b[3])
+{
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// Non normalized triangle normal (twice the area)
+static void TriangleNormal(const float p0[3], const float p1[3], const float p2[3], float out[3])
+{
+	const float e0[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+	const float e1[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+	Cross(e0, e1, out);
+}
+
+static float PointSegmentDistanceSquared(const float p[3], const float a[3], const float b[3])
+{
+	const float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+	const float ap[3] = { p[0] - a[0], p[1] - a[1], p[2] - a[2] };
+	const float lengthSquared = Dot(ab, ab);
+	const float t = lengthSquared > 0.0f ? std::clamp(Dot(ap, ab) / lengthSquared, 0.0f, 1.0f) : 0.0f;
+	const float d[3] = { ap[0] - ab[0] * t, ap[1] - ab[1] * t, ap[2] - ab[2] * t };
+	return Dot(d, d);
+}
+
+// Squared distance from p to the triangle abc, closest point by Voronoi region (Ericson, Real-Time Collision Detection 5.1.5)
+static float PointTriangleDistanceSquared(const float p[3], const float a[3], const float b[3], const float c[3])
+{
+	const float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+	const float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+	const float ap[3] = { p[0] - a[0], p[1] - a[1], p[2] - a[2] };
+
+	// Triangles collapsed to a line (seam twins share their position) would divide by 0 below
+	float normal[3];
+	Cross(ab, ac, normal);
+	if (Dot(normal, normal) == 0.0f)
+	{
+		return (std::min)({ PointSegmentDistanceSquared(p, a, b), PointSegmentDistanceSquared(p, b, c), PointSegmentDistanceSquared(p, c, a) });
+	}
+	const float bp[3] = { p[0] - b[0], p[1] - b[1], p[2] - b[2] };
+	const float cp[3] = { p[0] - c[0], p[1] - c[1], p[2] - c[2] };
+	const float d1 = Dot(ab, ap), d2 = Dot(ac, ap);
+	const float d3 = Dot(ab, bp), d4 = Dot(ac, bp);
+	const float d5 = Dot(ab, cp), d6 = Dot(ac, cp);
+	const float va = d3 * d6 - d5 * d4;
+	const float vb = d5 * d2 - d1 * d6;
+	const float vc = d1 * d4 - d3 * d2;
+
+	// Barycentric coordinates of the closest point along ab and ac
+	float u, v;
+	if (d1 <= 0.0f && d2 <= 0.0f)
+	{
+		u = 0.0f, v = 0.0f;
+	}
+	else if (d3 >= 0.0f && d4 <= d3)
+	{
+		u = 1.0f, v = 0.0f;
+	}
+	else if (d6 >= 0.0f && d5 <= d6)
+	{
+		u = 0.0f, v = 1.0f;
+	}
+	else if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+	{
+		u = d1 / (d1 - d3), v = 0.0f;
+	}
+	else if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+	{
+		u = 0.0f, v = d2 / (d2 - d6);
+	}
+	else if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+	{
+		v = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+		u = 1.0f - v;
+	}
+	else
+	{
+		const float invSum = 1.0f / (va + vb + vc);
+		u = vb * invSum, v = vc * invSum;
+	}
+
+	const float d[3] = { ap[0] - ab[0] * u - ac[0] * v, ap[1] - ab[1] * u - ac[1] * v, ap[2] - ab[2] * u - ac[2] * v };
+	return Dot(d, d);
+}
+
+struct PositionKey
+{
+	uint32_t bits[3];
+
+	bool operator==(const PositionKey& o) const noexcept
+	{
+		return bits[0] == o.bits[0] && bits[1] == o.bits[1] && bits[2] == o.bits[2];
+	}
+};
+
+struct PositionKeyHash
+{
+	size_t operator()(const PositionKey& key) const noexcept
+	{
+		return static_cast<size_t>(MixHash64((static_cast<uint64_t>(key.bits[0]) << 32 | key.bits[1]) ^ MixHash64(key.bits[2])));
+	}
+};
+
+struct EdgeHash
+{
+	size_t operator()(const uint64_t key) const noexcept
+	{
+		return static_cast<size_t>(MixHash64(key));
+	}
+};
+
+static uint64_t EdgeKey(const uint32_t a, const uint32_t b)
+{
+	return static_cast<uint64_t>(a) << 32 | b;
+}
+
+// Topology of the source mesh the collapses are checked against
+struct SimplifierTopology
+{
+	std::vector<uint32_t> position;	// First vertex with the same position
+	std::vector<uint32_t> twin;		// Next vertex with the same position (circular list, itself when unique)
+	std::vector<uint32_t> openOut;	// Target of the open half edge leaving the vertex (kNoVertex if none)
+	std::vector<uint32_t> openIn;	// Source of the open half edge reaching the vertex
+	std::vector<uint8_t> seamOut;	// The open half edge leaving the vertex is closed on the other side of a seam
+	std::vector<VertexKind> kind;
+};
+
+static SimplifierTopology BuildTopology(std::span<const Vertex> vertices, std::span<const uint32_t> indices)
+{
+	const size_t vertexCount = vertices.size();
+	SimplifierTopology topology;
+	topology.position.resize(vertexCount);
+	topology.twin.resize(vertexCount);
+	topology.openOut.assign(vertexCount, kNoVertex);
+	topology.openIn.assign(vertexCount, kNoVertex);
+	topology.seamOut.assign(vertexCount, 0);
+	topology.kind.assign(vertexCount, VertexKind::Manifold);
+
+	FlatHashMap<PositionKey, uint32_t, PositionKeyHash> positions(vertexCount);
+	for (uint32_t v = 0; v < vertexCount; ++v)
+	{
+		PositionKey key;
+		std::memcpy(key.bits, vertices[v].position, sizeof(key.bits));
+		bool inserted = false;
+		const uint32_t first = positions.FindOrInsert(key, v, inserted);
+		topology.position[v] = first;
+		if (inserted)
+		{
+			topology.twin[v] = v;
+		}
+		else
+		{
+			topology.twin[v] = topology.twin[first];
+			topology.twin[first] = v;
+		}
+	}
+
+	// Open half edges are the ones without the opposite half edge, a vertex with more than one in or out is locked
+	std::vector<uint8_t> multipleOpen(vertexCount, 0);
+	FlatHashMap<uint64_t, uint32_t, EdgeHash> halfEdges(indices.size());
+	FlatHashMap<uint64_t, uint32_t, EdgeHash> positionEdges(indices.size());
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		for (int e = 0; e < 3; ++e)
+		{
+			const uint32_t a = indices[i + e];
+			const uint32_t b = indices[i + (e + 1) % 3];
+			halfEdges.Insert(EdgeKey(a, b), 1);
+			positionEdges.Insert(EdgeKey(topology.position[a], topology.position[b]), 1);
+		}
+	}
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		for (int e = 0; e < 3; ++e)
+		{
+			const uint32_t a = indices[i + e];
+			const uint32_t b = indices[i + (e + 1) % 3];
+			if (halfEdges.Find(EdgeKey(b, a)) != nullptr)
+			{
+				continue;
+			}
+
+			multipleOpen[a] |= topology.openOut[a] != kNoVertex && topology.openOut[a] != b;
+			multipleOpen[b] |= topology.openIn[b] != kNoVertex && topology.openIn[b] != a;
+			topology.openOut[a] = b;
+			topology.openIn[b] = a;
+			topology.seamOut[a] = positionEdges.Find(EdgeKey(topology.position[b], topology.position[a])) != nullptr;
+		}
+	}
+
+	for (uint32_t v = 0; v < vertexCount; ++v)
+	{
+		const bool hasOpen = topology.openOut[v] != kNoVertex || topology.openIn[v] != kNoVertex;
+		const bool singleOpen = topology.openOut[v] != kNoVertex && topology.openIn[v] != kNoVertex && !multipleOpen[v];
+		const uint32_t t = topology.twin[v];
+
+		if (t == v)
+		{
+			topology.kind[v] = !hasOpen ? VertexKind::Manifold : (singleOpen ? VertexKind::Border : VertexKind::Locked);
+		}
+		else if (topology.twin[t] == v)
+		{
+			// The two sides of a seam run in opposite directions
+			const bool twinSingleOpen = topology.openOut[t] != kNoVertex && topology.openIn[t] != kNoVertex && !multipleOpen[t];
+			const bool mirrored = singleOpen && twinSingleOpen &&
+				topology.position[topology.openOut[v]] == topology.position[topology.openIn[t]] &&
+				topology.position[topology.openIn[v]] == topology.position[topology.openOut[t]];
+			topology.kind[v] = mirrored ? VertexKind::Seam : VertexKind::Locked;
+		}
+		else
+		{
+			topology.kind[v] = VertexKind::Locked;
+		}
+	}
+
+	return topology;
+}
+
+// Farthest distance from a vertex of the source mesh to the simplified mesh. The triangles around the vertex it
+// collapsed into (owner) give a first bound, then a grid of the result triangles finds the closest one within it.
+static float MaxVertexDeviation(std::span<const Vertex> vertices, std::span<const uint32_t> indices, std::span<const uint32_t> result, std::span<const uint32_t> owner)
+{
+	const size_t vertexCount = vertices.size();
+	const uint32_t triangleCount = static_cast<uint32_t>(result.size() / 3);
+	if (triangleCount == 0)
+	{
+		return 0.0f;
+	}
+
+	auto Position = [&](const uint32_t triangle, const int corner) -> const float*
+	{
+		return vertices[result[triangle * 3 + corner]].position;
+	};
+
+	// Triangles around every vertex of the result
+	std::vector<uint32_t> fanOffsets(vertexCount + 1, 0);
+	for (const uint32_t v : result)
+	{
+		++fanOffsets[v + 1];
+	}
+	std::partial_sum(fanOffsets.begin(), fanOffsets.end(), fanOffsets.begin());
+	std::vector<uint32_t> fans(result.size());
+	{
+		std::vector<uint32_t> cursor(fanOffsets.begin(), fanOffsets.end() - 1);
+		for (size_t i = 0; i < result.size(); ++i)
+		{
+			fans[cursor[result[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+	}
+
+	// Uniform grid over the triangle bounds, cells about the size of a triangle and at most a few per triangle
+	float boundsMin[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+	float boundsMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	double extentSum = 0.0;
+	for (uint32_t t = 0; t < triangleCount; ++t)
+	{
+		float triangleExtent = 0.0f;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const float lo = (std::min)({ Position(t, 0)[axis], Position(t, 1)[axis], Position(t, 2)[axis] });
+			const float hi = (std::max)({ Position(t, 0)[axis], Position(t, 1)[axis], Position(t, 2)[axis] });
+			boundsMin[axis] = (std::min)(boundsMin[axis], lo);
+			boundsMax[axis] = (std::max)(boundsMax[axis], hi);
+			triangleExtent = (std::max)(triangleExtent, hi - lo);
+		}
+		extentSum += triangleExtent;
+	}
+
+	float cellSize = (std::max)(static_cast<float>(extentSum / triangleCount), 1e-6f);
+	uint32_t dims[3];
+	for (;;)
+	{
+		size_t cellCount = 1;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			dims[axis] = static_cast<uint32_t>((std::min)((boundsMax[axis] - boundsMin[axis]) / cellSize, 1023.0f)) + 1;
+			cellCount *= dims[axis];
+		}
+		if (cellCount <= static_cast<size_t>(triangleCount) * 4 + 64)
+		{
+			break;
+		}
+		cellSize *= 1.5f;
+	}
+
+	auto Cell = [&](const float value, const int axis) -> uint32_t
+	{
+		const float cell = (value - boundsMin[axis]) / cellSize;
+		return cell <= 0.0f ? 0 : static_cast<uint32_t>((std::min)(cell, static_cast<float>(dims[axis] - 1)));
+	};
+
+	auto ForEachCell = [&](const float lo[3], const float hi[3], auto&& function)
+	{
+		for (uint32_t z = Cell(lo[2], 2); z <= Cell(hi[2], 2); ++z)
+		{
+			for (uint32_t y = Cell(lo[1], 1); y <= Cell(hi[1], 1); ++y)
+			{
+				for (uint32_t x = Cell(lo[0], 0); x <= Cell(hi[0], 0); ++x)
+				{
+					function((z * dims[1] + y) * dims[0] + x);
+				}
+			}
+		}
+	};
+
+	// Box of every triangle, lo xyz then hi xyz
+	std::vector<float> triangleBounds(static_cast<size_t>(triangleCount) * 6);
+	for (uint32_t t = 0; t < triangleCount; ++t)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			triangleBounds[t * 6 + axis] = (std::min)({ Position(t, 0)[axis], Position(t, 1)[axis], Position(t, 2)[axis] });
+			triangleBounds[t * 6 + 3 + axis] = (std::max)({ Position(t, 0)[axis], Position(t, 1)[axis], Position(t, 2)[axis] });
+		}
+	}
+
+	std::vector<uint32_t> cellOffsets(static_cast<size_t>(dims[0]) * dims[1] * dims[2] + 1, 0);
+	for (uint32_t t = 0; t < triangleCount; ++t)
+	{
+		ForEachCell(&triangleBounds[t * 6], &triangleBounds[t * 6 + 3], [&](const uint32_t cell) { ++cellOffsets[cell + 1]; });
+	}
+	std::partial_sum(cellOffsets.begin(), cellOffsets.end(), cellOffsets.begin());
+	std::vector<uint32_t> cellTriangles(cellOffsets.back());
+	{
+		std::vector<uint32_t> cursor(cellOffsets.begin(), cellOffsets.end() - 1);
+		for (uint32_t t = 0; t < triangleCount; ++t)
+		{
+			ForEachCell(&triangleBounds[t * 6], &triangleBounds[t * 6 + 3], [&](const uint32_t cell) { cellTriangles[cursor[cell]++] = t; });
+		}
+	}
+
+	std::vector<uint8_t> referenced(vertexCount, 0);
+	for (const uint32_t index : indices)
+	{
+		referenced[index] = 1;
+	}
+
+	// Last vertex that measured a triangle, triangles span several cells
+	std::vector<uint32_t> visited(triangleCount, kNoVertex);
+	float maxDistanceSquared = 0.0f;
+	for (uint32_t v = 0; v < vertexCount; ++v)
+	{
+		if (!referenced[v])
+		{
+			continue;
+		}
+
+		const float* p = vertices[v].position;
+		float distanceSquared = FLT_MAX;
+		auto Measure = [&](const uint32_t t)
+		{
+			if (visited[t] == v)
+			{
+				return;
+			}
+			visited[t] = v;
+
+			// Most of the triangles of the cells are farther than the best one, their box tells
+			float boxDistanceSquared = 0.0f;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				const float outside = (std::max)({ triangleBounds[t * 6 + axis] - p[axis], p[axis] - triangleBounds[t * 6 + 3 + axis], 0.0f });
+				boxDistanceSquared += outside * outside;
+			}
+			if (boxDistanceSquared < distanceSquared)
+			{
+				distanceSquared = (std::min)(distanceSquared, PointTriangleDistanceSquared(p, Position(t, 0), Position(t, 1), Position(t, 2)));
+			}
+		};
+
+		for (uint32_t i = fanOffsets[owner[v]]; i < fanOffsets[owner[v] + 1]; ++i)
+		{
+			Measure(fans[i]);
+		}
+
+		// Only the cells within the first bound can hold a closer triangle (all of them when the owner has no triangle
+		// left), and only while they are closer than the best triangle so far. The cell of the vertex goes first.
+		auto MeasureCell = [&](const uint32_t x, const uint32_t y, const uint32_t z)
+		{
+			const uint32_t cell[3] = { x, y, z };
+			float cellDistanceSquared = 0.0f;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				const float lo = boundsMin[axis] + cell[axis] * cellSize;
+				const float outside = (std::max)({ lo - p[axis], p[axis] - (lo + cellSize), 0.0f });
+				cellDistanceSquared += outside * outside;
+			}
+			// The last cells of an axis reach to the end of the bounds
+			if (cellDistanceSquared >= distanceSquared && x + 1 < dims[0] && y + 1 < dims[1] && z + 1 < dims[2])
+			{
+				return;
+			}
+			const uint32_t index = (z * dims[1] + y) * dims[0] + x;
+			for (uint32_t i = cellOffsets[index]; i < cellOffsets[index + 1]; ++i)
+			{
+				Measure(cellTriangles[i]);
+			}
+		};
+
+		MeasureCell(Cell(p[0], 0), Cell(p[1], 1), Cell(p[2], 2));
+		const float reach = distanceSquared == FLT_MAX ? FLT_MAX : sqrtf(distanceSquared);
+		for (uint32_t z = Cell(p[2] - reach, 2); z <= Cell(p[2] + reach, 2); ++z)
+		{
+			for (uint32_t y = Cell(p[1] - reach, 1); y <= Cell(p[1] + reach, 1); ++y)
+			{
+				for (uint32_t x = Cell(p[0] - reach, 0); x <= Cell(p[0] + reach, 0); ++x)
+				{
+					MeasureCell(x, y, z);
+				}
+			}
+		}
+		maxDistanceSquared = (std::max)(maxDistanceSquared, distanceSquared);
+	}
+
+	return sqrtf(maxDistanceSquared);
+}
+
+std::vector<uint32_t> SimplifyMesh(std::span<const Vertex> vertices, std::span<const uint32_t> indices, size_t targetIndexCount, float& error)
+{
+	error = 0.0f;
+	std::vector<uint32_t> result(indices.begin(), indices.end());
+	const size_t vertexCount = vertices.size();
+	if (result.size() <= targetIndexCount || vertexCount == 0)
+	{
+		return result;
+	}
+
+	SimplifierTopology topology = BuildTopology(vertices, indices);
+	const std::vector<uint32_t>& position = topology.position;
+
+	// Quadrics per position, from the area weighted triangle planes and the border planes
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		const float* p[3] = { vertices[indices[i]].position, vertices[indices[i + 1]].position, vertices[indices[i + 2]].position };
+		float normal[3];
+		TriangleNormal(p[0], p[1], p[2], normal);
+		const float length = sqrtf(Dot(normal, normal));
+		if (length == 0.0f)
+		{
+			continue;
+		}
+		for (float& n : normal)
+		{
+			n /= length;
+		}
+
+		const float area = length * 0.5f;
+		Quadric plane;
+		plane.AddPlane(normal, -Dot(normal, p[0]), area);
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			quadrics[position[indices[i + corner]]].Add(plane);
+		}
+
+		for (int e = 0; e < 3; ++e)
+		{
+			const uint32_t a = indices[i + e];
+			const uint32_t b = indices[i + (e + 1) % 3];
+			if (topology.openOut[a] != b)
+			{
+				continue;
+			}
+
+			const float edge[3] = { p[(e + 1) % 3][0] - p[e][0], p[(e + 1) % 3][1] - p[e][1], p[(e + 1) % 3][2] - p[e][2] };
+			const float edgeLength = sqrtf(Dot(edge, edge));
+			if (edgeLength == 0.0f)
+			{
+				continue;
+			}
+			float borderNormal[3];
+			Cross(edge, normal, borderNormal);
+			for (float& n : borderNormal)
+			{
+				n /= edgeLength;
+			}
+
+			Quadric border;
+			border.AddPlane(borderNormal, -Dot(borderNormal, p[e]), edgeLength * edgeLength * (topology.seamOut[a] ? kSeamWeight : kBorderWeight));
+			quadrics[position[a]].Add(border);
+			quadrics[position[b]].Add(border);
+		}
+	}
+
+	// Border and seam vertices only move along their open edge, seams drag their twin along
+	auto OnOpenEdge = [&](const uint32_t from, const uint32_t to)
+	{
+		return topology.openOut[from] == to || topology.openIn[from] == to;
+	};
+
+	auto SameFrame = [&](const uint32_t from, const uint32_t to)
+	{
+		const Vertex& a = vertices[from];
+		const Vertex& b = vertices[to];
+		if ((a.tangent[3] < 0.0f) != (b.tangent[3] < 0.0f))
+		{
+			return false;
+		}
+		return Dot(a.normal, b.normal) >= kMinNormalDot * sqrtf(Dot(a.normal, a.normal) * Dot(b.normal, b.normal));
+	};
+
+	// twinTo receives where the twin of a seam vertex goes, the vertex of the target position on the other side
+	auto CanCollapse = [&](const uint32_t from, const uint32_t to, uint32_t& twinTo)
+	{
+		const VertexKind fromKind = topology.kind[from];
+		if (!kCanCollapse[static_cast<int>(fromKind)][static_cast<int>(topology.kind[to])])
+		{
+			return false;
+		}
+		if (fromKind != VertexKind::Manifold && !OnOpenEdge(from, to))
+		{
+			return false;
+		}
+
+		twinTo = kNoVertex;
+		if (fromKind == VertexKind::Seam)
+		{
+			const uint32_t fromTwin = topology.twin[from];
+			for (uint32_t w = topology.twin[to]; w != to; w = topology.twin[w])
+			{
+				if (OnOpenEdge(fromTwin, w))
+				{
+					twinTo = w;
+					break;
+				}
+			}
+			if (twinTo == kNoVertex || !SameFrame(fromTwin, twinTo))
+			{
+				return false;
+			}
+		}
+
+		return SameFrame(from, to);
+	};
+
+	struct Collapse
+	{
+		uint32_t from;
+		uint32_t to;
+		uint32_t twinTo;
+		float error;
+	};
+
+	std::vector<uint32_t> triangleOffsets(vertexCount + 1);
+	std::vector<uint32_t> vertexTriangles;
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> collapseRemap(vertexCount);
+	std::vector<uint8_t> locked(vertexCount);
+
+	// Vertex of the result every source vertex ended up in
+	std::vector<uint32_t> owner(vertexCount);
+	std::iota(owner.begin(), owner.end(), 0);
+
+	// Each pass collapses the cheapest edges that don't touch each other and rebuilds the index buffer
+	while (result.size() > targetIndexCount)
+	{
+		std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+		for (const uint32_t v : result)
+		{
+			++triangleOffsets[v + 1];
+		}
+		std::partial_sum(triangleOffsets.begin(), triangleOffsets.end(), triangleOffsets.begin());
+		vertexTriangles.resize(result.size());
+		{
+			std::vector<uint32_t> cursor(triangleOffsets.begin(), triangleOffsets.end() - 1);
+			for (size_t i = 0; i < result.size(); ++i)
+			{
+				vertexTriangles[cursor[result[i]]++] = static_cast<uint32_t>(i / 3);
+			}
+		}
+
+		// Cheapest collapse of every vertex
+		collapses.clear();
+		{
+			std::vector<Collapse> best(vertexCount, { kNoVertex, kNoVertex, kNoVertex, FLT_MAX });
+			for (size_t i = 0; i < result.size(); i += 3)
+			{
+				for (int e = 0; e < 3; ++e)
+				{
+					const uint32_t a = result[i + e];
+					const uint32_t b = result[i + (e + 1) % 3];
+					for (const auto& [from, to] : { std::pair(a, b), std::pair(b, a) })
+					{
+						uint32_t twinTo;
+						if (!CanCollapse(from, to, twinTo))
+						{
+							continue;
+						}
+						const float collapseError = quadrics[position[from]].Error(vertices[to].position);
+						if (collapseError < best[from].error)
+						{
+							best[from] = { from, to, twinTo, collapseError };
+						}
+					}
+				}
+			}
+
+			for (const Collapse& collapse : best)
+			{
+				// Seams are handled from one side
+				if (collapse.from != kNoVertex && (topology.kind[collapse.from] != VertexKind::Seam || collapse.from < topology.twin[collapse.from]))
+				{
+					collapses.push_back(collapse);
+				}
+			}
+		}
+
+		if (collapses.empty())
+		{
+			break;
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+		// Moving a vertex is rejected if a triangle around it that survives turns over
+		auto Flips = [&](const uint32_t from, const uint32_t to)
+		{
+			for (uint32_t i = triangleOffsets[from]; i < triangleOffsets[from + 1]; ++i)
+			{
+				const uint32_t* triangle = &result[vertexTriangles[i] * 3];
+				if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+				{
+					continue;
+				}
+
+				const float* before[3];
+				const float* after[3];
+				for (int corner = 0; corner < 3; ++corner)
+				{
+					before[corner] = vertices[triangle[corner]].position;
+					after[corner] = triangle[corner] == from ? vertices[to].position : before[corner];
+				}
+
+				float normalBefore[3];
+				float normalAfter[3];
+				TriangleNormal(before[0], before[1], before[2], normalBefore);
+				TriangleNormal(after[0], after[1], after[2], normalAfter);
+				if (Dot(normalBefore, normalAfter) <= 0.0f)
+				{
+					return true;
+				}
+			}
+			return false;
+		};
+
+		auto LockFan = [&](const uint32_t v)
+		{
+			for (uint32_t i = triangleOffsets[v]; i < triangleOffsets[v + 1]; ++i)
+			{
+				const uint32_t* triangle = &result[vertexTriangles[i] * 3];
+				locked[triangle[0]] = locked[triangle[1]] = locked[triangle[2]] = 1;
+			}
+		};
+
+		// The open edges of the removed vertex now end at the target
+		auto MoveOpenEdges = [&](const uint32_t from, const uint32_t to)
+		{
+			if (topology.openOut[from] == to && topology.openIn[from] != kNoVertex)
+			{
+				topology.openOut[topology.openIn[from]] = to;
+				topology.openIn[to] = topology.openIn[from];
+			}
+			else if (topology.openIn[from] == to && topology.openOut[from] != kNoVertex)
+			{
+				topology.openIn[topology.openOut[from]] = to;
+				topology.openOut[to] = topology.openOut[from];
+			}
+		};
+
+		auto CollapsedTriangles = [&](const uint32_t from, const uint32_t to)
+		{
+			size_t count = 0;
+			for (uint32_t i = triangleOffsets[from]; i < triangleOffsets[from + 1]; ++i)
+			{
+				const uint32_t* triangle = &result[vertexTriangles[i] * 3];
+				count += (triangle[0] == to || triangle[1] == to || triangle[2] == to) ? 1 : 0;
+			}
+			return count;
+		};
+
+		std::iota(collapseRemap.begin(), collapseRemap.end(), 0);
+		std::fill(locked.begin(), locked.end(), 0);
+
+		const size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+		size_t removed = 0;
+		size_t applied = 0;
+		for (const Collapse& collapse : collapses)
+		{
+			if (removed >= trianglesToRemove)
+			{
+				break;
+			}
+
+			const uint32_t from = collapse.from;
+			const uint32_t to = collapse.to;
+			const bool seam = topology.kind[from] == VertexKind::Seam;
+			const uint32_t fromTwin = topology.twin[from];
+			const uint32_t toTwin = collapse.twinTo;
+
+			if (locked[from] || locked[to] || (seam && (locked[fromTwin] || locked[toTwin])))
+			{
+				continue;
+			}
+			if (Flips(from, to) || (seam && Flips(fromTwin, toTwin)))
+			{
+				continue;
+			}
+
+			collapseRemap[from] = to;
+			removed += CollapsedTriangles(from, to);
+			LockFan(from);
+			MoveOpenEdges(from, to);
+			if (seam)
+			{
+				collapseRemap[fromTwin] = toTwin;
+				removed += CollapsedTriangles(fromTwin, toTwin);
+				LockFan(fromTwin);
+				MoveOpenEdges(fromTwin, toTwin);
+			}
+
+			quadrics[position[to]].Add(quadrics[position[from]]);
+			++applied;
+		}
+
+		if (applied == 0)
+		{
+			break;
+		}
+
+		size_t write = 0;
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			const uint32_t a = collapseRemap[result[i]];
+			const uint32_t b = collapseRemap[result[i + 1]];
+			const uint32_t c = collapseRemap[result[i + 2]];
+			if (a != b && b != c && c != a)
+			{
+				result[write++] = a;
+				result[write++] = b;
+				result[write++] = c;
+			}
+		}
+		result.resize(write);
+
+		// A target is never collapsed in the pass it receives a vertex (its fan is locked), one step per pass is enough
+		for (uint32_t& o : owner)
+		{
+			o = collapseRemap[o];
+		}
+	}
+
+	// The quadric error is an area weighted mean of squared plane distances, under the real deviation on curved
+	// surfaces (half of it on the icosphere) and well over it elsewhere, so the deviation is measured instead
+	error = MaxVertexDeviation(vertices, indices, result, owner);
+	return result;
+}
+
+void BuildMeshLods(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<MeshLod>& lods, const char* name)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	const uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+	const uint32_t fullIndexCount = static_cast<uint32_t>(indices.size());
+
+	// Every level is simplified from the full detail mesh so the errors are all measured against it
+	std::vector<MeshLod> levels;
+	std::vector<std::vector<uint32_t>> levelIndices;
+	for (const float ratio : RHConfig::lodRatios)
+	{
+		const size_t target = static_cast<size_t>(fullIndexCount / 3 * ratio) * 3;
+		float error = 0.0f;
+		std::vector<uint32_t> simplified = SimplifyMesh(vertices, std::span<const uint32_t>(indices.data(), fullIndexCount), target, error);
+
+		// Stop at the first level the constraints can't reduce meaningfully any further
+		if (!levelIndices.empty() && simplified.size() * 10 > levelIndices.back().size() * 9)
+		{
+			break;
+		}
+		levels.push_back({ 0, static_cast<uint32_t>(simplified.size()), vertexCount, error });
+		levelIndices.push_back(std::move(simplified));
+	}
+
+	lods.clear();
+	for (size_t level = levels.size(); level-- > 0;)
+	{
+		MeshLod lod = levels[level];
+		lod.indexOffset = static_cast<uint32_t>(indices.size());
+		indices.insert(indices.end(), levelIndices[level].begin(), levelIndices[level].end());
+		lods.push_back(lod);
+
+		if (RHConfig::optimizeMeshes)
+		{
+			char lodName[64];
+			sprintf_s(lodName, "%s lod %zu", name, level + 1);
+			OptimizeIndexRange(std::span<uint32_t>(indices).subspan(lod.indexOffset, lod.indexCount), vertices, vertexCount, lodName);
+		}
+	}
+	lods.push_back({ 0, fullIndexCount, vertexCount, 0.0f });
+
+	const auto end = std::chrono::steady_clock::now();
+	for (size_t level = 0; level + 1 < lods.size(); ++level)
+	{
+		const MeshLod& lod = lods[level];
+		char message[160];
+		sprintf_s(message, "LOD (%s): %u -> %u triangles (%.1f%%), error %.5f\n", name, fullIndexCount / 3, lod.indexCount / 3,
+			100.0f * lod.indexCount / fullIndexCount, lod.error);
+		::OutputDebugStringA(message);
+	}
+
+	char message[128];
+	sprintf_s(message, "LOD chain (%s): %zu levels in %.2f ms\n", name, lods.size() - 1, std::chrono::duration<double, std::milli>(end - start).count());
+	::OutputDebugStringA(message);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "MeshTypes.h"
+
+// Quadric error edge collapse simplification (Garland & Heckbert). Vertices only collapse onto other existing vertices,
+// so every level indexes the vertex buffer of the source mesh and the attributes (uvs, MikkTSpace tangents) are never
+// interpolated. To keep the seams and the tangent frames intact:
+// - a vertex that shares its position with one twin along a uv / normal seam only collapses along the seam, together
+//   with its twin
+// - a vertex on an open border only collapses along the border
+// - corners of several seams and non manifold vertices never move
+// - collapses that flip a triangle or join vertices with different tangent handedness or diverging normals are rejected
+// error receives the deviation from the source mesh in world units: the farthest distance from a vertex of the source
+// mesh to the result, 0 if nothing was collapsed. The result may stay above targetIndexCount when the constraints run out of collapses.
+std::vector<uint32_t> SimplifyMesh(std::span<const Vertex> vertices, std::span<const uint32_t> indices, size_t targetIndexCount, float& error);
+
+// Simplifies the mesh at every RHConfig::lodRatios and appends the levels to indices. lods gets the coarsest level
+// first and the full detail mesh (index range 0) last.
+void BuildMeshLods(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<MeshLod>& lods, const char* name);
@@ -0,0 +1,181 @@
+#include "SphericalHarmonics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#include <xmmintrin.h>
+
+#include "JobSystem.h"
+
+static constexpr double kPi = 3.14159265358979323846;
+
+static constexpr uint32_t kIrradianceSHMagic = 0x39485352; // "RSH9"
+static constexpr uint32_t kIrradianceSHVersion = 1;
+
+struct IrradianceSHFile
+{
+	uint32_t magic = kIrradianceSHMagic;
+	uint32_t version = kIrradianceSHVersion;
+	uint64_t sourceHash = 0;
+	IrradianceSH sh;
+};
+
+// Rows accumulated in float by one job before they are added to the double totals of its band
+static constexpr uint32_t kRowsPerBand = 8;
+
+// Normalization constants of the real basis of bands 0 to 2
+static constexpr float kY0 = 0.282095f;
+static constexpr float kY1 = 0.488603f;
+static constexpr float kY2 = 1.092548f;
+static constexpr float kY20 = 0.315392f;
+static constexpr float kY22 = 0.546274f;
+
+// Cosine lobe convolution of each band divided by pi (pi, 2pi/3, pi/4 over pi)
+static constexpr float kBand0 = 1.0f;
+static constexpr float kBand1 = 2.0f / 3.0f;
+static constexpr float kBand2 = 0.25f;
+
+IrradianceSH ProjectIrradianceSH(const uint8_t* texels, const HdrTexelFormat format, const uint32_t width, const uint32_t height, const uint32_t rowPitch)
+{
+	// Direction of every column, the row only scales x and z
+	std::vector<float> cosAzimuth(width);
+	std::vector<float> sinAzimuth(width);
+	for (uint32_t x = 0; x < width; ++x)
+	{
+		const double azimuth = (0.5 - (x + 0.5) / width) * 2.0 * kPi;
+		cosAzimuth[x] = static_cast<float>(std::cos(azimuth));
+		sinAzimuth[x] = static_cast<float>(std::sin(azimuth));
+	}
+
+	const uint32_t bandCount = (height + kRowsPerBand - 1) / kRowsPerBand;
+	std::vector<double> bandSums(static_cast<size_t>(bandCount) * 9 * 4, 0.0);
+	const uint32_t texelBytes = HdrTexelBytes(format);
+
+	JobSystem::Get().ParallelFor(bandCount, 1, [&](const size_t band)
+	{
+		double* sums = &bandSums[band * 9 * 4];
+		const uint32_t rowEnd = (std::min)(height, static_cast<uint32_t>(band + 1) * kRowsPerBand);
+		for (uint32_t y = static_cast<uint32_t>(band) * kRowsPerBand; y < rowEnd; ++y)
+		{
+			const double elevation = (0.5 - (y + 0.5) / height) * kPi;
+			const float dirY = static_cast<float>(std::sin(elevation));
+			const float cosElevation = static_cast<float>(std::cos(elevation));
+			const float solidAngle = static_cast<float>((2.0 * kPi / width) * (kPi / height) * std::cos(elevation));
+
+			__m128 acc[9];
+			for (__m128& a : acc)
+			{
+				a = _mm_setzero_ps();
+			}
+
+			const uint8_t* row = texels + static_cast<size_t>(y) * rowPitch;
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				const float dirX = cosElevation * cosAzimuth[x];
+				const float dirZ = cosElevation * sinAzimuth[x];
+
+				// Basis values times the solid angle, broadcast over the 4 channels of the texel
+				const __m128 radiance = _mm_mul_ps(LoadHdrTexel(row + x * texelBytes, format), _mm_set1_ps(solidAngle));
+				acc[0] = _mm_add_ps(acc[0], radiance);
+				acc[1] = _mm_add_ps(acc[1], _mm_mul_ps(radiance, _mm_set1_ps(dirY)));
+				acc[2] = _mm_add_ps(acc[2], _mm_mul_ps(radiance, _mm_set1_ps(dirZ)));
+				acc[3] = _mm_add_ps(acc[3], _mm_mul_ps(radiance, _mm_set1_ps(dirX)));
+				acc[4] = _mm_add_ps(acc[4], _mm_mul_ps(radiance, _mm_set1_ps(dirX * dirY)));
+				acc[5] = _mm_add_ps(acc[5], _mm_mul_ps(radiance, _mm_set1_ps(dirY * dirZ)));
+				acc[6] = _mm_add_ps(acc[6], _mm_mul_ps(radiance, _mm_set1_ps(3.0f * dirZ * dirZ - 1.0f)));
+				acc[7] = _mm_add_ps(acc[7], _mm_mul_ps(radiance, _mm_set1_ps(dirX * dirZ)));
+				acc[8] = _mm_add_ps(acc[8], _mm_mul_ps(radiance, _mm_set1_ps(dirX * dirX - dirY * dirY)));
+			}
+
+			for (uint32_t i = 0; i < 9; ++i)
+			{
+				alignas(16) float rowSum[4];
+				_mm_store_ps(rowSum, acc[i]);
+				for (uint32_t c = 0; c < 4; ++c)
+				{
+					sums[i * 4 + c] += rowSum[c];
+				}
+			}
+		}
+	});
+
+	// Bands are added in order so the result doesn't depend on the scheduling
+	double totals[9 * 4] = {};
+	for (uint32_t band = 0; band < bandCount; ++band)
+	{
+		for (uint32_t i = 0; i < 9 * 4; ++i)
+		{
+			totals[i] += bandSums[band * 9 * 4 + i];
+		}
+	}
+
+	// The totals are projections on the basis without its constants: the coefficient is constant * total, and the
+	// evaluation multiplies by the constant again (and by the lobe of the band)
+	static constexpr float kScale[9] =
+	{
+		kY0 * kY0 * kBand0,
+		kY1 * kY1 * kBand1, kY1 * kY1 * kBand1, kY1 * kY1 * kBand1,
+		kY2 * kY2 * kBand2, kY2 * kY2 * kBand2, kY20 * kY20 * kBand2, kY2 * kY2 * kBand2, kY22 * kY22 * kBand2
+	};
+
+	IrradianceSH sh;
+	for (uint32_t i = 0; i < 9; ++i)
+	{
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			sh.coefficients[i][c] = static_cast<float>(totals[i * 4 + c] * kScale[i]);
+		}
+	}
+	return sh;
+}
+
+void EvaluateIrradianceSH(const IrradianceSH& sh, const float x, const float y, const float z, float rgb[3])
+{
+	const float basis[9] = { 1.0f, y, z, x, x * y, y * z, 3.0f * z * z - 1.0f, x * z, x * x - y * y };
+	for (uint32_t c = 0; c < 3; ++c)
+	{
+		float value = 0.0f;
+		for (uint32_t i = 0; i < 9; ++i)
+		{
+			value += sh.coefficients[i][c] * basis[i];
+		}
+		rgb[c] = (std::max)(value, 0.0f);
+	}
+}
+
+bool WriteIrradianceSH(const std::string& file, const uint64_t sourceHash, const IrradianceSH& sh)
+{
+	std::error_code ec;
+	std::filesystem::create_directories(std::filesystem::path(file).parent_path(), ec);
+
+	std::ofstream stream(file, std::ios::binary | std::ios::trunc);
+	if (!stream)
+	{
+		return false;
+	}
+
+	IrradianceSHFile contents;
+	contents.sourceHash = sourceHash;
+	contents.sh = sh;
+	stream.write(reinterpret_cast<const char*>(&contents), sizeof(contents));
+	return static_cast<bool>(stream);
+}
+
+bool ReadIrradianceSH(const std::string& file, const uint64_t sourceHash, IrradianceSH& sh)
+{
+	std::ifstream stream(file, std::ios::binary);
+	IrradianceSHFile contents;
+	if (!stream.read(reinterpret_cast<char*>(&contents), sizeof(contents)))
+	{
+		return false;
+	}
+	if (contents.magic != kIrradianceSHMagic || contents.version != kIrradianceSHVersion || contents.sourceHash != sourceHash)
+	{
+		return false;
+	}
+
+	sh = contents.sh;
+	return true;
+}
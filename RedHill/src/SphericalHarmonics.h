@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "RadianceHdr.h"
+
+// Diffuse irradiance of an environment as the 9 spherical harmonics coefficients of bands 0 to 2, per color channel.
+// They are already convolved with the clamped cosine lobe and divided by pi (the irradiance cubemap convention, the
+// light pass multiplies by the albedo only), and the basis constants are folded in, so evaluating is the polynomial
+//   c0 + c1 y + c2 z + c3 x + c4 xy + c5 yz + c6 (3z^2 - 1) + c7 xz + c8 (x^2 - y^2)
+// One float4 per coefficient (w unused) so the array goes to the shader as root constants as is.
+struct IrradianceSH
+{
+	float coefficients[9][4] = {};
+};
+
+// Projects a decoded equirectangular environment, rows rowPitch bytes apart, with the mapping of the cubemap bake
+// (u = 0.5 - atan2(z, x) / 2pi, v = 0.5 - asin(y) / pi). Every texel is weighted by its solid angle. The rows are split
+// over the job system, each texel is accumulated into the 9 coefficients with SSE over its 4 channels.
+IrradianceSH ProjectIrradianceSH(const uint8_t* texels, HdrTexelFormat format, uint32_t width, uint32_t height, uint32_t rowPitch);
+
+// Irradiance / pi in the normalized direction (x, y, z), the same sum as the light pass
+void EvaluateIrradianceSH(const IrradianceSH& sh, float x, float y, float z, float rgb[3]);
+
+// Coefficients kept on disk next to the cooked environment maps, with the hash they were projected for. Read fails on
+// a missing, truncated or stale file.
+bool WriteIrradianceSH(const std::string& file, const uint64_t sourceHash, const IrradianceSH& sh);
+bool ReadIrradianceSH(const std::string& file, const uint64_t sourceHash, IrradianceSH& sh);
@@ -0,0 +1,292 @@
+#include "TangentSpace.h"
+
+#include <windows.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+#include "mikktspace.h"
+#include "FlatHashMap.h"
+#include "JobSystem.h"
+
+// Islands below this size are not worth splitting the mesh for
+static constexpr size_t kMinParallelFaces = 4096;
+
+struct MeshLoader
+{
+	Vertex* vertex;
+	const uint32_t* index;	// 3 vertex indices per face, either the whole index buffer or the compacted list of an island
+	int faceCount;
+	const Vertex* sentinel;	// Extra face after the last one (3 vertices), null for none
+
+	const Vertex& Corner(const int face, const int vert) const
+	{
+		return face == faceCount ? sentinel[vert] : vertex[index[face * 3 + vert]];
+	}
+
+	static int GetNumFaces(const SMikkTSpaceContext* ctx)
+	{
+		MeshLoader* meshLoader = static_cast<MeshLoader*>(ctx->m_pUserData);
+		return meshLoader->faceCount + (meshLoader->sentinel ? 1 : 0);
+	}
+
+	static int GetNumVerticesOfFace(const SMikkTSpaceContext* ctx, const int face)
+	{
+		return 3;
+	}
+
+	static void GetPosition(const SMikkTSpaceContext* ctx, float posOut[3], const int face, const int vert)
+	{
+		MeshLoader* meshLoader = static_cast<MeshLoader*>(ctx->m_pUserData);
+		const Vertex& v = meshLoader->Corner(face, vert);
+		posOut[0] = v.position[0];
+		posOut[1] = v.position[1];
+		posOut[2] = v.position[2];
+	}
+
+	static void GetNormal(const SMikkTSpaceContext* ctx, float normOut[3], const int face, const int vert)
+	{
+		MeshLoader* meshLoader = static_cast<MeshLoader*>(ctx->m_pUserData);
+		const Vertex& v = meshLoader->Corner(face, vert);
+		normOut[0] = v.normal[0];
+		normOut[1] = v.normal[1];
+		normOut[2] = v.normal[2];
+	}
+	static void GetTexCoord(const SMikkTSpaceContext* ctx, float texcOut[2], const int face, const int vert)
+	{
+		MeshLoader* meshLoader = static_cast<MeshLoader*>(ctx->m_pUserData);
+		const Vertex& v = meshLoader->Corner(face, vert);
+		texcOut[0] = v.uv[0];
+		texcOut[1] = v.uv[1];
+	}
+	static void SetTSpaceBasic(const SMikkTSpaceContext* ctx, const float tangent[3], const float sign, const int face, const int vert)
+	{
+		MeshLoader* meshLoader = static_cast<MeshLoader*>(ctx->m_pUserData);
+		if (face == meshLoader->faceCount)
+		{
+			return;
+		}
+		Vertex& v = meshLoader->vertex[meshLoader->index[face * 3 + vert]];
+		v.tangent[0] = tangent[0];
+		v.tangent[1] = tangent[1];
+		v.tangent[2] = tangent[2];
+		v.tangent[3] = sign;
+	}
+};
+
+static void RunMikkTSpace(Vertex* vertices, const uint32_t* indices, const size_t faceCount, const Vertex* sentinel = nullptr)
+{
+	MeshLoader mesh{ vertices, indices, static_cast<int>(faceCount), sentinel };
+
+	SMikkTSpaceInterface ispace = {};
+	ispace.m_getNumFaces = MeshLoader::GetNumFaces;
+	ispace.m_getNumVerticesOfFace = MeshLoader::GetNumVerticesOfFace;
+	ispace.m_getPosition = MeshLoader::GetPosition;
+	ispace.m_getNormal = MeshLoader::GetNormal;
+	ispace.m_getTexCoord = MeshLoader::GetTexCoord;
+	ispace.m_setTSpaceBasic = MeshLoader::SetTSpaceBasic;
+	ispace.m_setTSpace = nullptr;
+
+	SMikkTSpaceContext ctx = {};
+	ctx.m_pUserData = &mesh;
+	ctx.m_pInterface = &ispace;
+
+	//  We could check the return to handle errors
+	genTangSpaceDefault(&ctx);
+}
+
+// Positions are compared the way MikkTSpace compares them (float ==), so -0 and +0 must land in the same bucket
+struct PositionKey
+{
+	float p[3];
+
+	bool operator==(const PositionKey& o) const noexcept
+	{
+		return p[0] == o.p[0] && p[1] == o.p[1] && p[2] == o.p[2];
+	}
+};
+
+struct PositionKeyHash
+{
+	size_t operator()(const PositionKey& key) const noexcept
+	{
+		uint32_t bits[3];
+		for (int i = 0; i < 3; ++i)
+		{
+			const float value = key.p[i] + 0.0f; // -0 -> +0
+			std::memcpy(&bits[i], &value, sizeof(float));
+		}
+		return static_cast<size_t>(MixHash64((static_cast<uint64_t>(bits[0]) << 32 | bits[1]) ^ MixHash64(bits[2])));
+	}
+};
+
+static uint32_t FindRoot(std::vector<uint32_t>& parent, uint32_t i)
+{
+	while (parent[i] != i)
+	{
+		parent[i] = parent[parent[i]];
+		i = parent[i];
+	}
+	return i;
+}
+
+static void Union(std::vector<uint32_t>& parent, const uint32_t a, const uint32_t b)
+{
+	const uint32_t rootA = FindRoot(parent, a);
+	const uint32_t rootB = FindRoot(parent, b);
+	if (rootA != rootB)
+	{
+		// Keep the smallest index as root so the island order is deterministic
+		parent[(std::max)(rootA, rootB)] = (std::min)(rootA, rootB);
+	}
+}
+
+// BuildNeighborsFast in MikkTSpace never sub sorts the last run of its sorted edge list, two triangles sharing an edge
+// there may not be paired. An island run would leave the last run of the island unsorted where the whole mesh run sorts
+// it, so every island gets a sentinel face after its own: welded to nothing (NaN texcoords) its edges are the last run.
+// It reuses the positions of a face of the island so the weld grid of MikkTSpace doesn't move. False if every face of
+// the island is degenerate (no edge is paired then anyway).
+static bool MakeSentinel(const Vertex* vertices, const std::vector<uint32_t>& island, Vertex sentinel[3])
+{
+	auto SamePosition = [](const Vertex& a, const Vertex& b)
+	{
+		return a.position[0] == b.position[0] && a.position[1] == b.position[1] && a.position[2] == b.position[2];
+	};
+
+	for (size_t face = 0; face < island.size(); face += 3)
+	{
+		const Vertex& v0 = vertices[island[face]];
+		const Vertex& v1 = vertices[island[face + 1]];
+		const Vertex& v2 = vertices[island[face + 2]];
+		if (!SamePosition(v0, v1) && !SamePosition(v0, v2) && !SamePosition(v1, v2))
+		{
+			for (const int i : { 0, 1, 2 })
+			{
+				sentinel[i] = {};
+				std::copy_n(vertices[island[face + i]].position, 3, sentinel[i].position);
+				sentinel[i].uv[0] = sentinel[i].uv[1] = std::numeric_limits<float>::quiet_NaN();
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+static void VerifyAgainstSerial(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+
+static void LogTiming(const std::chrono::steady_clock::time_point start, const size_t islandCount, const uint32_t threadCount)
+{
+	const auto end = std::chrono::steady_clock::now();
+	char message[160];
+	sprintf_s(message, "Tangent generation: %.2f ms (%zu islands, %u threads)\n",
+		std::chrono::duration<double, std::milli>(end - start).count(), islandCount, threadCount);
+	::OutputDebugStringA(message);
+}
+
+void GenerateTangents(std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, uint32_t threadCount)
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	const size_t faceCount = indices.size() / 3;
+	JobSystem& jobs = JobSystem::Get();
+	if (threadCount == 0)
+	{
+		threadCount = jobs.ThreadCount();
+	}
+
+	if (threadCount == 1 || faceCount < kMinParallelFaces)
+	{
+		RunMikkTSpace(vertices.data(), indices.data(), faceCount);
+		LogTiming(start, 1, 1);
+		return;
+	}
+
+	// Union the vertices of every triangle and every vertex with the first vertex seen at the same position
+	std::vector<uint32_t> parent(vertices.size());
+	std::iota(parent.begin(), parent.end(), 0u);
+
+	FlatHashMap<PositionKey, uint32_t, PositionKeyHash> positions(vertices.size());
+	for (uint32_t i = 0; i < vertices.size(); ++i)
+	{
+		const PositionKey key{ { vertices[i].position[0], vertices[i].position[1], vertices[i].position[2] } };
+		bool inserted = false;
+		const uint32_t first = positions.FindOrInsert(key, i, inserted);
+		if (!inserted)
+		{
+			Union(parent, first, i);
+		}
+	}
+
+	for (size_t face = 0; face < faceCount; ++face)
+	{
+		Union(parent, indices[face * 3], indices[face * 3 + 1]);
+		Union(parent, indices[face * 3 + 1], indices[face * 3 + 2]);
+	}
+
+	// Gather the faces of every island in their original order, compacting their indices so the callbacks only
+	// do one indirection
+	std::vector<uint32_t> islandOfRoot(vertices.size(), UINT32_MAX);
+	std::vector<std::vector<uint32_t>> islands;
+	for (size_t face = 0; face < faceCount; ++face)
+	{
+		const uint32_t root = FindRoot(parent, indices[face * 3]);
+		if (islandOfRoot[root] == UINT32_MAX)
+		{
+			islandOfRoot[root] = static_cast<uint32_t>(islands.size());
+			islands.emplace_back();
+		}
+		std::vector<uint32_t>& island = islands[islandOfRoot[root]];
+		island.insert(island.end(), indices.begin() + face * 3, indices.begin() + face * 3 + 3);
+	}
+
+	if (islands.size() == 1)
+	{
+		RunMikkTSpace(vertices.data(), indices.data(), faceCount);
+		LogTiming(start, 1, 1);
+		return;
+	}
+
+	// Largest islands first, then every job pulls the next island from a shared counter.
+	// Islands never share vertices so the writes of SetTSpaceBasic don't overlap.
+	std::vector<uint32_t> order(islands.size());
+	std::iota(order.begin(), order.end(), 0u);
+	std::stable_sort(order.begin(), order.end(), [&islands](const uint32_t a, const uint32_t b) { return islands[a].size() > islands[b].size(); });
+
+	std::atomic<size_t> next = 0;
+	auto Worker = [&]()
+	{
+		for (size_t i = next++; i < order.size(); i = next++)
+		{
+			const std::vector<uint32_t>& island = islands[order[i]];
+			Vertex sentinel[3];
+			const bool hasSentinel = MakeSentinel(vertices.data(), island, sentinel);
+			RunMikkTSpace(vertices.data(), island.data(), island.size() / 3, hasSentinel ? sentinel : nullptr);
+		}
+	};
+
+	const uint32_t workerCount = static_cast<uint32_t>((std::min)(static_cast<size_t>(threadCount), islands.size()));
+	jobs.ParallelFor(workerCount, 1, [&Worker](size_t) { Worker(); });
+
+	LogTiming(start, islands.size(), workerCount);
+
+#if defined(_DEBUG)
+	VerifyAgainstSerial(vertices, indices);
+#endif
+}
+
+// Debug check that the island split didn't change a single bit compared to the whole mesh run
+static void VerifyAgainstSerial(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+{
+	std::vector<Vertex> reference = vertices;
+	RunMikkTSpace(reference.data(), indices.data(), indices.size() / 3);
+
+	if (std::memcmp(reference.data(), vertices.data(), vertices.size() * sizeof(Vertex)) != 0)
+	{
+		::OutputDebugStringA("Parallel tangent generation differs from the single threaded path\n");
+		::__debugbreak();
+	}
+}
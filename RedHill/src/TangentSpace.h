@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "MeshTypes.h"
+
+// MikkTSpace tangent generation. The mesh is split in islands (triangles connected through vertices that share a
+// position) and the islands are processed in parallel. MikkTSpace never relates triangles that don't share a
+// position, so every island gets the tangents the single threaded run over the whole mesh gives, bit for bit (each
+// island ends with a sentinel face, see MakeSentinel, MikkTSpace itself is untouched).
+// threadCount == 0 uses every thread of the job system, 1 runs the plain single threaded path. The time is logged either
+// way so the thread counts can be compared.
+void GenerateTangents(std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, uint32_t threadCount = 0);
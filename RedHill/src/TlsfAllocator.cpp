@@ -0,0 +1,275 @@
+#include "TlsfAllocator.h"
+
+#include <algorithm>
+#include <bit>
+
+static uint64_t AlignUp(const uint64_t value, const uint64_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+float TlsfAllocator::Stats::Fragmentation() const
+{
+	const uint64_t freeBytes = totalBytes - usedBytes;
+	return freeBytes == 0 ? 0.0f : 1.0f - static_cast<float>(static_cast<double>(largestFreeBlock) / freeBytes);
+}
+
+void TlsfAllocator::Init(const uint64_t size, const uint64_t granularity)
+{
+	m_granularity = granularity;
+	m_granularityLog2 = static_cast<uint32_t>(std::countr_zero(granularity));
+	m_size = size & ~(granularity - 1);
+
+	m_blocks.clear();
+	m_unusedBlocks.clear();
+	m_firstLevelBitmap = 0;
+	std::fill(std::begin(m_secondLevelBitmaps), std::end(m_secondLevelBitmaps), 0u);
+	for (auto& heads : m_freeHeads)
+	{
+		std::fill(std::begin(heads), std::end(heads), kNull);
+	}
+	m_usedBytes = 0;
+	m_allocationCount = 0;
+	m_freeBlockCount = 0;
+
+	// The whole region starts as one free block
+	const uint32_t index = NewBlock();
+	m_blocks[index].offset = 0;
+	m_blocks[index].size = m_size;
+	InsertFree(index);
+}
+
+void TlsfAllocator::Mapping(const uint64_t units, uint32_t& firstLevel, uint32_t& secondLevel)
+{
+	if (units < kSecondLevelCount)
+	{
+		firstLevel = 0;
+		secondLevel = static_cast<uint32_t>(units);
+		return;
+	}
+
+	const uint32_t msb = 63 - static_cast<uint32_t>(std::countl_zero(units));
+	firstLevel = msb - kSecondLevelLog2 + 1;
+	secondLevel = static_cast<uint32_t>(units >> (msb - kSecondLevelLog2)) - kSecondLevelCount;
+}
+
+void TlsfAllocator::MappingRoundUp(const uint64_t units, uint32_t& firstLevel, uint32_t& secondLevel)
+{
+	uint64_t rounded = units;
+	if (units >= kSecondLevelCount)
+	{
+		const uint32_t msb = 63 - static_cast<uint32_t>(std::countl_zero(units));
+		rounded += (uint64_t{ 1 } << (msb - kSecondLevelLog2)) - 1;
+	}
+	Mapping(rounded, firstLevel, secondLevel);
+}
+
+uint32_t TlsfAllocator::NewBlock()
+{
+	if (!m_unusedBlocks.empty())
+	{
+		const uint32_t index = m_unusedBlocks.back();
+		m_unusedBlocks.pop_back();
+		m_blocks[index] = {};
+		return index;
+	}
+	m_blocks.emplace_back();
+	return static_cast<uint32_t>(m_blocks.size() - 1);
+}
+
+void TlsfAllocator::InsertFree(const uint32_t index)
+{
+	uint32_t firstLevel, secondLevel;
+	Mapping(m_blocks[index].size >> m_granularityLog2, firstLevel, secondLevel);
+
+	Block& block = m_blocks[index];
+	block.free = true;
+	block.prevFree = kNull;
+	block.nextFree = m_freeHeads[firstLevel][secondLevel];
+	if (block.nextFree != kNull)
+	{
+		m_blocks[block.nextFree].prevFree = index;
+	}
+	m_freeHeads[firstLevel][secondLevel] = index;
+	m_firstLevelBitmap |= 1u << firstLevel;
+	m_secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+	++m_freeBlockCount;
+}
+
+void TlsfAllocator::RemoveFree(const uint32_t index)
+{
+	Block& block = m_blocks[index];
+	if (block.prevFree != kNull)
+	{
+		m_blocks[block.prevFree].nextFree = block.nextFree;
+	}
+	else
+	{
+		uint32_t firstLevel, secondLevel;
+		Mapping(block.size >> m_granularityLog2, firstLevel, secondLevel);
+		m_freeHeads[firstLevel][secondLevel] = block.nextFree;
+		if (block.nextFree == kNull)
+		{
+			m_secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+			if (m_secondLevelBitmaps[firstLevel] == 0)
+			{
+				m_firstLevelBitmap &= ~(1u << firstLevel);
+			}
+		}
+	}
+	if (block.nextFree != kNull)
+	{
+		m_blocks[block.nextFree].prevFree = block.prevFree;
+	}
+	block.free = false;
+	block.prevFree = kNull;
+	block.nextFree = kNull;
+	--m_freeBlockCount;
+}
+
+uint32_t TlsfAllocator::FindFree(const uint64_t size)
+{
+	const uint64_t units = size >> m_granularityLog2;
+
+	// Any block of the next class up fits
+	uint32_t firstLevel, secondLevel;
+	MappingRoundUp(units, firstLevel, secondLevel);
+	if (firstLevel < kFirstLevelCount)
+	{
+		uint32_t secondLevelMap = secondLevel < kSecondLevelCount ? m_secondLevelBitmaps[firstLevel] & (~0u << secondLevel) : 0;
+		if (secondLevelMap == 0)
+		{
+			const uint32_t firstLevelMap = firstLevel + 1 < kFirstLevelCount ? m_firstLevelBitmap & (~0u << (firstLevel + 1)) : 0;
+			if (firstLevelMap != 0)
+			{
+				firstLevel = static_cast<uint32_t>(std::countr_zero(firstLevelMap));
+				secondLevelMap = m_secondLevelBitmaps[firstLevel];
+			}
+		}
+		if (secondLevelMap != 0)
+		{
+			return m_freeHeads[firstLevel][std::countr_zero(secondLevelMap)];
+		}
+	}
+
+	// The class of the size itself may still hold a block that is big enough, worth a walk before giving up
+	Mapping(units, firstLevel, secondLevel);
+	for (uint32_t index = m_freeHeads[firstLevel][secondLevel]; index != kNull; index = m_blocks[index].nextFree)
+	{
+		if (m_blocks[index].size >= size)
+		{
+			return index;
+		}
+	}
+	return kNull;
+}
+
+uint32_t TlsfAllocator::Split(const uint32_t index, const uint64_t size)
+{
+	const uint32_t rest = NewBlock();
+	Block& block = m_blocks[index];
+	Block& restBlock = m_blocks[rest];
+	restBlock.offset = block.offset + size;
+	restBlock.size = block.size - size;
+	restBlock.prevPhysical = index;
+	restBlock.nextPhysical = block.nextPhysical;
+	if (block.nextPhysical != kNull)
+	{
+		m_blocks[block.nextPhysical].prevPhysical = rest;
+	}
+	block.nextPhysical = rest;
+	block.size = size;
+	return rest;
+}
+
+void TlsfAllocator::Merge(const uint32_t index, const uint32_t next)
+{
+	Block& block = m_blocks[index];
+	const Block& nextBlock = m_blocks[next];
+	block.size += nextBlock.size;
+	block.nextPhysical = nextBlock.nextPhysical;
+	if (nextBlock.nextPhysical != kNull)
+	{
+		m_blocks[nextBlock.nextPhysical].prevPhysical = index;
+	}
+	m_unusedBlocks.push_back(next);
+}
+
+TlsfAllocator::Allocation TlsfAllocator::Allocate(const uint64_t size, uint64_t alignment)
+{
+	const uint64_t alignedSize = AlignUp((std::max)(size, uint64_t{ 1 }), m_granularity);
+	alignment = (std::max)(alignment, m_granularity);
+
+	// Room for the worst front padding, the blocks always start on a granule
+	const uint64_t searchSize = alignedSize + alignment - m_granularity;
+	if (searchSize > m_size)
+	{
+		return {};
+	}
+
+	uint32_t index = FindFree(searchSize);
+	if (index == kNull)
+	{
+		return {};
+	}
+	RemoveFree(index);
+
+	const uint64_t padding = AlignUp(m_blocks[index].offset, alignment) - m_blocks[index].offset;
+	if (padding > 0)
+	{
+		// The padding stays free in front
+		const uint32_t aligned = Split(index, padding);
+		InsertFree(index);
+		index = aligned;
+	}
+	if (m_blocks[index].size > alignedSize)
+	{
+		InsertFree(Split(index, alignedSize));
+	}
+
+	m_usedBytes += alignedSize;
+	++m_allocationCount;
+	return { m_blocks[index].offset, index };
+}
+
+void TlsfAllocator::Free(uint32_t handle)
+{
+	m_usedBytes -= m_blocks[handle].size;
+	--m_allocationCount;
+
+	const uint32_t next = m_blocks[handle].nextPhysical;
+	if (next != kNull && m_blocks[next].free)
+	{
+		RemoveFree(next);
+		Merge(handle, next);
+	}
+	const uint32_t prev = m_blocks[handle].prevPhysical;
+	if (prev != kNull && m_blocks[prev].free)
+	{
+		RemoveFree(prev);
+		Merge(prev, handle);
+		handle = prev;
+	}
+	InsertFree(handle);
+}
+
+TlsfAllocator::Stats TlsfAllocator::GetStats() const
+{
+	Stats stats;
+	stats.totalBytes = m_size;
+	stats.usedBytes = m_usedBytes;
+	stats.allocationCount = m_allocationCount;
+	stats.freeBlockCount = m_freeBlockCount;
+
+	// The largest free block is in the highest non empty class
+	if (m_firstLevelBitmap != 0)
+	{
+		const uint32_t firstLevel = 31 - static_cast<uint32_t>(std::countl_zero(m_firstLevelBitmap));
+		const uint32_t secondLevel = 31 - static_cast<uint32_t>(std::countl_zero(m_secondLevelBitmaps[firstLevel]));
+		for (uint32_t index = m_freeHeads[firstLevel][secondLevel]; index != kNull; index = m_blocks[index].nextFree)
+		{
+			stats.largestFreeBlock = (std::max)(stats.largestFreeBlock, m_blocks[index].size);
+		}
+	}
+	return stats;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Two level segregated fit allocator of byte ranges in a region it never touches (a D3D12 heap). The free blocks are
+// sorted in power of two classes split in kSecondLevelCount linear sub classes, finding a block that fits and freeing
+// with the merge of the physical neighbours are constant time. Sizes are rounded to the granularity (64KB, the default
+// placement alignment), bigger alignments (4MB for MSAA) split the padding off the front of the block.
+class TlsfAllocator
+{
+public:
+	static constexpr uint32_t kInvalidAllocation = UINT32_MAX;
+
+	struct Allocation
+	{
+		uint64_t offset = 0;
+		uint32_t handle = kInvalidAllocation;	// For Free
+	};
+
+	struct Stats
+	{
+		uint64_t totalBytes = 0;
+		uint64_t usedBytes = 0;
+		uint64_t largestFreeBlock = 0;
+		uint32_t allocationCount = 0;
+		uint32_t freeBlockCount = 0;
+
+		// Share of the free space that isn't in the largest free block, 0 when the free space is in one piece
+		float Fragmentation() const;
+	};
+
+	void Init(const uint64_t size, const uint64_t granularity);
+
+	// handle is kInvalidAllocation when no free block fits. Alignments are powers of two, at least the granularity.
+	Allocation Allocate(const uint64_t size, const uint64_t alignment);
+	void Free(const uint32_t handle);
+
+	Stats GetStats() const;
+	uint64_t Size() const { return m_size; }
+
+private:
+	static constexpr uint32_t kSecondLevelLog2 = 4;
+	static constexpr uint32_t kSecondLevelCount = 1 << kSecondLevelLog2;
+	static constexpr uint32_t kFirstLevelCount = 32;
+	static constexpr uint32_t kNull = UINT32_MAX;
+
+	struct Block
+	{
+		uint64_t offset = 0;
+		uint64_t size = 0;
+		uint32_t prevPhysical = kNull;	// Neighbours in the region
+		uint32_t nextPhysical = kNull;
+		uint32_t prevFree = kNull;		// Links in the free list of the size class
+		uint32_t nextFree = kNull;
+		bool free = false;
+	};
+
+	// Size class of a size in granules, rounded down (insertion) or up (search, so any block of the class fits)
+	static void Mapping(const uint64_t units, uint32_t& firstLevel, uint32_t& secondLevel);
+	static void MappingRoundUp(const uint64_t units, uint32_t& firstLevel, uint32_t& secondLevel);
+
+	uint32_t NewBlock();
+	void InsertFree(const uint32_t index);
+	void RemoveFree(const uint32_t index);
+	uint32_t FindFree(const uint64_t size);
+	// Splits the end of a block off as a new free block, returns it
+	uint32_t Split(const uint32_t index, const uint64_t size);
+	// Merges a free block with its free neighbour after it
+	void Merge(const uint32_t index, const uint32_t next);
+
+	uint64_t m_size = 0;
+	uint64_t m_granularity = 0;
+	uint32_t m_granularityLog2 = 0;
+
+	std::vector<Block> m_blocks;
+	std::vector<uint32_t> m_unusedBlocks;
+
+	uint32_t m_firstLevelBitmap = 0;
+	uint32_t m_secondLevelBitmaps[kFirstLevelCount] = {};
+	uint32_t m_freeHeads[kFirstLevelCount][kSecondLevelCount];
+
+	uint64_t m_usedBytes = 0;
+	uint32_t m_allocationCount = 0;
+	uint32_t m_freeBlockCount = 0;
+};
@@ -0,0 +1,105 @@
+#include "TransientDescriptorRing.h"
+
+#include <algorithm>
+#include <cassert>
+
+void TransientDescriptorRing::Init(const uint32_t capacity, const uint32_t blockSize)
+{
+	assert(blockSize > 0 && capacity % blockSize == 0);
+	m_capacity = capacity;
+	m_blockSize = blockSize;
+	m_head.store(0, std::memory_order_relaxed);
+	m_tail.store(0, std::memory_order_relaxed);
+	m_submitted = 0;
+	m_peak = 0;
+	m_submissions.clear();
+
+	// The epoch never goes back, the cursors of before are empty whatever they were
+	m_epoch.fetch_add(1, std::memory_order_release);
+}
+
+uint32_t TransientDescriptorRing::Allocate(Cursor& cursor, const uint32_t count)
+{
+	const uint64_t epoch = m_epoch.load(std::memory_order_acquire);
+	if (cursor.epoch != epoch)
+	{
+		cursor = { 0, 0, epoch };
+	}
+
+	if (cursor.end - cursor.next >= count)
+	{
+		const uint32_t offset = cursor.next;
+		cursor.next += count;
+		return offset;
+	}
+
+	// What is left of the block is wasted until its fence, a table never straddles two grabs
+	const uint32_t blockCount = (count + m_blockSize - 1) / m_blockSize;
+	const uint32_t offset = GrabBlocks(blockCount);
+	if (offset == kInvalidOffset)
+	{
+		return kInvalidOffset;
+	}
+	cursor.next = offset + count;
+	cursor.end = offset + blockCount * m_blockSize;
+	return offset;
+}
+
+uint32_t TransientDescriptorRing::GrabBlocks(const uint32_t blockCount)
+{
+	const uint64_t size = static_cast<uint64_t>(blockCount) * m_blockSize;
+	if (size == 0 || size > m_capacity)
+	{
+		return kInvalidOffset;
+	}
+
+	// The tail only moves in Reclaim, between the recordings. A stale head fails the exchange and is reloaded.
+	const uint64_t tail = m_tail.load(std::memory_order_acquire);
+	uint64_t head = m_head.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		const uint64_t position = head % m_capacity;
+		const uint64_t offset = position + size > m_capacity ? 0 : position;
+		const uint64_t taken = (offset == position ? 0 : m_capacity - position) + size;
+		if (head + taken - tail > m_capacity)
+		{
+			return kInvalidOffset;
+		}
+		if (m_head.compare_exchange_weak(head, head + taken, std::memory_order_relaxed))
+		{
+			return static_cast<uint32_t>(offset);
+		}
+	}
+}
+
+void TransientDescriptorRing::Submit(const uint64_t fenceValue)
+{
+	const uint64_t head = m_head.load(std::memory_order_relaxed);
+	if (head != m_submitted)
+	{
+		m_submissions.push_back({ fenceValue, head });
+		m_submitted = head;
+		m_peak = (std::max)(m_peak, static_cast<uint32_t>(head - m_tail.load(std::memory_order_relaxed)));
+	}
+	m_epoch.fetch_add(1, std::memory_order_release);
+}
+
+void TransientDescriptorRing::Reclaim(const uint64_t completedFenceValue)
+{
+	while (!m_submissions.empty() && m_submissions.front().fenceValue <= completedFenceValue)
+	{
+		m_tail.store(m_submissions.front().end, std::memory_order_release);
+		m_submissions.pop_front();
+	}
+
+	// Nothing in flight, the next grab starts from the beginning so a run can take the whole ring. Head and tail move up
+	// together, the skipped descriptors were free and every grab after this one measures against the new tail.
+	const uint64_t tail = m_tail.load(std::memory_order_relaxed);
+	if (m_capacity > 0 && m_submissions.empty() && m_head.load(std::memory_order_relaxed) == tail && tail % m_capacity != 0)
+	{
+		const uint64_t start = tail + m_capacity - tail % m_capacity;
+		m_head.store(start, std::memory_order_relaxed);
+		m_tail.store(start, std::memory_order_release);
+		m_submitted = start;
+	}
+}
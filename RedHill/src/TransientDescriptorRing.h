@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+
+// Transient descriptors of a heap as a ring shared by the frames in flight, no device involved (the heap lives in
+// DescriptorHeapAllocator). Same scheme as RingAllocator, made lock free: recording threads grab whole blocks from the
+// ring with a compare exchange on the head and hand out the descriptors of their block through their own cursor, so
+// a descriptor costs no atomic at all. Submit tags everything grabbed since the previous one with the fence value and
+// Reclaim gives it back once the value is completed, the partly used blocks included.
+class TransientDescriptorRing
+{
+public:
+	static constexpr uint32_t kInvalidOffset = UINT32_MAX;
+
+	// The block a recording thread (or job) allocates from, one per thread. It is emptied by every Submit: what is left
+	// of its block was tagged with that fence and can't hold descriptors of the next frame.
+	struct Cursor
+	{
+		uint32_t next = 0;
+		uint32_t end = 0;
+		uint64_t epoch = 0;
+	};
+
+	TransientDescriptorRing() = default;
+	TransientDescriptorRing(const TransientDescriptorRing&) = delete;
+	TransientDescriptorRing& operator=(const TransientDescriptorRing&) = delete;
+
+	// capacity is a multiple of blockSize. Also empties the ring, with nothing in flight.
+	void Init(const uint32_t capacity, const uint32_t blockSize);
+
+	// Thread safe and lock free, count contiguous descriptors from the cursor or from new blocks. kInvalidOffset when the
+	// frames in flight hold the ring: the caller waits for the oldest fence (or the ring is too small for a frame).
+	uint32_t Allocate(Cursor& cursor, const uint32_t count);
+
+	// Render thread only, while no thread is allocating (between the recordings and the execution of a frame)
+	void Submit(const uint64_t fenceValue);
+	void Reclaim(const uint64_t completedFenceValue);
+
+	uint32_t Capacity() const { return m_capacity; }
+	uint32_t BlockSize() const { return m_blockSize; }
+	// In use at the fence signals, the peak of the frames in flight
+	uint32_t PeakDescriptors() const { return m_peak; }
+
+private:
+	// Offset of blockCount contiguous blocks, a run that doesn't fit before the end skips the tail of the ring. Reclaim
+	// moves the head back to the beginning when nothing is in flight, like RingAllocator.
+	uint32_t GrabBlocks(const uint32_t blockCount);
+
+	struct Submission
+	{
+		uint64_t fenceValue;
+		uint64_t end;
+	};
+
+	uint32_t m_capacity = 0;
+	uint32_t m_blockSize = 1;
+
+	// Running counts of grabbed and given back descriptors, always whole blocks. The head is the only contended word.
+	alignas(64) std::atomic<uint64_t> m_head = 0;
+	alignas(64) std::atomic<uint64_t> m_tail = 0;
+	std::atomic<uint64_t> m_epoch = 1;
+
+	uint64_t m_submitted = 0;
+	uint32_t m_peak = 0;
+	std::deque<Submission> m_submissions;
+};
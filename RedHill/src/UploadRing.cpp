@@ -0,0 +1,35 @@
+#include "UploadRing.h"
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN             // Exclude rarely-used stuff from Windows headers.
+#endif
+
+#include <windows.h>
+#include "Utils.h"
+
+void UploadRing::Init(ID3D12Device* device, const uint64_t size)
+{
+	auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+	auto bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(size);
+	CrashIfFailed(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &bufferDesc, D3D12_RESOURCE_STATE_GENERIC_READ, nullptr, IID_PPV_ARGS(&m_buffer)));
+
+	// Upload heaps can stay mapped for their whole life, the CPU never reads them back
+	const CD3DX12_RANGE readRange(0, 0);
+	CrashIfFailed(m_buffer->Map(0, &readRange, reinterpret_cast<void**>(&m_cpu)));
+
+	m_allocator.Init(size);
+}
+
+bool UploadRing::TryAllocate(const uint64_t size, const uint64_t alignment, UploadAllocation& allocation)
+{
+	const uint64_t offset = m_allocator.Allocate(size, alignment);
+	if (offset == RingAllocator::kInvalidOffset)
+	{
+		return false;
+	}
+
+	allocation.resource = m_buffer.Get();
+	allocation.offset = offset;
+	allocation.cpu = m_cpu + offset;
+	return true;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <d3d12.h>
+#include <d3dx12/d3dx12.h>
+#include <wrl.h>
+#include <cstdint>
+
+#include "RingAllocator.h"
+
+using Microsoft::WRL::ComPtr;
+
+struct UploadAllocation
+{
+	ID3D12Resource* resource = nullptr;
+	uint64_t offset = 0;		// In the upload buffer, for the copy commands
+	uint8_t* cpu = nullptr;		// Where to write the data
+};
+
+// One persistently mapped upload buffer every mesh and texture upload goes through. The space is handed out by a
+// RingAllocator and comes back once the fence of the work copying from it has completed, so the staging memory stays
+// bounded however much is streamed.
+class UploadRing
+{
+public:
+	UploadRing() = default;
+	UploadRing(const UploadRing&) = delete;
+	UploadRing& operator=(const UploadRing&) = delete;
+
+	void Init(ID3D12Device* device, const uint64_t size);
+
+	// False when the ring is full of data still in flight, the caller flushes its copies and waits before retrying
+	bool TryAllocate(const uint64_t size, const uint64_t alignment, UploadAllocation& allocation);
+
+	void Submit(const uint64_t fenceValue) { m_allocator.Submit(fenceValue); }
+	void Reclaim(const uint64_t completedFenceValue) { m_allocator.Reclaim(completedFenceValue); }
+
+	uint64_t Capacity() const { return m_allocator.Capacity(); }
+	uint64_t PeakBytes() const { return m_allocator.PeakBytes(); }
+
+private:
+	ComPtr<ID3D12Resource> m_buffer;
+	uint8_t* m_cpu = nullptr;
+	RingAllocator m_allocator;
+};
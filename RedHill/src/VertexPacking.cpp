@@ -0,0 +1,185 @@
+#include "VertexPacking.h"
+
+#include <algorithm>
+#include <cmath>
+
+static constexpr float kUnormMax = 65535.0f;
+static constexpr float kSnormMax = 32767.0f;
+static constexpr float kRadiansToDegrees = 57.2957795f;
+
+static int16_t ToSnorm(const float value)
+{
+	return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * kSnormMax));
+}
+
+static float FromSnorm(const int16_t value)
+{
+	return (std::max)(static_cast<float>(value) / kSnormMax, -1.0f);
+}
+
+// Octahedral mapping of a unit vector to [-1, 1]^2
+static void OctEncode(const float v[3], int16_t out[2])
+{
+	const float l1 = fabsf(v[0]) + fabsf(v[1]) + fabsf(v[2]);
+	if (l1 == 0.0f)
+	{
+		out[0] = 0;
+		out[1] = 0;
+		return;
+	}
+
+	float x = v[0] / l1;
+	float y = v[1] / l1;
+	if (v[2] < 0.0f)
+	{
+		const float ox = x;
+		x = (1.0f - fabsf(y)) * (ox >= 0.0f ? 1.0f : -1.0f);
+		y = (1.0f - fabsf(ox)) * (y >= 0.0f ? 1.0f : -1.0f);
+	}
+
+	out[0] = ToSnorm(x);
+	out[1] = ToSnorm(y);
+}
+
+static void OctDecode(const int16_t in[2], float out[3])
+{
+	float x = FromSnorm(in[0]);
+	float y = FromSnorm(in[1]);
+	const float z = 1.0f - fabsf(x) - fabsf(y);
+	const float t = (std::max)(-z, 0.0f);
+	x += x >= 0.0f ? -t : t;
+	y += y >= 0.0f ? -t : t;
+
+	const float invLength = 1.0f / sqrtf(x * x + y * y + z * z);
+	out[0] = x * invLength;
+	out[1] = y * invLength;
+	out[2] = z * invLength;
+}
+
+VertexQuantization ComputeVertexQuantization(std::span<const Vertex> vertices)
+{
+	VertexQuantization quantization;
+	if (vertices.empty())
+	{
+		return quantization;
+	}
+
+	float boundsMin[3] = { vertices[0].position[0], vertices[0].position[1], vertices[0].position[2] };
+	float boundsMax[3] = { boundsMin[0], boundsMin[1], boundsMin[2] };
+	for (const Vertex& v : vertices)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			boundsMin[axis] = (std::min)(boundsMin[axis], v.position[axis]);
+			boundsMax[axis] = (std::max)(boundsMax[axis], v.position[axis]);
+		}
+	}
+
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		// Flat axis (the floor), any scale works as every vertex quantizes to 0
+		const float extent = boundsMax[axis] - boundsMin[axis];
+		quantization.offset[axis] = boundsMin[axis];
+		quantization.scale[axis] = extent > 0.0f ? extent : 1.0f;
+	}
+	return quantization;
+}
+
+PackedVertex PackVertex(const Vertex& vertex, const VertexQuantization& quantization)
+{
+	PackedVertex packed;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		const float normalized = (vertex.position[axis] - quantization.offset[axis]) / quantization.scale[axis];
+		packed.position[axis] = static_cast<uint16_t>(std::lround(std::clamp(normalized, 0.0f, 1.0f) * kUnormMax));
+	}
+	packed.position[3] = vertex.tangent[3] < 0.0f ? 0 : 0xFFFF;
+
+	packed.uv[0] = FloatToHalf(vertex.uv[0]);
+	packed.uv[1] = FloatToHalf(vertex.uv[1]);
+
+	OctEncode(vertex.normal, packed.normal);
+	OctEncode(vertex.tangent, packed.tangent);
+	return packed;
+}
+
+Vertex UnpackVertex(const PackedVertex& packed, const VertexQuantization& quantization)
+{
+	Vertex vertex;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		vertex.position[axis] = quantization.offset[axis] + (static_cast<float>(packed.position[axis]) / kUnormMax) * quantization.scale[axis];
+	}
+
+	vertex.uv[0] = HalfToFloat(packed.uv[0]);
+	vertex.uv[1] = HalfToFloat(packed.uv[1]);
+
+	OctDecode(packed.normal, vertex.normal);
+	OctDecode(packed.tangent, vertex.tangent);
+	vertex.tangent[3] = packed.position[3] != 0 ? 1.0f : -1.0f;
+	return vertex;
+}
+
+void PackVertices(std::span<const Vertex> vertices, const VertexQuantization& quantization, std::vector<PackedVertex>& out)
+{
+	out.resize(vertices.size());
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		out[i] = PackVertex(vertices[i], quantization);
+	}
+}
+
+// Angle between a reference direction and its decoded version, 0 if the reference is not a direction (meshes without tangents).
+// atan2 of the cross and dot products, acosf of a cosine that close to 1 can't resolve less than ~0.02 degrees.
+static float AngleBetween(const float a[3], const float b[3])
+{
+	if (a[0] == 0.0f && a[1] == 0.0f && a[2] == 0.0f)
+	{
+		return 0.0f;
+	}
+	const float cx = a[1] * b[2] - a[2] * b[1];
+	const float cy = a[2] * b[0] - a[0] * b[2];
+	const float cz = a[0] * b[1] - a[1] * b[0];
+	const float cosAngle = a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	return atan2f(sqrtf(cx * cx + cy * cy + cz * cz), cosAngle) * kRadiansToDegrees;
+}
+
+VertexPackingError MeasureVertexPackingError(std::span<const Vertex> vertices, std::span<const PackedVertex> packed, const VertexQuantization& quantization)
+{
+	VertexPackingError error;
+	if (vertices.empty())
+	{
+		return error;
+	}
+
+	double positionSum = 0.0;
+	double normalSum = 0.0;
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		const Vertex& reference = vertices[i];
+		const Vertex decoded = UnpackVertex(packed[i], quantization);
+
+		const float dx = decoded.position[0] - reference.position[0];
+		const float dy = decoded.position[1] - reference.position[1];
+		const float dz = decoded.position[2] - reference.position[2];
+		const float positionError = sqrtf(dx * dx + dy * dy + dz * dz);
+		error.maxPosition = (std::max)(error.maxPosition, positionError);
+		positionSum += positionError;
+
+		error.maxUv = (std::max)({ error.maxUv, fabsf(decoded.uv[0] - reference.uv[0]), fabsf(decoded.uv[1] - reference.uv[1]) });
+
+		const float normalAngle = AngleBetween(reference.normal, decoded.normal);
+		error.maxNormalAngle = (std::max)(error.maxNormalAngle, normalAngle);
+		normalSum += normalAngle;
+
+		error.maxTangentAngle = (std::max)(error.maxTangentAngle, AngleBetween(reference.tangent, decoded.tangent));
+		if ((reference.tangent[3] < 0.0f) != (decoded.tangent[3] < 0.0f))
+		{
+			++error.tangentSignErrors;
+		}
+	}
+
+	error.avgPosition = static_cast<float>(positionSum / vertices.size());
+	error.avgNormalAngle = static_cast<float>(normalSum / vertices.size());
+	return error;
+}
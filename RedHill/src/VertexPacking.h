@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "HalfFloat.h"
+#include "MeshTypes.h"
+
+// Encoding of PackedVertex:
+// - position: 16 bit unorm per axis against the bounds of the mesh (see VertexQuantization)
+// - uv: half floats
+// - normal and tangent: octahedral mapping stored as 16 bit snorm pairs
+// - the tangent sign goes in the spare w component of the position
+
+// Quantization that maps the bounds of the vertices to the full unorm range
+VertexQuantization ComputeVertexQuantization(std::span<const Vertex> vertices);
+
+PackedVertex PackVertex(const Vertex& vertex, const VertexQuantization& quantization);
+
+// CPU version of the shader decode (VertexInput.hlsli)
+Vertex UnpackVertex(const PackedVertex& packed, const VertexQuantization& quantization);
+
+void PackVertices(std::span<const Vertex> vertices, const VertexQuantization& quantization, std::vector<PackedVertex>& out);
+
+// Error of the packed vertices against the float ones, angles in degrees
+struct VertexPackingError
+{
+	float maxPosition = 0.0f;
+	float avgPosition = 0.0f;
+	float maxUv = 0.0f;
+	float maxNormalAngle = 0.0f;
+	float avgNormalAngle = 0.0f;
+	float maxTangentAngle = 0.0f;
+	uint32_t tangentSignErrors = 0;
+};
+
+VertexPackingError MeasureVertexPackingError(std::span<const Vertex> vertices, std::span<const PackedVertex> packed, const VertexQuantization& quantization);
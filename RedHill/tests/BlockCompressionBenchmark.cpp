@@ -0,0 +1,63 @@
+// Encode throughput of CompressMipChain on the Helmet textures, the whole mip chain in the format each one is cooked
+// to plus BC1 on the albedo. The blocks are spread over the shared job system like at cook time. MB/s counts the RGBA8
+// input of every level.
+//
+//   BlockCompressionBenchmark
+
+#include <cstdio>
+#include <string>
+
+#include "BlockCompression.h"
+#include "JobSystem.h"
+#include "TestUtils.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+namespace
+{
+	const char* FormatName(const BlockFormat format)
+	{
+		switch (format)
+		{
+		case BlockFormat::BC1: return "BC1";
+		case BlockFormat::BC4: return "BC4";
+		case BlockFormat::BC5: return "BC5";
+		default: return "BC7";
+		}
+	}
+
+	void Benchmark(const char* file, const BlockFormat format, const bool srgb)
+	{
+		int width, height, channels;
+		stbi_uc* pixels = stbi_load((std::string(REDHILL_RESOURCES "/") + file).c_str(), &width, &height, &channels, 4);
+		RH_CHECK(pixels != nullptr);
+		const MipChain chain = GenerateMipChain(pixels, width, height, srgb);
+		size_t pixelCount = 0;
+		for (const MipLevel& level : chain.levels)
+		{
+			pixelCount += static_cast<size_t>(level.width) * level.height;
+		}
+
+		CompressedTexture texture;
+		const double ms = MeasureMs(5, [&]()
+		{
+			texture = CompressMipChain(chain, format);
+		});
+		std::printf("%-28s %s %4d x %4d: %8.2f ms %8.1f MB/s %7.1f Mpix/s  %.2f dB\n", file, FormatName(format), width, height, ms,
+			pixelCount * 4 / (ms * 1000.0), pixelCount / (ms * 1000.0), MeasurePsnr(chain.levels[0], texture.levels[0], format));
+		stbi_image_free(pixels);
+	}
+}
+
+int main()
+{
+	std::printf("Job system threads: %u\n", JobSystem::Get().ThreadCount());
+	Benchmark("Default_albedo.jpg", BlockFormat::BC7, true);
+	Benchmark("Default_albedo.jpg", BlockFormat::BC1, true);
+	Benchmark("Default_metalRoughness.jpg", BlockFormat::BC7, false);
+	Benchmark("Default_emissive.jpg", BlockFormat::BC7, true);
+	Benchmark("Default_normal.jpg", BlockFormat::BC5, false);
+	Benchmark("Default_AO.jpg", BlockFormat::BC4, false);
+	return 0;
+}
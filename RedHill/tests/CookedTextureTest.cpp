@@ -0,0 +1,227 @@
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <random>
+
+#include "CookedTexture.h"
+#include "TestUtils.h"
+
+namespace
+{
+	constexpr uint64_t kSourceHash = 0x1234567890abcdefULL;
+	constexpr uint32_t kFormatR8G8B8A8 = 28;	// DXGI_FORMAT_R8G8B8A8_UNORM
+	constexpr uint32_t kFormatBC7 = 98;			// DXGI_FORMAT_BC7_UNORM
+
+	struct Source
+	{
+		CookedTextureDesc desc;
+		std::vector<std::vector<uint8_t>> data;
+		std::vector<TextureSubresource> subresources;
+	};
+
+	// A full mip chain of random texels, pixel rows for RGBA8, rows of 4x4 blocks of 16 bytes for BC7
+	Source MakeSource(const uint32_t width, const uint32_t height, const uint32_t arraySize, const bool blocks, const uint32_t seed)
+	{
+		Source source;
+		source.desc.format = blocks ? kFormatBC7 : kFormatR8G8B8A8;
+		source.desc.flags = arraySize == 6 ? kCookedTextureCubemap : 0;
+		source.desc.width = width;
+		source.desc.height = height;
+		source.desc.arraySize = arraySize;
+		while ((std::max)(width, height) >> source.desc.mipLevels)
+		{
+			source.desc.mipLevels++;
+		}
+
+		std::mt19937 random(seed);
+		for (uint32_t slice = 0; slice < arraySize; ++slice)
+		{
+			for (uint32_t mip = 0; mip < source.desc.mipLevels; ++mip)
+			{
+				TextureSubresource subresource;
+				subresource.width = (std::max)(1u, width >> mip);
+				subresource.height = (std::max)(1u, height >> mip);
+				if (blocks)
+				{
+					subresource.width = (subresource.width + 3) & ~3u;
+					subresource.height = (subresource.height + 3) & ~3u;
+				}
+				subresource.rowCount = blocks ? subresource.height / 4 : subresource.height;
+				subresource.rowBytes = blocks ? subresource.width / 4 * 16 : subresource.width * 4;
+				std::vector<uint8_t>& data = source.data.emplace_back(static_cast<size_t>(subresource.rowCount) * subresource.rowBytes);
+				for (uint8_t& value : data)
+				{
+					value = static_cast<uint8_t>(random());
+				}
+				source.subresources.push_back(subresource);
+			}
+		}
+		for (size_t i = 0; i < source.subresources.size(); ++i)
+		{
+			source.subresources[i].data = source.data[i].data();
+		}
+		return source;
+	}
+
+	// The footprints follow the D3D12 rules and every row reads back the source, the padding zeroed
+	void CheckContents(const CookedTextureFile& file, const Source& source)
+	{
+		const CookedTextureHeader& header = file.Header();
+		RH_CHECK(header.magic == kCookedTextureMagic && header.version == kCookedTextureVersion && header.sourceHash == kSourceHash);
+		RH_CHECK(header.format == source.desc.format && header.flags == source.desc.flags);
+		RH_CHECK(header.width == source.desc.width && header.height == source.desc.height);
+		RH_CHECK(header.arraySize == source.desc.arraySize && header.mipLevels == source.desc.mipLevels);
+		RH_CHECK(header.payloadOffset % kCookedTexturePlacementAlignment == 0);
+		RH_CHECK(file.Subresources().size() == source.subresources.size());
+		RH_CHECK(file.Payload().size() == header.payloadSize);
+
+		uint64_t end = 0;
+		for (size_t i = 0; i < source.subresources.size(); ++i)
+		{
+			const CookedSubresource& entry = file.Subresources()[i];
+			const TextureSubresource& expected = source.subresources[i];
+			RH_CHECK(entry.offset % kCookedTexturePlacementAlignment == 0 && entry.offset >= end);
+			RH_CHECK(entry.rowPitch % kCookedTextureRowPitchAlignment == 0 && entry.rowPitch >= entry.rowBytes);
+			RH_CHECK(entry.width == expected.width && entry.height == expected.height);
+			RH_CHECK(entry.rowCount == expected.rowCount && entry.rowBytes == expected.rowBytes);
+			for (uint32_t row = 0; row < entry.rowCount; ++row)
+			{
+				const uint8_t* rowData = file.Payload().data() + entry.offset + static_cast<uint64_t>(row) * entry.rowPitch;
+				RH_CHECK(std::memcmp(rowData, expected.data + static_cast<size_t>(row) * expected.rowBytes, entry.rowBytes) == 0);
+				for (uint32_t padding = entry.rowBytes; padding < entry.rowPitch; ++padding)
+				{
+					RH_CHECK(rowData[padding] == 0);
+				}
+			}
+			end = entry.offset + static_cast<uint64_t>(entry.rowPitch) * entry.rowCount;
+		}
+		RH_CHECK(end == header.payloadSize);
+	}
+
+	// Written to disk then mapped back, and the same bytes loaded in memory
+	void TestRoundTrip(const std::string& path)
+	{
+		const Source sources[] = { MakeSource(37, 11, 1, false, 1), MakeSource(256, 128, 1, true, 2), MakeSource(64, 64, 6, false, 3), MakeSource(1, 1, 1, true, 4) };
+		for (const Source& source : sources)
+		{
+			std::vector<uint8_t> bytes = BuildCookedTexture(kSourceHash, source.desc, source.subresources);
+			RH_CHECK(WriteCookedTexture(path, bytes));
+			RH_CHECK(std::filesystem::file_size(path) == bytes.size());
+
+			CookedTextureFile mapped;
+			RH_CHECK(mapped.Open(path, kSourceHash));
+			RH_CHECK(mapped.IsMapped());
+			CheckContents(mapped, source);
+
+			// Only the cook of this source is accepted
+			CookedTextureFile stale;
+			RH_CHECK(!stale.Open(path, kSourceHash + 1));
+
+			CookedTextureFile loaded;
+			RH_CHECK(loaded.Load(std::move(bytes)));
+			RH_CHECK(!loaded.IsMapped());
+			CheckContents(loaded, source);
+		}
+
+		CookedTextureFile missing;
+		RH_CHECK(!missing.Open(path + ".missing", kSourceHash));
+	}
+
+	// Subresources without data are left zeroed and filled in place afterwards (how the baker writes its readbacks)
+	void TestFillInPlace()
+	{
+		Source source = MakeSource(64, 32, 1, false, 5);
+		std::vector<TextureSubresource> empty = source.subresources;
+		for (TextureSubresource& subresource : empty)
+		{
+			subresource.data = nullptr;
+		}
+		std::vector<uint8_t> bytes = BuildCookedTexture(kSourceHash, source.desc, empty);
+		for (uint32_t i = 0; i < empty.size(); ++i)
+		{
+			CookedSubresource entry;
+			uint8_t* rows = CookedSubresourceRows(bytes, i, entry);
+			for (uint32_t row = 0; row < entry.rowCount; ++row)
+			{
+				RH_CHECK(std::all_of(rows + row * entry.rowPitch, rows + row * entry.rowPitch + entry.rowPitch, [](const uint8_t b) { return b == 0; }));
+				std::memcpy(rows + row * entry.rowPitch, source.subresources[i].data + row * entry.rowBytes, entry.rowBytes);
+			}
+		}
+		RH_CHECK(bytes == BuildCookedTexture(kSourceHash, source.desc, source.subresources));
+	}
+
+	// Every truncation of the file, on disk and in memory, and each field of the header and of the table broken on its
+	// own. None of them may open, none of them may read out of bounds (run under ASan).
+	void TestCorruption(const std::string& path)
+	{
+		const Source source = MakeSource(64, 16, 1, true, 6);
+		const std::vector<uint8_t> bytes = BuildCookedTexture(kSourceHash, source.desc, source.subresources);
+
+		for (size_t size = 0; size < bytes.size(); ++size)
+		{
+			const std::vector<uint8_t> truncated(bytes.begin(), bytes.begin() + size);
+			CookedTextureFile loaded;
+			RH_CHECK(!loaded.Load(std::vector<uint8_t>(truncated)));
+			if (size % 61 == 0 || size + 1 == bytes.size())
+			{
+				RH_CHECK(WriteCookedTexture(path, truncated));
+				CookedTextureFile mapped;
+				RH_CHECK(!mapped.Open(path, kSourceHash));
+			}
+		}
+
+		auto Corrupt = [&](const std::function<void(CookedTextureHeader&, CookedSubresource*)>& modify)
+		{
+			std::vector<uint8_t> corrupted = bytes;
+			CookedTextureHeader header;
+			std::memcpy(&header, corrupted.data(), sizeof(header));
+			CookedSubresource* table = reinterpret_cast<CookedSubresource*>(corrupted.data() + header.subresourceOffset);
+			modify(header, table);
+			std::memcpy(corrupted.data(), &header, sizeof(header));
+
+			CookedTextureFile loaded;
+			RH_CHECK(!loaded.Load(std::vector<uint8_t>(corrupted)));
+			RH_CHECK(WriteCookedTexture(path, corrupted));
+			CookedTextureFile mapped;
+			RH_CHECK(!mapped.Open(path, kSourceHash));
+		};
+		Corrupt([](CookedTextureHeader& h, CookedSubresource*) { h.magic = 0x58455453; });
+		Corrupt([](CookedTextureHeader& h, CookedSubresource*) { h.version = kCookedTextureVersion + 1; });
+		Corrupt([](CookedTextureHeader& h, CookedSubresource*) { h.width = 0; });
+		Corrupt([](CookedTextureHeader& h, CookedSubresource*) { h.height = 0; });
+		Corrupt([](CookedTextureHeader& h, CookedSubresource*) { h.arraySize = 0; });
+		Corrupt([](CookedTextureHeader& h, CookedSubresource*) { h.mipLevels = 0x10000; });
+		Corrupt([](CookedTextureHeader& h, CookedSubresource*) { h.arraySize = 0x10000; h.mipLevels = 0x10000; });
+		Corrupt([](CookedTextureHeader& h, CookedSubresource*) { h.arraySize = 6; h.mipLevels = 32; });
+		Corrupt([](CookedTextureHeader& h, CookedSubresource*) { h.flags |= kCookedTextureCubemap; });
+		Corrupt([](CookedTextureHeader& h, CookedSubresource*) { h.subresourceOffset = ~0ull - 7; });
+		Corrupt([](CookedTextureHeader& h, CookedSubresource*) { h.subresourceOffset += 4; });
+		Corrupt([](CookedTextureHeader& h, CookedSubresource*) { h.payloadOffset += 16; });
+		Corrupt([](CookedTextureHeader& h, CookedSubresource*) { h.payloadOffset = ~0ull - 511; });
+		Corrupt([](CookedTextureHeader& h, CookedSubresource*) { h.payloadSize += 1; });
+		Corrupt([](CookedTextureHeader& h, CookedSubresource*) { h.payloadSize = ~0ull; });
+		Corrupt([](CookedTextureHeader&, CookedSubresource* t) { t[0].offset += 256; });
+		Corrupt([](CookedTextureHeader&, CookedSubresource* t) { t[1].offset = ~0ull - 511; });
+		Corrupt([](CookedTextureHeader&, CookedSubresource* t) { t[0].rowPitch += 16; });
+		Corrupt([](CookedTextureHeader&, CookedSubresource* t) { t[2].rowBytes = t[2].rowPitch + 1; });
+		Corrupt([](CookedTextureHeader&, CookedSubresource* t) { t[6].rowCount += 1; });
+		Corrupt([](CookedTextureHeader&, CookedSubresource* t) { t[3].rowCount = 0xffffffff; t[3].rowPitch = 0xffffff00; });
+
+		// A failed open drops the texture that was open before
+		CookedTextureFile file;
+		RH_CHECK(file.Load(std::vector<uint8_t>(bytes)));
+		RH_CHECK(!file.Open(path, kSourceHash));
+		RH_CHECK(file.Subresources().empty() && file.Payload().empty());
+	}
+}
+
+int main()
+{
+	const std::string path = (std::filesystem::temp_directory_path() / "RedHillCookedTextureTest.rhtex").string();
+	TestRoundTrip(path);
+	TestFillInPlace();
+	TestCorruption(path);
+	std::filesystem::remove(path);
+	return 0;
+}
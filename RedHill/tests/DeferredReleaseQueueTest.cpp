@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "DeferredReleaseQueue.h"
+#include "TestUtils.h"
+
+namespace
+{
+	// Stands in for a ComPtr, records in the set whether it is still alive
+	class TrackedObject
+	{
+	public:
+		TrackedObject(std::set<int>& alive, const int id) : m_alive(&alive), m_id(id) { alive.insert(id); }
+		TrackedObject(TrackedObject&& other) noexcept : m_alive(other.m_alive), m_id(other.m_id) { other.m_alive = nullptr; }
+		TrackedObject& operator=(TrackedObject&& other) noexcept
+		{
+			Reset();
+			m_alive = std::exchange(other.m_alive, nullptr);
+			m_id = other.m_id;
+			return *this;
+		}
+		~TrackedObject() { Reset(); }
+
+	private:
+		void Reset()
+		{
+			if (m_alive)
+			{
+				m_alive->erase(m_id);
+				m_alive = nullptr;
+			}
+		}
+
+		std::set<int>* m_alive;
+		int m_id;
+	};
+
+	// A fake fence completing the frames zero to two frames late. Every object lives until the first Release that sees
+	// its fence value completed, not one call longer, and the bytes of every category add up.
+	void TestFakeFence()
+	{
+		std::set<int> alive;
+		{
+			DeferredReleaseQueue<TrackedObject> queue;
+			std::mt19937 random(3);
+			std::vector<std::pair<int, uint64_t>> retired;
+			uint64_t retiredBytes[static_cast<uint32_t>(ReleaseCategory::Count)] = {};
+			uint64_t nextFenceValue = 1, completed = 0;
+			int nextId = 0;
+
+			for (int frame = 0; frame < 20000; ++frame)
+			{
+				const uint32_t count = random() % 4;
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					const ReleaseCategory category = static_cast<ReleaseCategory>(random() % static_cast<uint32_t>(ReleaseCategory::Count));
+					const uint64_t bytes = random() % 100000;
+					queue.Retire(TrackedObject(alive, nextId), category, bytes, nextFenceValue);
+					retired.push_back({ nextId++, nextFenceValue });
+					retiredBytes[static_cast<uint32_t>(category)] += bytes;
+				}
+
+				++nextFenceValue;
+				const uint64_t reached = nextFenceValue - 1 - random() % 3;
+				completed = (std::max)(completed, reached);
+				queue.Release(completed);
+
+				for (const auto& [id, fenceValue] : retired)
+				{
+					RH_CHECK((alive.count(id) != 0) == (fenceValue > completed));
+				}
+				std::erase_if(retired, [completed](const std::pair<int, uint64_t>& entry) { return entry.second <= completed; });
+			}
+
+			uint32_t pendingCount = 0;
+			for (uint32_t category = 0; category < static_cast<uint32_t>(ReleaseCategory::Count); ++category)
+			{
+				const auto& stats = queue.Stats(static_cast<ReleaseCategory>(category));
+				RH_CHECK(stats.pendingBytes + stats.releasedBytes == retiredBytes[category]);
+				pendingCount += stats.pendingCount;
+			}
+			RH_CHECK(pendingCount == queue.PendingCount());
+			RH_CHECK(alive.size() == queue.PendingCount());
+		}
+		// The queue releases what is left when destroyed
+		RH_CHECK(alive.empty());
+	}
+
+	// A fence value smaller than the previous one keeps the object until that previous value
+	void TestOutOfOrderFence()
+	{
+		std::set<int> alive;
+		DeferredReleaseQueue<TrackedObject> queue;
+		queue.Retire(TrackedObject(alive, 0), ReleaseCategory::Texture, 100, 10);
+		queue.Retire(TrackedObject(alive, 1), ReleaseCategory::Scratch, 10, 5);
+
+		RH_CHECK(queue.Release(5) == 0);
+		RH_CHECK(alive.count(1) == 1);
+		RH_CHECK(queue.Stats(ReleaseCategory::Scratch).pendingBytes == 10);
+
+		RH_CHECK(queue.Release(10) == 2);
+		RH_CHECK(alive.empty());
+		RH_CHECK(queue.Stats(ReleaseCategory::Texture).releasedBytes == 100);
+		RH_CHECK(queue.Stats(ReleaseCategory::Scratch).releasedCount == 1);
+		RH_CHECK(queue.PendingCount() == 0);
+	}
+}
+
+int main()
+{
+	TestFakeFence();
+	TestOutOfOrderFence();
+	return 0;
+}
@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "DescriptorRangeAllocator.h"
+#include "TestUtils.h"
+
+namespace
+{
+	using Range = DescriptorRangeAllocator::Range;
+
+	bool IsValid(const Range& range)
+	{
+		return range.slot != DescriptorRangeAllocator::kInvalidSlot;
+	}
+
+	void TestBasics()
+	{
+		DescriptorRangeAllocator allocator;
+		allocator.Init(30);
+
+		const Range table = allocator.Allocate(4);
+		RH_CHECK(IsValid(table) && table.offset == 0 && table.count == 4);
+		const Range single = allocator.Allocate(1);
+		RH_CHECK(single.offset == 4);
+		RH_CHECK(!IsValid(allocator.Allocate(0)));
+		RH_CHECK(!IsValid(allocator.Allocate(31)));
+
+		// A freed range is dead at once, a second free is refused
+		RH_CHECK(allocator.Free(single, 5));
+		RH_CHECK(!allocator.IsLive(single));
+		RH_CHECK(!allocator.Free(single, 5));
+
+		// Its descriptor only comes back once the fence is completed
+		const Range rest = allocator.Allocate(25);
+		RH_CHECK(rest.offset == 5);
+		RH_CHECK(!IsValid(allocator.Allocate(1)));
+		allocator.Reclaim(4);
+		RH_CHECK(!IsValid(allocator.Allocate(1)));
+		allocator.Reclaim(5);
+
+		// Same slot, new generation: the old range doesn't match the new one
+		const Range reused = allocator.Allocate(1);
+		RH_CHECK(reused.offset == 4 && reused.slot == single.slot && reused.generation != single.generation);
+		RH_CHECK(!allocator.IsLive(single));
+		RH_CHECK(!allocator.Free(single, 6));
+		RH_CHECK(allocator.IsLive(reused));
+
+		Range forged = table;
+		forged.count = 3;
+		RH_CHECK(!allocator.IsLive(forged));
+		forged = table;
+		forged.slot = 999;
+		RH_CHECK(!allocator.IsLive(forged));
+
+		// Everything freed merges back into one range
+		RH_CHECK(allocator.Free(table, 7));
+		RH_CHECK(allocator.Free(reused, 7));
+		RH_CHECK(allocator.Free(rest, 8));
+		allocator.Reclaim(8);
+		const DescriptorRangeAllocator::Stats stats = allocator.GetStats();
+		RH_CHECK(stats.ranges.usedBytes == 0 && stats.ranges.freeBlockCount == 1 && stats.ranges.largestFreeBlock == 30);
+		RH_CHECK(stats.liveRanges == 0 && stats.pendingDescriptors == 0);
+		RH_CHECK(allocator.Allocate(30).offset == 0);
+	}
+
+	// Random single descriptors and tables freed on a fake fence two frames behind. The live and pending ranges never
+	// overlap, the ranges freed earlier never pass as live or get freed again once their slot is reused, and the stats
+	// follow.
+	void TestFuzz(const uint32_t size, const uint32_t seed)
+	{
+		DescriptorRangeAllocator allocator;
+		allocator.Init(size);
+
+		std::mt19937 random(seed);
+		std::vector<Range> live, stale;
+		std::vector<std::pair<uint64_t, Range>> pending;
+		std::vector<bool> owned(size, false);
+		uint64_t fenceValue = 1;
+		uint32_t allocationCount = 0, failedCount = 0, sampleCount = 0;
+		double fragmentationSum = 0.0;
+
+		for (int i = 0; i < 100000; ++i)
+		{
+			const uint32_t operation = random() % 10;
+			if (operation < 5)
+			{
+				const uint32_t count = random() % 4 == 0 ? 1 + random() % 16 : 1;
+				const Range range = allocator.Allocate(count);
+				allocationCount++;
+				if (!IsValid(range))
+				{
+					failedCount++;
+					continue;
+				}
+				RH_CHECK(range.count == count && range.offset + count <= size);
+				for (uint32_t descriptor = range.offset; descriptor < range.offset + count; ++descriptor)
+				{
+					RH_CHECK(!owned[descriptor]);
+					owned[descriptor] = true;
+				}
+				live.push_back(range);
+			}
+			else if (operation < 9 && !live.empty())
+			{
+				const size_t index = random() % live.size();
+				const Range range = live[index];
+				live[index] = live.back();
+				live.pop_back();
+
+				RH_CHECK(allocator.Free(range, fenceValue));
+				RH_CHECK(!allocator.IsLive(range));
+				pending.push_back({ fenceValue, range });
+				stale.push_back(range);
+				if (stale.size() > 64)
+				{
+					stale.erase(stale.begin());
+				}
+			}
+			else
+			{
+				// End of a frame, the GPU is two frames behind
+				++fenceValue;
+				const uint64_t completed = fenceValue > 3 ? fenceValue - 3 : 0;
+				allocator.Reclaim(completed);
+				std::erase_if(pending, [&](const std::pair<uint64_t, Range>& entry)
+				{
+					if (entry.first > completed)
+					{
+						return false;
+					}
+					for (uint32_t descriptor = entry.second.offset; descriptor < entry.second.offset + entry.second.count; ++descriptor)
+					{
+						owned[descriptor] = false;
+					}
+					return true;
+				});
+
+				for (const Range& range : stale)
+				{
+					RH_CHECK(!allocator.IsLive(range));
+					RH_CHECK(!allocator.Free(range, fenceValue));
+				}
+
+				const DescriptorRangeAllocator::Stats stats = allocator.GetStats();
+				uint32_t pendingDescriptors = 0;
+				for (const auto& entry : pending)
+				{
+					pendingDescriptors += entry.second.count;
+				}
+				RH_CHECK(stats.pendingDescriptors == pendingDescriptors);
+				RH_CHECK(stats.liveRanges == live.size());
+				if (stats.ranges.usedBytes < size)
+				{
+					fragmentationSum += stats.ranges.Fragmentation();
+					sampleCount++;
+				}
+			}
+		}
+
+		const DescriptorRangeAllocator::Stats stats = allocator.GetStats();
+		std::printf("%4u descriptors: %u allocations, %.2f%% failed (heap full), peak %u, mean fragmentation %.3f\n", size, allocationCount,
+			100.0 * failedCount / allocationCount, stats.peakDescriptors, fragmentationSum / (std::max)(sampleCount, 1u));
+	}
+
+	// The persistent descriptors of the renderer (G-buffer table, material table, shadow map, BRDF LUT), then a cubemap
+	// and a prefilter view per resident environment with two of three resident, swapped a thousand times. The bump
+	// pointer this replaced needed two new descriptors per swap.
+	void TestEnvironmentSwaps()
+	{
+		DescriptorRangeAllocator allocator;
+		allocator.Init(30);
+		RH_CHECK(IsValid(allocator.Allocate(4)));
+		RH_CHECK(IsValid(allocator.Allocate(4)));
+		RH_CHECK(IsValid(allocator.Allocate(1)));
+		RH_CHECK(IsValid(allocator.Allocate(1)));
+
+		struct Environment
+		{
+			Range cubemap;
+			Range prefilter;
+			bool resident = false;
+			uint64_t lastShown = 0;
+		};
+		Environment environments[3];
+		uint64_t fenceValue = 1, shows = 0;
+
+		for (uint32_t show = 0; show <= 1000; ++show)
+		{
+			Environment& shown = environments[show % 3];
+			shown.lastShown = ++shows;
+			if (!shown.resident)
+			{
+				shown.cubemap = allocator.Allocate(1);
+				shown.prefilter = allocator.Allocate(1);
+				RH_CHECK(IsValid(shown.cubemap) && IsValid(shown.prefilter));
+				shown.resident = true;
+
+				Environment* oldest = nullptr;
+				uint32_t residentCount = 0;
+				for (Environment& environment : environments)
+				{
+					residentCount += environment.resident;
+					if (environment.resident && (!oldest || environment.lastShown < oldest->lastShown))
+					{
+						oldest = &environment;
+					}
+				}
+				if (residentCount > 2)
+				{
+					RH_CHECK(allocator.Free(oldest->cubemap, fenceValue));
+					RH_CHECK(allocator.Free(oldest->prefilter, fenceValue));
+					oldest->resident = false;
+				}
+			}
+			++fenceValue;
+			allocator.Reclaim(fenceValue - 2);
+		}
+
+		const DescriptorRangeAllocator::Stats stats = allocator.GetStats();
+		RH_CHECK(stats.peakDescriptors <= 30);
+		std::printf("1000 environment swaps: peak %u of 30 descriptors, fragmentation %.2f\n", stats.peakDescriptors, stats.ranges.Fragmentation());
+	}
+}
+
+int main()
+{
+	TestBasics();
+	TestFuzz(64, 1);
+	TestFuzz(1000, 2);
+	TestFuzz(4096, 3);
+	TestEnvironmentSwaps();
+	return 0;
+}
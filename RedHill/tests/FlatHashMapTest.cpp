@@ -0,0 +1,78 @@
+#include <map>
+#include <random>
+#include <tuple>
+
+#include "FlatHashMap.h"
+#include "ObjParser.h"
+#include "TestUtils.h"
+
+namespace
+{
+	struct IntHash
+	{
+		size_t operator()(const uint64_t key) const noexcept
+		{
+			return static_cast<size_t>(MixHash64(key));
+		}
+	};
+
+	// Grows from the default size, every key keeps its first value
+	void TestInsertAndFind()
+	{
+		FlatHashMap<uint64_t, uint32_t, IntHash> map;
+		RH_CHECK(map.Find(0) == nullptr);
+
+		for (uint32_t i = 0; i < 100000; ++i)
+		{
+			bool inserted = false;
+			RH_CHECK(map.FindOrInsert(uint64_t(i) * 7, i, inserted) == i);
+			RH_CHECK(inserted);
+		}
+		RH_CHECK(map.Size() == 100000);
+
+		for (uint32_t i = 0; i < 100000; ++i)
+		{
+			bool inserted = true;
+			RH_CHECK(map.FindOrInsert(uint64_t(i) * 7, 0, inserted) == i);
+			RH_CHECK(!inserted);
+			RH_CHECK(*map.Find(uint64_t(i) * 7) == i);
+		}
+		RH_CHECK(map.Find(3) == nullptr);
+
+		map.Clear();
+		RH_CHECK(map.Size() == 0);
+		RH_CHECK(map.Find(7) == nullptr);
+	}
+
+	// Same vertices and indices as the std::map dedup it replaced, missing attributes (-1) included
+	void TestVertexDedup()
+	{
+		std::mt19937 random(1234);
+		std::uniform_int_distribution<int32_t> attribute(-1, 300);
+
+		std::vector<ObjCorner> corners(200000);
+		for (ObjCorner& corner : corners)
+		{
+			corner = { attribute(random) + 1, attribute(random), attribute(random) };
+		}
+
+		FlatHashMap<VertexKey, uint32_t, VertexKeyHash> flat(corners.size());
+		std::map<std::tuple<int32_t, int32_t, int32_t>, uint32_t> tree;
+		for (const ObjCorner& corner : corners)
+		{
+			bool inserted = false;
+			const uint32_t index = flat.FindOrInsert({ corner.posIndex, corner.uvIndex, corner.normIndex }, static_cast<uint32_t>(tree.size()), inserted);
+			const auto result = tree.insert({ { corner.posIndex, corner.uvIndex, corner.normIndex }, static_cast<uint32_t>(tree.size()) });
+			RH_CHECK(inserted == result.second);
+			RH_CHECK(index == result.first->second);
+		}
+		RH_CHECK(flat.Size() == tree.size());
+	}
+}
+
+int main()
+{
+	TestInsertAndFind();
+	TestVertexDedup();
+	return 0;
+}
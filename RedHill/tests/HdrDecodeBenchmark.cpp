@@ -0,0 +1,132 @@
+// Time and peak memory of cooking an .hdr equirect: the old path (stbi_loadf to an RGBA32F image, copied into an
+// RGBA32F cook) against RadianceReader decoding every scanline straight into an RGBA16F or RGB9E5 cook. Synthetic RLE
+// skies of 4096x2048 and 8192x4096 are written to the temporary directory. Peak RSS is per process, so every path runs
+// in a child process of its own (the benchmark started with a path and a file).
+//
+//   HdrDecodeBenchmark
+//   HdrDecodeBenchmark stb|rgba16f|rgb9e5 file.hdr
+
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "CookedTexture.h"
+#include "HdrFixtures.h"
+#include "MappedFile.h"
+#include "RadianceHdr.h"
+#include "TestUtils.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+namespace
+{
+	constexpr uint32_t kFormatR32G32B32A32Float = 2;	// DXGI_FORMAT_R32G32B32A32_FLOAT
+
+	size_t PeakRssMB()
+	{
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters = {};
+		::GetProcessMemoryInfo(::GetCurrentProcess(), &counters, sizeof(counters));
+		return counters.PeakWorkingSetSize >> 20;
+#else
+		rusage usage = {};
+		::getrusage(RUSAGE_SELF, &usage);
+		return static_cast<size_t>(usage.ru_maxrss) >> 10;
+#endif
+	}
+
+	std::vector<uint8_t> CookWithStb(const char* file)
+	{
+		int width, height, channels;
+		float* pixels = stbi_loadf(file, &width, &height, &channels, 4);
+		RH_CHECK(pixels != nullptr);
+		CookedTextureDesc desc;
+		desc.format = kFormatR32G32B32A32Float;
+		desc.width = width;
+		desc.height = height;
+		const TextureSubresource subresource = { reinterpret_cast<const uint8_t*>(pixels), desc.width, desc.height, desc.height, desc.width * 16 };
+		std::vector<uint8_t> bytes = BuildCookedTexture(1, desc, std::span<const TextureSubresource>(&subresource, 1));
+		stbi_image_free(pixels);
+		return bytes;
+	}
+
+	// Renderer::LoadHDRTexture without the cache
+	std::vector<uint8_t> CookWithReader(const char* file, const HdrTexelFormat format)
+	{
+		MappedFile source;
+		RadianceReader reader;
+		RH_CHECK(source.Open(file) && reader.Open({ source.Data(), source.Size() }));
+		CookedTextureDesc desc;
+		desc.format = static_cast<uint32_t>(format);
+		desc.width = reader.Width();
+		desc.height = reader.Height();
+		const TextureSubresource subresource = { nullptr, desc.width, desc.height, desc.height, desc.width * HdrTexelBytes(format) };
+		std::vector<uint8_t> bytes = BuildCookedTexture(1, desc, std::span<const TextureSubresource>(&subresource, 1));
+		CookedSubresource entry;
+		RH_CHECK(reader.ReadRows(format, CookedSubresourceRows(bytes, 0, entry), entry.rowPitch, desc.height));
+		return bytes;
+	}
+
+	int RunPath(const std::string& path, const char* file)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		std::vector<uint8_t> bytes;
+		if (path == "stb")
+		{
+			bytes = CookWithStb(file);
+		}
+		else if (path == "rgba16f" || path == "rgb9e5")
+		{
+			bytes = CookWithReader(file, path == "rgb9e5" ? HdrTexelFormat::Rgb9e5 : HdrTexelFormat::Rgba16Float);
+		}
+		else
+		{
+			return 1;
+		}
+		const auto end = std::chrono::steady_clock::now();
+		std::printf("  %-8s %9.1f ms  cook %5zu MB  peak RSS %5zu MB\n", path.c_str(), std::chrono::duration<double, std::milli>(end - start).count(),
+			bytes.size() >> 20, PeakRssMB());
+		return 0;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc == 3)
+	{
+		return RunPath(argv[1], argv[2]);
+	}
+
+	for (const uint32_t width : { 4096u, 8192u })
+	{
+		const std::string file = (std::filesystem::temp_directory_path() / ("RedHillHdrDecodeBenchmark" + std::to_string(width) + ".hdr")).string();
+		{
+			const std::vector<uint8_t> hdr = MakeRadianceHdr(width, width / 2, true);
+			std::ofstream(file, std::ios::binary).write(reinterpret_cast<const char*>(hdr.data()), static_cast<std::streamsize>(hdr.size()));
+			std::printf("%u x %u RLE sky, %zu MB file\n", width, width / 2, hdr.size() >> 20);
+		}
+		std::fflush(stdout);
+		for (const char* path : { "stb", "rgba16f", "rgb9e5" })
+		{
+			std::string command = "\"";
+			command.append(argv[0]).append("\" ").append(path).append(" \"").append(file).append("\"");
+#ifdef _WIN32
+			// cmd strips the outer quotes of the line
+			command = "\"" + command + "\"";
+#endif
+			RH_CHECK(std::system(command.c_str()) == 0);
+		}
+		std::filesystem::remove(file);
+	}
+	return 0;
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+// Float RGB to an RGBE texel the way Radiance writes it (float2rgbe)
+inline void FloatToRgbe(const float r, const float g, const float b, uint8_t rgbe[4])
+{
+	const float maxValue = (std::max)({ r, g, b });
+	if (maxValue < 1e-32f)
+	{
+		rgbe[0] = rgbe[1] = rgbe[2] = rgbe[3] = 0;
+		return;
+	}
+	int exponent;
+	const float scale = std::frexp(maxValue, &exponent) * 256.0f / maxValue;
+	rgbe[0] = static_cast<uint8_t>(r * scale);
+	rgbe[1] = static_cast<uint8_t>(g * scale);
+	rgbe[2] = static_cast<uint8_t>(b * scale);
+	rgbe[3] = static_cast<uint8_t>(exponent + 128);
+}
+
+// One channel of a scanline in the adaptive RLE of the format: runs of 3 or more equal bytes as (128 + count, value),
+// everything else as (count, bytes...)
+inline void AppendRleChannel(std::vector<uint8_t>& file, const uint8_t* values, const uint32_t width)
+{
+	uint32_t x = 0;
+	while (x < width)
+	{
+		uint32_t runStart = x;
+		while (runStart + 2 < width && !(values[runStart] == values[runStart + 1] && values[runStart] == values[runStart + 2]))
+		{
+			++runStart;
+		}
+		if (runStart + 2 >= width)
+		{
+			runStart = width;
+		}
+		while (x < runStart)
+		{
+			const uint32_t count = (std::min)(runStart - x, 128u);
+			file.push_back(static_cast<uint8_t>(count));
+			file.insert(file.end(), values + x, values + x + count);
+			x += count;
+		}
+		if (runStart < width)
+		{
+			uint32_t runEnd = runStart;
+			while (runEnd < width && values[runEnd] == values[runStart])
+			{
+				++runEnd;
+			}
+			while (x < runEnd)
+			{
+				const uint32_t count = (std::min)(runEnd - x, 127u);
+				file.push_back(static_cast<uint8_t>(128 + count));
+				file.push_back(values[runStart]);
+				x += count;
+			}
+		}
+	}
+}
+
+// Radiance file of an equirect sky: a blue gradient, a sun of sunPeak, a noisy ground, rows flat or RLE encoded (RLE
+// only applies to widths 8 to 32767, the format stores the others flat)
+inline std::vector<uint8_t> MakeRadianceHdr(const uint32_t width, const uint32_t height, const bool rle, const float sunPeak = 50000.0f, const uint32_t seed = 1)
+{
+	const std::string header = "#?RADIANCE\n# RedHill test sky\nFORMAT=32-bit_rle_rgbe\n\n-Y " + std::to_string(height) + " +X " + std::to_string(width) + "\n";
+	std::vector<uint8_t> file(header.begin(), header.end());
+
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> noise(0.8f, 1.2f);
+	std::vector<uint8_t> row(static_cast<size_t>(width) * 4);
+	std::vector<uint8_t> channel(width);
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		const float v = static_cast<float>(y) / height;
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			float rgb[3];
+			if (v < 0.5f)
+			{
+				rgb[0] = 0.3f + v;
+				rgb[1] = 0.5f + v;
+				rgb[2] = 1.0f + v * 2.0f;
+			}
+			else
+			{
+				const float k = noise(random);
+				rgb[0] = 0.2f * k;
+				rgb[1] = 0.15f * k;
+				rgb[2] = 0.1f * k;
+			}
+			const float dx = (x - width * 0.3f) / width;
+			const float dy = (y - height * 0.3f) / height;
+			if (dx * dx + dy * dy < 1e-4f)
+			{
+				rgb[0] = sunPeak;
+				rgb[1] = sunPeak * 0.9f;
+				rgb[2] = sunPeak * 0.8f;
+			}
+			FloatToRgbe(rgb[0], rgb[1], rgb[2], &row[x * 4]);
+		}
+
+		if (!rle || width < 8 || width > 0x7fff)
+		{
+			file.insert(file.end(), row.begin(), row.end());
+			continue;
+		}
+		file.insert(file.end(), { 2, 2, static_cast<uint8_t>(width >> 8), static_cast<uint8_t>(width & 0xff) });
+		for (uint32_t c = 0; c < 4; ++c)
+		{
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				channel[x] = row[x * 4 + c];
+			}
+			AppendRleChannel(file, channel.data(), width);
+		}
+	}
+	return file;
+}
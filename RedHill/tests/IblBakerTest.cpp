@@ -0,0 +1,192 @@
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include "CookedTexture.h"
+#include "HdrFixtures.h"
+#include "HalfFloat.h"
+#include "IblBaker.h"
+#include "MappedFile.h"
+#include "TestUtils.h"
+
+namespace
+{
+	constexpr float kColor[4] = { 0.5f, 0.25f, 2.0f, 1.0f };
+
+	// Every texel of every mip of the cubemap is the color of a constant environment
+	void CheckConstant(const FloatCubemap& cubemap, const float tolerance)
+	{
+		for (uint32_t mip = 0; mip < cubemap.mipLevels; ++mip)
+		{
+			for (uint32_t face = 0; face < 6; ++face)
+			{
+				const float* texels = cubemap.Face(mip, face);
+				for (uint32_t i = 0; i < cubemap.MipSize(mip) * cubemap.MipSize(mip); ++i)
+				{
+					for (uint32_t channel = 0; channel < 3; ++channel)
+					{
+						RH_CHECK(std::fabs(texels[i * 4 + channel] - kColor[channel]) <= tolerance);
+					}
+				}
+			}
+		}
+	}
+
+	// A constant environment stays constant through the cubemap bake, the box mips and the prefilter
+	void TestConstantEnvironment(FloatCubemap& environment)
+	{
+		const uint32_t width = 64, height = 32;
+		std::vector<uint16_t> texels(width * height * 4);
+		for (size_t i = 0; i < texels.size(); ++i)
+		{
+			texels[i] = FloatToHalf(kColor[i % 4]);
+		}
+
+		environment = BakeEnvironmentCubemap(reinterpret_cast<const uint8_t*>(texels.data()), HdrTexelFormat::Rgba16Float, width, height,
+			width * 8, 16, 5);
+		RH_CHECK(environment.size == 16 && environment.mipLevels == 5 && environment.levels.size() == 5);
+		CheckConstant(environment, 1e-5f);
+
+		const FloatCubemap prefiltered = PrefilterEnvironmentCubemap(environment, 8, 4);
+		RH_CHECK(prefiltered.size == 8 && prefiltered.mipLevels == 4);
+		CheckConstant(prefiltered, 1e-4f);
+	}
+
+	// Scale and bias of the split sum stay in [0, 1], a smooth surface seen head on reflects everything
+	void TestBrdfLut()
+	{
+		const uint32_t size = 32;
+		const std::vector<float> lut = IntegrateBrdfLut(size);
+		RH_CHECK(lut.size() == size * size * 2);
+		for (uint32_t i = 0; i < size * size; ++i)
+		{
+			RH_CHECK(std::isfinite(lut[i * 2]) && std::isfinite(lut[i * 2 + 1]));
+			RH_CHECK(lut[i * 2] >= 0.0f && lut[i * 2 + 1] >= 0.0f && lut[i * 2] + lut[i * 2 + 1] <= 1.001f);
+		}
+		const float* headOnSmooth = &lut[(size - 1) * 2];
+		RH_CHECK(headOnSmooth[0] + headOnSmooth[1] > 0.95f);
+	}
+
+	// The cooked cubemap goes through the file and the mmap path of MappedFile and comes back with its layout
+	void TestCookedRoundTrip(const FloatCubemap& environment)
+	{
+		const std::vector<uint8_t> bytes = CookCubemap(environment, 1234);
+		const std::string path = (std::filesystem::temp_directory_path() / "RedHillIblBakerTest.rhtex").string();
+		RH_CHECK(WriteCookedTexture(path, bytes));
+		RH_CHECK(HashFileContents(path) == HashBytes(bytes.data(), bytes.size()));
+
+		{
+			CookedTextureFile cooked;
+			RH_CHECK(!cooked.Open(path, 4321));
+			RH_CHECK(cooked.Open(path, 1234));
+			RH_CHECK(cooked.IsMapped());
+			RH_CHECK(cooked.Header().format == kIblCubemapFormat);
+			RH_CHECK(cooked.Header().flags & kCookedTextureCubemap);
+			RH_CHECK(cooked.Header().width == 16 && cooked.Header().arraySize == 6 && cooked.Header().mipLevels == 5);
+			RH_CHECK(cooked.Subresources().size() == 6 * 5);
+
+			const CookedSubresource& first = cooked.Subresources()[0];
+			const uint16_t* texel = reinterpret_cast<const uint16_t*>(cooked.Payload().data() + first.offset);
+			RH_CHECK(HalfToFloat(texel[0]) == kColor[0] && HalfToFloat(texel[2]) == kColor[2]);
+		}
+
+		std::filesystem::remove(path);
+		MappedFile missing;
+		RH_CHECK(!missing.Open(path));
+		RH_CHECK(HashFileContents(path) == 0);
+	}
+
+	// Each input of the cache keys on its own changes the key, and only the keys that depend on it. The shaders are
+	// read from Shaders/ under the working directory, the test works in a copy of them.
+	void TestCacheKeys()
+	{
+		const std::filesystem::path previous = std::filesystem::current_path();
+		const std::filesystem::path directory = std::filesystem::temp_directory_path() / "RedHillIblCacheKeyTest";
+		std::filesystem::remove_all(directory);
+		std::filesystem::create_directories(directory);
+		std::filesystem::copy(REDHILL_RESOURCES "/../Shaders", directory / "Shaders");
+		std::filesystem::current_path(directory);
+
+		auto WriteFile = [](const std::string& path, const std::vector<uint8_t>& bytes)
+		{
+			std::ofstream file(path, std::ios::binary | std::ios::trunc);
+			file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+			RH_CHECK(static_cast<bool>(file));
+		};
+		auto ReadFile = [](const std::string& path)
+		{
+			std::ifstream file(path, std::ios::binary);
+			return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		};
+
+		const std::string hdrFile = "sky.hdr";
+		std::vector<uint8_t> hdr = MakeRadianceHdr(64, 32, true);
+		WriteFile(hdrFile, hdr);
+		const IblBakeSettings settings;
+		const uint64_t environmentKey = EnvironmentCacheKey(hdrFile, settings);
+		const uint64_t lutKey = BrdfLutCacheKey(kBrdfLutSize);
+		RH_CHECK(EnvironmentCacheKey(hdrFile, settings) == environmentKey);
+		RH_CHECK(BrdfLutCacheKey() == lutKey);
+
+		// One byte of the HDR, anywhere in the file
+		for (const size_t offset : { size_t(0), hdr.size() / 2, hdr.size() - 1 })
+		{
+			hdr[offset] ^= 1;
+			WriteFile(hdrFile, hdr);
+			RH_CHECK(EnvironmentCacheKey(hdrFile, settings) != environmentKey);
+			RH_CHECK(BrdfLutCacheKey(kBrdfLutSize) == lutKey);
+			hdr[offset] ^= 1;
+		}
+		WriteFile(hdrFile, hdr);
+		RH_CHECK(EnvironmentCacheKey(hdrFile, settings) == environmentKey);
+		RH_CHECK(EnvironmentCacheKey("missing.hdr", settings) != environmentKey);
+
+		// Every bake setting
+		uint32_t IblBakeSettings::* const sizes[] = { &IblBakeSettings::cubemapSize, &IblBakeSettings::cubemapMips, &IblBakeSettings::prefilterSize, &IblBakeSettings::prefilterMips };
+		for (uint32_t IblBakeSettings::* const size : sizes)
+		{
+			IblBakeSettings changed = settings;
+			changed.*size /= 2;
+			RH_CHECK(EnvironmentCacheKey(hdrFile, changed) != environmentKey);
+		}
+		IblBakeSettings sharedExponent = settings;
+		sharedExponent.sharedExponentEquirect = !settings.sharedExponentEquirect;
+		RH_CHECK(EnvironmentCacheKey(hdrFile, sharedExponent) != environmentKey);
+		RH_CHECK(BrdfLutCacheKey(kBrdfLutSize / 2) != lutKey);
+
+		// Every shader the bakes follow, a change to the LUT shader leaves the environments alone and the other way around
+		const std::pair<const char*, bool> shaders[] = { { "Shaders/Fullscreen.hlsli", false }, { "Shaders/BakeCubemapShader.hlsl", false },
+			{ "Shaders/MipDownsample.hlsl", false }, { "Shaders/PrefilterBake.hlsl", false }, { "Shaders/Brdflut.hlsl", true } };
+		for (const auto& [shader, lut] : shaders)
+		{
+			const std::vector<uint8_t> source = ReadFile(shader);
+			RH_CHECK(!source.empty());
+			std::vector<uint8_t> edited = source;
+			edited.push_back('\n');
+			WriteFile(shader, edited);
+			RH_CHECK((EnvironmentCacheKey(hdrFile, settings) != environmentKey) == !lut);
+			RH_CHECK((BrdfLutCacheKey(kBrdfLutSize) != lutKey) == lut);
+			WriteFile(shader, source);
+		}
+		RH_CHECK(EnvironmentCacheKey(hdrFile, settings) == environmentKey && BrdfLutCacheKey(kBrdfLutSize) == lutKey);
+
+		// The files of an environment don't collide with each other or with another environment
+		RH_CHECK(IblCachePath("a/sky.hdr", ".cubemap.rhtex") != IblCachePath("a/sky.hdr", ".prefilter.rhtex"));
+		RH_CHECK(IblCachePath("a/sky.hdr", ".cubemap.rhtex") != IblCachePath("a/night.hdr", ".cubemap.rhtex"));
+
+		std::filesystem::current_path(previous);
+		std::filesystem::remove_all(directory);
+	}
+}
+
+int main()
+{
+	FloatCubemap environment;
+	TestConstantEnvironment(environment);
+	TestBrdfLut();
+	TestCookedRoundTrip(environment);
+	TestCacheKeys();
+	return 0;
+}
@@ -0,0 +1,89 @@
+// Startup cost of one environment with a cold and a warm IBL cache, with the map sizes of the renderer. Cold is the CPU
+// bake path of a miss: the .hdr decoded to RGB9E5, the SH projected, the cubemap and the prefiltered cubemap baked,
+// cooked and written to the cache. Warm is the hit: the key, the two cooks mapped and the SH read. The GPU upload of
+// either is left out. Runs in a temporary directory with a copy of the bake shaders (they are part of the key).
+//
+//   IblCacheBenchmark [equirect width, 2048 by default]
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+#include "CookedTexture.h"
+#include "HdrFixtures.h"
+#include "IblBaker.h"
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "RadianceHdr.h"
+#include "SphericalHarmonics.h"
+#include "TestUtils.h"
+
+namespace
+{
+	const std::string kHdrFile = "sky.hdr";
+
+	IblBakeSettings Settings()
+	{
+		IblBakeSettings settings;
+		settings.sharedExponentEquirect = true;
+		return settings;
+	}
+
+	void ColdStart()
+	{
+		const uint64_t key = EnvironmentCacheKey(kHdrFile, Settings());
+
+		MappedFile source;
+		RadianceReader reader;
+		RH_CHECK(source.Open(kHdrFile) && reader.Open({ source.Data(), source.Size() }));
+		const uint32_t rowPitch = reader.Width() * HdrTexelBytes(HdrTexelFormat::Rgb9e5);
+		std::vector<uint8_t> equirect(static_cast<size_t>(rowPitch) * reader.Height());
+		RH_CHECK(reader.ReadRows(HdrTexelFormat::Rgb9e5, equirect.data(), rowPitch, reader.Height()));
+
+		const IrradianceSH sh = ProjectIrradianceSH(equirect.data(), HdrTexelFormat::Rgb9e5, reader.Width(), reader.Height(), rowPitch);
+		const FloatCubemap cubemap = BakeEnvironmentCubemap(equirect.data(), HdrTexelFormat::Rgb9e5, reader.Width(), reader.Height(), rowPitch, kCubemapSize, kCubemapMips);
+		const FloatCubemap prefilter = PrefilterEnvironmentCubemap(cubemap, kPrefilterSize, kPrefilterMips);
+		RH_CHECK(WriteCookedTexture(IblCachePath(kHdrFile, ".cubemap.rhtex"), CookCubemap(cubemap, key)));
+		RH_CHECK(WriteCookedTexture(IblCachePath(kHdrFile, ".prefilter.rhtex"), CookCubemap(prefilter, key)));
+		RH_CHECK(WriteIrradianceSH(IblCachePath(kHdrFile, ".irradiance.rhsh"), key, sh));
+	}
+
+	size_t WarmStart()
+	{
+		const uint64_t key = EnvironmentCacheKey(kHdrFile, Settings());
+		CookedTextureFile cubemap;
+		CookedTextureFile prefilter;
+		IrradianceSH sh;
+		RH_CHECK(cubemap.Open(IblCachePath(kHdrFile, ".cubemap.rhtex"), key));
+		RH_CHECK(prefilter.Open(IblCachePath(kHdrFile, ".prefilter.rhtex"), key));
+		RH_CHECK(ReadIrradianceSH(IblCachePath(kHdrFile, ".irradiance.rhsh"), key, sh));
+		return cubemap.Payload().size() + prefilter.Payload().size();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const uint32_t width = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 2048;
+	const std::filesystem::path previous = std::filesystem::current_path();
+	const std::filesystem::path directory = std::filesystem::temp_directory_path() / "RedHillIblCacheBenchmark";
+	std::filesystem::remove_all(directory);
+	std::filesystem::create_directories(directory);
+	std::filesystem::copy(REDHILL_RESOURCES "/../Shaders", directory / "Shaders");
+	std::filesystem::current_path(directory);
+
+	const std::vector<uint8_t> hdr = MakeRadianceHdr(width, width / 2, true);
+	std::ofstream(kHdrFile, std::ios::binary).write(reinterpret_cast<const char*>(hdr.data()), static_cast<std::streamsize>(hdr.size()));
+
+	std::printf("Job system threads: %u, %u x %u equirect, cubemap %u (%u mips), prefilter %u (%u mips)\n", JobSystem::Get().ThreadCount(),
+		width, width / 2, kCubemapSize, kCubemapMips, kPrefilterSize, kPrefilterMips);
+	const double coldMs = MeasureMs(1, ColdStart);
+	size_t mappedBytes = 0;
+	const double warmMs = MeasureMs(10, [&mappedBytes]() { mappedBytes = WarmStart(); });
+	const std::string warm = "Warm cache (key, map " + std::to_string(mappedBytes / 1024) + " KB)";
+	std::printf("%-40s %10.2f ms\n", "Cold cache (decode, bake, cook, write)", coldMs);
+	std::printf("%-40s %10.2f ms  %6.0fx faster\n", warm.c_str(), warmMs, coldMs / warmMs);
+
+	std::filesystem::current_path(previous);
+	std::filesystem::remove_all(directory);
+	return 0;
+}
@@ -0,0 +1,29 @@
+// Icosphere generation time for 0 to 8 subdivisions, every level below included as a LOD like the grid spheres. The
+// logs of GenerateIcosphere go to stderr.
+//
+//   IcosphereBenchmark 2>/dev/null
+
+#include <cstdio>
+#include <vector>
+
+#include "Icosphere.h"
+#include "TestUtils.h"
+
+int main()
+{
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<MeshLod> lods;
+	for (uint32_t subdivisions = 0; subdivisions <= 8; ++subdivisions)
+	{
+		const int repeatCount = subdivisions < 6 ? 50 : 5;
+		const double ms = MeasureMs(repeatCount, [&]()
+		{
+			GenerateIcosphere(subdivisions, vertices, indices, lods);
+		});
+		const size_t triangleCount = indices.size() / 3;
+		std::printf("%u subdivisions: %9zu vertices %9zu triangles (all levels) %10.3f ms %8.1f Mtri/s\n", subdivisions,
+			vertices.size(), triangleCount, ms, triangleCount / (ms * 1000.0));
+	}
+	return 0;
+}
@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include "Icosphere.h"
+#include "TestUtils.h"
+
+namespace
+{
+	void CheckLevel(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const MeshLod& lod, const uint32_t level)
+	{
+		// Closed form sizes of the level
+		const size_t triangleCount = static_cast<size_t>(20) << (2 * level);
+		RH_CHECK(lod.indexCount == triangleCount * 3);
+		RH_CHECK(lod.vertexCount == (static_cast<size_t>(10) << (2 * level)) + 2);
+
+		// Every edge is used by exactly two triangles, once in each direction. A midpoint added twice would leave both
+		// copies with a single triangle on each side of the edge and break this.
+		std::vector<uint64_t> halfEdges;
+		halfEdges.reserve(lod.indexCount);
+		std::vector<bool> used(lod.vertexCount, false);
+		float maxDeviation = 0.0f;
+		for (uint32_t i = lod.indexOffset; i < lod.indexOffset + lod.indexCount; i += 3)
+		{
+			const uint32_t t[3] = { indices[i], indices[i + 1], indices[i + 2] };
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				RH_CHECK(t[corner] < lod.vertexCount);
+				used[t[corner]] = true;
+				halfEdges.push_back(static_cast<uint64_t>(t[corner]) << 32 | t[(corner + 1) % 3]);
+			}
+
+			// Facing outwards
+			const float* a = vertices[t[0]].position;
+			const float* b = vertices[t[1]].position;
+			const float* c = vertices[t[2]].position;
+			const float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			const float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+			const float normal[3] = { ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0] };
+			const float center[3] = { a[0] + b[0] + c[0], a[1] + b[1] + c[1], a[2] + b[2] + c[2] };
+			RH_CHECK(normal[0] * center[0] + normal[1] * center[1] + normal[2] * center[2] > 0.0f);
+
+			// Distance from the unit sphere over a grid of points of the triangle
+			constexpr int kSteps = 8;
+			for (int u = 0; u <= kSteps; ++u)
+			{
+				for (int v = 0; u + v <= kSteps; ++v)
+				{
+					const float fu = static_cast<float>(u) / kSteps, fv = static_cast<float>(v) / kSteps;
+					const float x[3] = { a[0] + ab[0] * fu + ac[0] * fv, a[1] + ab[1] * fu + ac[1] * fv, a[2] + ab[2] * fu + ac[2] * fv };
+					maxDeviation = (std::max)(maxDeviation, 1.0f - std::sqrt(x[0] * x[0] + x[1] * x[1] + x[2] * x[2]));
+				}
+			}
+		}
+		RH_CHECK(std::all_of(used.begin(), used.end(), [](const bool u) { return u; }));
+
+		// The error of the level bounds the triangles and is not far above what the samples find
+		RH_CHECK(maxDeviation <= lod.error * 1.001f + 1e-6f);
+		RH_CHECK(lod.error <= maxDeviation * 1.05f + 1e-6f);
+
+		std::sort(halfEdges.begin(), halfEdges.end());
+		RH_CHECK(std::adjacent_find(halfEdges.begin(), halfEdges.end()) == halfEdges.end());
+		for (const uint64_t edge : halfEdges)
+		{
+			const uint64_t twin = (edge & 0xFFFFFFFFull) << 32 | edge >> 32;
+			RH_CHECK(std::binary_search(halfEdges.begin(), halfEdges.end(), twin));
+		}
+
+		// No two vertices of the level in the same place
+		std::vector<std::array<float, 3>> positions(lod.vertexCount);
+		for (uint32_t i = 0; i < lod.vertexCount; ++i)
+		{
+			std::copy_n(vertices[i].position, 3, positions[i].begin());
+		}
+		std::sort(positions.begin(), positions.end());
+		RH_CHECK(std::adjacent_find(positions.begin(), positions.end()) == positions.end());
+	}
+
+	void TestIcosphere(const uint32_t subdivisions)
+	{
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		std::vector<MeshLod> lods;
+		GenerateIcosphere(subdivisions, vertices, indices, lods);
+
+		RH_CHECK(lods.size() == subdivisions + 1);
+		RH_CHECK(vertices.size() == lods.back().vertexCount);
+		RH_CHECK(indices.size() == static_cast<size_t>(lods.back().indexOffset) + lods.back().indexCount);
+
+		// Unit sphere, the normal is the position
+		for (const Vertex& v : vertices)
+		{
+			const float length = std::sqrt(v.position[0] * v.position[0] + v.position[1] * v.position[1] + v.position[2] * v.position[2]);
+			RH_CHECK(std::fabs(length - 1.0f) < 1e-5f);
+			RH_CHECK(std::equal(v.position, v.position + 3, v.normal));
+		}
+
+		uint32_t indexOffset = 0;
+		for (uint32_t level = 0; level <= subdivisions; ++level)
+		{
+			const MeshLod& lod = lods[level];
+			RH_CHECK(lod.indexOffset == indexOffset);
+			indexOffset += lod.indexCount;
+			if (level > 0)
+			{
+				RH_CHECK(lod.error < lods[level - 1].error);
+			}
+			CheckLevel(vertices, indices, lod, level);
+		}
+	}
+}
+
+int main()
+{
+	TestIcosphere(0);
+	TestIcosphere(6);
+	return 0;
+}
@@ -0,0 +1,107 @@
+// Wall-clock of the asset import done at init (the five Helmet textures decoded with stb_image, Helmet.obj parsed and
+// deduplicated, its tangents generated) run serially and fanned out on a job system of every thread count up to the
+// cores of the machine. Every stage runs single threaded inside its job so the numbers only show the fan-out, then
+// the raw cost of small jobs and of a ParallelFor is measured for the same thread counts.
+//
+//   JobSystemBenchmark
+
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "JobSystem.h"
+#include "MeshFixtures.h"
+#include "TangentSpace.h"
+#include "TestUtils.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+namespace
+{
+	const char* kTextures[] = { "Default_albedo.jpg", "Default_normal.jpg", "Default_metalRoughness.jpg", "Default_AO.jpg", "Default_emissive.jpg" };
+	constexpr int kTextureCount = sizeof(kTextures) / sizeof(kTextures[0]);
+
+	void DecodeTexture(const int index)
+	{
+		int width, height, channels;
+		stbi_uc* pixels = stbi_load((std::string(REDHILL_RESOURCES "/") + kTextures[index]).c_str(), &width, &height, &channels, 4);
+		RH_CHECK(pixels != nullptr);
+		stbi_image_free(pixels);
+	}
+
+	void ImportMesh()
+	{
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		RH_CHECK(LoadObjMesh(REDHILL_RESOURCES "/Helmet.obj", vertices, indices, 1));
+		GenerateTangents(vertices, indices, 1);
+	}
+
+	// Mesh first, it is the longest job
+	void ImportAssets(JobSystem& jobs)
+	{
+		JobCounter counter;
+		jobs.Run(ImportMesh, &counter);
+		for (int i = 0; i < kTextureCount; ++i)
+		{
+			jobs.Run([i]() { DecodeTexture(i); }, &counter);
+		}
+		jobs.Wait(counter);
+	}
+}
+
+int main()
+{
+	const uint32_t maxThreads = (std::max)(1u, std::thread::hardware_concurrency());
+	std::printf("Hardware threads: %u\n", maxThreads);
+
+	const double serialMs = MeasureMs(3, []()
+	{
+		ImportMesh();
+		for (int i = 0; i < kTextureCount; ++i)
+		{
+			DecodeTexture(i);
+		}
+	});
+	std::printf("Asset import serial      %9.2f ms\n", serialMs);
+
+	for (uint32_t threadCount = 2; threadCount <= (std::max)(2u, maxThreads); threadCount *= 2)
+	{
+		JobSystem jobs(threadCount - 1);
+		const double ms = MeasureMs(3, [&jobs]() { ImportAssets(jobs); });
+		std::printf("Asset import %2u threads  %9.2f ms  %6.2fx\n", jobs.ThreadCount(), ms, serialMs / ms);
+	}
+
+	for (uint32_t threadCount = 1; threadCount <= maxThreads; threadCount *= 2)
+	{
+		JobSystem jobs(threadCount == 1 ? 0 : threadCount - 1);
+		if (jobs.ThreadCount() != threadCount)
+		{
+			continue;
+		}
+
+		constexpr int kJobCount = 100000;
+		std::atomic<int> sum = 0;
+		const double runMs = MeasureMs(5, [&]()
+		{
+			JobCounter counter;
+			for (int i = 0; i < kJobCount; ++i)
+			{
+				jobs.Run([&sum]() { sum++; }, &counter);
+			}
+			jobs.Wait(counter);
+		});
+
+		std::vector<float> values(1 << 22, 1.0f);
+		const double forMs = MeasureMs(5, [&]()
+		{
+			jobs.ParallelFor(values.size(), 4096, [&values](const size_t i) { values[i] = values[i] * 0.5f + 1.0f; });
+		});
+
+		std::printf("%2u threads  Run %6.1f ns/job  ParallelFor 4M floats %7.2f ms\n", threadCount, runMs * 1e6 / kJobCount, forMs);
+	}
+	return 0;
+}
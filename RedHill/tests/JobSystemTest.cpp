@@ -0,0 +1,147 @@
+// Stress of the job system with several worker counts: many small jobs, nested parallel fors that overflow the
+// worker deques, dependency chains, fan-in continuations and concurrent submitters. Build with
+// -DREDHILL_SANITIZE=thread to run it under TSan.
+//
+//   JobSystemTest [rounds]
+
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "JobSystem.h"
+#include "TestUtils.h"
+
+namespace
+{
+	void SmallJobs(JobSystem& jobs)
+	{
+		std::atomic<int> sum = 0;
+		JobCounter counter;
+		for (int i = 0; i < 10000; ++i)
+		{
+			jobs.Run([&sum, i]() { sum += i; }, &counter);
+		}
+		jobs.Wait(counter);
+		RH_CHECK(sum == 10000 * 9999 / 2);
+	}
+
+	// Jobs started from jobs, more of them than a deque holds (4096) so some go through the shared queue
+	void NestedParallelFor(JobSystem& jobs)
+	{
+		std::vector<std::atomic<int>> hits(64 * 300);
+		jobs.ParallelFor(64, 1, [&](const size_t i)
+		{
+			JobCounter inner;
+			for (size_t k = 0; k < 300; ++k)
+			{
+				jobs.Run([&hits, i, k]() { hits[i * 300 + k]++; }, &inner);
+			}
+			jobs.Wait(inner);
+			jobs.ParallelFor(300, 7, [&hits, i](const size_t k) { hits[i * 300 + k]++; });
+		});
+		for (const std::atomic<int>& hit : hits)
+		{
+			RH_CHECK(hit == 2);
+		}
+	}
+
+	// Every stage runs after the previous one
+	void DependencyChain(JobSystem& jobs)
+	{
+		std::vector<int> order;
+		std::mutex mutex;
+		std::vector<std::unique_ptr<JobCounter>> stages;
+		for (int stage = 0; stage < 20; ++stage)
+		{
+			stages.push_back(std::make_unique<JobCounter>());
+		}
+
+		for (int stage = 0; stage < 20; ++stage)
+		{
+			auto Record = [&order, &mutex, stage]()
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				order.push_back(stage);
+			};
+			if (stage == 0)
+			{
+				jobs.Run(Record, stages[0].get());
+			}
+			else
+			{
+				jobs.RunAfter(*stages[stage - 1], Record, stages[stage].get());
+			}
+		}
+		for (const std::unique_ptr<JobCounter>& stage : stages)
+		{
+			jobs.Wait(*stage);
+		}
+
+		RH_CHECK(order.size() == 20);
+		for (int stage = 0; stage < 20; ++stage)
+		{
+			RH_CHECK(order[stage] == stage);
+		}
+	}
+
+	// One continuation after 100 jobs, it must see all of them
+	void FanIn(JobSystem& jobs)
+	{
+		std::atomic<int> done = 0;
+		std::atomic<int> seen = -1;
+		JobCounter producers, continuation;
+		for (int i = 0; i < 100; ++i)
+		{
+			jobs.Run([&done]() { done++; }, &producers);
+		}
+		jobs.RunAfter(producers, [&done, &seen]() { seen = done.load(); }, &continuation);
+		jobs.Wait(continuation);
+		jobs.Wait(producers);
+		RH_CHECK(seen == 100);
+	}
+
+	// Threads that aren't workers submitting and waiting at the same time
+	void ExternalSubmitters()
+	{
+		JobSystem jobs(4);
+		std::atomic<int> total = 0;
+		std::vector<std::thread> threads;
+		for (int t = 0; t < 4; ++t)
+		{
+			threads.emplace_back([&jobs, &total]()
+			{
+				for (int round = 0; round < 50; ++round)
+				{
+					jobs.ParallelFor(1000, 16, [&total](size_t) { total += 1; });
+				}
+			});
+		}
+		for (std::thread& thread : threads)
+		{
+			thread.join();
+		}
+		RH_CHECK(total == 4 * 50 * 1000);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const int rounds = argc > 1 ? std::atoi(argv[1]) : 20;
+
+	for (const uint32_t workerCount : { 1u, 2u, 3u, 7u, 15u })
+	{
+		JobSystem jobs(workerCount);
+		for (int round = 0; round < rounds; ++round)
+		{
+			SmallJobs(jobs);
+			NestedParallelFor(jobs);
+			DependencyChain(jobs);
+			FanIn(jobs);
+		}
+	}
+
+	ExternalSubmitters();
+	return 0;
+}
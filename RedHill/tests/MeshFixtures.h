@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "FlatHashMap.h"
+#include "MeshTypes.h"
+#include "ObjParser.h"
+
+// Vertices and indices the way PBRMesh::GenerateVertexAndIndexFromObj builds them, before the tangents
+inline bool LoadObjMesh(const std::string& objFile, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const uint32_t threadCount = 0)
+{
+	ObjData obj;
+	std::string error;
+	if (!ObjParser::ParseFromFile(objFile, obj, error, threadCount))
+	{
+		return false;
+	}
+
+	vertices.clear();
+	indices.clear();
+	FlatHashMap<VertexKey, uint32_t, VertexKeyHash> vertexMap(obj.corners.size());
+	for (const ObjCorner& idx : obj.corners)
+	{
+		bool inserted = false;
+		const uint32_t vertexIndex = vertexMap.FindOrInsert({ idx.posIndex, idx.uvIndex, idx.normIndex }, static_cast<uint32_t>(vertices.size()), inserted);
+		if (inserted)
+		{
+			Vertex v;
+			std::copy_n(&obj.positions[3 * idx.posIndex], 3, v.position);
+			if (idx.uvIndex >= 0)
+			{
+				v.uv[0] = obj.texcoords[2 * idx.uvIndex];
+				v.uv[1] = 1.0f - obj.texcoords[2 * idx.uvIndex + 1];
+			}
+			if (idx.normIndex >= 0)
+			{
+				std::copy_n(&obj.normals[3 * idx.normIndex], 3, v.normal);
+			}
+			vertices.push_back(v);
+		}
+		indices.push_back(vertexIndex);
+	}
+	return true;
+}
+
+// islandCount bumpy grids of side * side vertices with a uv seam down the middle, their triangles shuffled together
+// so the islands are interleaved in the index buffer like in a scanned or merged asset
+inline void MakeIslandSoup(const uint32_t islandCount, const uint32_t side, const uint32_t seed, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	vertices.clear();
+	indices.clear();
+
+	std::vector<uint32_t> triangles;
+	for (uint32_t island = 0; island < islandCount; ++island)
+	{
+		const uint32_t base = static_cast<uint32_t>(vertices.size());
+		for (uint32_t y = 0; y < side; ++y)
+		{
+			for (uint32_t x = 0; x < side; ++x)
+			{
+				Vertex v;
+				const float fx = static_cast<float>(x), fy = static_cast<float>(y);
+				v.position[0] = fx + island * (side + 2.0f);
+				v.position[1] = 0.3f * std::sin(fx * 0.7f + island) * std::cos(fy * 0.4f);
+				v.position[2] = fy;
+				v.uv[0] = fx / side;
+				v.uv[1] = fy / side;
+				v.normal[1] = 1.0f;
+				vertices.push_back(v);
+			}
+		}
+
+		// Second copy of the middle column with other uvs, the triangles on the right of the seam use it
+		const uint32_t seam = static_cast<uint32_t>(vertices.size());
+		for (uint32_t y = 0; y < side; ++y)
+		{
+			Vertex v = vertices[base + y * side + side / 2];
+			v.uv[0] += 0.5f;
+			vertices.push_back(v);
+		}
+
+		for (uint32_t y = 0; y + 1 < side; ++y)
+		{
+			for (uint32_t x = 0; x + 1 < side; ++x)
+			{
+				auto Index = [&](const uint32_t vx, const uint32_t vy)
+				{
+					return (vx == side / 2 && x >= side / 2) ? seam + vy : base + vy * side + vx;
+				};
+				const uint32_t quad[6] = { Index(x, y), Index(x + 1, y), Index(x + 1, y + 1), Index(x, y), Index(x + 1, y + 1), Index(x, y + 1) };
+				triangles.insert(triangles.end(), quad, quad + 6);
+			}
+		}
+	}
+
+	std::vector<uint32_t> order(triangles.size() / 3);
+	for (uint32_t i = 0; i < order.size(); ++i)
+	{
+		order[i] = i;
+	}
+	std::shuffle(order.begin(), order.end(), std::mt19937(seed));
+	for (const uint32_t triangle : order)
+	{
+		indices.insert(indices.end(), triangles.begin() + triangle * 3, triangles.begin() + triangle * 3 + 3);
+	}
+}
@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <random>
+
+#include "MeshFixtures.h"
+#include "MeshOptimizer.h"
+#include "TestUtils.h"
+
+namespace
+{
+	// Triangles rotated so their smallest index comes first (keeps the winding) and sorted, two index buffers with the
+	// same triangles in any order give the same list
+	std::vector<std::array<uint32_t, 3>> SortedTriangles(std::span<const uint32_t> indices)
+	{
+		std::vector<std::array<uint32_t, 3>> triangles(indices.size() / 3);
+		for (size_t i = 0; i < triangles.size(); ++i)
+		{
+			const uint32_t* t = &indices[i * 3];
+			const size_t first = t[0] <= t[1] && t[0] <= t[2] ? 0 : (t[1] <= t[2] ? 1 : 2);
+			triangles[i] = { t[first], t[(first + 1) % 3], t[(first + 2) % 3] };
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	std::vector<uint32_t> ShuffleTriangles(const std::vector<uint32_t>& indices, const uint32_t seed)
+	{
+		std::vector<uint32_t> order(indices.size() / 3);
+		for (uint32_t i = 0; i < order.size(); ++i)
+		{
+			order[i] = i;
+		}
+		std::shuffle(order.begin(), order.end(), std::mt19937(seed));
+
+		std::vector<uint32_t> shuffled;
+		shuffled.reserve(indices.size());
+		for (const uint32_t triangle : order)
+		{
+			shuffled.insert(shuffled.end(), indices.begin() + triangle * 3, indices.begin() + triangle * 3 + 3);
+		}
+		return shuffled;
+	}
+
+	// Each pass on its own, then the whole OptimizeMesh: the triangles stay the same ones and the ACMR never goes up
+	void CheckOptimize(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const char* name)
+	{
+		const auto triangles = SortedTriangles(indices);
+		const VertexCacheStats source = AnalyzeVertexCache(indices, vertices.size());
+
+		std::vector<uint32_t> cache = indices;
+		OptimizeVertexCache(cache, vertices.size());
+		RH_CHECK(SortedTriangles(cache) == triangles);
+		const VertexCacheStats cacheStats = AnalyzeVertexCache(cache, vertices.size());
+		RH_CHECK(cacheStats.acmr <= source.acmr);
+
+		// The overdraw pass trades some of the cache gain for the cluster order but stays within the threshold of the
+		// cache optimized runs, so it is still no worse than the source order
+		std::vector<uint32_t> overdraw = cache;
+		OptimizeOverdraw(overdraw, vertices);
+		RH_CHECK(SortedTriangles(overdraw) == triangles);
+		const VertexCacheStats overdrawStats = AnalyzeVertexCache(overdraw, vertices.size());
+		RH_CHECK(overdrawStats.acmr <= source.acmr);
+
+		// Vertex fetch: positional remap of the same triangle sequence, vertices in first use order, unused ones dropped.
+		// An extra vertex nobody references has to go.
+		std::vector<Vertex> fetchVertices = vertices;
+		fetchVertices.push_back(Vertex{});
+		std::vector<uint32_t> fetch = overdraw;
+		OptimizeVertexFetch(fetchVertices, fetch);
+		RH_CHECK(fetch.size() == overdraw.size());
+		RH_CHECK(fetchVertices.size() <= vertices.size());
+		uint32_t nextNew = 0;
+		for (size_t i = 0; i < fetch.size(); ++i)
+		{
+			RH_CHECK(fetch[i] < fetchVertices.size());
+			RH_CHECK(std::memcmp(&fetchVertices[fetch[i]], &vertices[overdraw[i]], sizeof(Vertex)) == 0);
+			RH_CHECK(fetch[i] <= nextNew);
+			nextNew = (std::max)(nextNew, fetch[i] + 1);
+		}
+		RH_CHECK(nextNew == fetchVertices.size());
+		RH_CHECK(AnalyzeVertexCache(fetch, fetchVertices.size()).acmr == overdrawStats.acmr);
+
+		std::vector<Vertex> meshVertices = vertices;
+		std::vector<uint32_t> meshIndices = indices;
+		OptimizeMesh(meshVertices, meshIndices, name);
+		RH_CHECK(meshIndices.size() == indices.size());
+		const VertexCacheStats meshStats = AnalyzeVertexCache(meshIndices, meshVertices.size());
+		RH_CHECK(meshStats.acmr <= source.acmr);
+
+		std::printf("%-16s ACMR %.3f -> cache %.3f -> overdraw %.3f, ATVR %.3f -> %.3f\n", name,
+			source.acmr, cacheStats.acmr, overdrawStats.acmr, source.atvr, meshStats.atvr);
+	}
+
+	// A LOD range in the middle of a shared index buffer: only that range moves, and it keeps its triangles
+	void CheckIndexRange(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+	{
+		std::vector<uint32_t> buffer = indices;
+		const std::vector<uint32_t> range = ShuffleTriangles(indices, 7);
+		buffer.insert(buffer.end(), range.begin(), range.end());
+		buffer.insert(buffer.end(), indices.begin(), indices.end());
+
+		OptimizeIndexRange(std::span<uint32_t>(buffer).subspan(indices.size(), range.size()), vertices, vertices.size(), "range");
+		RH_CHECK(std::equal(indices.begin(), indices.end(), buffer.begin()));
+		RH_CHECK(std::equal(indices.begin(), indices.end(), buffer.begin() + indices.size() + range.size()));
+
+		const std::span<const uint32_t> optimized(buffer.data() + indices.size(), range.size());
+		RH_CHECK(SortedTriangles(optimized) == SortedTriangles(range));
+		const std::vector<uint32_t> optimizedCopy(optimized.begin(), optimized.end());
+		RH_CHECK(AnalyzeVertexCache(optimizedCopy, vertices.size()).acmr <= AnalyzeVertexCache(range, vertices.size()).acmr);
+	}
+
+	void TestAnalyzeVertexCache()
+	{
+		// Every triangle of a strip like fan after the first one reuses two vertices
+		std::vector<uint32_t> indices;
+		for (uint32_t i = 0; i < 10; ++i)
+		{
+			indices.insert(indices.end(), { 0, i + 1, i + 2 });
+		}
+		const VertexCacheStats fan = AnalyzeVertexCache(indices, 12);
+		RH_CHECK(fan.misses == 12);
+		RH_CHECK(fan.atvr == 1.0f);
+
+		// A cache of 3 against triangles that never share a vertex: every index misses
+		const std::vector<uint32_t> soup = { 0, 1, 2, 3, 4, 5, 6, 7, 8 };
+		RH_CHECK(AnalyzeVertexCache(soup, 9, 3).acmr == 3.0f);
+	}
+}
+
+int main()
+{
+	TestAnalyzeVertexCache();
+
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	RH_CHECK(LoadObjMesh(REDHILL_RESOURCES "/Helmet.obj", vertices, indices));
+	CheckOptimize(vertices, indices, "Helmet");
+	CheckOptimize(vertices, ShuffleTriangles(indices, 1), "Helmet shuffled");
+	CheckIndexRange(vertices, indices);
+
+	for (uint32_t seed = 0; seed < 4; ++seed)
+	{
+		MakeIslandSoup(8 + seed, 16 + seed * 4, seed, vertices, indices);
+		CheckOptimize(vertices, indices, "island soup");
+		CheckIndexRange(vertices, indices);
+	}
+	return 0;
+}
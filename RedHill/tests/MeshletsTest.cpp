@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
+
+#include "Icosphere.h"
+#include "MeshFixtures.h"
+#include "Meshlets.h"
+#include "TestUtils.h"
+
+namespace
+{
+	// Triangles rotated so their smallest index comes first (keeps the winding) and sorted
+	std::vector<std::array<uint32_t, 3>> SortedTriangles(std::span<const uint32_t> indices)
+	{
+		std::vector<std::array<uint32_t, 3>> triangles(indices.size() / 3);
+		for (size_t i = 0; i < triangles.size(); ++i)
+		{
+			const uint32_t* t = &indices[i * 3];
+			const size_t first = t[0] <= t[1] && t[0] <= t[2] ? 0 : (t[1] <= t[2] ? 1 : 2);
+			triangles[i] = { t[first], t[(first + 1) % 3], t[(first + 2) % 3] };
+		}
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	// The limits and the coverage, checked here instead of trusting ValidateMeshlets (which gets the same answer)
+	void CheckClustering(const MeshletData& data, std::span<const uint32_t> indices, const uint32_t maxVertices, const uint32_t maxTriangles)
+	{
+		RH_CHECK(data.bounds.size() == data.meshlets.size());
+
+		std::vector<uint32_t> clustered;
+		clustered.reserve(indices.size());
+		uint32_t vertexOffset = 0;
+		uint32_t triangleOffset = 0;
+		for (const Meshlet& meshlet : data.meshlets)
+		{
+			RH_CHECK(meshlet.vertexCount > 0 && meshlet.vertexCount <= maxVertices);
+			RH_CHECK(meshlet.triangleCount > 0 && meshlet.triangleCount <= maxTriangles);
+
+			// Packed back to back
+			RH_CHECK(meshlet.vertexOffset == vertexOffset && meshlet.triangleOffset == triangleOffset);
+			vertexOffset += meshlet.vertexCount;
+			triangleOffset += meshlet.triangleCount * 3;
+
+			// No mesh vertex twice in a meshlet, and every one of them used by a triangle
+			std::vector<uint32_t> meshletVertices(data.vertices.begin() + meshlet.vertexOffset, data.vertices.begin() + meshlet.vertexOffset + meshlet.vertexCount);
+			std::sort(meshletVertices.begin(), meshletVertices.end());
+			RH_CHECK(std::adjacent_find(meshletVertices.begin(), meshletVertices.end()) == meshletVertices.end());
+
+			std::vector<bool> used(meshlet.vertexCount, false);
+			for (uint32_t i = 0; i < meshlet.triangleCount * 3; ++i)
+			{
+				const uint8_t local = data.triangles[meshlet.triangleOffset + i];
+				RH_CHECK(local < meshlet.vertexCount);
+				used[local] = true;
+				clustered.push_back(data.vertices[meshlet.vertexOffset + local]);
+			}
+			RH_CHECK(std::all_of(used.begin(), used.end(), [](const bool u) { return u; }));
+		}
+		RH_CHECK(vertexOffset == data.vertices.size() && triangleOffset == data.triangles.size());
+
+		// Every triangle exactly once with its winding
+		RH_CHECK(SortedTriangles(clustered) == SortedTriangles(indices));
+		RH_CHECK(ValidateMeshlets(data, indices, maxVertices, maxTriangles));
+	}
+
+	// The bounds against brute force: the sphere and the box hold every vertex, and a viewer the cone culls sees the
+	// back of every triangle of the meshlet (no false culls). Returns the fraction of the meshlet / viewer pairs with
+	// only back faces that the cone culls.
+	float CheckBounds(const MeshletData& data, std::span<const Vertex> vertices, const uint32_t seed)
+	{
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+		size_t backFacing = 0;
+		size_t culled = 0;
+		for (size_t m = 0; m < data.meshlets.size(); ++m)
+		{
+			const Meshlet& meshlet = data.meshlets[m];
+			const MeshletBounds& bounds = data.bounds[m];
+			auto Position = [&](const uint32_t local) -> const float*
+			{
+				return vertices[data.vertices[meshlet.vertexOffset + local]].position;
+			};
+
+			for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+			{
+				const float* p = Position(i);
+				const float d[3] = { p[0] - bounds.center[0], p[1] - bounds.center[1], p[2] - bounds.center[2] };
+				RH_CHECK(std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]) <= bounds.radius * 1.0001f + 1e-6f);
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					RH_CHECK(p[axis] >= bounds.boundsMin[axis] && p[axis] <= bounds.boundsMax[axis]);
+				}
+			}
+
+			// Viewers all around the meshlet, from right next to it to far away
+			for (int viewer = 0; viewer < 64; ++viewer)
+			{
+				const float distance = bounds.radius * (0.5f + 0.25f * (viewer % 4)) * (1 << (viewer % 8));
+				float p[3];
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					p[axis] = bounds.center[axis] + unit(random) * distance;
+				}
+
+				bool allBack = true;
+				for (uint32_t t = 0; t < meshlet.triangleCount && allBack; ++t)
+				{
+					const uint8_t* triangle = &data.triangles[meshlet.triangleOffset + t * 3];
+					const float* a = Position(triangle[0]);
+					const float* b = Position(triangle[1]);
+					const float* c = Position(triangle[2]);
+					const float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+					const float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+					const float n[3] = { ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0] };
+					const float toViewer[3] = { p[0] - a[0], p[1] - a[1], p[2] - a[2] };
+					const float nLength = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+					const float vLength = std::sqrt(toViewer[0] * toViewer[0] + toViewer[1] * toViewer[1] + toViewer[2] * toViewer[2]);
+					// Viewers in the plane of a triangle see it edge on, either way is fine
+					allBack = n[0] * toViewer[0] + n[1] * toViewer[1] + n[2] * toViewer[2] <= 1e-4f * nLength * vLength;
+				}
+
+				const float toApex[3] = { bounds.coneApex[0] - p[0], bounds.coneApex[1] - p[1], bounds.coneApex[2] - p[2] };
+				const float apexLength = std::sqrt(toApex[0] * toApex[0] + toApex[1] * toApex[1] + toApex[2] * toApex[2]);
+				const bool coneCulled = bounds.coneCutoff < 1.0f && apexLength > 0.0f &&
+					(toApex[0] * bounds.coneAxis[0] + toApex[1] * bounds.coneAxis[1] + toApex[2] * bounds.coneAxis[2]) / apexLength >= bounds.coneCutoff;
+				RH_CHECK(!coneCulled || allBack);
+				backFacing += allBack ? 1 : 0;
+				culled += coneCulled ? 1 : 0;
+			}
+		}
+		return backFacing > 0 ? static_cast<float>(culled) / backFacing : 0.0f;
+	}
+
+	void CheckMesh(const char* name, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const float minCulledFraction)
+	{
+		const uint32_t limits[][2] = { { kMeshletMaxVertices, kMeshletMaxTriangles }, { 16, 8 }, { 3, 1 }, { 32, 64 }, { 255, 512 } };
+		for (const auto& limit : limits)
+		{
+			const MeshletData data = BuildMeshlets(vertices, indices, limit[0], limit[1]);
+			CheckClustering(data, indices, limit[0], limit[1]);
+			const float culledFraction = CheckBounds(data, vertices, limit[0]);
+			const MeshletStats stats = AnalyzeMeshlets(data, vertices.size(), limit[0], limit[1]);
+			std::printf("%-12s %3u / %3u: %6zu meshlets, fill %3.0f%% / %3.0f%%, %3.0f%% of the back facing views cone culled\n", name, limit[0], limit[1],
+				stats.meshletCount, stats.vertexFill * 100.0f, stats.triangleFill * 100.0f, culledFraction * 100.0f);
+			if (limit[0] == kMeshletMaxVertices)
+			{
+				RH_CHECK(culledFraction >= minCulledFraction);
+			}
+		}
+	}
+}
+
+int main()
+{
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	RH_CHECK(LoadObjMesh(REDHILL_RESOURCES "/Helmet.obj", vertices, indices));
+	CheckMesh("Helmet", vertices, indices, 0.5f);
+
+	std::vector<MeshLod> lods;
+	GenerateIcosphere(5, vertices, indices, lods);
+	indices.erase(indices.begin(), indices.begin() + lods.back().indexOffset);
+	CheckMesh("icosphere", vertices, indices, 0.8f);
+
+	MakeIslandSoup(12, 24, 3, vertices, indices);
+	CheckMesh("island soup", vertices, indices, 0.8f);
+
+	// More limits than the meshlet can take: the local indices are bytes
+	const MeshletData wide = BuildMeshlets(vertices, indices, 1000, 1000);
+	CheckClustering(wide, indices, 255, 1000);
+	return 0;
+}
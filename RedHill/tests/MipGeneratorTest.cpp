@@ -0,0 +1,175 @@
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "MipGenerator.h"
+#include "TestUtils.h"
+
+namespace
+{
+	float SrgbToLinear(const uint8_t value)
+	{
+		const double c = value / 255.0;
+		return static_cast<float>(c <= 0.04045 ? c / 12.92 : std::pow((c + 0.055) / 1.055, 2.4));
+	}
+
+	float LinearToSrgb(const double linear)
+	{
+		const double c = linear <= 0.0031308 ? linear * 12.92 : 1.055 * std::pow(linear, 1.0 / 2.4) - 0.055;
+		return static_cast<float>(c * 255.0);
+	}
+
+	std::vector<uint8_t> RandomImage(const uint32_t width, const uint32_t height, const uint32_t seed)
+	{
+		std::mt19937 random(seed);
+		std::vector<uint8_t> rgba(static_cast<size_t>(width) * height * 4);
+		for (uint8_t& value : rgba)
+		{
+			value = static_cast<uint8_t>(random());
+		}
+		return rgba;
+	}
+
+	// Sizes of every level, and each level against a double precision box filter of the level above it (the D3D
+	// footprint: odd sizes drop the last row / column)
+	void CheckChain(const std::vector<uint8_t>& rgba, const uint32_t width, const uint32_t height, const bool srgb)
+	{
+		const MipChain chain = GenerateMipChain(rgba.data(), width, height, srgb);
+		RH_CHECK(chain.levels.size() == MipLevelCount(width, height));
+		RH_CHECK(chain.levels[0].pixels == rgba.data());
+
+		size_t storageSize = 0;
+		for (uint32_t level = 0; level < chain.levels.size(); ++level)
+		{
+			const MipLevel& mip = chain.levels[level];
+			RH_CHECK(mip.width == (std::max)(1u, width >> level));
+			RH_CHECK(mip.height == (std::max)(1u, height >> level));
+			if (level > 0)
+			{
+				RH_CHECK(mip.pixels == chain.storage.data() + storageSize);
+				storageSize += static_cast<size_t>(mip.width) * mip.height * 4;
+			}
+		}
+		RH_CHECK(chain.levels.back().width == 1 && chain.levels.back().height == 1);
+		RH_CHECK(chain.storage.size() == storageSize);
+
+		for (uint32_t level = 1; level < chain.levels.size(); ++level)
+		{
+			const MipLevel& src = chain.levels[level - 1];
+			const MipLevel& dst = chain.levels[level];
+			for (uint32_t y = 0; y < dst.height; ++y)
+			{
+				const uint32_t y0 = y * 2, y1 = (std::min)(y * 2 + 1, src.height - 1);
+				for (uint32_t x = 0; x < dst.width; ++x)
+				{
+					const uint32_t x0 = x * 2, x1 = (std::min)(x * 2 + 1, src.width - 1);
+					const uint8_t* footprint[4] = { &src.pixels[(y0 * src.width + x0) * 4], &src.pixels[(y0 * src.width + x1) * 4],
+						&src.pixels[(y1 * src.width + x0) * 4], &src.pixels[(y1 * src.width + x1) * 4] };
+					for (uint32_t c = 0; c < 4; ++c)
+					{
+						const uint8_t value = dst.pixels[(y * dst.width + x) * 4 + c];
+						if (srgb && c < 3)
+						{
+							// 13 bit linear intermediates: within one step of the exact result
+							double linear = 0.0;
+							for (const uint8_t* p : footprint)
+							{
+								linear += SrgbToLinear(p[c]);
+							}
+							RH_CHECK(std::fabs(value - LinearToSrgb(linear / 4.0)) <= 1.0f);
+						}
+						else
+						{
+							const uint32_t sum = footprint[0][c] + footprint[1][c] + footprint[2][c] + footprint[3][c];
+							RH_CHECK(value == (sum + 2) / 4);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	void TestMipLevelCount()
+	{
+		RH_CHECK(MipLevelCount(1, 1) == 1);
+		RH_CHECK(MipLevelCount(2, 1) == 2);
+		RH_CHECK(MipLevelCount(256, 256) == 9);
+		RH_CHECK(MipLevelCount(257, 3) == 9);
+		RH_CHECK(MipLevelCount(1000, 1) == 10);
+		RH_CHECK(MipLevelCount(4096, 2048) == 13);
+	}
+
+	void TestRandomImages()
+	{
+		const uint32_t sizes[][2] = { { 1, 1 }, { 2, 1 }, { 1, 7 }, { 3, 3 }, { 5, 17 }, { 64, 64 }, { 257, 3 }, { 300, 77 }, { 2048, 24 } };
+		uint32_t seed = 0;
+		for (const auto& size : sizes)
+		{
+			const std::vector<uint8_t> rgba = RandomImage(size[0], size[1], ++seed);
+			CheckChain(rgba, size[0], size[1], false);
+			CheckChain(rgba, size[0], size[1], true);
+		}
+	}
+
+	// A black and white checkerboard averages to half the light: 188 in sRGB, not the 128 of a gamma space average.
+	// Alpha is coverage, it averages linearly.
+	void TestSrgbCheckerboard()
+	{
+		const uint32_t size = 64;
+		std::vector<uint8_t> rgba(size * size * 4);
+		for (uint32_t y = 0; y < size; ++y)
+		{
+			for (uint32_t x = 0; x < size; ++x)
+			{
+				const uint8_t value = (x + y) % 2 ? 255 : 0;
+				uint8_t* p = &rgba[(y * size + x) * 4];
+				p[0] = p[1] = p[2] = p[3] = value;
+			}
+		}
+
+		for (const bool srgb : { true, false })
+		{
+			const MipChain chain = GenerateMipChain(rgba.data(), size, size, srgb);
+			for (uint32_t level = 1; level < chain.levels.size(); ++level)
+			{
+				const MipLevel& mip = chain.levels[level];
+				for (uint32_t i = 0; i < mip.width * mip.height; ++i)
+				{
+					const uint8_t* p = &mip.pixels[i * 4];
+					for (uint32_t c = 0; c < 3; ++c)
+					{
+						RH_CHECK(p[c] == (srgb ? 188 : 128));
+					}
+					RH_CHECK(p[3] == 128);
+				}
+			}
+		}
+	}
+
+	// Flat colors stay flat down the chain
+	void TestConstantImage()
+	{
+		for (uint32_t value = 0; value < 256; ++value)
+		{
+			const std::vector<uint8_t> rgba(16 * 8 * 4, static_cast<uint8_t>(value));
+			for (const bool srgb : { true, false })
+			{
+				const MipChain chain = GenerateMipChain(rgba.data(), 16, 8, srgb);
+				for (uint32_t i = 0; i < chain.storage.size(); ++i)
+				{
+					RH_CHECK(chain.storage[i] == value);
+				}
+			}
+		}
+	}
+}
+
+int main()
+{
+	TestMipLevelCount();
+	TestRandomImages();
+	TestSrgbCheckerboard();
+	TestConstantImage();
+	return 0;
+}
@@ -0,0 +1,120 @@
+// OBJ parse time of tinyobj (the reference path of Model.cpp, slow float path included) and of ObjParser for every
+// thread count up to the threads of the job system, on Helmet.obj and synthetic grids. Both parse from memory, the
+// file read is left out.
+//
+//   ObjParserBenchmark [file.obj...]
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "JobSystem.h"
+#include "ObjParser.h"
+#include "TestUtils.h"
+
+#define TINYOBJLOADER_DISABLE_FAST_FLOAT
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+
+namespace
+{
+	// side * side vertices with texcoords and normals, two triangles per quad
+	std::string MakeGrid(const int side)
+	{
+		std::string text;
+		text.reserve(static_cast<size_t>(side) * side * 160);
+		char line[256];
+		for (int y = 0; y < side; ++y)
+		{
+			for (int x = 0; x < side; ++x)
+			{
+				std::snprintf(line, sizeof(line), "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn %.6f %.6f %.6f\n",
+					x * 0.01f, 0.25f * (x % 7) * (y % 5), y * 0.01f, x / float(side), y / float(side), 0.0f, 1.0f, 0.0f);
+				text += line;
+			}
+		}
+		for (int y = 0; y + 1 < side; ++y)
+		{
+			for (int x = 0; x + 1 < side; ++x)
+			{
+				const int v00 = y * side + x + 1, v10 = v00 + 1, v01 = v00 + side, v11 = v01 + 1;
+				std::snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d\nf %d/%d/%d %d/%d/%d %d/%d/%d\n",
+					v00, v00, v00, v10, v10, v10, v11, v11, v11, v00, v00, v00, v11, v11, v11, v01, v01, v01);
+				text += line;
+			}
+		}
+		return text;
+	}
+
+	void Run(const char* name, const std::string& text)
+	{
+		const int repeatCount = text.size() > 64 * 1024 * 1024 ? 1 : 5;
+
+		size_t referenceCorners = 0;
+		const double tinyObjMs = MeasureMs(repeatCount, [&]()
+		{
+			tinyobj::ObjReaderConfig config;
+			config.triangulate = true;
+			tinyobj::ObjReader reader;
+			RH_CHECK(reader.ParseFromString(text, "", config));
+			referenceCorners = reader.GetShapes().empty() ? 0 : reader.GetShapes()[0].mesh.indices.size();
+		});
+
+		std::printf("%-16s %8.1f MB  tinyobj %9.2f ms\n", name, text.size() / (1024.0 * 1024.0), tinyObjMs);
+
+		const uint32_t maxThreads = JobSystem::Get().ThreadCount();
+		for (uint32_t threadCount = 1; ; threadCount = (std::min)(threadCount * 2, maxThreads))
+		{
+			ObjData obj;
+			const double ms = MeasureMs(repeatCount, [&]()
+			{
+				obj = {};
+				std::string error;
+				RH_CHECK(ObjParser::ParseFromMemory(text.data(), text.size(), obj, error, threadCount));
+			});
+			RH_CHECK(obj.corners.size() == referenceCorners);
+
+			std::printf("%-16s %2u threads          %9.2f ms  %6.2fx\n", "", threadCount, ms, tinyObjMs / ms);
+			if (threadCount == maxThreads)
+			{
+				break;
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> files;
+	for (int i = 1; i < argc; ++i)
+	{
+		files.push_back(argv[i]);
+	}
+	if (files.empty())
+	{
+		files.push_back(REDHILL_RESOURCES "/Helmet.obj");
+	}
+
+	std::printf("Job system threads: %u\n", JobSystem::Get().ThreadCount());
+
+	for (const std::string& file : files)
+	{
+		std::ifstream stream(file, std::ios::binary);
+		if (!stream)
+		{
+			std::fprintf(stderr, "Cannot open %s\n", file.c_str());
+			return 1;
+		}
+		std::stringstream buffer;
+		buffer << stream.rdbuf();
+
+		const size_t slash = file.find_last_of("/\\");
+		Run(file.substr(slash == std::string::npos ? 0 : slash + 1).c_str(), buffer.str());
+	}
+
+	Run("grid 250k verts", MakeGrid(500));
+	Run("grid 1M verts", MakeGrid(1000));
+	return 0;
+}
@@ -0,0 +1,213 @@
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+
+#include "ObjParser.h"
+#include "TestUtils.h"
+
+#define TINYOBJLOADER_DISABLE_FAST_FLOAT
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+
+namespace
+{
+	bool Parse(const std::string& text, ObjData& out, const uint32_t threadCount = 1)
+	{
+		out = {};
+		std::string error;
+		return ObjParser::ParseFromMemory(text.data(), text.size(), out, error, threadCount);
+	}
+
+	// What Model.cpp gets from the tinyobj path
+	ObjData ParseWithTinyObj(const std::string& text)
+	{
+		tinyobj::ObjReaderConfig config;
+		config.triangulate = true;
+		tinyobj::ObjReader reader;
+		RH_CHECK(reader.ParseFromString(text, "", config));
+
+		ObjData out;
+		out.positions = reader.GetAttrib().vertices;
+		out.texcoords = reader.GetAttrib().texcoords;
+		out.normals = reader.GetAttrib().normals;
+		for (const auto& shape : reader.GetShapes())
+		{
+			for (const auto& idx : shape.mesh.indices)
+			{
+				out.corners.push_back({ idx.vertex_index, idx.texcoord_index, idx.normal_index });
+			}
+		}
+		return out;
+	}
+
+	bool SameCorners(const ObjData& a, const ObjData& b)
+	{
+		if (a.corners.size() != b.corners.size())
+		{
+			return false;
+		}
+		for (size_t i = 0; i < a.corners.size(); ++i)
+		{
+			if (a.corners[i].posIndex != b.corners[i].posIndex || a.corners[i].uvIndex != b.corners[i].uvIndex ||
+				a.corners[i].normIndex != b.corners[i].normIndex)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Strips of quads written with absolute and relative indices, big enough to be split in several chunks
+	std::string MakeStrips(const int stripCount)
+	{
+		std::string text;
+		char line[160];
+		for (int strip = 0; strip < stripCount; ++strip)
+		{
+			for (int i = 0; i < 64; ++i)
+			{
+				std::snprintf(line, sizeof(line), "v %d.25 %d.5 -%d.125\nv %d.25 %d.5 1e-3\nvt 0.%d 0.%d\nvt 0.%d 1\nvn 0 1 0\n", i, strip, i, i, strip + 1, i, strip, i);
+				text += line;
+			}
+			// Every face of the strip indexes the vertices just above it, the relative ones cross the chunk boundaries
+			for (int i = 0; i + 1 < 64; ++i)
+			{
+				if (strip % 2 == 0)
+				{
+					const int v0 = -128 + 2 * i, uv0 = -128 + 2 * i, n0 = -64 + i;
+					std::snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d\n", v0, uv0, n0, v0 + 1, uv0 + 1, n0, v0 + 2, uv0 + 2, n0 + 1);
+				}
+				else
+				{
+					const int v0 = strip * 128 + 2 * i + 1, n0 = strip * 64 + i + 1;
+					std::snprintf(line, sizeof(line), "f %d//%d %d//%d %d//%d\n", v0, n0, v0 + 2, n0 + 1, v0 + 1, n0);
+				}
+				text += line;
+			}
+		}
+		return text;
+	}
+
+	void TestMatchesTinyObj()
+	{
+		const std::string text = MakeStrips(4000);
+		RH_CHECK(text.size() > 4 * 256 * 1024);
+		const ObjData reference = ParseWithTinyObj(text);
+
+		for (const uint32_t threadCount : { 1u, 2u, 3u, 8u })
+		{
+			ObjData obj;
+			RH_CHECK(Parse(text, obj, threadCount));
+			RH_CHECK(obj.positions == reference.positions);
+			RH_CHECK(obj.texcoords == reference.texcoords);
+			RH_CHECK(obj.normals == reference.normals);
+			RH_CHECK(SameCorners(obj, reference));
+		}
+	}
+
+	// Random values written the ways exporters write them (fixed, exponents of both signs, leading + and dots, long
+	// fractions, garbage after the number) must give the exact same floats as tinyobj
+	void TestRandomFloats()
+	{
+		std::mt19937 random(42);
+		std::uniform_real_distribution<double> mantissa(-10.0, 10.0);
+		std::uniform_int_distribution<int> exponent(-40, 40);
+		std::string text;
+		char value[64];
+		for (int i = 0; i < 100000; ++i)
+		{
+			const double number = mantissa(random) * std::pow(10.0, exponent(random));
+			switch (random() % 8)
+			{
+			case 0: std::snprintf(value, sizeof(value), "%g", number); break;
+			case 1: std::snprintf(value, sizeof(value), "%e", number); break;
+			case 2: std::snprintf(value, sizeof(value), "%.9g", number); break;
+			case 3: std::snprintf(value, sizeof(value), "%.17g", number); break;
+			case 4: std::snprintf(value, sizeof(value), "%f", mantissa(random)); break;
+			case 5: std::snprintf(value, sizeof(value), "+%.6E", std::fabs(number)); break;
+			case 6: std::snprintf(value, sizeof(value), "%s.%u", random() % 2 ? "-" : "", static_cast<uint32_t>(random() % 1000000)); break;
+			default: std::snprintf(value, sizeof(value), "%.4fx", number); break;
+			}
+			text += (i % 3 == 0 ? "v " : (i % 3 == 1 ? "vn " : "vt "));
+			text += value;
+			text += i % 3 == 2 ? " 0.5\n" : " 1e-3 -2.5E+2\n";
+		}
+
+		const ObjData reference = ParseWithTinyObj(text);
+		for (const uint32_t threadCount : { 1u, 4u })
+		{
+			ObjData obj;
+			RH_CHECK(Parse(text, obj, threadCount));
+			RH_CHECK(obj.positions.size() == reference.positions.size());
+			RH_CHECK(std::memcmp(obj.positions.data(), reference.positions.data(), obj.positions.size() * sizeof(float)) == 0);
+			RH_CHECK(obj.texcoords.size() == reference.texcoords.size());
+			RH_CHECK(std::memcmp(obj.texcoords.data(), reference.texcoords.data(), obj.texcoords.size() * sizeof(float)) == 0);
+			RH_CHECK(obj.normals.size() == reference.normals.size());
+			RH_CHECK(std::memcmp(obj.normals.data(), reference.normals.data(), obj.normals.size() * sizeof(float)) == 0);
+		}
+	}
+
+	void TestMissingAttributes()
+	{
+		ObjData obj;
+		RH_CHECK(Parse("v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n", obj));
+		RH_CHECK(obj.corners.size() == 3);
+		RH_CHECK(obj.corners[1].posIndex == 1 && obj.corners[1].uvIndex == -1 && obj.corners[1].normIndex == -1);
+
+		// Zero texcoord and normal indices are missing ones too, like tinyobj reads them
+		RH_CHECK(Parse("v 0 0 0\nv 1 0 0\nv 0 1 0\nvn 0 0 1\nf 1/0/1 2//1 3/0/0\n", obj));
+		RH_CHECK(obj.corners[0].uvIndex == -1 && obj.corners[0].normIndex == 0);
+		RH_CHECK(obj.corners[2].uvIndex == -1 && obj.corners[2].normIndex == -1);
+		std::string error;
+		RH_CHECK(ObjParser::ValidateIndices(obj, error));
+	}
+
+	void TestOutOfRange()
+	{
+		const std::string header = "v 0 0 0\nv 1 0 0\nv 0 1 0\nvt 0 0\nvn 0 0 1\n";
+		const char* faces[] =
+		{
+			"f 1 2 4\n",			// Position past the end
+			"f 0 1 2\n",			// Zero position
+			"f -4 -1 -2\n",			// Relative position before the start
+			"f 1/2 2/1 3/1\n",		// Texcoord past the end
+			"f 1/1/1 2/1/1 3/1/2\n",	// Normal past the end
+			"f 1/-2 2/1 3/1\n",		// Relative texcoord before the start
+			"f 1//-1 2//-2 3//1\n",	// Relative normal before the start
+		};
+
+		for (const char* face : faces)
+		{
+			ObjData obj;
+			RH_CHECK(!Parse(header + face, obj));
+		}
+
+		// Forward references are fine as long as the attribute exists somewhere in the file
+		ObjData obj;
+		RH_CHECK(Parse("v 0 0 0\nf 1 2 3\nv 1 0 0\nv 0 1 0\n", obj));
+
+		// Same checks when the faces land in another chunk than the attributes
+		std::string big = MakeStrips(2000);
+		big += "f 1 2 999999\n";
+		RH_CHECK(!Parse(big, obj, 4));
+
+		// The tinyobj path goes through ValidateIndices
+		std::string error;
+		obj = ParseWithTinyObj(header + "f 1/1/1 2/1/1 7/1/1\n");
+		RH_CHECK(!ObjParser::ValidateIndices(obj, error));
+		RH_CHECK(!error.empty());
+		obj = ParseWithTinyObj(header + "f 1/1/1 2/1/1 3/1/1\n");
+		RH_CHECK(ObjParser::ValidateIndices(obj, error));
+	}
+}
+
+int main()
+{
+	TestMatchesTinyObj();
+	TestRandomFloats();
+	TestMissingAttributes();
+	TestOutOfRange();
+	return 0;
+}
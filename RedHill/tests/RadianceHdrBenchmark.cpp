@@ -0,0 +1,40 @@
+// Decode throughput of RadianceReader on synthetic equirect skies of 4096x2048 and 8192x4096, flat and RLE, to RGBA16F
+// and RGB9E5. The file is in memory and the destination is allocated once with a padded row pitch, so the times are
+// the header parse and the scanline decode alone. MB/s is of the .hdr bytes read.
+//
+//   RadianceHdrBenchmark [runs, 5 by default]
+
+#include <cstdlib>
+
+#include "HdrFixtures.h"
+#include "RadianceHdr.h"
+#include "TestUtils.h"
+
+int main(int argc, char** argv)
+{
+	const int runs = argc > 1 ? std::atoi(argv[1]) : 5;
+	std::printf("%-22s %-8s %10s %10s %12s\n", "Equirect", "Format", "ms", "MB/s", "Mtexel/s");
+	for (const uint32_t width : { 4096u, 8192u })
+	{
+		const uint32_t height = width / 2;
+		for (const bool rle : { false, true })
+		{
+			const std::vector<uint8_t> hdr = MakeRadianceHdr(width, height, rle);
+			for (const HdrTexelFormat format : { HdrTexelFormat::Rgba16Float, HdrTexelFormat::Rgb9e5 })
+			{
+				const uint32_t rowPitch = (width * HdrTexelBytes(format) + 255) & ~255u;
+				std::vector<uint8_t> texels(static_cast<size_t>(rowPitch) * height);
+				const double ms = MeasureMs(runs, [&]()
+				{
+					RadianceReader reader;
+					RH_CHECK(reader.Open(hdr));
+					RH_CHECK(reader.ReadRows(format, texels.data(), rowPitch, height));
+				});
+				const std::string name = std::to_string(width) + "x" + std::to_string(height) + (rle ? " RLE" : " flat");
+				std::printf("%-22s %-8s %10.2f %10.0f %12.1f\n", name.c_str(), format == HdrTexelFormat::Rgb9e5 ? "RGB9E5" : "RGBA16F", ms,
+					hdr.size() / (1024.0 * 1024.0) / (ms / 1000.0), static_cast<double>(width) * height / 1e6 / (ms / 1000.0));
+			}
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,346 @@
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "HalfFloat.h"
+#include "HdrFixtures.h"
+#include "RadianceHdr.h"
+#include "TestUtils.h"
+
+namespace
+{
+	constexpr HdrTexelFormat kFormats[] = { HdrTexelFormat::Rgba16Float, HdrTexelFormat::Rgb9e5 };
+
+	std::vector<uint8_t> Header(const uint32_t width, const uint32_t height)
+	{
+		const std::string header = "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y " + std::to_string(height) + " +X " + std::to_string(width) + "\n";
+		return std::vector<uint8_t>(header.begin(), header.end());
+	}
+
+	// rgbe holds width * height texels, rle(y) picks the encoding of each row
+	template<typename RowIsRle>
+	std::vector<uint8_t> EncodeHdr(const uint32_t width, const uint32_t height, const std::vector<uint8_t>& rgbe, const RowIsRle& rle)
+	{
+		std::vector<uint8_t> file = Header(width, height);
+		std::vector<uint8_t> channel(width);
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			const uint8_t* row = &rgbe[static_cast<size_t>(y) * width * 4];
+			if (!rle(y))
+			{
+				file.insert(file.end(), row, row + static_cast<size_t>(width) * 4);
+				continue;
+			}
+			file.insert(file.end(), { 2, 2, static_cast<uint8_t>(width >> 8), static_cast<uint8_t>(width & 0xff) });
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				for (uint32_t x = 0; x < width; ++x)
+				{
+					channel[x] = row[x * 4 + c];
+				}
+				AppendRleChannel(file, channel.data(), width);
+			}
+		}
+		return file;
+	}
+
+	// Texels with runs (flat areas, long enough for the 127 texel runs) and literals (noise) in every channel
+	std::vector<uint8_t> MakeTexels(const uint32_t width, const uint32_t height, const uint32_t seed)
+	{
+		std::mt19937 random(seed);
+		std::vector<uint8_t> rgbe(static_cast<size_t>(width) * height * 4);
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				uint8_t* texel = &rgbe[(static_cast<size_t>(y) * width + x) * 4];
+				if ((x / 150 + y) % 3 == 0)
+				{
+					FloatToRgbe(0.5f, 0.75f, 1.0f, texel);
+				}
+				else
+				{
+					std::uniform_real_distribution<float> value(0.0f, y % 2 ? 4.0f : 1e5f);
+					FloatToRgbe(value(random), value(random), value(random), texel);
+				}
+			}
+		}
+		return rgbe;
+	}
+
+	double RgbeValue(const uint8_t* rgbe, const uint32_t channel)
+	{
+		return rgbe[3] == 0 ? 0.0 : std::ldexp(static_cast<double>(rgbe[channel]), rgbe[3] - 136);
+	}
+
+	// One decoded texel against the RGBE one. RGBA16F: the float rounded to a half, clamped to the largest one, alpha 1.
+	// RGB9E5: exact while the exponent fits, clamped to 65408 above, rounded to the nearest 2^-24 below.
+	void CheckTexel(const uint8_t* rgbe, const HdrTexelFormat format, const uint8_t* texel)
+	{
+		if (format == HdrTexelFormat::Rgba16Float)
+		{
+			uint16_t halves[4];
+			std::memcpy(halves, texel, sizeof(halves));
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				const float value = static_cast<float>((std::min)(RgbeValue(rgbe, c), 65504.0));
+				RH_CHECK(halves[c] == FloatToHalf(value));
+			}
+			RH_CHECK(halves[3] == FloatToHalf(1.0f));
+			return;
+		}
+
+		uint32_t bits;
+		std::memcpy(&bits, texel, sizeof(bits));
+		const int exponent = static_cast<int>(bits >> 27) - 15 - 9;
+		for (uint32_t c = 0; c < 3; ++c)
+		{
+			const double decoded = std::ldexp(static_cast<double>((bits >> (c * 9)) & 0x1FF), exponent);
+			const double value = RgbeValue(rgbe, c);
+			if (value > 65408.0)
+			{
+				RH_CHECK(decoded == 65408.0);
+			}
+			else
+			{
+				RH_CHECK(std::fabs(decoded - value) <= (rgbe[3] >= 113 ? 0.0 : 0x1p-25));
+			}
+		}
+	}
+
+	std::vector<uint8_t> Decode(const std::vector<uint8_t>& file, const HdrTexelFormat format, const uint32_t width, const uint32_t height)
+	{
+		RadianceReader reader;
+		RH_CHECK(reader.Open(file));
+		RH_CHECK(reader.Width() == width && reader.Height() == height);
+		std::vector<uint8_t> texels(static_cast<size_t>(width) * height * HdrTexelBytes(format));
+		RH_CHECK(reader.ReadRows(format, texels.data(), width * HdrTexelBytes(format), height));
+		// Past the last row
+		std::vector<uint8_t> extra(static_cast<size_t>(width) * HdrTexelBytes(format));
+		RH_CHECK(!reader.ReadRow(format, extra.data()));
+		return texels;
+	}
+
+	// Every exponent with random mantissas, through both formats
+	void TestConversion()
+	{
+		const uint32_t width = 256, height = 8;
+		std::mt19937 random(1);
+		std::vector<uint8_t> rgbe(width * height * 4);
+		for (uint32_t i = 0; i < width * height; ++i)
+		{
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				rgbe[i * 4 + c] = static_cast<uint8_t>(random());
+			}
+			rgbe[i * 4 + 3] = static_cast<uint8_t>(i % width);
+		}
+		const std::vector<uint8_t> file = EncodeHdr(width, height, rgbe, [](uint32_t) { return false; });
+		for (const HdrTexelFormat format : kFormats)
+		{
+			const std::vector<uint8_t> texels = Decode(file, format, width, height);
+			for (uint32_t i = 0; i < width * height; ++i)
+			{
+				CheckTexel(&rgbe[i * 4], format, &texels[i * HdrTexelBytes(format)]);
+			}
+		}
+	}
+
+	// Flat, RLE and mixed rows of the same texels decode to the same rows, including the widths the RLE can't encode
+	void TestFlatAndRleRows()
+	{
+		for (const uint32_t width : { 1u, 5u, 7u, 8u, 9u, 31u, 127u, 128u, 129u, 300u, 1001u })
+		{
+			const uint32_t height = 6;
+			const std::vector<uint8_t> rgbe = MakeTexels(width, height, width);
+			const std::vector<uint8_t> flat = EncodeHdr(width, height, rgbe, [](uint32_t) { return false; });
+			const bool canRle = width >= 8;
+			const std::vector<uint8_t> rle = EncodeHdr(width, height, rgbe, [canRle](uint32_t) { return canRle; });
+			const std::vector<uint8_t> mixed = EncodeHdr(width, height, rgbe, [canRle](const uint32_t y) { return canRle && y % 2 == 0; });
+			if (canRle)
+			{
+				RH_CHECK(rle.size() < flat.size());
+			}
+
+			for (const HdrTexelFormat format : kFormats)
+			{
+				const std::vector<uint8_t> texels = Decode(flat, format, width, height);
+				for (uint32_t i = 0; i < width * height; ++i)
+				{
+					CheckTexel(&rgbe[i * 4], format, &texels[i * HdrTexelBytes(format)]);
+				}
+				RH_CHECK(Decode(rle, format, width, height) == texels);
+				RH_CHECK(Decode(mixed, format, width, height) == texels);
+			}
+		}
+
+		// The fixture sky, with a sun past the range of both formats
+		const std::vector<uint8_t> sky = MakeRadianceHdr(512, 256, true, 1e6f);
+		const std::vector<uint8_t> flatSky = MakeRadianceHdr(512, 256, false, 1e6f);
+		for (const HdrTexelFormat format : kFormats)
+		{
+			RH_CHECK(Decode(sky, format, 512, 256) == Decode(flatSky, format, 512, 256));
+		}
+	}
+
+	// Rows into pitched memory, the padding between them untouched
+	void TestPitchedRows()
+	{
+		const uint32_t width = 37, height = 5;
+		const std::vector<uint8_t> file = EncodeHdr(width, height, MakeTexels(width, height, 3), [](uint32_t) { return true; });
+		for (const HdrTexelFormat format : kFormats)
+		{
+			const uint32_t rowBytes = width * HdrTexelBytes(format);
+			const uint32_t rowPitch = (rowBytes + 255) & ~255u;
+			std::vector<uint8_t> rows(static_cast<size_t>(rowPitch) * height, 0xCD);
+			RadianceReader reader;
+			RH_CHECK(reader.Open(file));
+			RH_CHECK(reader.ReadRows(format, rows.data(), rowPitch, height));
+
+			const std::vector<uint8_t> tight = Decode(file, format, width, height);
+			for (uint32_t y = 0; y < height; ++y)
+			{
+				RH_CHECK(std::memcmp(&rows[static_cast<size_t>(y) * rowPitch], &tight[static_cast<size_t>(y) * rowBytes], rowBytes) == 0);
+				for (uint32_t i = rowBytes; i < rowPitch; ++i)
+				{
+					RH_CHECK(rows[static_cast<size_t>(y) * rowPitch + i] == 0xCD);
+				}
+			}
+		}
+	}
+
+	// Opens and reads every row, false if any of it fails
+	bool OpenAndRead(const std::vector<uint8_t>& file)
+	{
+		RadianceReader reader;
+		if (!reader.Open(file))
+		{
+			return false;
+		}
+		std::vector<uint8_t> row(static_cast<size_t>(reader.Width()) * 8);
+		for (uint32_t y = 0; y < reader.Height(); ++y)
+		{
+			if (!reader.ReadRow(HdrTexelFormat::Rgba16Float, row.data()))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Every truncation of a flat, an RLE and a mixed file fails in Open or in a row, without reading past the end (run
+	// under ASan, the truncated copies are exactly their size)
+	void TestTruncatedFiles()
+	{
+		const uint32_t width = 40, height = 4;
+		const std::vector<uint8_t> rgbe = MakeTexels(width, height, 4);
+		for (const uint32_t everyRle : { 0u, 1u, 2u })
+		{
+			const std::vector<uint8_t> file = EncodeHdr(width, height, rgbe, [everyRle](const uint32_t y) { return everyRle != 0 && y % everyRle == 0; });
+			RH_CHECK(OpenAndRead(file));
+			for (size_t size = 0; size < file.size(); ++size)
+			{
+				RH_CHECK(!OpenAndRead(std::vector<uint8_t>(file.begin(), file.begin() + size)));
+			}
+		}
+	}
+
+	// One RLE row of 16 texels with the given channel data, after the row start
+	std::vector<uint8_t> RleRow(const std::vector<uint8_t>& channels, const uint32_t rowWidth = 16)
+	{
+		std::vector<uint8_t> file = Header(16, 1);
+		file.insert(file.end(), { 2, 2, static_cast<uint8_t>(rowWidth >> 8), static_cast<uint8_t>(rowWidth & 0xff) });
+		file.insert(file.end(), channels.begin(), channels.end());
+		return file;
+	}
+
+	void TestBadRleCounts()
+	{
+		// A valid row first: a run of 16, literals of 10 and 6, a run of 1 and a literal of 15, a run of 16
+		const std::vector<uint8_t> valid = { 128 + 16, 7, 10, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 6, 1, 2, 3, 4, 5, 6,
+			128 + 1, 9, 15, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 128 + 16, 130 };
+		RH_CHECK(OpenAndRead(RleRow(valid)));
+
+		auto Broken = [&valid](const size_t offset, const uint8_t value)
+		{
+			std::vector<uint8_t> channels = valid;
+			channels[offset] = value;
+			return RleRow(channels);
+		};
+		RH_CHECK(!OpenAndRead(Broken(0, 128 + 17)));	// Run past the row
+		RH_CHECK(!OpenAndRead(Broken(2, 11)));			// Literal past the row
+		RH_CHECK(!OpenAndRead(Broken(2, 0)));			// Empty literal
+		RH_CHECK(!OpenAndRead(Broken(2, 128)));			// 128 is a literal of 128, not an empty run
+		RH_CHECK(!OpenAndRead(Broken(13, 128 + 7)));	// Run past the row in the middle of the channel
+		RH_CHECK(!OpenAndRead(Broken(13, 255)));
+
+		// Row start with another width, and the last run without its value
+		RH_CHECK(!OpenAndRead(RleRow(valid, 15)));
+		RH_CHECK(!OpenAndRead(RleRow(valid, 17)));
+		RH_CHECK(!OpenAndRead(RleRow(std::vector<uint8_t>(valid.begin(), valid.end() - 1))));
+
+		// A run that would overflow x + count if it were added before the check
+		std::vector<uint8_t> wide = Header(32767, 1);
+		wide.insert(wide.end(), { 2, 2, 0x7f, 0xff });
+		for (uint32_t i = 0; i < 32767 / 127; ++i)
+		{
+			wide.insert(wide.end(), { 128 + 127, 1 });
+		}
+		wide.insert(wide.end(), { 128 + 127, 1 });
+		RH_CHECK(!OpenAndRead(wide));
+	}
+
+	bool OpenHeader(const std::string& header)
+	{
+		RadianceReader reader;
+		return reader.Open(std::span<const uint8_t>(reinterpret_cast<const uint8_t*>(header.data()), header.size()));
+	}
+
+	void TestHeaders()
+	{
+		const std::string format = "FORMAT=32-bit_rle_rgbe\n\n";
+		RH_CHECK(OpenHeader("#?RADIANCE\n" + format + "-Y 8 +X 16\n"));
+		RH_CHECK(OpenHeader("#?RGBE\n# comment\nEXPOSURE=1.0\n" + format + "-Y 8 +X 16\n"));
+
+		// The largest size opens, its rows are read one at a time so nothing the size of the image is allocated
+		RH_CHECK(OpenHeader("#?RADIANCE\n" + format + "-Y 32768 +X 32768\n"));
+
+		// Oversize and broken dimensions
+		RH_CHECK(!OpenHeader("#?RADIANCE\n" + format + "-Y 32769 +X 16\n"));
+		RH_CHECK(!OpenHeader("#?RADIANCE\n" + format + "-Y 8 +X 32769\n"));
+		RH_CHECK(!OpenHeader("#?RADIANCE\n" + format + "-Y 8 +X 4294967312\n"));
+		RH_CHECK(!OpenHeader("#?RADIANCE\n" + format + "-Y 99999999999999999999999999 +X 16\n"));
+		RH_CHECK(!OpenHeader("#?RADIANCE\n" + format + "-Y 0 +X 16\n"));
+		RH_CHECK(!OpenHeader("#?RADIANCE\n" + format + "-Y 8 +X 0\n"));
+		RH_CHECK(!OpenHeader("#?RADIANCE\n" + format + "-Y 8 +X -16\n"));
+		RH_CHECK(!OpenHeader("#?RADIANCE\n" + format + "-Y +X 16\n"));
+		RH_CHECK(!OpenHeader("#?RADIANCE\n" + format + "-Y 8 +X\n"));
+		RH_CHECK(!OpenHeader("#?RADIANCE\n" + format + "-Y 8 +X 16 \n"));
+		RH_CHECK(!OpenHeader("#?RADIANCE\n" + format + "-Y 8  +X 16\n"));
+		RH_CHECK(!OpenHeader("#?RADIANCE\n" + format + "-Y 8 +X 16"));
+
+		// Other orientations and formats
+		RH_CHECK(!OpenHeader("#?RADIANCE\n" + format + "+Y 8 +X 16\n"));
+		RH_CHECK(!OpenHeader("#?RADIANCE\n" + format + "-Y 8 -X 16\n"));
+		RH_CHECK(!OpenHeader("#?RADIANCE\n" + format + "+X 16 -Y 8\n"));
+		RH_CHECK(!OpenHeader("#?RADIANCE\nFORMAT=32-bit_rle_xyze\n\n-Y 8 +X 16\n"));
+		RH_CHECK(!OpenHeader("#?RADIANCE\n\n-Y 8 +X 16\n"));
+		RH_CHECK(!OpenHeader("#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n-Y 8 +X 16\n"));
+		RH_CHECK(!OpenHeader("#?PNG\n" + format + "-Y 8 +X 16\n"));
+		RH_CHECK(!OpenHeader(""));
+		RH_CHECK(!OpenHeader("#?RADIANCE"));
+	}
+}
+
+int main()
+{
+	TestConversion();
+	TestFlatAndRleRows();
+	TestPitchedRows();
+	TestTruncatedFiles();
+	TestBadRleCounts();
+	TestHeaders();
+	return 0;
+}
@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "RingAllocator.h"
+#include "TestUtils.h"
+
+namespace
+{
+	struct Allocation
+	{
+		uint64_t offset;
+		uint64_t size;
+		uint64_t fenceValue;
+	};
+
+	void TestBasics()
+	{
+		const uint64_t capacity = 1 << 20;
+		RingAllocator ring;
+		ring.Init(capacity);
+
+		RH_CHECK(ring.Allocate(capacity + 1, 16) == RingAllocator::kInvalidOffset);
+		RH_CHECK(ring.Allocate(100, 512) == 0);
+		RH_CHECK(ring.Allocate(100, 512) == 512);
+		RH_CHECK(ring.Allocate(capacity, 16) == RingAllocator::kInvalidOffset);
+		RH_CHECK(ring.HasUnsubmitted());
+
+		ring.Submit(1);
+		RH_CHECK(!ring.HasUnsubmitted());
+		ring.Reclaim(0);
+		RH_CHECK(ring.UsedBytes() == 612);
+		ring.Reclaim(1);
+		RH_CHECK(ring.UsedBytes() == 0);
+
+		// Idle again, an allocation can take the whole ring
+		RH_CHECK(ring.Allocate(capacity, 16) == 0);
+		ring.Submit(2);
+		ring.Reclaim(2);
+
+		// A tail too small for the next allocation is skipped and comes back with it
+		RH_CHECK(ring.Allocate(capacity - 256, 1) == 0);
+		ring.Submit(3);
+		RH_CHECK(ring.Allocate(1024, 1) == RingAllocator::kInvalidOffset);
+		ring.Reclaim(3);
+		RH_CHECK(ring.Allocate(100, 1) == 0);
+		RH_CHECK(ring.Allocate(1024, 1) == 100);
+		ring.Submit(4);
+		ring.Reclaim(4);
+		RH_CHECK(ring.UsedBytes() == 0);
+	}
+
+	// Trace of random uploads with a fake GPU that completes the submits one to three submits late. When the ring is
+	// full everything pending is submitted and waited for, like the renderer does. Live allocations never overlap.
+	void TestTrace(const uint32_t seed, const int allocationCount)
+	{
+		const uint64_t capacity = 1 << 20;
+		RingAllocator ring;
+		ring.Init(capacity);
+
+		std::mt19937_64 random(seed);
+		std::vector<Allocation> live, pending;
+		uint64_t fenceValue = 0, completed = 0, flushes = 0;
+
+		auto SubmitPending = [&]()
+		{
+			ring.Submit(++fenceValue);
+			for (Allocation& allocation : pending)
+			{
+				allocation.fenceValue = fenceValue;
+				live.push_back(allocation);
+			}
+			pending.clear();
+		};
+		auto Complete = [&](const uint64_t value)
+		{
+			completed = (std::max)(completed, value);
+			ring.Reclaim(completed);
+			live.erase(std::remove_if(live.begin(), live.end(), [completed](const Allocation& a) { return a.fenceValue <= completed; }), live.end());
+		};
+
+		for (int i = 0; i < allocationCount; ++i)
+		{
+			const uint64_t size = 1 + random() % (capacity / 4);
+			const uint64_t alignment = uint64_t(1) << (random() % 10);
+			uint64_t offset = ring.Allocate(size, alignment);
+			if (offset == RingAllocator::kInvalidOffset)
+			{
+				SubmitPending();
+				Complete(fenceValue);
+				offset = ring.Allocate(size, alignment);
+				RH_CHECK(offset != RingAllocator::kInvalidOffset);
+				flushes++;
+			}
+
+			RH_CHECK(offset % alignment == 0 && offset + size <= capacity);
+			for (const std::vector<Allocation>* list : { &live, &pending })
+			{
+				for (const Allocation& other : *list)
+				{
+					RH_CHECK(offset + size <= other.offset || other.offset + other.size <= offset);
+				}
+			}
+			pending.push_back({ offset, size, 0 });
+
+			if (random() % 4 == 0)
+			{
+				SubmitPending();
+				Complete(fenceValue > 3 ? fenceValue - random() % 3 : completed);
+			}
+			RH_CHECK(ring.UsedBytes() <= capacity);
+		}
+
+		SubmitPending();
+		Complete(fenceValue);
+		RH_CHECK(ring.UsedBytes() == 0);
+		RH_CHECK(ring.PeakBytes() <= capacity);
+		RH_CHECK(flushes > 0);
+	}
+}
+
+int main()
+{
+	TestBasics();
+	TestTrace(1, 200000);
+	TestTrace(2, 200000);
+	return 0;
+}
@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <cmath>
+
+#include "Icosphere.h"
+#include "MeshFixtures.h"
+#include "Simplifier.h"
+#include "TangentSpace.h"
+#include "TestUtils.h"
+
+namespace
+{
+	float Dot(const float a[3], const float b[3])
+	{
+		return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+	}
+
+	// Squared distance from p to the triangle abc (closest point by region, Ericson's Real-Time Collision Detection 5.1.5)
+	float PointTriangleDistanceSquared(const float p[3], const float a[3], const float b[3], const float c[3])
+	{
+		const float ab[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		const float ac[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+		const float ap[3] = { p[0] - a[0], p[1] - a[1], p[2] - a[2] };
+		float closest[3];
+		auto Set = [&](const float u, const float v)
+		{
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				closest[axis] = a[axis] + ab[axis] * u + ac[axis] * v;
+			}
+		};
+
+		const float d1 = Dot(ab, ap), d2 = Dot(ac, ap);
+		const float bp[3] = { p[0] - b[0], p[1] - b[1], p[2] - b[2] };
+		const float d3 = Dot(ab, bp), d4 = Dot(ac, bp);
+		const float cp[3] = { p[0] - c[0], p[1] - c[1], p[2] - c[2] };
+		const float d5 = Dot(ab, cp), d6 = Dot(ac, cp);
+		const float va = d3 * d6 - d5 * d4, vb = d5 * d2 - d1 * d6, vc = d1 * d4 - d3 * d2;
+		if (d1 <= 0.0f && d2 <= 0.0f)
+		{
+			Set(0.0f, 0.0f);
+		}
+		else if (d3 >= 0.0f && d4 <= d3)
+		{
+			Set(1.0f, 0.0f);
+		}
+		else if (d6 >= 0.0f && d5 <= d6)
+		{
+			Set(0.0f, 1.0f);
+		}
+		else if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+		{
+			Set(d1 / (d1 - d3), 0.0f);
+		}
+		else if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+		{
+			Set(0.0f, d2 / (d2 - d6));
+		}
+		else if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+		{
+			const float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+			Set(1.0f - w, w);
+		}
+		else
+		{
+			const float denom = 1.0f / (va + vb + vc);
+			Set(vb * denom, vc * denom);
+		}
+		const float d[3] = { p[0] - closest[0], p[1] - closest[1], p[2] - closest[2] };
+		return Dot(d, d);
+	}
+
+	// Farthest distance from a vertex of the source mesh to the simplified surface, brute force
+	float MeasureError(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& source, const std::vector<uint32_t>& simplified)
+	{
+		std::vector<bool> referenced(vertices.size(), false);
+		for (const uint32_t index : source)
+		{
+			referenced[index] = true;
+		}
+
+		float maxDistanceSquared = 0.0f;
+		for (size_t v = 0; v < vertices.size(); ++v)
+		{
+			if (!referenced[v])
+			{
+				continue;
+			}
+			float best = 1e30f;
+			for (size_t i = 0; i < simplified.size() && best > maxDistanceSquared; i += 3)
+			{
+				best = (std::min)(best, PointTriangleDistanceSquared(vertices[v].position, vertices[simplified[i]].position,
+					vertices[simplified[i + 1]].position, vertices[simplified[i + 2]].position));
+			}
+			maxDistanceSquared = (std::max)(maxDistanceSquared, best);
+		}
+		return std::sqrt(maxDistanceSquared);
+	}
+
+	// reachable: the constraints leave enough collapses for the ratio, the result has to get to the target
+	void CheckSimplify(const char* name, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const float ratio, const bool reachable)
+	{
+		const size_t target = static_cast<size_t>(indices.size() / 3 * ratio) * 3;
+		float error = -1.0f;
+		const std::vector<uint32_t> simplified = SimplifyMesh(vertices, indices, target, error);
+
+		RH_CHECK(simplified.size() % 3 == 0 && !simplified.empty());
+		RH_CHECK(simplified.size() <= indices.size());
+		if (reachable)
+		{
+			RH_CHECK(simplified.size() <= target);
+		}
+
+		// Only existing vertices of the source mesh, no collapsed triangles
+		std::vector<bool> referenced(vertices.size(), false);
+		for (const uint32_t index : indices)
+		{
+			referenced[index] = true;
+		}
+		for (size_t i = 0; i < simplified.size(); i += 3)
+		{
+			const uint32_t* t = &simplified[i];
+			RH_CHECK(t[0] < vertices.size() && t[1] < vertices.size() && t[2] < vertices.size());
+			RH_CHECK(referenced[t[0]] && referenced[t[1]] && referenced[t[2]]);
+			RH_CHECK(t[0] != t[1] && t[1] != t[2] && t[0] != t[2]);
+		}
+
+		// The reported error bounds the deviation of the source vertices from the result
+		const float measured = MeasureError(vertices, indices, simplified);
+		RH_CHECK(error >= 0.0f);
+		RH_CHECK(measured <= error * 1.001f + 1e-6f);
+		std::printf("%-12s %5.1f%%: %6zu -> %6zu triangles (target %6zu), error reported %.5f measured %.5f\n", name, ratio * 100.0f,
+			indices.size() / 3, simplified.size() / 3, target / 3, error, measured);
+	}
+
+	void CheckUnchanged(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+	{
+		float error = -1.0f;
+		const std::vector<uint32_t> simplified = SimplifyMesh(vertices, indices, indices.size(), error);
+		RH_CHECK(simplified == indices);
+		RH_CHECK(error == 0.0f);
+	}
+
+	void CheckLods(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& sourceIndices)
+	{
+		std::vector<uint32_t> indices = sourceIndices;
+		std::vector<MeshLod> lods;
+		BuildMeshLods(vertices, indices, lods, "test");
+
+		// Coarsest first, the full mesh untouched at index 0 last, the levels appended after it
+		RH_CHECK(!lods.empty());
+		RH_CHECK(std::equal(sourceIndices.begin(), sourceIndices.end(), indices.begin()));
+		const MeshLod& full = lods.back();
+		RH_CHECK(full.indexOffset == 0 && full.indexCount == sourceIndices.size() && full.vertexCount == vertices.size() && full.error == 0.0f);
+		uint32_t offset = static_cast<uint32_t>(sourceIndices.size());
+		for (size_t level = 0; level + 1 < lods.size(); ++level)
+		{
+			const MeshLod& lod = lods[level];
+			RH_CHECK(lod.indexOffset == offset);
+			offset += lod.indexCount;
+			RH_CHECK(lod.indexCount < lods[level + 1].indexCount);
+			RH_CHECK(lod.error > 0.0f);
+			const std::vector<uint32_t> levelIndices(indices.begin() + lod.indexOffset, indices.begin() + lod.indexOffset + lod.indexCount);
+			RH_CHECK(MeasureError(vertices, sourceIndices, levelIndices) <= lod.error * 1.001f + 1e-6f);
+		}
+		RH_CHECK(offset == indices.size());
+	}
+}
+
+int main()
+{
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+
+	// Closed, no seams: every vertex can collapse and the targets are reached
+	std::vector<MeshLod> lods;
+	GenerateIcosphere(5, vertices, indices, lods);
+	indices.erase(indices.begin(), indices.begin() + lods.back().indexOffset);
+	CheckUnchanged(vertices, indices);
+	for (const float ratio : { 0.5f, 0.25f, 0.1f })
+	{
+		CheckSimplify("icosphere", vertices, indices, ratio, true);
+	}
+	CheckLods(vertices, indices);
+
+	// Bumpy grids with borders and a uv seam
+	MakeIslandSoup(4, 32, 5, vertices, indices);
+	GenerateTangents(vertices, indices);
+	for (const float ratio : { 0.5f, 0.25f })
+	{
+		CheckSimplify("island soup", vertices, indices, ratio, true);
+	}
+
+	// Helmet stalls around 25% (a third of its vertices are locked seam junctions)
+	RH_CHECK(LoadObjMesh(REDHILL_RESOURCES "/Helmet.obj", vertices, indices));
+	GenerateTangents(vertices, indices);
+	CheckUnchanged(vertices, indices);
+	CheckSimplify("Helmet", vertices, indices, 0.5f, true);
+	CheckSimplify("Helmet", vertices, indices, 0.125f, false);
+	CheckLods(vertices, indices);
+	return 0;
+}
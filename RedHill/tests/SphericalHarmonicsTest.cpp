@@ -0,0 +1,222 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <random>
+#include <vector>
+
+#include "HalfFloat.h"
+#include "IblBaker.h"
+#include "SphericalHarmonics.h"
+#include "TestUtils.h"
+
+namespace
+{
+	constexpr double kPi = 3.14159265358979323846;
+
+	using Environment = std::function<void(double x, double y, double z, double rgb[3])>;
+
+	// Radiance made of bands 0 to 2 only, different in every channel and along every axis so a mirrored or swapped axis
+	// shows. Its irradiance / pi is known exactly: the cosine lobe keeps band 0, scales band 1 by 2/3 and band 2 by 1/4.
+	void AnalyticRadiance(const double x, const double y, const double z, double rgb[3])
+	{
+		rgb[0] = 1.0 + 0.5 * x + 0.3 * y;
+		rgb[1] = 1.0 + 0.4 * z + 0.8 * x * y;
+		rgb[2] = 1.2 + 0.6 * x * z + 0.3 * (x * x - y * y) - 0.2 * (3.0 * z * z - 1.0);
+	}
+
+	void AnalyticIrradiance(const double x, const double y, const double z, double rgb[3])
+	{
+		rgb[0] = 1.0 + 2.0 / 3.0 * (0.5 * x + 0.3 * y);
+		rgb[1] = 1.0 + 2.0 / 3.0 * 0.4 * z + 0.25 * 0.8 * x * y;
+		rgb[2] = 1.2 + 0.25 * (0.6 * x * z + 0.3 * (x * x - y * y) - 0.2 * (3.0 * z * z - 1.0));
+	}
+
+	// A bright sky over a dark ground with a warm horizon, not band limited
+	void SkyRadiance(const double x, const double y, const double z, double rgb[3])
+	{
+		const double horizon = std::exp(-40.0 * y * y);
+		rgb[0] = (y > 0.0 ? 1.0 : 0.1) + 2.0 * horizon * (x > 0.0 ? 1.0 : 0.5);
+		rgb[1] = (y > 0.0 ? 1.5 : 0.1) + horizon;
+		rgb[2] = y > 0.0 ? 3.0 : 0.05;
+	}
+
+	// Half float equirect with the mapping of the bake (u = 0.5 - atan2(z, x) / 2pi, v = 0.5 - asin(y) / pi)
+	std::vector<uint16_t> MakeEquirect(const Environment& environment, const uint32_t width, const uint32_t height)
+	{
+		std::vector<uint16_t> texels(static_cast<size_t>(width) * height * 4);
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			const double elevation = (0.5 - (y + 0.5) / height) * kPi;
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				const double azimuth = (0.5 - (x + 0.5) / width) * 2.0 * kPi;
+				double rgb[3];
+				environment(std::cos(elevation) * std::cos(azimuth), std::sin(elevation), std::cos(elevation) * std::sin(azimuth), rgb);
+				uint16_t* texel = &texels[(static_cast<size_t>(y) * width + x) * 4];
+				for (uint32_t c = 0; c < 3; ++c)
+				{
+					texel[c] = FloatToHalf(static_cast<float>(rgb[c]));
+				}
+				texel[3] = FloatToHalf(1.0f);
+			}
+		}
+		return texels;
+	}
+
+	// Face basis of the GPU bake (forward, up, and right = up x forward), see IblBaker.cpp
+	constexpr double kFaces[6][3][3] =
+	{
+		{ { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, -1 } }, { { -1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } },
+		{ { 0, 1, 0 }, { 0, 0, -1 }, { 1, 0, 0 } }, { { 0, -1, 0 }, { 0, 0, 1 }, { 1, 0, 0 } },
+		{ { 0, 0, 1 }, { 0, 1, 0 }, { 1, 0, 0 } }, { { 0, 0, -1 }, { 0, 1, 0 }, { -1, 0, 0 } }
+	};
+
+	// Irradiance / pi of the baked cubemap by brute force: every texel of the top level weighted by its solid angle and
+	// the clamped cosine
+	void CubemapIrradiance(const FloatCubemap& cubemap, const double n[3], double rgb[3])
+	{
+		rgb[0] = rgb[1] = rgb[2] = 0.0;
+		const uint32_t size = cubemap.size;
+		for (uint32_t face = 0; face < 6; ++face)
+		{
+			const float* texels = cubemap.Face(0, face);
+			const auto& basis = kFaces[face];
+			for (uint32_t y = 0; y < size; ++y)
+			{
+				const double clipY = 1.0 - (y + 0.5) / size * 2.0;
+				for (uint32_t x = 0; x < size; ++x)
+				{
+					const double clipX = (x + 0.5) / size * 2.0 - 1.0;
+					double d[3];
+					for (int axis = 0; axis < 3; ++axis)
+					{
+						d[axis] = basis[2][axis] * clipX + basis[1][axis] * clipY + basis[0][axis];
+					}
+					const double lengthSquared = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+					const double length = std::sqrt(lengthSquared);
+					const double cosine = (d[0] * n[0] + d[1] * n[1] + d[2] * n[2]) / length;
+					if (cosine <= 0.0)
+					{
+						continue;
+					}
+					// Texel area (2 / size)^2 projected on the unit sphere
+					const double solidAngle = 4.0 / (static_cast<double>(size) * size) / (lengthSquared * length);
+					const float* texel = texels + (static_cast<size_t>(y) * size + x) * 4;
+					for (uint32_t c = 0; c < 3; ++c)
+					{
+						rgb[c] += texel[c] * cosine * solidAngle / kPi;
+					}
+				}
+			}
+		}
+	}
+
+	void RandomNormal(std::mt19937& random, double n[3])
+	{
+		std::normal_distribution<double> gaussian;
+		double length = 0.0;
+		while (length < 1e-3)
+		{
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				n[axis] = gaussian(random);
+			}
+			length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		}
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			n[axis] /= length;
+		}
+	}
+
+	// Largest error of the SH against the reference over the axes and random normals, relative to the brightest
+	// irradiance of the channel (the dim side of a contrasted environment only shows the ringing of the 9 terms)
+	template<typename Reference>
+	float MaxRelativeError(const IrradianceSH& sh, const Reference& reference)
+	{
+		std::vector<std::array<double, 3>> normals = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+		std::mt19937 random(11);
+		for (int i = 0; i < 200; ++i)
+		{
+			RandomNormal(random, normals.emplace_back().data());
+		}
+
+		double maxError[3] = {};
+		double maxExpected[3] = {};
+		for (const auto& n : normals)
+		{
+			float rgb[3];
+			EvaluateIrradianceSH(sh, static_cast<float>(n[0]), static_cast<float>(n[1]), static_cast<float>(n[2]), rgb);
+			double expected[3];
+			reference(n.data(), expected);
+			for (uint32_t c = 0; c < 3; ++c)
+			{
+				maxError[c] = (std::max)(maxError[c], std::fabs(rgb[c] - expected[c]));
+				maxExpected[c] = (std::max)(maxExpected[c], expected[c]);
+			}
+		}
+		return static_cast<float>((std::max)({ maxError[0] / maxExpected[0], maxError[1] / maxExpected[1], maxError[2] / maxExpected[2] }));
+	}
+
+	// Bands 0 to 2 project exactly, only the equirect sampling and the half floats are left
+	void TestAnalyticEnvironment()
+	{
+		const uint32_t width = 512, height = 256;
+		const std::vector<uint16_t> texels = MakeEquirect(AnalyticRadiance, width, height);
+		const IrradianceSH sh = ProjectIrradianceSH(reinterpret_cast<const uint8_t*>(texels.data()), HdrTexelFormat::Rgba16Float, width, height, width * 8);
+		const float error = MaxRelativeError(sh, [](const double n[3], double rgb[3]) { AnalyticIrradiance(n[0], n[1], n[2], rgb); });
+		std::printf("analytic environment: max relative error %.5f\n", error);
+		RH_CHECK(error <= 1e-3f);
+	}
+
+	// The SH of an equirect against the irradiance of the cubemap IblBaker bakes from it, both mappings have to agree
+	void CheckAgainstBakedCubemap(const char* name, const Environment& environment, const float tolerance)
+	{
+		const uint32_t width = 512, height = 256;
+		const std::vector<uint16_t> texels = MakeEquirect(environment, width, height);
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(texels.data());
+		const IrradianceSH sh = ProjectIrradianceSH(bytes, HdrTexelFormat::Rgba16Float, width, height, width * 8);
+		const FloatCubemap cubemap = BakeEnvironmentCubemap(bytes, HdrTexelFormat::Rgba16Float, width, height, width * 8, 64, 1);
+		const float error = MaxRelativeError(sh, [&cubemap](const double n[3], double rgb[3]) { CubemapIrradiance(cubemap, n, rgb); });
+		std::printf("%s against the baked cubemap: max relative error %.5f\n", name, error);
+		RH_CHECK(error <= tolerance);
+	}
+
+	void TestFile()
+	{
+		const std::string path = (std::filesystem::temp_directory_path() / "RedHillSphericalHarmonicsTest.rsh").string();
+		IrradianceSH sh;
+		for (uint32_t i = 0; i < 9; ++i)
+		{
+			for (uint32_t c = 0; c < 4; ++c)
+			{
+				sh.coefficients[i][c] = i * 0.5f - c;
+			}
+		}
+		RH_CHECK(WriteIrradianceSH(path, 42, sh));
+
+		IrradianceSH read;
+		RH_CHECK(ReadIrradianceSH(path, 42, read));
+		RH_CHECK(std::memcmp(&read, &sh, sizeof(sh)) == 0);
+		RH_CHECK(!ReadIrradianceSH(path, 43, read));
+		RH_CHECK(!ReadIrradianceSH(path + ".missing", 42, read));
+
+		const uintmax_t size = std::filesystem::file_size(path);
+		std::filesystem::resize_file(path, size - 1);
+		RH_CHECK(!ReadIrradianceSH(path, 42, read));
+		std::filesystem::remove(path);
+	}
+}
+
+int main()
+{
+	TestAnalyticEnvironment();
+	CheckAgainstBakedCubemap("analytic environment", AnalyticRadiance, 0.01f);
+	// The sharp horizon needs the bands past 2, measured 4.1% of the brightest irradiance
+	CheckAgainstBakedCubemap("sky", SkyRadiance, 0.06f);
+	TestFile();
+	return 0;
+}
@@ -0,0 +1,78 @@
+// Tangent generation time against the thread count: the single threaded run over the whole mesh, then the island
+// split with 2, 4... threads (more threads than the job system has run on the ones it has). The logs of
+// GenerateTangents go to stderr.
+//
+//   TangentSpaceBenchmark [file.obj...] 2>/dev/null
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "JobSystem.h"
+#include "MeshFixtures.h"
+#include "TangentSpace.h"
+#include "TestUtils.h"
+
+namespace
+{
+	void Run(const char* name, const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+	{
+		std::vector<Vertex> result;
+		const double wholeMs = MeasureMs(3, [&]()
+		{
+			result = vertices;
+			GenerateTangents(result, indices, 1);
+		});
+		std::printf("%-20s %9zu tris  whole mesh %9.2f ms\n", name, indices.size() / 3, wholeMs);
+
+		const uint32_t maxThreads = (std::max)(JobSystem::Get().ThreadCount(), 2u);
+		for (uint32_t threadCount = 2; ; threadCount = (std::min)(threadCount * 2, maxThreads))
+		{
+			const double ms = MeasureMs(3, [&]()
+			{
+				result = vertices;
+				GenerateTangents(result, indices, threadCount);
+			});
+			std::printf("%-20s %2u threads (%2u run)     %9.2f ms  %6.2fx\n", "", threadCount,
+				(std::min)(threadCount, JobSystem::Get().ThreadCount()), ms, wholeMs / ms);
+			if (threadCount == maxThreads)
+			{
+				break;
+			}
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> files;
+	for (int i = 1; i < argc; ++i)
+	{
+		files.push_back(argv[i]);
+	}
+	if (files.empty())
+	{
+		files.push_back(REDHILL_RESOURCES "/Helmet.obj");
+	}
+
+	std::printf("Job system threads: %u\n", JobSystem::Get().ThreadCount());
+
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	for (const std::string& file : files)
+	{
+		if (!LoadObjMesh(file, vertices, indices))
+		{
+			std::fprintf(stderr, "Cannot load %s\n", file.c_str());
+			return 1;
+		}
+		const size_t slash = file.find_last_of("/\\");
+		Run(file.substr(slash == std::string::npos ? 0 : slash + 1).c_str(), vertices, indices);
+	}
+
+	MakeIslandSoup(64, 64, 1, vertices, indices);
+	Run("64 islands 64x64", vertices, indices);
+	MakeIslandSoup(200, 64, 2, vertices, indices);
+	Run("200 islands 64x64", vertices, indices);
+	return 0;
+}
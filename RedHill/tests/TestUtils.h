@@ -0,0 +1,32 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+// A failed check prints where it failed and exits, so ctest reports the test as failed (asserts are compiled out in Release)
+#define RH_CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+			std::exit(1); \
+		} \
+	} while (false)
+
+// Best of repeatCount runs, in milliseconds
+template<typename Function>
+double MeasureMs(const int repeatCount, Function&& function)
+{
+	double best = 1e30;
+	for (int i = 0; i < repeatCount; ++i)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		function();
+		const auto end = std::chrono::steady_clock::now();
+		const double ms = std::chrono::duration<double, std::milli>(end - start).count();
+		best = ms < best ? ms : best;
+	}
+	return best;
+}
@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "TlsfAllocator.h"
+#include "TestUtils.h"
+
+namespace
+{
+	constexpr uint64_t KB = 1024, MB = 1024 * KB;
+
+	struct LiveRange
+	{
+		uint64_t size;
+		uint32_t handle;
+	};
+
+	// The allocation doesn't overlap the live ranges (offset -> size), stays in the region and is aligned
+	void CheckPlacement(const TlsfAllocator& allocator, const std::map<uint64_t, LiveRange>& live, const uint64_t offset, const uint64_t size, const uint64_t alignment)
+	{
+		RH_CHECK(offset % alignment == 0);
+		RH_CHECK(offset + size <= allocator.Size());
+		const auto next = live.lower_bound(offset);
+		RH_CHECK(next == live.end() || next->first >= offset + size);
+		if (next != live.begin())
+		{
+			const auto previous = std::prev(next);
+			RH_CHECK(previous->first + previous->second.size <= offset);
+		}
+	}
+
+	// Random allocations and frees in regions of random sizes with the alignments of the renderer (64KB, 4MB for MSAA)
+	// and a few bigger ones, checked against a map of the live ranges. Freeing everything must merge the region back
+	// into one block.
+	void TestFuzz()
+	{
+		constexpr uint64_t granularity = 64 * KB;
+		std::mt19937_64 random(1);
+		for (int trial = 0; trial < 20; ++trial)
+		{
+			const uint64_t regionSize = (1 + random() % 200) * granularity;
+			TlsfAllocator allocator;
+			allocator.Init(regionSize, granularity);
+
+			std::map<uint64_t, LiveRange> live;
+			uint64_t usedBytes = 0;
+			for (int i = 0; i < 50000; ++i)
+			{
+				if (live.empty() || random() % 2)
+				{
+					const uint64_t size = 1 + random() % (regionSize / 4);
+					const uint64_t alignment = granularity << (random() % 4 == 0 ? random() % 7 : 0);
+					const TlsfAllocator::Allocation allocation = allocator.Allocate(size, alignment);
+					if (allocation.handle == TlsfAllocator::kInvalidAllocation)
+					{
+						continue;
+					}
+
+					const uint64_t roundedSize = (size + granularity - 1) / granularity * granularity;
+					CheckPlacement(allocator, live, allocation.offset, roundedSize, alignment);
+					live[allocation.offset] = { roundedSize, allocation.handle };
+					usedBytes += roundedSize;
+				}
+				else
+				{
+					auto it = live.begin();
+					std::advance(it, random() % live.size());
+					allocator.Free(it->second.handle);
+					usedBytes -= it->second.size;
+					live.erase(it);
+				}
+
+				const TlsfAllocator::Stats stats = allocator.GetStats();
+				RH_CHECK(stats.usedBytes == usedBytes);
+				RH_CHECK(stats.allocationCount == live.size());
+				RH_CHECK(stats.largestFreeBlock <= stats.totalBytes - stats.usedBytes);
+			}
+
+			for (const auto& [offset, range] : live)
+			{
+				allocator.Free(range.handle);
+			}
+			const TlsfAllocator::Stats stats = allocator.GetStats();
+			RH_CHECK(stats.usedBytes == 0 && stats.freeBlockCount == 1 && stats.largestFreeBlock == regionSize);
+			RH_CHECK(stats.Fragmentation() == 0.0f);
+		}
+	}
+
+	// Trace of the resource kinds of the renderer (small buffers, meshes and textures, BC mip chains, cubemaps and
+	// render targets) in a 512MB heap, prints the fragmentation while the heap is more than half full
+	void TestResourceTrace()
+	{
+		constexpr uint64_t granularity = 64 * KB;
+		TlsfAllocator allocator;
+		allocator.Init(512 * MB, granularity);
+
+		std::mt19937_64 random(7);
+		std::map<uint64_t, LiveRange> live;
+		std::vector<uint64_t> offsets;
+		uint32_t failedCount = 0;
+		double fragmentationSum = 0.0, worstFragmentation = 0.0;
+		uint32_t sampleCount = 0;
+		for (int i = 0; i < 200000; ++i)
+		{
+			if (offsets.empty() || random() % 100 < 55)
+			{
+				uint64_t size;
+				switch (random() % 4)
+				{
+				case 0: size = 1 + random() % (256 * KB); break;
+				case 1: size = 1 + random() % (8 * MB); break;
+				case 2: size = (1 + random() % 6) * 5592 * KB; break;
+				default: size = 16 * MB + random() % (48 * MB); break;
+				}
+				const uint64_t alignment = random() % 16 == 0 ? 4 * MB : granularity;
+				const TlsfAllocator::Allocation allocation = allocator.Allocate(size, alignment);
+				if (allocation.handle == TlsfAllocator::kInvalidAllocation)
+				{
+					failedCount++;
+					continue;
+				}
+
+				const uint64_t roundedSize = (size + granularity - 1) / granularity * granularity;
+				CheckPlacement(allocator, live, allocation.offset, roundedSize, alignment);
+				live[allocation.offset] = { roundedSize, allocation.handle };
+				offsets.push_back(allocation.offset);
+			}
+			else
+			{
+				const size_t index = random() % offsets.size();
+				allocator.Free(live[offsets[index]].handle);
+				live.erase(offsets[index]);
+				offsets[index] = offsets.back();
+				offsets.pop_back();
+			}
+
+			const TlsfAllocator::Stats stats = allocator.GetStats();
+			if (i % 100 == 0 && stats.usedBytes > stats.totalBytes / 2)
+			{
+				fragmentationSum += stats.Fragmentation();
+				worstFragmentation = (std::max)(worstFragmentation, double(stats.Fragmentation()));
+				sampleCount++;
+			}
+		}
+
+		RH_CHECK(sampleCount > 0);
+		std::printf("Resource trace: %u failed allocations, fragmentation above half full: average %.3f, worst %.3f\n",
+			failedCount, fragmentationSum / sampleCount, worstFragmentation);
+	}
+
+	void TestExactFits()
+	{
+		TlsfAllocator allocator;
+		allocator.Init(64 * MB, 64 * KB);
+
+		const TlsfAllocator::Allocation whole = allocator.Allocate(64 * MB, 64 * KB);
+		RH_CHECK(whole.handle != TlsfAllocator::kInvalidAllocation && whole.offset == 0);
+		RH_CHECK(allocator.Allocate(1, 64 * KB).handle == TlsfAllocator::kInvalidAllocation);
+		allocator.Free(whole.handle);
+
+		std::vector<uint32_t> handles;
+		for (int i = 0; i < 1024; ++i)
+		{
+			const TlsfAllocator::Allocation allocation = allocator.Allocate(64 * KB, 64 * KB);
+			RH_CHECK(allocation.handle != TlsfAllocator::kInvalidAllocation);
+			handles.push_back(allocation.handle);
+		}
+		RH_CHECK(allocator.Allocate(1, 64 * KB).handle == TlsfAllocator::kInvalidAllocation);
+
+		// Every other granule free: half the space is free but nothing bigger than a granule fits
+		for (size_t i = 0; i < handles.size(); i += 2)
+		{
+			allocator.Free(handles[i]);
+		}
+		const TlsfAllocator::Stats stats = allocator.GetStats();
+		RH_CHECK(stats.freeBlockCount == 512 && stats.largestFreeBlock == 64 * KB);
+		RH_CHECK(stats.Fragmentation() > 0.99f);
+		RH_CHECK(allocator.Allocate(128 * KB, 64 * KB).handle == TlsfAllocator::kInvalidAllocation);
+	}
+}
+
+int main()
+{
+	TestFuzz();
+	TestResourceTrace();
+	TestExactFits();
+	return 0;
+}
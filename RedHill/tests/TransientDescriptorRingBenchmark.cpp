@@ -0,0 +1,123 @@
+// Contention of transient descriptor allocation from 1 to 32 recording threads: 4096 descriptors a frame split over
+// the threads, then the render thread submits and reclaims with two frames in flight. Times the recording phase (frame
+// barrier included) per descriptor for the ring in blocks of 64, the same ring grabbing every descriptor with a
+// compare exchange (blocks of 1), and a RingAllocator behind a mutex.
+//
+//   TransientDescriptorRingBenchmark [frames]
+
+#include <barrier>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "RingAllocator.h"
+#include "TransientDescriptorRing.h"
+#include "TestUtils.h"
+
+namespace
+{
+	constexpr uint32_t kFrameDescriptors = 4096;
+
+	// Nanoseconds per descriptor of the recording phase, allocate(count) runs on every thread for each frame
+	double Run(const uint32_t threadCount, const uint32_t frameCount, const std::function<void(uint32_t)>& allocate, const std::function<void(uint64_t)>& endFrame)
+	{
+		const uint32_t perThread = kFrameDescriptors / threadCount;
+		std::barrier sync(threadCount + 1);
+		std::vector<std::thread> recorders;
+		for (uint32_t thread = 0; thread < threadCount; ++thread)
+		{
+			recorders.emplace_back([&]()
+			{
+				for (uint32_t frame = 0; frame < frameCount; ++frame)
+				{
+					sync.arrive_and_wait();
+					allocate(perThread);
+					sync.arrive_and_wait();
+				}
+			});
+		}
+
+		double totalNs = 0.0;
+		for (uint64_t frame = 1; frame <= frameCount; ++frame)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			sync.arrive_and_wait();
+			sync.arrive_and_wait();
+			totalNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+			endFrame(frame);
+		}
+		for (std::thread& recorder : recorders)
+		{
+			recorder.join();
+		}
+		return totalNs / frameCount / (static_cast<double>(perThread) * threadCount);
+	}
+
+	double RunRing(const uint32_t threadCount, const uint32_t frameCount, const uint32_t blockSize)
+	{
+		// Three frames of descriptors plus a partly used block per thread and frame
+		const uint32_t capacity = 3 * kFrameDescriptors + 3 * 32 * 64;
+		TransientDescriptorRing ring;
+		ring.Init(capacity, blockSize);
+		return Run(threadCount, frameCount,
+			[&ring](const uint32_t count)
+			{
+				TransientDescriptorRing::Cursor cursor;
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					RH_CHECK(ring.Allocate(cursor, 1) != TransientDescriptorRing::kInvalidOffset);
+				}
+			},
+			[&ring](const uint64_t frame)
+			{
+				ring.Submit(frame);
+				if (frame >= 2)
+				{
+					ring.Reclaim(frame - 1);
+				}
+			});
+	}
+
+	double RunLockedRing(const uint32_t threadCount, const uint32_t frameCount)
+	{
+		RingAllocator ring;
+		ring.Init(3 * kFrameDescriptors);
+		std::mutex mutex;
+		return Run(threadCount, frameCount,
+			[&ring, &mutex](const uint32_t count)
+			{
+				for (uint32_t i = 0; i < count; ++i)
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					RH_CHECK(ring.Allocate(1, 1) != RingAllocator::kInvalidOffset);
+				}
+			},
+			[&ring](const uint64_t frame)
+			{
+				ring.Submit(frame);
+				if (frame >= 2)
+				{
+					ring.Reclaim(frame - 1);
+				}
+			});
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const uint32_t frameCount = argc > 1 ? std::atoi(argv[1]) : 300;
+	std::printf("Hardware threads: %u, ns per descriptor\n", std::thread::hardware_concurrency());
+	std::printf("threads  blocks of 64  CAS per descriptor  mutex + RingAllocator\n");
+	for (const uint32_t threadCount : { 1u, 2u, 4u, 8u, 16u, 32u })
+	{
+		const double blocks = RunRing(threadCount, frameCount, 64);
+		const double single = RunRing(threadCount, frameCount, 1);
+		const double locked = RunLockedRing(threadCount, frameCount);
+		std::printf("%7u  %12.2f  %18.2f  %21.2f\n", threadCount, blocks, single, locked);
+	}
+	return 0;
+}
@@ -0,0 +1,108 @@
+// Recording threads allocating from one transient ring with frames in flight behind a fake fence. Every descriptor
+// handed out is stamped with its frame, a stamp of a frame the GPU hasn't finished means two owners. Every few frames
+// the render thread waits for the GPU so the next grabs race on the idle reset. Build with -DREDHILL_SANITIZE=thread
+// to run it under TSan.
+//
+//   TransientDescriptorRingStressTest [frames]
+
+#include <atomic>
+#include <barrier>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "TransientDescriptorRing.h"
+#include "TestUtils.h"
+
+namespace
+{
+	void Stress(const uint32_t threadCount, const uint32_t frameCount, const uint32_t blockSize)
+	{
+		constexpr uint32_t capacity = 4096;
+		constexpr uint64_t framesInFlight = 2;
+
+		TransientDescriptorRing ring;
+		ring.Init(capacity, blockSize);
+
+		std::vector<std::atomic<uint64_t>> stamps(capacity);
+		std::atomic<uint64_t> completed = 0;
+		std::atomic<uint32_t> overlapCount = 0, outOfRangeCount = 0;
+		std::barrier sync(threadCount + 1);
+
+		std::vector<std::thread> recorders;
+		for (uint32_t thread = 0; thread < threadCount; ++thread)
+		{
+			recorders.emplace_back([&, thread]()
+			{
+				std::mt19937 random(thread * 7919 + 1);
+				for (uint64_t frame = 1; frame <= frameCount; ++frame)
+				{
+					sync.arrive_and_wait();
+
+					// A frame's worth split over the recorders, stops early when the frames in flight hold the ring
+					TransientDescriptorRing::Cursor cursor;
+					const uint32_t descriptorCount = 1 + random() % (1400 / threadCount);
+					for (uint32_t allocated = 0; allocated < descriptorCount; )
+					{
+						const uint32_t count = random() % 5 == 0 ? 1 + random() % 8 : 1;
+						const uint32_t offset = ring.Allocate(cursor, count);
+						if (offset == TransientDescriptorRing::kInvalidOffset)
+						{
+							break;
+						}
+						if (offset + count > capacity)
+						{
+							outOfRangeCount++;
+							break;
+						}
+						for (uint32_t descriptor = offset; descriptor < offset + count; ++descriptor)
+						{
+							if (stamps[descriptor].exchange(frame, std::memory_order_relaxed) > completed.load(std::memory_order_relaxed))
+							{
+								overlapCount++;
+							}
+						}
+						allocated += count;
+					}
+
+					sync.arrive_and_wait();
+				}
+			});
+		}
+
+		for (uint64_t frame = 1; frame <= frameCount; ++frame)
+		{
+			sync.arrive_and_wait();
+			sync.arrive_and_wait();
+
+			ring.Submit(frame);
+			const uint64_t reached = frame % 16 == 0 ? frame : (frame >= framesInFlight ? frame - framesInFlight + 1 : 0);
+			if (reached > completed)
+			{
+				completed = reached;
+				ring.Reclaim(reached);
+			}
+		}
+		for (std::thread& recorder : recorders)
+		{
+			recorder.join();
+		}
+
+		RH_CHECK(overlapCount == 0);
+		RH_CHECK(outOfRangeCount == 0);
+		RH_CHECK(ring.PeakDescriptors() <= capacity);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const uint32_t frameCount = argc > 1 ? std::atoi(argv[1]) : 200;
+	for (const uint32_t threadCount : { 1u, 2u, 4u, 8u, 16u, 32u })
+	{
+		Stress(threadCount, frameCount, 16);
+	}
+	Stress(8, frameCount, 1);
+	Stress(8, frameCount, 64);
+	return 0;
+}
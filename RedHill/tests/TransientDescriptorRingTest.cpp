@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "TransientDescriptorRing.h"
+#include "TestUtils.h"
+
+namespace
+{
+	// Frames recorded like the renderer does on the render thread (one cursor, blocks of one descriptor): allocate,
+	// submit with the fence value of the frame, then wait until only framesInFlight frames are queued. When the ring is
+	// full the CPU waits for the oldest frame. No descriptor is handed out while a frame the GPU hasn't finished owns it.
+	void TestFakeFence(const uint32_t capacity, const uint32_t framesInFlight, const uint32_t perFrameMax, const bool tables, const uint32_t seed)
+	{
+		TransientDescriptorRing ring;
+		ring.Init(capacity, 1);
+		TransientDescriptorRing::Cursor cursor;
+
+		std::mt19937 random(seed);
+		std::vector<uint64_t> owner(capacity, 0);		// Fence value of the frame holding the descriptor, 0 for none
+		uint64_t completed = 0;
+		uint32_t stallCount = 0;
+
+		auto Complete = [&](const uint64_t fenceValue)
+		{
+			completed = fenceValue;
+			ring.Reclaim(completed);
+			std::replace(owner.begin(), owner.end(), completed, uint64_t(0));
+		};
+
+		for (uint64_t fenceValue = 1; fenceValue <= 20000; ++fenceValue)
+		{
+			uint32_t budget = 1 + random() % perFrameMax;
+			while (budget > 0)
+			{
+				const uint32_t count = tables ? (std::min)(budget, 1 + static_cast<uint32_t>(random() % 8)) : 1;
+				budget -= count;
+
+				uint32_t offset = ring.Allocate(cursor, count);
+				while (offset == TransientDescriptorRing::kInvalidOffset)
+				{
+					// The frame itself never waits on its own fence
+					RH_CHECK(completed + 1 < fenceValue);
+					stallCount++;
+					Complete(completed + 1);
+					offset = ring.Allocate(cursor, count);
+				}
+
+				RH_CHECK(offset + count <= capacity);
+				for (uint32_t descriptor = offset; descriptor < offset + count; ++descriptor)
+				{
+					RH_CHECK(owner[descriptor] == 0);
+					owner[descriptor] = fenceValue;
+				}
+			}
+			ring.Submit(fenceValue);
+
+			while (fenceValue >= framesInFlight && completed < fenceValue - framesInFlight + 1)
+			{
+				Complete(completed + 1);
+			}
+		}
+
+		RH_CHECK(ring.PeakDescriptors() <= capacity);
+		std::printf("%4u descriptors, %u frames in flight, up to %2u a frame%s: peak %u, %u stalls\n", capacity, framesInFlight, perFrameMax,
+			tables ? " in tables" : "", ring.PeakDescriptors(), stallCount);
+	}
+
+	// Once the GPU has caught up the next grab starts at the beginning, so a frame can take the whole ring whatever the
+	// previous frames left the head at
+	void TestIdleReset()
+	{
+		TransientDescriptorRing ring;
+		ring.Init(64, 8);
+		TransientDescriptorRing::Cursor cursor;
+
+		RH_CHECK(ring.Allocate(cursor, 40) == 0);
+		ring.Submit(1);
+		RH_CHECK(ring.Allocate(cursor, 64) == TransientDescriptorRing::kInvalidOffset);
+		ring.Reclaim(1);
+		RH_CHECK(ring.Allocate(cursor, 64) == 0);
+		RH_CHECK(ring.Allocate(cursor, 1) == TransientDescriptorRing::kInvalidOffset);
+		ring.Submit(2);
+		ring.Reclaim(2);
+
+		// Partly through the ring again: blocks keep following each other while a frame is in flight
+		TransientDescriptorRing::Cursor other;
+		RH_CHECK(ring.Allocate(cursor, 20) == 0);
+		RH_CHECK(ring.Allocate(other, 1) == 24);
+		ring.Submit(3);
+		RH_CHECK(ring.Allocate(cursor, 1) == 32);
+		RH_CHECK(ring.Allocate(other, 32) == TransientDescriptorRing::kInvalidOffset);
+		ring.Submit(4);
+		ring.Reclaim(4);
+		RH_CHECK(ring.Allocate(other, 64) == 0);
+		ring.Submit(5);
+		ring.Reclaim(5);
+		RH_CHECK(ring.PeakDescriptors() == 64);
+
+		// The reset counts for every grab after the first one, not only the first: the whole ring is free again
+		TransientDescriptorRing single;
+		TransientDescriptorRing::Cursor singleCursor;
+		single.Init(8, 1);
+		for (uint32_t i = 0; i < 5; ++i)
+		{
+			RH_CHECK(single.Allocate(singleCursor, 1) == i);
+		}
+		single.Submit(1);
+		single.Reclaim(1);
+		for (uint32_t i = 0; i < 8; ++i)
+		{
+			RH_CHECK(single.Allocate(singleCursor, 1) == i);
+		}
+		RH_CHECK(single.Allocate(singleCursor, 1) == TransientDescriptorRing::kInvalidOffset);
+	}
+}
+
+int main()
+{
+	TestFakeFence(64, 2, 20, false, 1);
+	TestFakeFence(40, 2, 20, false, 2);
+	TestFakeFence(64, 2, 20, true, 3);
+	TestFakeFence(256, 3, 60, true, 4);
+	TestFakeFence(100, 3, 60, true, 5);
+	TestIdleReset();
+	return 0;
+}
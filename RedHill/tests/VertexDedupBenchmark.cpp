@@ -0,0 +1,149 @@
+// Corner dedup of the OBJ import: the FlatHashMap of Model.cpp against the std::map it replaced, on Helmet.obj and on
+// synthetic 10M index grids. Both give the same index buffer, only the time differs.
+//
+//   VertexDedupBenchmark [file.obj...]
+
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "FlatHashMap.h"
+#include "ObjParser.h"
+#include "TestUtils.h"
+
+namespace
+{
+	struct VertexKeyLess
+	{
+		bool operator()(const VertexKey& a, const VertexKey& b) const noexcept
+		{
+			if (a.posIndex == b.posIndex)
+			{
+				if (a.uvIndex == b.uvIndex)
+				{
+					return a.normIndex < b.normIndex;
+				}
+				return a.uvIndex < b.uvIndex;
+			}
+			return a.posIndex < b.posIndex;
+		}
+	};
+
+	// The loop of GenerateVertexAndIndexFromObj, the vertex itself is left out (same cost for both maps)
+	void DedupFlat(const std::vector<ObjCorner>& corners, std::vector<uint32_t>& indices, uint32_t& vertexCount)
+	{
+		indices.clear();
+		indices.reserve(corners.size());
+		vertexCount = 0;
+
+		FlatHashMap<VertexKey, uint32_t, VertexKeyHash> vertexMap(corners.size());
+		for (const ObjCorner& idx : corners)
+		{
+			bool inserted = false;
+			const uint32_t vertexIndex = vertexMap.FindOrInsert({ idx.posIndex, idx.uvIndex, idx.normIndex }, vertexCount, inserted);
+			vertexCount += inserted ? 1 : 0;
+			indices.push_back(vertexIndex);
+		}
+	}
+
+	// The baseline loop, find and then insert through operator[]
+	void DedupTree(const std::vector<ObjCorner>& corners, std::vector<uint32_t>& indices, uint32_t& vertexCount)
+	{
+		indices.clear();
+		vertexCount = 0;
+
+		std::map<VertexKey, uint32_t, VertexKeyLess> vertexMap;
+		for (const ObjCorner& idx : corners)
+		{
+			const VertexKey key{ idx.posIndex, idx.uvIndex, idx.normIndex };
+			auto it = vertexMap.find(key);
+			if (it == vertexMap.end())
+			{
+				vertexMap[key] = vertexCount;
+				indices.push_back(vertexCount++);
+			}
+			else
+			{
+				indices.push_back(it->second);
+			}
+		}
+	}
+
+	// Grid of quads with at least indexCount indices. Smooth grids share every corner between 6 triangles, faceted ones
+	// have a normal per quad like an OBJ exported with flat shading (4 vertices a quad).
+	std::vector<ObjCorner> MakeGrid(const size_t indexCount, const bool faceted)
+	{
+		size_t side = 2;
+		while ((side - 1) * (side - 1) * 6 < indexCount)
+		{
+			++side;
+		}
+
+		std::vector<ObjCorner> corners;
+		corners.reserve((side - 1) * (side - 1) * 6);
+		for (size_t y = 0; y + 1 < side; ++y)
+		{
+			for (size_t x = 0; x + 1 < side; ++x)
+			{
+				const int32_t quad = static_cast<int32_t>(y * (side - 1) + x);
+				const int32_t v00 = static_cast<int32_t>(y * side + x);
+				const int32_t v10 = v00 + 1;
+				const int32_t v01 = v00 + static_cast<int32_t>(side);
+				const int32_t v11 = v01 + 1;
+				for (const int32_t v : { v00, v10, v11, v00, v11, v01 })
+				{
+					corners.push_back({ v, v, faceted ? quad : v });
+				}
+			}
+		}
+		return corners;
+	}
+
+	void Run(const char* name, const std::vector<ObjCorner>& corners)
+	{
+		std::vector<uint32_t> flatIndices, treeIndices;
+		uint32_t flatVertices = 0, treeVertices = 0;
+
+		const int repeatCount = corners.size() > 1000000 ? 2 : 10;
+		const double flatMs = MeasureMs(repeatCount, [&]() { DedupFlat(corners, flatIndices, flatVertices); });
+		const double treeMs = MeasureMs(repeatCount, [&]() { DedupTree(corners, treeIndices, treeVertices); });
+
+		RH_CHECK(flatVertices == treeVertices);
+		RH_CHECK(flatIndices == treeIndices);
+
+		std::printf("%-24s %10zu %10u %12.2f %12.2f %8.2fx\n", name, corners.size(), flatVertices, treeMs, flatMs, treeMs / flatMs);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> files;
+	for (int i = 1; i < argc; ++i)
+	{
+		files.push_back(argv[i]);
+	}
+	if (files.empty())
+	{
+		files.push_back(REDHILL_RESOURCES "/Helmet.obj");
+	}
+
+	std::printf("%-24s %10s %10s %12s %12s %9s\n", "mesh", "indices", "vertices", "std::map ms", "flat ms", "speedup");
+
+	for (const std::string& file : files)
+	{
+		ObjData obj;
+		std::string error;
+		if (!ObjParser::ParseFromFile(file, obj, error))
+		{
+			std::fprintf(stderr, "%s", error.c_str());
+			return 1;
+		}
+		const size_t slash = file.find_last_of("/\\");
+		Run(file.substr(slash == std::string::npos ? 0 : slash + 1).c_str(), obj.corners);
+	}
+
+	Run("grid 10M smooth", MakeGrid(10000000, false));
+	Run("grid 10M faceted", MakeGrid(10000000, true));
+	return 0;
+}
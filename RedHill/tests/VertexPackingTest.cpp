@@ -0,0 +1,155 @@
+#include <cmath>
+#include <random>
+
+#include "MeshFixtures.h"
+#include "TangentSpace.h"
+#include "VertexPacking.h"
+#include "TestUtils.h"
+
+namespace
+{
+	// 16 bit snorm octahedral directions are within this of the source direction (measured max about 0.004 degrees)
+	constexpr float kMaxDirectionDegrees = 0.01f;
+
+	void RandomDirection(std::mt19937& random, float out[3])
+	{
+		std::normal_distribution<float> gaussian;
+		float length = 0.0f;
+		while (length < 1e-3f)
+		{
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				out[axis] = gaussian(random);
+			}
+			length = std::sqrt(out[0] * out[0] + out[1] * out[1] + out[2] * out[2]);
+		}
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			out[axis] /= length;
+		}
+	}
+
+	float AngleDegrees(const float a[3], const float b[3])
+	{
+		const double cx = double(a[1]) * b[2] - double(a[2]) * b[1];
+		const double cy = double(a[2]) * b[0] - double(a[0]) * b[2];
+		const double cz = double(a[0]) * b[1] - double(a[1]) * b[0];
+		const double cosAngle = double(a[0]) * b[0] + double(a[1]) * b[1] + double(a[2]) * b[2];
+		return static_cast<float>(std::atan2(std::sqrt(cx * cx + cy * cy + cz * cz), cosAngle) * 57.29577951308232);
+	}
+
+	// Every component against its own quantization step: half a unorm step of the bounds for the positions, half an ulp
+	// of a half float for the uvs, the octahedral bound for the directions and the exact tangent sign
+	void CheckRoundTrip(const std::vector<Vertex>& vertices)
+	{
+		const VertexQuantization quantization = ComputeVertexQuantization(vertices);
+		std::vector<PackedVertex> packed;
+		PackVertices(vertices, quantization, packed);
+		RH_CHECK(packed.size() == vertices.size());
+
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			const Vertex& source = vertices[i];
+			const Vertex decoded = UnpackVertex(packed[i], quantization);
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				const float step = quantization.scale[axis] / 65535.0f;
+				RH_CHECK(std::fabs(decoded.position[axis] - source.position[axis]) <= 0.5f * step + 1e-6f * quantization.scale[axis]);
+			}
+			for (int axis = 0; axis < 2; ++axis)
+			{
+				RH_CHECK(std::fabs(decoded.uv[axis] - source.uv[axis]) <= (std::max)(std::fabs(source.uv[axis]) * 0x1p-11f, 0x1p-25f));
+			}
+			RH_CHECK(AngleDegrees(source.normal, decoded.normal) <= kMaxDirectionDegrees);
+			RH_CHECK(AngleDegrees(source.tangent, decoded.tangent) <= kMaxDirectionDegrees);
+			RH_CHECK((decoded.tangent[3] < 0.0f) == (source.tangent[3] < 0.0f));
+
+			// The decoded vertex packs back to the same bits, so a cooked mesh can be re-packed without drifting
+			const PackedVertex repacked = PackVertex(decoded, quantization);
+			for (int axis = 0; axis < 4; ++axis)
+			{
+				RH_CHECK(repacked.position[axis] == packed[i].position[axis]);
+			}
+			RH_CHECK(repacked.uv[0] == packed[i].uv[0] && repacked.uv[1] == packed[i].uv[1]);
+		}
+
+		const VertexPackingError error = MeasureVertexPackingError(vertices, packed, quantization);
+		RH_CHECK(error.maxNormalAngle <= kMaxDirectionDegrees);
+		RH_CHECK(error.maxTangentAngle <= kMaxDirectionDegrees);
+		RH_CHECK(error.tangentSignErrors == 0);
+		std::printf("%zu vertices: position max %.3g avg %.3g, uv max %.3g, normal max %.4f avg %.4f deg, tangent max %.4f deg\n",
+			vertices.size(), error.maxPosition, error.avgPosition, error.maxUv, error.maxNormalAngle, error.avgNormalAngle, error.maxTangentAngle);
+	}
+
+	void TestRandomVertices()
+	{
+		std::mt19937 random(7);
+		std::uniform_real_distribution<float> position(-40.0f, 25.0f);
+		std::uniform_real_distribution<float> uv(-2.0f, 3.0f);
+		std::vector<Vertex> vertices(100000);
+		for (Vertex& v : vertices)
+		{
+			for (float& p : v.position)
+			{
+				p = position(random);
+			}
+			v.uv[0] = uv(random);
+			v.uv[1] = uv(random);
+			RandomDirection(random, v.normal);
+			RandomDirection(random, v.tangent);
+			v.tangent[3] = random() & 1 ? 1.0f : -1.0f;
+		}
+
+		// The axes and the diagonals hit the folds of the octahedral mapping
+		const float axes[][3] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 },
+			{ 0.57735027f, 0.57735027f, -0.57735027f }, { -0.57735027f, -0.57735027f, -0.57735027f }, { 0.70710678f, 0, -0.70710678f } };
+		for (size_t i = 0; i < std::size(axes); ++i)
+		{
+			std::copy_n(axes[i], 3, vertices[i].normal);
+			std::copy_n(axes[std::size(axes) - 1 - i], 3, vertices[i].tangent);
+		}
+		CheckRoundTrip(vertices);
+	}
+
+	void TestFlatMesh()
+	{
+		// The floor: y is flat, it has to come back exact
+		std::vector<Vertex> vertices(4);
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			vertices[i].position[0] = i & 1 ? 10.0f : -10.0f;
+			vertices[i].position[1] = -1.5f;
+			vertices[i].position[2] = i & 2 ? 10.0f : -10.0f;
+			vertices[i].normal[1] = 1.0f;
+			vertices[i].tangent[0] = 1.0f;
+			vertices[i].tangent[3] = 1.0f;
+		}
+		CheckRoundTrip(vertices);
+
+		const VertexQuantization quantization = ComputeVertexQuantization(vertices);
+		for (const Vertex& v : vertices)
+		{
+			const Vertex decoded = UnpackVertex(PackVertex(v, quantization), quantization);
+			RH_CHECK(decoded.position[1] == -1.5f);
+			RH_CHECK(decoded.position[0] == v.position[0] && decoded.position[2] == v.position[2]);
+			RH_CHECK(decoded.normal[1] == 1.0f && decoded.tangent[0] == 1.0f);
+		}
+	}
+
+	void TestHelmet()
+	{
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		RH_CHECK(LoadObjMesh(REDHILL_RESOURCES "/Helmet.obj", vertices, indices));
+		GenerateTangents(vertices, indices);
+		CheckRoundTrip(vertices);
+	}
+}
+
+int main()
+{
+	TestRandomVertices();
+	TestFlatMesh();
+	TestHelmet();
+	return 0;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+// What the device free sources use of windows.h, so they build with g++ / clang for the headless tests.
+// Only in the include path of the tests on other platforms.
+
+#include <csignal>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdio>
+
+inline void OutputDebugStringA(const char* message)
+{
+	std::fputs(message, stderr);
+}
+
+inline void __debugbreak()
+{
+	std::raise(SIGTRAP);
+}
+
+template<size_t Size>
+int sprintf_s(char (&buffer)[Size], const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	const int result = std::vsnprintf(buffer, Size, format, args);
+	va_end(args);
+	return result;
+}